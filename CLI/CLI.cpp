@@ -153,18 +153,11 @@ int main( int argc, char* argv[] )
 						source += newLine + "\n";
 				}
 
-				auto astNodes = QScript::GenerateAST( source );
+				Compiler::NodeArena arena;
+				auto astNodes = QScript::GenerateAST( source, &arena );
 
 				for ( auto node : astNodes )
 					std::cout << node->ToJson() << std::endl;
-
-				for ( auto node : astNodes )
-				{
-					node->Release();
-					delete node;
-				}
-
-				// NOTE: Currently leaks memory for values nested in astNodes tree
 			}
 			EXCEPTION_HANDLING;
 
@@ -172,6 +165,46 @@ int main( int argc, char* argv[] )
 				break;
 		}
 	}
+	else if ( GetArg( "--compile-out", argc, argv, &next ) )
+	{
+		QScript::FunctionObject* function = NULL;
+		std::string outputPath = next;
+		std::string unused;
+
+		// --strip leaves out debug symbols
+		QScript::Config_t config( !GetArg( "--strip", argc, argv, &unused ) );
+
+		// --optimize runs the AST optimizer passes
+		if ( GetArg( "--optimize", argc, argv, &unused ) )
+			config.m_CompilerFlags = QScript::Config_t::OF_ALL;
+
+		try
+		{
+			if ( outputPath.length() == 0 )
+				throw Exception( "cli_no_output", "Missing output path for --compile-out" );
+
+			function = QScript::Compile( input, config );
+			QScript::SaveBytecode( *function, outputPath, config.m_DebugSymbols );
+		}
+		EXCEPTION_HANDLING;
+
+		if ( function )
+			QScript::FreeFunction( function );
+	}
+	else if ( GetArg( "--bytecode", argc, argv, &next ) )
+	{
+		QScript::FunctionObject* function = NULL;
+
+		try
+		{
+			function = QScript::LoadBytecode( next );
+			QScript::Interpret( *function );
+		}
+		EXCEPTION_HANDLING;
+
+		if ( function )
+			QScript::FreeFunction( function );
+	}
 	else
 	{
 		if ( input.length() == 0 )
@@ -179,15 +212,52 @@ int main( int argc, char* argv[] )
 
 		QScript::FunctionObject* function = NULL;
 
+		// --cache <dir> reuses compilations from earlier runs
+		bool useCache = GetArg( "--cache", argc, argv, &next ) && next.length() > 0;
+
+		if ( useCache )
+			QScript::SetCompileCacheDirectory( next );
+
+		QScript::Config_t config( true );
+
+		if ( GetArg( "--optimize", argc, argv, &next ) )
+			config.m_CompilerFlags = QScript::Config_t::OF_ALL;
+
+		// --lazy compiles top-level functions when they are first called
+		if ( GetArg( "--lazy", argc, argv, &next ) )
+			config.m_LazyCompilation = true;
+
+		// --superinstructions <count> prints superinstructions for the opcode sequences of this
+		// run. Sequences are only recorded by QVM_PROFILE builds, and code is profiled without
+		// the current superinstructions so that their parts show up.
+		std::string superinstructions;
+		bool generateSuperinstructions = GetArg( "--superinstructions", argc, argv, &superinstructions );
+
+		if ( generateSuperinstructions )
+			config.m_CompilerFlags = QScript::Config_t::OF_ALL & ~QScript::Config_t::OF_SUPERINSTRUCTIONS;
+
 		try
 		{
-			function = QScript::Compile( input );
-			QScript::Interpret( *function );
+			function = useCache ? QScript::CompileCached( input, config ) : QScript::Compile( input, config );
+			QScript::Interpret( *function, config );
 		}
 		EXCEPTION_HANDLING;
 
 		if ( function )
 			QScript::FreeFunction( function );
+
+		if ( generateSuperinstructions )
+		{
+			int count = superinstructions.length() > 0 ? std::atoi( superinstructions.c_str() ) : 16;
+			std::cout << QScript::GenerateSuperinstructions( count );
+		}
+
+		if ( GetArg( "--cache-stats", argc, argv, &next ) )
+		{
+			auto stats = QScript::CompileCacheStats();
+			std::cout << "Compile cache: " << stats.m_MemoryHits << " memory hits, " << stats.m_DiskHits
+				<< " disk hits, " << stats.m_Misses << " misses" << std::endl;
+		}
 	}
 
 	return 0;
@@ -94,7 +94,94 @@ fmt(OP_SET_PROP_STACK), \
 fmt(OP_SET_PROP_LONG), \
 fmt(OP_SET_UPVALUE_SHORT), \
 fmt(OP_SET_UPVALUE_LONG), \
-fmt(OP_SUB),
+fmt(OP_SUB), \
+fmt(OP_STORE_GLOBAL_SHORT), \
+fmt(OP_STORE_GLOBAL_LONG), \
+fmt(OP_STORE_LOCAL_SHORT), \
+fmt(OP_STORE_LOCAL_LONG), \
+fmt(OP_STORE_LOCAL_0), \
+fmt(OP_STORE_LOCAL_1), \
+fmt(OP_STORE_LOCAL_2), \
+fmt(OP_STORE_LOCAL_3), \
+fmt(OP_STORE_LOCAL_4), \
+fmt(OP_STORE_LOCAL_5), \
+fmt(OP_STORE_LOCAL_6), \
+fmt(OP_STORE_LOCAL_7), \
+fmt(OP_STORE_LOCAL_8), \
+fmt(OP_STORE_LOCAL_9), \
+fmt(OP_STORE_LOCAL_10), \
+fmt(OP_STORE_LOCAL_11), \
+fmt(OP_JUMP_IF_NOT_LT_SHORT), \
+fmt(OP_JUMP_IF_NOT_LE_SHORT), \
+fmt(OP_JUMP_IF_NOT_GT_SHORT), \
+fmt(OP_JUMP_IF_NOT_GE_SHORT), \
+fmt(OP_JUMP_IF_NOT_EQ_SHORT), \
+fmt(OP_JUMP_IF_NOT_NE_SHORT), \
+fmt(OP_JUMP_IF_NOT_LT_LONG), \
+fmt(OP_JUMP_IF_NOT_LE_LONG), \
+fmt(OP_JUMP_IF_NOT_GT_LONG), \
+fmt(OP_JUMP_IF_NOT_GE_LONG), \
+fmt(OP_JUMP_IF_NOT_EQ_LONG), \
+fmt(OP_JUMP_IF_NOT_NE_LONG), \
+fmt(OP_JUMP_IF_NOT_LT_LOCAL_CONSTANT), \
+fmt(OP_JUMP_IF_NOT_LE_LOCAL_CONSTANT), \
+fmt(OP_JUMP_IF_NOT_GT_LOCAL_CONSTANT), \
+fmt(OP_JUMP_IF_NOT_GE_LOCAL_CONSTANT), \
+fmt(OP_JUMP_IF_NOT_EQ_LOCAL_CONSTANT), \
+fmt(OP_JUMP_IF_NOT_NE_LOCAL_CONSTANT), \
+fmt(OP_JUMP_IF_NOT_LT_LOCAL_LOCAL), \
+fmt(OP_JUMP_IF_NOT_LE_LOCAL_LOCAL), \
+fmt(OP_JUMP_IF_NOT_GT_LOCAL_LOCAL), \
+fmt(OP_JUMP_IF_NOT_GE_LOCAL_LOCAL), \
+fmt(OP_JUMP_IF_NOT_EQ_LOCAL_LOCAL), \
+fmt(OP_JUMP_IF_NOT_NE_LOCAL_LOCAL), \
+fmt(OP_CALL_DIRECT_SHORT), \
+fmt(OP_CALL_DIRECT_LONG), \
+fmt(OP_CALL_SELF), \
+fmt(OP_CREATE_CLASS_SHORT), \
+fmt(OP_CREATE_CLASS_LONG), \
+fmt(OP_CLASS_FIELD_SHORT), \
+fmt(OP_CLASS_FIELD_LONG), \
+fmt(OP_CLASS_METHOD_SHORT), \
+fmt(OP_CLASS_METHOD_LONG), \
+fmt(OP_INVOKE_SHORT), \
+fmt(OP_INVOKE_LONG), \
+fmt(OP_CLASS_NUMBER_FIELD_SHORT), \
+fmt(OP_CLASS_NUMBER_FIELD_LONG), \
+fmt(OP_LOAD_SLOT), \
+fmt(OP_SET_SLOT), \
+fmt(OP_SET_SLOT_NUMBER), \
+fmt(OP_TAIL_CALL), \
+fmt(OP_TAIL_CALL_SELF), \
+QS_SUPERINSTRUCTIONS( _QS_SUPERINSTRUCTION_OPCODE, fmt )
+
+// Superinstructions run a sequence of up to four instructions with a single dispatch, unused
+// parts are OP_NOP. Operands of the parts follow the opcode in order, a jump can only be the
+// last part. The compiler emits them in the peephole pass (OF_SUPERINSTRUCTIONS).
+//
+// The list is generated from opcode sequence counts of a QVM_PROFILE build running
+// OSX/superinstructions.qss, see QScript::GenerateSuperinstructions. That workload is a set of
+// micro-benchmarks (recursive fib, counting and collatz loops, an array scan and string
+// building), so the set favours function-local loop arithmetic. Regenerate it from code closer
+// to your own scripts when that differs. Regenerating changes the opcode numbering of
+// superinstructions, compiled bytecode records the set it was built with.
+#define QS_SUPERINSTRUCTIONS( fmt, arg ) \
+fmt( arg, OP_LOAD_LOCAL_3_LOAD_1_ADD_STORE_LOCAL_3, OP_LOAD_LOCAL_3, OP_LOAD_1, OP_ADD, OP_STORE_LOCAL_3 ) \
+fmt( arg, OP_LOAD_LOCAL_2_LOAD_2_MOD_LOAD_0, OP_LOAD_LOCAL_2, OP_LOAD_2, OP_MOD, OP_LOAD_0 ) \
+fmt( arg, OP_LOAD_LOCAL_2_LOAD_LOCAL_3_LOAD_2_MUL, OP_LOAD_LOCAL_2, OP_LOAD_LOCAL_3, OP_LOAD_2, OP_MUL ) \
+fmt( arg, OP_LOAD_LOCAL_2_LOAD_CONSTANT_SHORT_MUL_STORE_LOCAL_2, OP_LOAD_LOCAL_2, OP_LOAD_CONSTANT_SHORT, OP_MUL, OP_STORE_LOCAL_2 ) \
+fmt( arg, OP_ADD_STORE_LOCAL_2, OP_ADD, OP_STORE_LOCAL_2, OP_NOP, OP_NOP ) \
+fmt( arg, OP_LOAD_LOCAL_2_LOAD_3_MUL_LOAD_1, OP_LOAD_LOCAL_2, OP_LOAD_3, OP_MUL, OP_LOAD_1 ) \
+fmt( arg, OP_LOAD_LOCAL_0_LOAD_LOCAL_1_LOAD_1_SUB, OP_LOAD_LOCAL_0, OP_LOAD_LOCAL_1, OP_LOAD_1, OP_SUB ) \
+fmt( arg, OP_LOAD_LOCAL_0_LOAD_LOCAL_1_LOAD_2_SUB, OP_LOAD_LOCAL_0, OP_LOAD_LOCAL_1, OP_LOAD_2, OP_SUB ) \
+fmt( arg, OP_LOAD_LOCAL_1_LOAD_1_ADD_STORE_LOCAL_1, OP_LOAD_LOCAL_1, OP_LOAD_1, OP_ADD, OP_STORE_LOCAL_1 ) \
+fmt( arg, OP_LOAD_LOCAL_4_LOAD_1_ADD_STORE_LOCAL_4, OP_LOAD_LOCAL_4, OP_LOAD_1, OP_ADD, OP_STORE_LOCAL_4 ) \
+fmt( arg, OP_LOAD_LOCAL_1_LOAD_CONSTANT_SHORT_MOD, OP_LOAD_LOCAL_1, OP_LOAD_CONSTANT_SHORT, OP_MOD, OP_NOP ) \
+fmt( arg, OP_LOAD_LOCAL_1_LOAD_0, OP_LOAD_LOCAL_1, OP_LOAD_0, OP_NOP, OP_NOP ) \
+fmt( arg, OP_LOAD_LOCAL_5_STORE_LOCAL_3_POP, OP_LOAD_LOCAL_5, OP_STORE_LOCAL_3, OP_POP, OP_NOP ) \
+
+#define _QS_SUPERINSTRUCTION_OPCODE( fmt, name, a, b, c, d ) fmt(name),
+#define _QS_SUPERINSTRUCTION_COUNT( arg, name, a, b, c, d ) + 1
 
 #define QS_OPCODE_PLAIN( opcode ) opcode
 
@@ -108,6 +195,10 @@ namespace QScript
 		OP_CALL_MAX = OP_CALL_7 - OP_CALL,
 		OP_LOAD_LOCAL_MAX = OP_LOAD_LOCAL_11 - OP_LOAD_LOCAL_0 + 1,
 		OP_SET_LOCAL_MAX = OP_SET_LOCAL_11 - OP_SET_LOCAL_0 + 1,
+		OP_STORE_LOCAL_MAX = OP_STORE_LOCAL_11 - OP_STORE_LOCAL_0 + 1,
+		OP_JUMP_IF_NOT_MAX = OP_JUMP_IF_NOT_NE_SHORT - OP_JUMP_IF_NOT_LT_SHORT + 1,
+		OP_SUPERINSTRUCTION_COUNT = 0 QS_SUPERINSTRUCTIONS( _QS_SUPERINSTRUCTION_COUNT, _ ),
+		OP_SUPERINSTRUCTION_FIRST = OP_OPCODE_COUNT - OP_SUPERINSTRUCTION_COUNT,
 	};
 }
 
@@ -9,6 +9,8 @@
 #endif
 
 #include <string>
+#include <cstring>
+#include <cmath>
 #include <vector>
 #include <numeric>
 #include <algorithm>
@@ -16,7 +18,9 @@
 #include <exception>
 #include <regex>
 #include <map>
+#include <list>
 #include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 #include <iomanip>
 #include <stdbool.h>
@@ -26,6 +30,12 @@
 #include <fstream>
 #include <cassert>
 #include <string_view>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <atomic>
 
 #include "QScript.h"
 #include "Exception.h"
@@ -15,6 +15,7 @@ struct VM_t;
 namespace Compiler
 {
 	class BaseNode;
+	class NodeArena;
 	struct Variable_t;
 
 	std::string TypeToString( uint32_t type );
@@ -35,15 +36,27 @@ namespace QScript
 	{
 		enum OptimizationFlags : uint8_t
 		{
-			OF_NONE = 0,
+			OF_NONE						= ( 0 << 0 ),
+			OF_CONSTANT_FOLDING			= ( 1 << 0 ),	// Evaluate constant expressions at compile time
+			OF_DEAD_CODE				= ( 1 << 1 ),	// Drop constant-condition branches and code after return
+			OF_STRENGTH_REDUCTION		= ( 1 << 2 ),	// Replace operations with cheaper equivalents
+			OF_PEEPHOLE					= ( 1 << 3 ),	// Rewrite instruction sequences of the generated bytecode
+			OF_SUPERINSTRUCTIONS		= ( 1 << 4 ),	// Fuse frequent instruction sequences, see QS_SUPERINSTRUCTIONS
+			OF_ALL						= OF_CONSTANT_FOLDING | OF_DEAD_CODE | OF_STRENGTH_REDUCTION | OF_PEEPHOLE | OF_SUPERINSTRUCTIONS,
 		};
 
+		static const uint32_t s_DefaultCallDepth = 100000;
+		static const uint32_t s_DefaultStackSize = sizeof( void* ) == 8 ? 1 << 24 : 1 << 20;
+
 		Config_t( bool debugSymbols )
 		{
 			m_CompilerFlags = OF_NONE;
 			m_DebugSymbols = debugSymbols;
+			m_LazyCompilation = false;
 			m_IdentifierCb = NULL;
 			m_ImportCb = NULL;
+			m_MaxCallDepth = s_DefaultCallDepth;
+			m_MaxStackSize = s_DefaultStackSize;
 		}
 
 		Config_t( const Config_t& other )
@@ -51,26 +64,77 @@ namespace QScript
 			m_CompilerFlags = other.m_CompilerFlags;
 			m_Globals = other.m_Globals;
 			m_DebugSymbols = other.m_DebugSymbols;
+			m_LazyCompilation = other.m_LazyCompilation;
 			m_IdentifierCb = other.m_IdentifierCb;
 			m_ImportCb = other.m_ImportCb;
+			m_MaxCallDepth = other.m_MaxCallDepth;
+			m_MaxStackSize = other.m_MaxStackSize;
 		}
 
 		uint8_t							m_CompilerFlags;
 		std::vector< std::string >		m_Globals;
 		bool							m_DebugSymbols;
+
+		// Generate code for functions declared at the top level of a script on their first call.
+		// Errors in their bodies are raised when they are called, as runtime exceptions.
+		// Ignored when m_IdentifierCb is set, it has to see every identifier.
+		bool							m_LazyCompilation;
 		IdentifierCreatedFn				m_IdentifierCb;
 		ImportCreatedFn					m_ImportCb;
+
+		// Frames a VM preallocates, calls nested any deeper raise rt_stack_overflow
+		uint32_t						m_MaxCallDepth;
+
+		// Values the stack of a VM can hold. Only address space is reserved for them, memory is
+		// committed as the stack grows. Growing past the reservation raises rt_stack_overflow.
+		uint32_t						m_MaxStackSize;
+	};
+
+	struct CompileCacheStats_t
+	{
+		uint64_t						m_MemoryHits;
+		uint64_t						m_DiskHits;
+		uint64_t						m_Misses;
 	};
 
 	Chunk_t* AllocChunk();
 	FunctionObject* Compile( const std::string& source, const Config_t& config = Config_t( true ) );
+
+	// Compile through a cache keyed by the source, config and compiler version. Returned
+	// functions are owned by the caller. The disk tier is off until a directory is set.
+	FunctionObject* CompileCached( const std::string& source, const Config_t& config = Config_t( true ) );
+	void SetCompileCacheDirectory( const std::string& directory );
+	void SetCompileCacheCapacity( size_t entries );
+	void ClearCompileCache();
+	CompileCacheStats_t CompileCacheStats();
 	std::vector< std::pair< uint32_t, uint32_t > > Typer( const std::string& source, const Config_t& config = Config_t( false ) );
-	std::vector< Compiler::BaseNode* > GenerateAST( const std::string& source );
+	// Nodes (and values in them) are owned by the arena and freed with it
+	std::vector< Compiler::BaseNode* > GenerateAST( const std::string& source, Compiler::NodeArena* arena );
 
 	void FreeChunk( Chunk_t* chunk );
 	void FreeFunction( FunctionObject* function );
 
+	// Compiled bytecode files (.qsc). Loaded code is mapped from the file and executed in
+	// place, the mapping lives until every function of the file has been freed.
+	void SaveBytecode( const FunctionObject& function, const std::string& path, bool debugSymbols = true );
+	FunctionObject* LoadBytecode( const std::string& path );
+
+	// QS_SUPERINSTRUCTIONS entries for the opcode sequences that saved the most dispatches in
+	// every VM released so far. Sequences are only recorded by QVM_PROFILE builds.
+	std::string GenerateSuperinstructions( int maxCount );
+
 	void Repl();
 	void Interpret( const FunctionObject& function );
+	void Interpret( const FunctionObject& function, const Config_t& config );
 	void Interpret( VM_t& vm, Value* exitCode );
+
+	// Call a global function of an already initialized VM
+	Value CallFunction( VM_t& vm, const std::string& name, const std::vector< Value >& args );
+
+	// Snapshots run the top-level code of a script once, and store the resulting heap. Loading
+	// a snapshot skips compilation and initialization. Snapshots are only valid for the build
+	// that created them.
+	std::vector< uint8_t > CreateSnapshot( const FunctionObject& function );
+	VM_t* LoadSnapshot( const std::vector< uint8_t >& snapshot );
+	void FreeSnapshot( VM_t* vm );
 }
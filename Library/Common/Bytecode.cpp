@@ -0,0 +1,480 @@
+#include "QLibPCH.h"
+#include "Chunk.h"
+#include "Serializer.h"
+#include "Bytecode.h"
+#include "Instructions.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bytecode file (.qsc) layout:
+//   Header_t
+//   Superinstruction set  (version 3 and up)
+//   Function table   (name, upvalues, flags (version 4 and up), arguments, code location,
+//                     constants, debug symbols)
+//   Code section     (bytecode of every function, executed in place once mapped)
+//
+// Functions are stored depth-first, main function first. Function constants refer to
+// other functions by their index in the table, and so do references to shared closures.
+
+namespace Bytecode
+{
+	static const uint32_t s_Magic = 0x31435351; // "QSC1"
+	static const uint32_t s_Version = 4;
+	// Opcodes are only ever appended, older files run unchanged
+	static const uint32_t s_MinVersion = 1;
+	static const uint32_t s_CodeAlignment = 16;
+
+	enum HeaderFlags : uint32_t
+	{
+		HF_NONE = 0,
+		HF_DEBUG_SYMBOLS = ( 1 << 0 ),
+	};
+
+	enum FunctionFlags : uint8_t
+	{
+		FF_NONE = 0,
+		FF_SHARED_CLOSURE = ( 1 << 0 ),
+	};
+
+	enum ConstantTag : uint8_t
+	{
+		CTAG_NULL,
+		CTAG_BOOL,
+		CTAG_NUMBER,
+		CTAG_STRING,
+		CTAG_FUNCTION,
+		CTAG_CLOSURE,
+	};
+
+	#define _BYTECODE_SUPERINSTRUCTION( arg, name, a, b, c, d ) #name " " #a " " #b " " #c " " #d ";"
+
+	// Superinstructions are numbered after every other opcode, and the list can be regenerated.
+	// Code is only valid for the same opcodes and the same list.
+	static uint32_t SuperinstructionSet()
+	{
+		const char* list = "" QS_SUPERINSTRUCTIONS( _BYTECODE_SUPERINSTRUCTION, _ );
+
+		// FNV-1a
+		uint32_t hash = 2166136261u ^ ( uint32_t ) QScript::OpCode::OP_SUPERINSTRUCTION_FIRST;
+		for ( const char* c = list; *c; ++c )
+			hash = ( hash ^ ( uint8_t ) *c ) * 16777619u;
+
+		return hash;
+	}
+
+	struct Header_t
+	{
+		uint32_t		m_Magic;
+		uint32_t		m_Version;
+		uint32_t		m_Flags;
+		uint32_t		m_NumFunctions;
+		uint64_t		m_CodeOffset;
+		uint64_t		m_CodeSize;
+	};
+
+	// Read-only view of a file, written pages are private to this process
+	class MappedFile_t
+	{
+	public:
+		MappedFile_t( const std::string& path )
+		{
+			m_Data = NULL;
+			m_Size = 0;
+
+#ifdef _WIN32
+			m_File = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+			m_Mapping = NULL;
+
+			if ( m_File == INVALID_HANDLE_VALUE )
+				throw Exception( "bytecode_no_file", "File \"" + path + "\" could not be opened" );
+
+			LARGE_INTEGER size;
+			GetFileSizeEx( m_File, &size );
+			m_Size = ( size_t ) size.QuadPart;
+
+			if ( m_Size > 0 )
+			{
+				m_Mapping = CreateFileMappingA( m_File, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+
+				if ( m_Mapping )
+					m_Data = ( uint8_t* ) MapViewOfFile( m_Mapping, FILE_MAP_COPY, 0, 0, 0 );
+
+				if ( !m_Data )
+				{
+					Close();
+					throw Exception( "bytecode_no_file", "File \"" + path + "\" could not be mapped" );
+				}
+			}
+#else
+			int file = open( path.c_str(), O_RDONLY );
+
+			if ( file < 0 )
+				throw Exception( "bytecode_no_file", "File \"" + path + "\" could not be opened" );
+
+			struct stat info;
+			if ( fstat( file, &info ) == 0 )
+				m_Size = ( size_t ) info.st_size;
+
+			if ( m_Size > 0 )
+			{
+				auto data = mmap( NULL, m_Size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0 );
+
+				if ( data == MAP_FAILED )
+				{
+					close( file );
+					throw Exception( "bytecode_no_file", "File \"" + path + "\" could not be mapped" );
+				}
+
+				m_Data = ( uint8_t* ) data;
+			}
+
+			close( file );
+#endif
+		}
+
+		~MappedFile_t()
+		{
+			Close();
+		}
+
+		uint8_t*		m_Data;
+		size_t			m_Size;
+
+	private:
+		void Close()
+		{
+#ifdef _WIN32
+			if ( m_Data )
+				UnmapViewOfFile( m_Data );
+
+			if ( m_Mapping )
+				CloseHandle( m_Mapping );
+
+			CloseHandle( m_File );
+#else
+			if ( m_Data )
+				munmap( m_Data, m_Size );
+#endif
+			m_Data = NULL;
+		}
+
+#ifdef _WIN32
+		HANDLE			m_File;
+		HANDLE			m_Mapping;
+#endif
+	};
+
+	static void CollectFunctions( QScript::FunctionObject* function, std::vector< QScript::FunctionObject* >* functions,
+		std::unordered_map< QScript::FunctionObject*, uint32_t >* indices )
+	{
+		if ( function->IsDeferred() )
+			throw Exception( "bytecode_unsupported", "Function \"" + function->GetName() + "\" has not been compiled yet" );
+
+		( *indices )[ function ] = ( uint32_t ) functions->size();
+		functions->push_back( function );
+
+		for ( auto& constant : function->GetChunk()->m_Constants )
+		{
+			if ( IS_OBJECT( constant ) && AS_OBJECT( constant )->m_Type == QScript::OT_FUNCTION )
+				CollectFunctions( ( QScript::FunctionObject* ) AS_OBJECT( constant ), functions, indices );
+		}
+	}
+
+	std::vector< uint8_t > Serialize( const QScript::FunctionObject& main, bool debugSymbols )
+	{
+		std::vector< QScript::FunctionObject* > functions;
+		std::unordered_map< QScript::FunctionObject*, uint32_t > indices;
+		CollectFunctions( ( QScript::FunctionObject* ) &main, &functions, &indices );
+
+		BinaryWriter writer;
+
+		Header_t header;
+		std::memset( &header, 0, sizeof( header ) );
+		header.m_Magic = s_Magic;
+		header.m_Version = s_Version;
+		header.m_Flags = debugSymbols ? HF_DEBUG_SYMBOLS : HF_NONE;
+		header.m_NumFunctions = ( uint32_t ) functions.size();
+		writer.Write( header );
+		writer.Write( SuperinstructionSet() );
+
+		uint64_t codeOffset = 0;
+
+		for ( auto function : functions )
+		{
+			auto chunk = function->GetChunk();
+
+			writer.WriteString( function->GetName() );
+			writer.Write( ( uint32_t ) function->NumUpvalues() );
+			writer.Write( ( uint8_t ) ( function->GetClosure() ? FF_SHARED_CLOSURE : FF_NONE ) );
+			writer.Write( ( uint32_t ) function->GetArgs().size() );
+
+			for ( auto& arg : function->GetArgs() )
+			{
+				writer.WriteString( arg.m_Name );
+				writer.Write( arg.m_Type );
+				writer.Write( arg.m_RetType );
+			}
+
+			writer.Write( codeOffset );
+			writer.Write( ( uint32_t ) chunk->m_Code.size() );
+			codeOffset += chunk->m_Code.size();
+
+			writer.Write( ( uint32_t ) chunk->m_Constants.size() );
+
+			for ( auto& constant : chunk->m_Constants )
+			{
+				if ( IS_NULL( constant ) )
+				{
+					writer.Write( ( uint8_t ) CTAG_NULL );
+				}
+				else if ( IS_BOOL( constant ) )
+				{
+					writer.Write( ( uint8_t ) CTAG_BOOL );
+					writer.Write( ( uint8_t ) ( AS_BOOL( constant ) ? 1 : 0 ) );
+				}
+				else if ( IS_NUMBER( constant ) )
+				{
+					writer.Write( ( uint8_t ) CTAG_NUMBER );
+					writer.Write( AS_NUMBER( constant ) );
+				}
+				else if ( IS_STRING( constant ) )
+				{
+					writer.Write( ( uint8_t ) CTAG_STRING );
+					writer.WriteString( AS_STRING( constant )->GetString() );
+				}
+				else if ( IS_FUNCTION( constant ) )
+				{
+					writer.Write( ( uint8_t ) CTAG_FUNCTION );
+					writer.Write( indices.at( AS_FUNCTION( constant ) ) );
+				}
+				else if ( IS_CLOSURE( constant ) && AS_CLOSURE( constant )->GetFunction()->GetClosure() == AS_CLOSURE( constant ) )
+				{
+					writer.Write( ( uint8_t ) CTAG_CLOSURE );
+					writer.Write( indices.at( ( QScript::FunctionObject* ) AS_CLOSURE( constant )->GetFunction() ) );
+				}
+				else
+				{
+					throw Exception( "bytecode_unsupported", "Function \"" + function->GetName() + "\" has a constant that can not be stored" );
+				}
+			}
+
+			if ( debugSymbols )
+			{
+				writer.Write( ( uint32_t ) chunk->m_Debug.size() );
+
+				for ( auto& debug : chunk->m_Debug )
+				{
+					writer.Write( debug.m_From );
+					writer.Write( debug.m_To );
+					writer.Write( debug.m_Line );
+					writer.Write( debug.m_Column );
+					writer.WriteString( debug.m_Token );
+				}
+			}
+		}
+
+		// Code section starts aligned, so mapped code begins on its own cache line
+		writer.m_Data.resize( ( writer.m_Data.size() + s_CodeAlignment - 1 ) / s_CodeAlignment * s_CodeAlignment, 0 );
+
+		header.m_CodeOffset = writer.m_Data.size();
+		header.m_CodeSize = codeOffset;
+		writer.Patch( 0, header );
+
+		for ( auto function : functions )
+		{
+			auto& code = function->GetChunk()->m_Code;
+			writer.m_Data.insert( writer.m_Data.end(), code.begin(), code.end() );
+		}
+
+		return writer.m_Data;
+	}
+
+	QScript::FunctionObject* Deserialize( uint8_t* data, size_t size, std::shared_ptr< void > owner )
+	{
+		BinaryReader reader( data, size, "bytecode_invalid" );
+
+		auto header = reader.Read< Header_t >();
+
+		if ( header.m_Magic != s_Magic )
+			reader.Fail( "Not a compiled QScript file" );
+
+		if ( header.m_Version < s_MinVersion || header.m_Version > s_Version )
+			reader.Fail( "Unsupported bytecode version " + std::to_string( header.m_Version ) );
+
+		if ( header.m_NumFunctions == 0 || header.m_CodeOffset > size || header.m_CodeSize > size - header.m_CodeOffset )
+			reader.Fail( "Corrupted header" );
+
+		// Earlier versions have no superinstructions
+		if ( header.m_Version >= 3 && reader.Read< uint32_t >() != SuperinstructionSet() )
+			reader.Fail( "Compiled with a different superinstruction set" );
+
+		struct FunctionLink_t
+		{
+			QScript::Value*		m_Constant;
+			uint32_t			m_Function;
+			bool				m_IsClosure;
+		};
+
+		std::vector< QScript::FunctionObject* > functions;
+		std::vector< FunctionLink_t > links;
+
+		try
+		{
+			functions.reserve( header.m_NumFunctions );
+
+			for ( uint32_t i = 0; i < header.m_NumFunctions; ++i )
+			{
+				auto chunk = QScript::AllocChunk();
+				auto function = QS_NEW QScript::FunctionObject( reader.ReadString(), chunk );
+				functions.push_back( function );
+
+				auto numUpvalues = reader.Read< uint32_t >();
+				for ( uint32_t u = 0; u < numUpvalues; ++u )
+					function->SetUpvalues( 0 );
+
+				if ( header.m_Version >= 4 && ( reader.Read< uint8_t >() & FF_SHARED_CLOSURE ) )
+				{
+					if ( numUpvalues > 0 )
+						reader.Fail( "Function \"" + function->GetName() + "\" captures variables and can not share a closure" );
+
+					function->ShareClosure();
+				}
+
+				auto numArgs = reader.Read< uint32_t >();
+				for ( uint32_t a = 0; a < numArgs; ++a )
+				{
+					auto name = reader.ReadString();
+					auto argType = reader.Read< uint32_t >();
+					auto retType = reader.Read< uint32_t >();
+					function->AddArgument( name, argType, retType );
+				}
+
+				auto codeOffset = reader.Read< uint64_t >();
+				auto codeSize = reader.Read< uint32_t >();
+
+				if ( codeOffset > header.m_CodeSize || codeSize > header.m_CodeSize - codeOffset )
+					reader.Fail( "Code of function \"" + function->GetName() + "\" is out of range" );
+
+				chunk->m_Code.Map( data + header.m_CodeOffset + codeOffset, codeSize, owner );
+
+				chunk->m_Constants.resize( reader.Read< uint32_t >() );
+
+				for ( auto& constant : chunk->m_Constants )
+				{
+					switch ( reader.Read< uint8_t >() )
+					{
+					case CTAG_NULL:
+						constant = MAKE_NULL;
+						break;
+					case CTAG_BOOL:
+						constant = MAKE_BOOL( reader.Read< uint8_t >() != 0 );
+						break;
+					case CTAG_NUMBER:
+						constant = MAKE_NUMBER( reader.Read< double >() );
+						break;
+					case CTAG_STRING:
+						constant = MAKE_OBJECT( QS_NEW QScript::StringObject( reader.ReadString() ) );
+						break;
+					case CTAG_FUNCTION:
+						// Linked once every function exists
+						constant = MAKE_NULL;
+						links.push_back( FunctionLink_t{ &constant, reader.Read< uint32_t >(), false } );
+						break;
+					case CTAG_CLOSURE:
+						constant = MAKE_NULL;
+						links.push_back( FunctionLink_t{ &constant, reader.Read< uint32_t >(), true } );
+						break;
+					default:
+						reader.Fail( "Unknown constant tag" );
+					}
+				}
+
+				if ( header.m_Flags & HF_DEBUG_SYMBOLS )
+				{
+					chunk->m_Debug.resize( reader.Read< uint32_t >() );
+
+					for ( auto& debug : chunk->m_Debug )
+					{
+						debug.m_From = reader.Read< uint32_t >();
+						debug.m_To = reader.Read< uint32_t >();
+						debug.m_Line = reader.Read< int >();
+						debug.m_Column = reader.Read< int >();
+						debug.m_Token = reader.ReadString();
+					}
+				}
+			}
+
+			// Every function but main must be referenced exactly once, chunks own their constants.
+			// Shared closures belong to their function and can be referenced from anywhere.
+			std::vector< int > references( functions.size(), 0 );
+
+			for ( auto& link : links )
+			{
+				if ( link.m_Function == 0 || link.m_Function >= functions.size() )
+					reader.Fail( "Invalid function reference" );
+
+				if ( link.m_IsClosure )
+				{
+					if ( !functions[ link.m_Function ]->GetClosure() )
+						reader.Fail( "Function \"" + functions[ link.m_Function ]->GetName() + "\" has no shared closure" );
+
+					*link.m_Constant = MAKE_OBJECT( functions[ link.m_Function ]->GetClosure() );
+					continue;
+				}
+
+				if ( references[ link.m_Function ]++ > 0 )
+					reader.Fail( "Invalid function reference" );
+
+				*link.m_Constant = MAKE_OBJECT( functions[ link.m_Function ] );
+			}
+
+			if ( std::count( references.begin() + 1, references.end(), 0 ) > 0 )
+				reader.Fail( "Unreferenced function" );
+		}
+		catch ( ... )
+		{
+			// Functions are not linked yet, release them one by one
+			for ( auto function : functions )
+			{
+				for ( auto& constant : function->GetChunk()->m_Constants )
+				{
+					if ( IS_STRING( constant ) )
+						delete AS_OBJECT( constant );
+				}
+
+				delete function->GetChunk();
+				delete function;
+			}
+
+			throw;
+		}
+
+		return functions[ 0 ];
+	}
+}
+
+void QScript::SaveBytecode( const QScript::FunctionObject& function, const std::string& path, bool debugSymbols )
+{
+	auto data = Bytecode::Serialize( function, debugSymbols );
+
+	std::ofstream file( path, std::ios::binary | std::ios::trunc );
+
+	if ( !file.is_open() )
+		throw Exception( "bytecode_no_file", "File \"" + path + "\" could not be written" );
+
+	file.write( ( const char* ) data.data(), data.size() );
+}
+
+QScript::FunctionObject* QScript::LoadBytecode( const std::string& path )
+{
+	auto file = std::make_shared< Bytecode::MappedFile_t >( path );
+	return Bytecode::Deserialize( file->m_Data, file->m_Size, file );
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace Bytecode
+{
+	// Encode a compiled function and everything nested in it into the .qsc format
+	std::vector< uint8_t > Serialize( const QScript::FunctionObject& main, bool debugSymbols );
+
+	// Rebuild functions from .qsc data. Code is used in place, owner keeps the data alive
+	// for as long as any of the returned functions exist.
+	QScript::FunctionObject* Deserialize( uint8_t* data, size_t size, std::shared_ptr< void > owner );
+}
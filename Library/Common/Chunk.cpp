@@ -1,57 +1,65 @@
 #include "QLibPCH.h"
 #include "Chunk.h"
 
-QScript::Object::StringAllocatorFn QScript::Object::AllocateString = NULL;
-QScript::Object::FunctionAllocatorFn QScript::Object::AllocateFunction = NULL;
-QScript::Object::NativeAllocatorFn QScript::Object::AllocateNative = NULL;
-QScript::Object::ClosureAllocatorFn QScript::Object::AllocateClosure = NULL;
-QScript::Object::UpvalueAllocatorFn QScript::Object::AllocateUpvalue = NULL;
-QScript::Object::TableAllocatorFn QScript::Object::AllocateTable = NULL;
-QScript::Object::ArrayAllocatorFn QScript::Object::AllocateArray = NULL;
+thread_local QScript::Object::StringAllocatorFn QScript::Object::AllocateString = NULL;
+thread_local QScript::Object::FunctionAllocatorFn QScript::Object::AllocateFunction = NULL;
+thread_local QScript::Object::NativeAllocatorFn QScript::Object::AllocateNative = NULL;
+thread_local QScript::Object::ClosureAllocatorFn QScript::Object::AllocateClosure = NULL;
+thread_local QScript::Object::UpvalueAllocatorFn QScript::Object::AllocateUpvalue = NULL;
+thread_local QScript::Object::TableAllocatorFn QScript::Object::AllocateTable = NULL;
+thread_local QScript::Object::ArrayAllocatorFn QScript::Object::AllocateArray = NULL;
+thread_local QScript::Object::Float64ArrayAllocatorFn QScript::Object::AllocateFloat64Array = NULL;
 
 QScript::Chunk_t* QScript::AllocChunk()
 {
 	return QS_NEW Chunk_t;
 }
 
-void FreeObject( QScript::Object* object )
+void QScript::FreeChunk( QScript::Chunk_t* chunk )
 {
-	switch ( object->m_Type )
-	{
-	case QScript::OT_FUNCTION:
-	{
-		QScript::FreeChunk( ( ( QScript::FunctionObject* ) object )->GetChunk() );
-		break;
-	}
-	case QScript::OT_CLOSURE:
-	{
-		assert( 0 );
-		break;
-	}
-	case QScript::OT_UPVALUE:
+	// Constants may refer to the shared closure of any function in the tree, so everything is
+	// found before anything is released. Shared closures are released with their function.
+	std::vector< QScript::Chunk_t* > chunks = { chunk };
+	std::vector< QScript::Object* > objects;
+
+	for ( size_t i = 0; i < chunks.size(); ++i )
 	{
-		assert( 0 );
-		break;
-	}
-	default:
-		break;
-	}
+		for ( auto constant : chunks[ i ]->m_Constants )
+		{
+			if ( !IS_OBJECT( constant ) )
+				continue;
 
-	delete object;
-}
+			auto object = AS_OBJECT( constant );
 
-void QScript::FreeChunk( QScript::Chunk_t* chunk )
-{
-	for ( auto constant : chunk->m_Constants )
-	{
-		if ( !IS_OBJECT( constant ) )
-			continue;
+			switch ( object->m_Type )
+			{
+			case QScript::OT_FUNCTION:
+			{
+				auto functionChunk = ( ( QScript::FunctionObject* ) object )->GetChunk();
+
+				if ( functionChunk )
+					chunks.push_back( functionChunk );
 
-		auto object = AS_OBJECT( constant );
-		FreeObject( object );
+				break;
+			}
+			case QScript::OT_CLOSURE:
+				continue;
+			case QScript::OT_UPVALUE:
+				assert( 0 );
+				break;
+			default:
+				break;
+			}
+
+			objects.push_back( object );
+		}
 	}
 
-	delete chunk;
+	for ( auto object : objects )
+		delete object;
+
+	for ( auto functionChunk : chunks )
+		delete functionChunk;
 }
 
 void QScript::FreeFunction( QScript::FunctionObject* function )
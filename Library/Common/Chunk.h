@@ -4,6 +4,65 @@
 
 namespace QScript
 {
+	// Bytecode storage. Code is either owned, or borrowed from a mapped bytecode file, in
+	// which case it is executed in place. Any modification copies borrowed code first.
+	class Code_t
+	{
+	public:
+		FORCEINLINE Code_t()
+		{
+			m_View = NULL;
+			m_ViewSize = 0;
+		}
+
+		FORCEINLINE void Map( uint8_t* code, size_t size, std::shared_ptr< void > owner )
+		{
+			m_Bytes.clear();
+			m_View = code;
+			m_ViewSize = size;
+			m_Owner = owner;
+		}
+
+		FORCEINLINE bool IsMapped()								const { return m_View != NULL; }
+		FORCEINLINE size_t size()								const { return m_View ? m_ViewSize : m_Bytes.size(); }
+		FORCEINLINE bool empty()								const { return size() == 0; }
+
+		FORCEINLINE uint8_t* data()								{ return m_View ? m_View : m_Bytes.data(); }
+		FORCEINLINE const uint8_t* data()						const { return m_View ? m_View : m_Bytes.data(); }
+		FORCEINLINE uint8_t* begin()							{ return data(); }
+		FORCEINLINE uint8_t* end()								{ return data() + size(); }
+		FORCEINLINE const uint8_t* begin()						const { return data(); }
+		FORCEINLINE const uint8_t* end()						const { return data() + size(); }
+
+		FORCEINLINE uint8_t& operator[]( size_t index )			{ return data()[ index ]; }
+		FORCEINLINE uint8_t operator[]( size_t index )			const { return data()[ index ]; }
+
+		FORCEINLINE void push_back( uint8_t byte )				{ Detach(); m_Bytes.push_back( byte ); }
+		FORCEINLINE void resize( size_t size, uint8_t fill = 0 )	{ Detach(); m_Bytes.resize( size, fill ); }
+		FORCEINLINE void assign( const uint8_t* first, const uint8_t* last )
+		{
+			Detach();
+			m_Bytes.assign( first, last );
+		}
+
+	private:
+		FORCEINLINE void Detach()
+		{
+			if ( !m_View )
+				return;
+
+			m_Bytes.assign( m_View, m_View + m_ViewSize );
+			m_View = NULL;
+			m_ViewSize = 0;
+			m_Owner.reset();
+		}
+
+		std::vector< uint8_t >		m_Bytes;
+		uint8_t*					m_View;
+		size_t						m_ViewSize;
+		std::shared_ptr< void >		m_Owner;
+	};
+
 	struct Chunk_t
 	{
 		struct Debug_t
@@ -15,7 +74,7 @@ namespace QScript
 			std::string 		m_Token;
 		};
 
-		std::vector< uint8_t > 	m_Code;
+		Code_t				 	m_Code;
 		std::vector< Value > 	m_Constants;
 		std::vector< Debug_t >	m_Debug;
 	};
@@ -111,6 +111,48 @@ namespace Disassembler
 				break; \
 			}
 		
+		#define BRANCH_INST( inst, name, isConstant ) case QScript::OpCode::inst: { \
+				uint8_t left = chunk.m_Code[ offset + 1 ]; \
+				uint8_t right = chunk.m_Code[ offset + 2 ]; \
+				uint8_t value = chunk.m_Code[ offset + 3 ]; \
+				auto jumpTo = std::to_string( offset + 4 + value ); \
+				opcode.m_Name = name; \
+				opcode.m_Full = name + std::string( " LOCAL " ) + std::to_string( left ) \
+					+ ( isConstant ? " CONSTANT " + std::to_string( right ) + " " + chunk.m_Constants[ right ].ToString() \
+						: " LOCAL " + std::to_string( right ) ) \
+					+ " " + std::to_string( value ) + " [to " + jumpTo + "]"; \
+				opcode.m_Attributes.emplace_back( std::string( "{ \"type\": \"jump\", \"jumpTo\": " ) \
+					+ jumpTo + ",\"relative\": " + std::to_string( value ) + ", \"dir\": 0}" ); \
+				opcode.m_Type = OPCODE_SHORT; \
+				break; \
+			}
+
+		#define BRANCH_INSTS( comparison ) \
+			JMP_INST_SHORT( OP_JUMP_IF_NOT_##comparison##_SHORT, "JUMP_IF_NOT_" #comparison, false ); \
+			JMP_INST_LONG( OP_JUMP_IF_NOT_##comparison##_LONG, "JUMP_IF_NOT_" #comparison, false ); \
+			BRANCH_INST( OP_JUMP_IF_NOT_##comparison##_LOCAL_CONSTANT, "JUMP_IF_NOT_" #comparison, true ); \
+			BRANCH_INST( OP_JUMP_IF_NOT_##comparison##_LOCAL_LOCAL, "JUMP_IF_NOT_" #comparison, false );
+
+		#define CALL_INST( inst, name, constantSize ) case QScript::OpCode::inst: { \
+				uint32_t constant = constantSize == 1 ? chunk.m_Code[ offset + 1 ] : DECODE_LONG( chunk.m_Code[ offset + 1 ], \
+					chunk.m_Code[ offset + 2 ], chunk.m_Code[ offset + 3 ], chunk.m_Code[ offset + 4 ] ); \
+				uint8_t numArgs = chunk.m_Code[ offset + 1 + constantSize ]; \
+				opcode.m_Name = name; \
+				opcode.m_Full = name + std::string( " " ) + std::to_string( constant ) + " " \
+					+ chunk.m_Constants[ constant ].ToString() + " " + std::to_string( numArgs ); \
+				opcode.m_Type = constantSize == 1 ? OPCODE_SHORT : OPCODE_LONG; \
+				break; \
+			}
+
+		#define SUPER_INST( arg, inst, a, b, c, d ) case QScript::OpCode::inst: { \
+				opcode.m_Name = std::string( #inst ).substr( 3 ); \
+				opcode.m_Full = opcode.m_Name; \
+				for ( uint32_t operand = offset + 1; operand < offset + opcode.m_Size; ++operand ) \
+					opcode.m_Full += " " + std::to_string( chunk.m_Code[ operand ] ); \
+				opcode.m_Type = OPCODE_SIMPLE; \
+				break; \
+			}
+
 		#define JMP_INST_SHORT( inst, name, backwards ) case QScript::OpCode::inst: { \
 				uint8_t value = chunk.m_Code[ offset + 1 ]; \
 				auto jumpTo = std::to_string( backwards ? ( offset - value ) : ( offset + 2 + value ) ); \
@@ -139,10 +181,20 @@ namespace Disassembler
 			CNST_INST_LONG( OP_CREATE_ARRAY_LONG, "CREATE_ARRAY" );
 			CNST_INST_SHORT( OP_CREATE_TABLE_SHORT, "CREATE_TABLE" );
 			CNST_INST_LONG( OP_CREATE_TABLE_LONG, "CREATE_TABLE" );
+			CNST_INST_SHORT( OP_CREATE_CLASS_SHORT, "CREATE_CLASS" );
+			CNST_INST_LONG( OP_CREATE_CLASS_LONG, "CREATE_CLASS" );
+			CNST_INST_SHORT( OP_CLASS_FIELD_SHORT, "CLASS_FIELD" );
+			CNST_INST_LONG( OP_CLASS_FIELD_LONG, "CLASS_FIELD" );
+			CNST_INST_SHORT( OP_CLASS_NUMBER_FIELD_SHORT, "CLASS_NUMBER_FIELD" );
+			CNST_INST_LONG( OP_CLASS_NUMBER_FIELD_LONG, "CLASS_NUMBER_FIELD" );
+			CNST_INST_SHORT( OP_CLASS_METHOD_SHORT, "CLASS_METHOD" );
+			CNST_INST_LONG( OP_CLASS_METHOD_LONG, "CLASS_METHOD" );
 			CNST_INST_SHORT( OP_LOAD_CONSTANT_SHORT, "LOAD_CONSTANT" );
 			CNST_INST_LONG( OP_LOAD_CONSTANT_LONG, "LOAD_CONSTANT" );
 			CNST_INST_SHORT( OP_SET_GLOBAL_SHORT, "SET_GLOBAL" );
 			CNST_INST_LONG( OP_SET_GLOBAL_LONG, "SET_GLOBAL" );
+			CNST_INST_SHORT( OP_STORE_GLOBAL_SHORT, "STORE_GLOBAL" );
+			CNST_INST_LONG( OP_STORE_GLOBAL_LONG, "STORE_GLOBAL" );
 			CNST_INST_SHORT( OP_LOAD_GLOBAL_SHORT, "LOAD_GLOBAL" );
 			CNST_INST_LONG( OP_LOAD_GLOBAL_LONG, "LOAD_GLOBAL" );
 			CNST_INST_SHORT( OP_SET_PROP_SHORT, "SET_PROP" );
@@ -151,9 +203,14 @@ namespace Disassembler
 			CNST_INST_LONG( OP_LOAD_PROP_LONG, "LOAD_PROP" );
 			CNST_INST_LONG( OP_IMPORT, "IMPORT" );
 			INST_SHORT( OP_LOAD_LOCAL_SHORT, "LOAD_LOCAL" );
+			INST_SHORT( OP_LOAD_SLOT, "LOAD_SLOT" );
+			INST_SHORT( OP_SET_SLOT, "SET_SLOT" );
+			INST_SHORT( OP_SET_SLOT_NUMBER, "SET_SLOT_NUMBER" );
 			INST_LONG( OP_LOAD_LOCAL_LONG, "LOAD_LOCAL" );
 			INST_SHORT( OP_SET_LOCAL_SHORT, "SET_LOCAL" );
 			INST_LONG( OP_SET_LOCAL_LONG, "SET_LOCAL" );
+			INST_SHORT( OP_STORE_LOCAL_SHORT, "STORE_LOCAL" );
+			INST_LONG( OP_STORE_LOCAL_LONG, "STORE_LOCAL" );
 			INST_SHORT( OP_LOAD_UPVALUE_SHORT, "LOAD_UPVALUE" );
 			INST_LONG( OP_LOAD_UPVALUE_LONG, "LOAD_UPVALUE" );
 			INST_SHORT( OP_SET_UPVALUE_SHORT, "SET_UPVALUE" );
@@ -164,7 +221,20 @@ namespace Disassembler
 			JMP_INST_LONG( OP_JUMP_LONG, "JUMP", false );
 			JMP_INST_SHORT( OP_JUMP_BACK_SHORT, "JUMP_BACK", true );
 			JMP_INST_LONG( OP_JUMP_BACK_LONG, "JUMP_BACK", true );
+			BRANCH_INSTS( LT );
+			BRANCH_INSTS( LE );
+			BRANCH_INSTS( GT );
+			BRANCH_INSTS( GE );
+			BRANCH_INSTS( EQ );
+			BRANCH_INSTS( NE );
 			INST_SHORT( OP_CALL, "CALL" );
+			CALL_INST( OP_CALL_DIRECT_SHORT, "CALL_DIRECT", 1 );
+			CALL_INST( OP_CALL_DIRECT_LONG, "CALL_DIRECT", 4 );
+			INST_SHORT( OP_CALL_SELF, "CALL_SELF" );
+			INST_SHORT( OP_TAIL_CALL, "TAIL_CALL" );
+			INST_SHORT( OP_TAIL_CALL_SELF, "TAIL_CALL_SELF" );
+			CALL_INST( OP_INVOKE_SHORT, "INVOKE", 1 );
+			CALL_INST( OP_INVOKE_LONG, "INVOKE", 4 );
 			SIMPLE_INST( OP_CALL_0, "CALL 0" );
 			SIMPLE_INST( OP_CALL_1, "CALL 1" );
 			SIMPLE_INST( OP_CALL_2, "CALL 2" );
@@ -199,6 +269,18 @@ namespace Disassembler
 			SIMPLE_INST( OP_SET_LOCAL_9, "SET_LOCAL 9" );
 			SIMPLE_INST( OP_SET_LOCAL_10, "SET_LOCAL 10" );
 			SIMPLE_INST( OP_SET_LOCAL_11, "SET_LOCAL 11" );
+			SIMPLE_INST( OP_STORE_LOCAL_0, "STORE_LOCAL 0" );
+			SIMPLE_INST( OP_STORE_LOCAL_1, "STORE_LOCAL 1" );
+			SIMPLE_INST( OP_STORE_LOCAL_2, "STORE_LOCAL 2" );
+			SIMPLE_INST( OP_STORE_LOCAL_3, "STORE_LOCAL 3" );
+			SIMPLE_INST( OP_STORE_LOCAL_4, "STORE_LOCAL 4" );
+			SIMPLE_INST( OP_STORE_LOCAL_5, "STORE_LOCAL 5" );
+			SIMPLE_INST( OP_STORE_LOCAL_6, "STORE_LOCAL 6" );
+			SIMPLE_INST( OP_STORE_LOCAL_7, "STORE_LOCAL 7" );
+			SIMPLE_INST( OP_STORE_LOCAL_8, "STORE_LOCAL 8" );
+			SIMPLE_INST( OP_STORE_LOCAL_9, "STORE_LOCAL 9" );
+			SIMPLE_INST( OP_STORE_LOCAL_10, "STORE_LOCAL 10" );
+			SIMPLE_INST( OP_STORE_LOCAL_11, "STORE_LOCAL 11" );
 			SIMPLE_INST( OP_SET_PROP_STACK, "LOAD_SET_STACK" );
 			SIMPLE_INST( OP_CLOSE_UPVALUE, "CLOSE_UPVALUE" );
 			SIMPLE_INST( OP_ADD, "ADD" );
@@ -226,6 +308,7 @@ namespace Disassembler
 			SIMPLE_INST( OP_LOAD_3, "LOAD_3" );
 			SIMPLE_INST( OP_LOAD_4, "LOAD_4" );
 			SIMPLE_INST( OP_LOAD_5, "LOAD_5" );
+			QS_SUPERINSTRUCTIONS( SUPER_INST, _ )
 		case QScript::OpCode::OP_CLOSURE_SHORT:
 		{
 			uint32_t constant = ( uint32_t ) chunk.m_Code[ offset + 1 ];
@@ -290,13 +373,23 @@ namespace Disassembler
 		#undef INST_SHORT
 		#undef JMP_INST_SHORT
 		#undef JMP_INST_LONG
+		#undef BRANCH_INST
+		#undef BRANCH_INSTS
+		#undef CALL_INST
+		#undef SUPER_INST
 		return opcode;
 	}
 
 	int InstructionSize( uint8_t inst )
 	{
+		// Superinstructions carry the operands of their parts
+		#define SUPER_INST_SIZE( arg, name, a, b, c, d ) case QScript::OpCode::name: \
+			return 1 + ( InstructionSize( QScript::OpCode::a ) - 1 ) + ( InstructionSize( QScript::OpCode::b ) - 1 ) \
+				+ ( InstructionSize( QScript::OpCode::c ) - 1 ) + ( InstructionSize( QScript::OpCode::d ) - 1 );
+
 		switch ( inst )
 		{
+		QS_SUPERINSTRUCTIONS( SUPER_INST_SIZE, _ )
 		case QScript::OpCode::OP_BIND: return 1;
 		case QScript::OpCode::OP_PUSH_ARRAY: return 1;
 		case QScript::OpCode::OP_LOAD_PROP_STACK: return 1;
@@ -304,12 +397,25 @@ namespace Disassembler
 		case QScript::OpCode::OP_LOAD_TOP_SHORT: return 2;
 		case QScript::OpCode::OP_CREATE_TABLE_SHORT: return 2;
 		case QScript::OpCode::OP_CREATE_TABLE_LONG: return 5;
+		case QScript::OpCode::OP_CREATE_CLASS_SHORT: return 2;
+		case QScript::OpCode::OP_CREATE_CLASS_LONG: return 5;
+		case QScript::OpCode::OP_CLASS_FIELD_SHORT: return 2;
+		case QScript::OpCode::OP_CLASS_FIELD_LONG: return 5;
+		case QScript::OpCode::OP_CLASS_NUMBER_FIELD_SHORT: return 2;
+		case QScript::OpCode::OP_CLASS_NUMBER_FIELD_LONG: return 5;
+		case QScript::OpCode::OP_LOAD_SLOT: return 2;
+		case QScript::OpCode::OP_SET_SLOT: return 2;
+		case QScript::OpCode::OP_SET_SLOT_NUMBER: return 2;
+		case QScript::OpCode::OP_CLASS_METHOD_SHORT: return 2;
+		case QScript::OpCode::OP_CLASS_METHOD_LONG: return 5;
 		case QScript::OpCode::OP_CREATE_ARRAY_SHORT: return 2;
 		case QScript::OpCode::OP_CREATE_ARRAY_LONG: return 5;
 		case QScript::OpCode::OP_LOAD_CONSTANT_SHORT: return 2;
 		case QScript::OpCode::OP_LOAD_CONSTANT_LONG: return 5;
 		case QScript::OpCode::OP_SET_GLOBAL_SHORT: return 2;
 		case QScript::OpCode::OP_SET_GLOBAL_LONG: return 5;
+		case QScript::OpCode::OP_STORE_GLOBAL_SHORT: return 2;
+		case QScript::OpCode::OP_STORE_GLOBAL_LONG: return 5;
 		case QScript::OpCode::OP_LOAD_GLOBAL_SHORT: return 2;
 		case QScript::OpCode::OP_LOAD_GLOBAL_LONG: return 5;
 		case QScript::OpCode::OP_LOAD_LOCAL_SHORT: return 2;
@@ -320,6 +426,8 @@ namespace Disassembler
 		case QScript::OpCode::OP_LOAD_UPVALUE_LONG: return 5;
 		case QScript::OpCode::OP_SET_LOCAL_SHORT: return 2;
 		case QScript::OpCode::OP_SET_LOCAL_LONG: return 5;
+		case QScript::OpCode::OP_STORE_LOCAL_SHORT: return 2;
+		case QScript::OpCode::OP_STORE_LOCAL_LONG: return 5;
 		case QScript::OpCode::OP_SET_PROP_SHORT: return 2;
 		case QScript::OpCode::OP_SET_PROP_LONG: return 5;
 		case QScript::OpCode::OP_SET_UPVALUE_SHORT: return 2;
@@ -330,6 +438,33 @@ namespace Disassembler
 		case QScript::OpCode::OP_JUMP_LONG: return 5;
 		case QScript::OpCode::OP_JUMP_BACK_SHORT: return 2;
 		case QScript::OpCode::OP_JUMP_BACK_LONG: return 5;
+		case QScript::OpCode::OP_JUMP_IF_NOT_LT_SHORT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_LE_SHORT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_GT_SHORT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_GE_SHORT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_EQ_SHORT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_NE_SHORT:
+			return 2;
+		case QScript::OpCode::OP_JUMP_IF_NOT_LT_LONG:
+		case QScript::OpCode::OP_JUMP_IF_NOT_LE_LONG:
+		case QScript::OpCode::OP_JUMP_IF_NOT_GT_LONG:
+		case QScript::OpCode::OP_JUMP_IF_NOT_GE_LONG:
+		case QScript::OpCode::OP_JUMP_IF_NOT_EQ_LONG:
+		case QScript::OpCode::OP_JUMP_IF_NOT_NE_LONG:
+			return 5;
+		case QScript::OpCode::OP_JUMP_IF_NOT_LT_LOCAL_CONSTANT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_LE_LOCAL_CONSTANT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_GT_LOCAL_CONSTANT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_GE_LOCAL_CONSTANT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_EQ_LOCAL_CONSTANT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_NE_LOCAL_CONSTANT:
+		case QScript::OpCode::OP_JUMP_IF_NOT_LT_LOCAL_LOCAL:
+		case QScript::OpCode::OP_JUMP_IF_NOT_LE_LOCAL_LOCAL:
+		case QScript::OpCode::OP_JUMP_IF_NOT_GT_LOCAL_LOCAL:
+		case QScript::OpCode::OP_JUMP_IF_NOT_GE_LOCAL_LOCAL:
+		case QScript::OpCode::OP_JUMP_IF_NOT_EQ_LOCAL_LOCAL:
+		case QScript::OpCode::OP_JUMP_IF_NOT_NE_LOCAL_LOCAL:
+			return 4;
 		case QScript::OpCode::OP_CLOSE_UPVALUE: return 1;
 		case QScript::OpCode::OP_ADD: return 1;
 		case QScript::OpCode::OP_SUB: return 1;
@@ -338,6 +473,13 @@ namespace Disassembler
 		case QScript::OpCode::OP_POW: return 1;
 		case QScript::OpCode::OP_MOD: return 1;
 		case QScript::OpCode::OP_CALL: return 2;
+		case QScript::OpCode::OP_CALL_DIRECT_SHORT: return 3;
+		case QScript::OpCode::OP_CALL_DIRECT_LONG: return 6;
+		case QScript::OpCode::OP_CALL_SELF: return 2;
+		case QScript::OpCode::OP_TAIL_CALL: return 2;
+		case QScript::OpCode::OP_TAIL_CALL_SELF: return 2;
+		case QScript::OpCode::OP_INVOKE_SHORT: return 3;
+		case QScript::OpCode::OP_INVOKE_LONG: return 6;
 		case QScript::OpCode::OP_IMPORT: return 5;
 		case QScript::OpCode::OP_CLOSURE_LONG: return 5;
 		case QScript::OpCode::OP_CLOSURE_SHORT: return 2;
@@ -395,9 +537,24 @@ namespace Disassembler
 		case QScript::OpCode::OP_SET_LOCAL_10:
 		case QScript::OpCode::OP_SET_LOCAL_11:
 			return 1;
+		case QScript::OpCode::OP_STORE_LOCAL_0:
+		case QScript::OpCode::OP_STORE_LOCAL_1:
+		case QScript::OpCode::OP_STORE_LOCAL_2:
+		case QScript::OpCode::OP_STORE_LOCAL_3:
+		case QScript::OpCode::OP_STORE_LOCAL_4:
+		case QScript::OpCode::OP_STORE_LOCAL_5:
+		case QScript::OpCode::OP_STORE_LOCAL_6:
+		case QScript::OpCode::OP_STORE_LOCAL_7:
+		case QScript::OpCode::OP_STORE_LOCAL_8:
+		case QScript::OpCode::OP_STORE_LOCAL_9:
+		case QScript::OpCode::OP_STORE_LOCAL_10:
+		case QScript::OpCode::OP_STORE_LOCAL_11:
+			return 1;
 		default:
 			return 1;
 		}
+
+		#undef SUPER_INST_SIZE
 	}
 
 	void DumpDisassembly( const Disassembly_t& disassembly )
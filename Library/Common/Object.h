@@ -20,6 +20,8 @@ namespace QScript
 		std::string m_String;
 	};
 
+	class ClosureObject;
+
 	class FunctionObject : public Object
 	{
 	public:
@@ -30,14 +32,27 @@ namespace QScript
 			uint32_t 		m_RetType;
 		};
 
+		// Generates the code of a deferred function into its chunk, see Config_t::m_LazyCompilation
+		class Deferred_t
+		{
+		public:
+			virtual ~Deferred_t() {}
+			virtual void Compile( FunctionObject* function ) = 0;
+		};
+
 		FORCEINLINE FunctionObject( const std::string& name, Chunk_t* chunk )
 		{
 			m_Type = OT_FUNCTION;
 			m_Name = name;
 			m_NumUpvalues = 0;
 			m_Chunk = chunk;
+			m_Closure = NULL;
+			m_Deferred = NULL;
+			m_IsDeferred = false;
 		}
 
+		~FunctionObject();
+
 		FORCEINLINE void Rename( const std::string& newName ) 		{ m_Name = newName; }
 		FORCEINLINE const std::string& GetName() 					const { return m_Name; }
 		FORCEINLINE int NumArgs() 									const { return ( int ) m_Arguments.size(); }
@@ -45,6 +60,18 @@ namespace QScript
 		FORCEINLINE Chunk_t* GetChunk() 							const { return m_Chunk; }
 		FORCEINLINE const std::vector< Arg_t >& GetArgs()			const { return m_Arguments; }
 
+		// Closure shared by every evaluation of a function that captures nothing and is never
+		// bound, NULL for other functions. It belongs to the function, not to a VM.
+		FORCEINLINE ClosureObject* GetClosure()						const { return m_Closure; }
+		void ShareClosure();
+
+		// Deferred functions have arguments but no code until CompileDeferred() succeeds, errors
+		// in their code are raised as runtime exceptions. The first thread to call one compiles it.
+		FORCEINLINE bool IsDeferred()								const { return m_IsDeferred.load( std::memory_order_acquire ); }
+		FORCEINLINE void Defer( Deferred_t* deferred )				{ m_Deferred = deferred; m_IsDeferred = true; }
+		FORCEINLINE void FinishDeferred()							{ m_IsDeferred.store( false, std::memory_order_release ); }
+		FORCEINLINE void CompileDeferred()							const { m_Deferred->Compile( const_cast< FunctionObject* >( this ) ); }
+
 		FORCEINLINE void SetUpvalues( int numUpvalues ) 							{ ++m_NumUpvalues; }
 		FORCEINLINE void AddArgument( const std::string& name, uint32_t type, uint32_t retType )
 		{
@@ -56,6 +83,9 @@ namespace QScript
 		int 					m_NumUpvalues;
 		Chunk_t*				m_Chunk;
 		std::vector< Arg_t >	m_Arguments;
+		ClosureObject*			m_Closure;
+		Deferred_t*				m_Deferred;
+		std::atomic< bool >		m_IsDeferred;
 	};
 
 	class NativeFunctionObject : public Object
@@ -69,6 +99,7 @@ namespace QScript
 		}
 
 		FORCEINLINE NativeFn GetNative()				{ return m_Native; }
+		FORCEINLINE void SetNative( NativeFn native )	{ m_Native = native; }
 		FORCEINLINE Object* GetThis()					{ return m_This; }
 		FORCEINLINE void SetThis( Object* receiver )	{ m_This = receiver; }
 	private:
@@ -83,44 +114,67 @@ namespace QScript
 		{
 			m_Type = OT_UPVALUE;
 			m_Slot = value;
-			m_Next = NULL;
 			m_Closed = MAKE_NULL;
 		}
 
 		FORCEINLINE Value* GetValue() { return m_Slot; }
-		FORCEINLINE void SetNext( UpvalueObject* next ) { m_Next = next; }
-		FORCEINLINE UpvalueObject* GetNext() { return m_Next; }
 		FORCEINLINE void Close() { m_Closed = *m_Slot; m_Slot = &m_Closed; }
 
 	private:
 		Value*				m_Slot;
 		Value				m_Closed;
-
-		// m_Next: Used ONLY by the VM to track open closures
-		UpvalueObject*		m_Next;
 	};
 
+	// Closures keep their upvalues inline, in a fixed-size array following the object. Create
+	// sizes the allocation from the function, so closures can't be constructed directly.
 	class ClosureObject : public Object
 	{
 	public:
-		FORCEINLINE ClosureObject( const FunctionObject* function )
+		static ClosureObject* Create( const FunctionObject* function )
 		{
-			m_Type = OT_CLOSURE;
-			m_Fn = function;
-			m_This = this;
+			auto memory = ::operator new( sizeof( ClosureObject ) + function->NumUpvalues() * sizeof( UpvalueObject* ) );
+			return new ( memory ) ClosureObject( function );
 		}
 
+		static void operator delete( void* memory )						{ ::operator delete( memory ); }
+
 		FORCEINLINE	const FunctionObject* GetFunction()					const { return m_Fn; }
 		FORCEINLINE Object* GetThis()									const { return m_This; }
 		FORCEINLINE void Bind( Object* receiver )						{ m_This = receiver; }
-		FORCEINLINE	std::vector< UpvalueObject* >& GetUpvalues()		{ return m_Upvalues; }
+		FORCEINLINE int NumUpvalues()									const { return m_NumUpvalues; }
+		FORCEINLINE UpvalueObject** GetUpvalues()						{ return reinterpret_cast< UpvalueObject** >( this + 1 ); }
 
 	private:
+		FORCEINLINE ClosureObject( const FunctionObject* function )
+		{
+			m_Type = OT_CLOSURE;
+			m_Fn = function;
+			m_This = this;
+			m_NumUpvalues = function->NumUpvalues();
+
+			// Upvalues are filled in after allocation, the collector may see the closure before that
+			std::fill_n( GetUpvalues(), m_NumUpvalues, ( UpvalueObject* ) NULL );
+		}
+
 		const FunctionObject* 			m_Fn;
-		std::vector< UpvalueObject* >	m_Upvalues;
 		Object*							m_This;
+		int								m_NumUpvalues;
 	};
 
+	static_assert( sizeof( ClosureObject ) % alignof( UpvalueObject* ) == 0, "Inline upvalues must be aligned" );
+
+	inline FunctionObject::~FunctionObject()
+	{
+		delete m_Closure;
+		delete m_Deferred;
+	}
+
+	inline void FunctionObject::ShareClosure()
+	{
+		if ( !m_Closure )
+			m_Closure = ClosureObject::Create( this );
+	}
+
 	class TableObject : public Object
 	{
 	public:
@@ -138,6 +192,101 @@ namespace QScript
 		std::unordered_map< std::string, Value >	m_Properties;
 	};
 
+	// Class declared with "Class", shared by all of its instances. Fields are numbered in
+	// declaration order, methods are stored once and called with the instance as "this".
+	// Number fields only ever hold numbers, so the collector skips them.
+	class ClassObject : public Object
+	{
+	public:
+		FORCEINLINE ClassObject( const std::string& name )
+		{
+			m_Type = OT_CLASS;
+			m_Name = name;
+		}
+
+		FORCEINLINE	const std::string&									GetName() const { return m_Name; }
+		FORCEINLINE int													NumFields() const { return ( int ) m_Defaults.size(); }
+		FORCEINLINE const std::vector< std::string >&					GetFieldNames() const { return m_FieldNames; }
+		FORCEINLINE std::vector< Value >&								GetDefaults() { return m_Defaults; }
+		FORCEINLINE std::unordered_map< std::string, ClosureObject* >&	GetMethods() { return m_Methods; }
+		FORCEINLINE bool												IsNumberField( int slot ) const { return m_NumberFields[ slot ]; }
+		FORCEINLINE const std::vector< uint32_t >&						GetReferenceFields() const { return m_ReferenceFields; }
+
+		// Slot of a field, -1 if the class has no field by that name
+		FORCEINLINE int FindField( const std::string& name ) const
+		{
+			auto field = m_Slots.find( name );
+			return field == m_Slots.end() ? -1 : ( int ) field->second;
+		}
+
+		FORCEINLINE ClosureObject* FindMethod( const std::string& name ) const
+		{
+			auto method = m_Methods.find( name );
+			return method == m_Methods.end() ? NULL : method->second;
+		}
+
+		void AddField( const std::string& name, const Value& defaultValue, bool isNumber )
+		{
+			int slot = FindField( name );
+
+			if ( slot != -1 )
+			{
+				m_Defaults[ slot ] = defaultValue;
+				return;
+			}
+
+			if ( !isNumber )
+				m_ReferenceFields.push_back( ( uint32_t ) m_Defaults.size() );
+
+			m_Slots[ name ] = ( uint32_t ) m_Defaults.size();
+			m_FieldNames.push_back( name );
+			m_NumberFields.push_back( isNumber );
+			m_Defaults.push_back( defaultValue );
+		}
+
+	private:
+		std::string											m_Name;
+		std::unordered_map< std::string, uint32_t >			m_Slots;
+		std::vector< std::string >							m_FieldNames;
+		std::vector< bool >									m_NumberFields;
+		std::vector< uint32_t >								m_ReferenceFields;
+		std::vector< Value >								m_Defaults;
+		std::unordered_map< std::string, ClosureObject* >	m_Methods;
+	};
+
+	// Instances hold nothing but their fields, inline after the object in the slot order of
+	// their class. Fields start out as the defaults of the class.
+	class InstanceObject : public Object
+	{
+	public:
+		static InstanceObject* Create( ClassObject* classObject )
+		{
+			auto memory = ::operator new( sizeof( InstanceObject ) + classObject->NumFields() * sizeof( Value ) );
+			return new ( memory ) InstanceObject( classObject );
+		}
+
+		static void operator delete( void* memory )						{ ::operator delete( memory ); }
+
+		FORCEINLINE ClassObject* GetClass()								const { return m_Class; }
+		FORCEINLINE int NumFields()										const { return m_NumFields; }
+		FORCEINLINE Value* GetFields()									{ return reinterpret_cast< Value* >( this + 1 ); }
+
+	private:
+		FORCEINLINE InstanceObject( ClassObject* classObject )
+		{
+			m_Type = OT_INSTANCE;
+			m_Class = classObject;
+			m_NumFields = classObject->NumFields();
+
+			std::uninitialized_copy_n( classObject->GetDefaults().data(), m_NumFields, GetFields() );
+		}
+
+		ClassObject*					m_Class;
+		int								m_NumFields;
+	};
+
+	static_assert( sizeof( InstanceObject ) % alignof( Value ) == 0, "Inline fields must be aligned" );
+
 	class ArrayObject : public Object
 	{
 	public:
@@ -149,11 +298,28 @@ namespace QScript
 
 		FORCEINLINE	const std::string&								GetName() const { return m_Name; }
 		FORCEINLINE std::vector< Value >&							GetArray() { return m_Array; }
-		FORCEINLINE std::unordered_map< std::string, Value >&		GetMethods() { return m_Methods; }
 
 	private:
 		std::string									m_Name;
 		std::vector< Value >						m_Array;
-		std::unordered_map< std::string, Value >	m_Methods;
+	};
+
+	// Packed numeric array: elements are stored as raw doubles, so the garbage
+	// collector never has to scan them
+	class Float64ArrayObject : public Object
+	{
+	public:
+		FORCEINLINE Float64ArrayObject( const std::string& name )
+		{
+			m_Type = OT_FLOAT64_ARRAY;
+			m_Name = name;
+		}
+
+		FORCEINLINE	const std::string&								GetName() const { return m_Name; }
+		FORCEINLINE std::vector< double >&							GetArray() { return m_Array; }
+
+	private:
+		std::string									m_Name;
+		std::vector< double >						m_Array;
 	};
 }
@@ -0,0 +1,109 @@
+#pragma once
+
+// Plain binary encoding shared by snapshots and bytecode files. Data is written in native
+// byte order, files are not meant to move between architectures.
+class BinaryWriter
+{
+public:
+	template< typename T >
+	void Write( const T& value )
+	{
+		static_assert( std::is_trivially_copyable< T >::value, "Only plain data can be written directly" );
+
+		auto bytes = ( const uint8_t* ) &value;
+		m_Data.insert( m_Data.end(), bytes, bytes + sizeof( T ) );
+	}
+
+	void WriteBytes( const void* data, size_t size )
+	{
+		Write( ( uint32_t ) size );
+
+		if ( size > 0 )
+			m_Data.insert( m_Data.end(), ( const uint8_t* ) data, ( const uint8_t* ) data + size );
+	}
+
+	void WriteString( const std::string& string )
+	{
+		WriteBytes( string.data(), string.size() );
+	}
+
+	// Overwrite a value written earlier, used to fill in offsets known only later
+	template< typename T >
+	void Patch( size_t offset, const T& value )
+	{
+		std::memcpy( &m_Data[ offset ], &value, sizeof( T ) );
+	}
+
+	std::vector< uint8_t >		m_Data;
+};
+
+class BinaryReader
+{
+public:
+	BinaryReader( const uint8_t* data, size_t size, const std::string& errorId )
+		: m_Data( data ), m_Size( size ), m_Offset( 0 ), m_ErrorId( errorId )
+	{
+	}
+
+	template< typename T >
+	T Read()
+	{
+		T value;
+		std::memcpy( &value, Take( sizeof( T ) ), sizeof( T ) );
+		return value;
+	}
+
+	std::string ReadString()
+	{
+		auto size = Read< uint32_t >();
+		auto data = ( const char* ) Take( size );
+		return std::string( data, size );
+	}
+
+	template< typename T, typename Container >
+	void ReadArray( Container* out )
+	{
+		auto size = Read< uint32_t >();
+		auto data = Take( size );
+
+		if ( size % sizeof( T ) != 0 )
+			Fail( "Misaligned array" );
+
+		out->resize( size / sizeof( T ) );
+
+		if ( size > 0 )
+			std::memcpy( out->data(), data, size );
+	}
+
+	// Skip over size bytes, returning where they start
+	const uint8_t* Take( size_t size )
+	{
+		if ( size > m_Size - m_Offset )
+			Fail( "Unexpected end of data" );
+
+		auto data = m_Data + m_Offset;
+		m_Offset += size;
+		return data;
+	}
+
+	void Seek( size_t offset )
+	{
+		if ( offset > m_Size )
+			Fail( "Offset out of range" );
+
+		m_Offset = offset;
+	}
+
+	size_t Offset() const { return m_Offset; }
+
+	[[noreturn]] void Fail( const std::string& desc ) const
+	{
+		throw Exception( m_ErrorId, desc );
+	}
+
+private:
+	const uint8_t*				m_Data;
+	size_t						m_Size;
+	size_t						m_Offset;
+	std::string					m_ErrorId;
+};
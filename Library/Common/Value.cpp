@@ -35,6 +35,8 @@ std::string QScript::Value::ToString() const
 		}
 		case OT_UPVALUE: return "<upvalue>";
 		case OT_TABLE: return "<table, " + AS_TABLE( *this )->GetName() + ">";
+		case OT_CLASS: return "<class, " + AS_CLASS( *this )->GetName() + ">";
+		case OT_INSTANCE: return "<instance, " + AS_INSTANCE( *this )->GetClass()->GetName() + ">";
 		case OT_ARRAY:
 		{
 			auto arr = AS_ARRAY( *this );
@@ -50,6 +52,21 @@ std::string QScript::Value::ToString() const
 
 			return "<array, " + nameString + itemsString + ">";
 		}
+		case OT_FLOAT64_ARRAY:
+		{
+			auto arr = AS_FLOAT64_ARRAY( *this );
+			auto& items = arr->GetArray();
+
+			std::string nameString = arr->GetName();
+			std::string itemsString;
+			for ( auto item : items )
+				itemsString += ", " + MAKE_NUMBER( item ).ToString();
+
+			if ( nameString.length() == 0 )
+				nameString = "<anonymous>";
+
+			return "<float64array, " + nameString + itemsString + ">";
+		}
 		default:
 		{
 #ifndef QVM_DEBUG
@@ -54,6 +54,7 @@
 #define MAKE_UPVALUE( valuePtr )	(MAKE_OBJECT( QScript::Object::AllocateUpvalue( valuePtr ) ))
 #define MAKE_TABLE( tableName )		(MAKE_OBJECT( QScript::Object::AllocateTable( tableName ) ))
 #define MAKE_ARRAY( arrayName )		(MAKE_OBJECT( QScript::Object::AllocateArray( arrayName ) ))
+#define MAKE_FLOAT64_ARRAY( arrayName )	(MAKE_OBJECT( QScript::Object::AllocateFloat64Array( arrayName ) ))
 
 #define AS_STRING( value )			((QScript::StringObject*)(AS_OBJECT(value)))
 #define AS_FUNCTION( value )		((QScript::FunctionObject*)(AS_OBJECT(value)))
@@ -61,6 +62,9 @@
 #define AS_CLOSURE( value )			((QScript::ClosureObject*)(AS_OBJECT(value)))
 #define AS_TABLE( value )			((QScript::TableObject*)(AS_OBJECT(value)))
 #define AS_ARRAY( value )			((QScript::ArrayObject*)(AS_OBJECT(value)))
+#define AS_FLOAT64_ARRAY( value )	((QScript::Float64ArrayObject*)(AS_OBJECT(value)))
+#define AS_CLASS( value )			((QScript::ClassObject*)(AS_OBJECT(value)))
+#define AS_INSTANCE( value )		((QScript::InstanceObject*)(AS_OBJECT(value)))
 
 #define IS_ANY( value ) 			(true)
 #define IS_STRING( value )			((value).IsObjectOfType<QScript::ObjectType::OT_STRING>())
@@ -70,6 +74,9 @@
 #define IS_UPVALUE( value )			((value).IsObjectOfType<QScript::ObjectType::OT_UPVALUE>())
 #define IS_TABLE( value )			((value).IsObjectOfType<QScript::ObjectType::OT_TABLE>())
 #define IS_ARRAY( value )			((value).IsObjectOfType<QScript::ObjectType::OT_ARRAY>())
+#define IS_FLOAT64_ARRAY( value )	((value).IsObjectOfType<QScript::ObjectType::OT_FLOAT64_ARRAY>())
+#define IS_CLASS( value )			((value).IsObjectOfType<QScript::ObjectType::OT_CLASS>())
+#define IS_INSTANCE( value )		((value).IsObjectOfType<QScript::ObjectType::OT_INSTANCE>())
 
 #define ENCODE_LONG( a, index ) (( uint8_t )( ( a >> ( 8 * index ) ) & 0xFF ))
 #define DECODE_LONG( a, b, c, d ) (( uint32_t ) ( a + 0x100UL * b + 0x10000UL * c + 0x1000000UL * d ))
@@ -143,6 +150,9 @@ namespace QScript
 	class UpvalueObject;
 	class TableObject;
 	class ArrayObject;
+	class Float64ArrayObject;
+	class ClassObject;
+	class InstanceObject;
 
 	enum ValueType : char
 	{
@@ -157,8 +167,11 @@ namespace QScript
 	{
 		OT_INVALID = 0,
 		OT_ARRAY,
+		OT_CLASS,
 		OT_CLOSURE,
+		OT_FLOAT64_ARRAY,
 		OT_FUNCTION,
+		OT_INSTANCE,
 		OT_NATIVE,
 		OT_STRING,
 		OT_TABLE,
@@ -168,6 +181,7 @@ namespace QScript
 	class Object
 	{
 	public:
+		Object() : m_Type( OT_INVALID ), m_IsReachable( false ) {};
 		virtual ~Object() {};
 
 		ObjectType 		m_Type;
@@ -180,14 +194,17 @@ namespace QScript
 		using UpvalueAllocatorFn = UpvalueObject * ( *)( Value* valuePtr );
 		using TableAllocatorFn = TableObject * ( *)( const std::string& name );
 		using ArrayAllocatorFn = ArrayObject * ( *)( const std::string& name );
-
-		static StringAllocatorFn AllocateString;
-		static FunctionAllocatorFn AllocateFunction;
-		static NativeAllocatorFn AllocateNative;
-		static ClosureAllocatorFn AllocateClosure;
-		static UpvalueAllocatorFn AllocateUpvalue;
-		static TableAllocatorFn AllocateTable;
-		static ArrayAllocatorFn AllocateArray;
+		using Float64ArrayAllocatorFn = Float64ArrayObject * ( *)( const std::string& name );
+
+		// Allocators of the VM (or compiler) running on the current thread
+		static thread_local StringAllocatorFn AllocateString;
+		static thread_local FunctionAllocatorFn AllocateFunction;
+		static thread_local NativeAllocatorFn AllocateNative;
+		static thread_local ClosureAllocatorFn AllocateClosure;
+		static thread_local UpvalueAllocatorFn AllocateUpvalue;
+		static thread_local TableAllocatorFn AllocateTable;
+		static thread_local ArrayAllocatorFn AllocateArray;
+		static thread_local Float64ArrayAllocatorFn AllocateFloat64Array;
 	};
 
 	// Value struct -- must be trivially copyable for stack relocations to work
@@ -14,8 +14,8 @@
 #define IS_STATEMENT( options ) (!(options & CO_EXPRESSION))
 #define IS_ASSIGN_TARGET( options ) ((options & (CO_ASSIGN | CO_REASSIGN)))
 
-#define EXPECTED_EXPRESSION CompilerException( "cp_expected_expression", "Expected an expression, got: \"" + m_Token + "\" (statement)", m_LineNr, m_ColNr, m_Token );
-#define EXPECTED_STATEMENT CompilerException( "cp_expected_statement", "Expected a statement, got: \"" + m_Token + "\" (expression)", m_LineNr, m_ColNr, m_Token );
+#define EXPECTED_EXPRESSION CompilerException( "cp_expected_expression", "Expected an expression, got: \"" + Token() + "\" (statement)", m_LineNr, m_ColNr, Token() );
+#define EXPECTED_STATEMENT CompilerException( "cp_expected_statement", "Expected a statement, got: \"" + Token() + "\" (expression)", m_LineNr, m_ColNr, Token() );
 
 namespace Compiler
 {
@@ -44,7 +44,7 @@ namespace Compiler
 
 	uint32_t EmitConstant( QScript::Chunk_t* chunk, const QScript::Value& value, QScript::OpCode shortOpCode, QScript::OpCode longOpCode, Compiler::Assembler& assembler )
 	{
-		uint32_t constant = AddConstant( value, chunk );
+		uint32_t constant = assembler.AddConstant( value, chunk );
 
 		if ( constant > 255 )
 		{
@@ -133,6 +133,37 @@ namespace Compiler
 		}
 	}
 
+	struct Branch_t
+	{
+		QScript::OpCode		m_Short;
+		QScript::OpCode		m_Long;
+		bool				m_IsFused;		// The branch pops the operands, there is no condition value to pop
+	};
+
+	// Branch taken when a condition is false. Comparisons are fused with the branch
+	Branch_t ConditionBranch( const BaseNode* condition )
+	{
+		switch ( condition->Id() )
+		{
+		case NODE_LESSTHAN: return Branch_t{ QScript::OpCode::OP_JUMP_IF_NOT_LT_SHORT, QScript::OpCode::OP_JUMP_IF_NOT_LT_LONG, true };
+		case NODE_LESSEQUAL: return Branch_t{ QScript::OpCode::OP_JUMP_IF_NOT_LE_SHORT, QScript::OpCode::OP_JUMP_IF_NOT_LE_LONG, true };
+		case NODE_GREATERTHAN: return Branch_t{ QScript::OpCode::OP_JUMP_IF_NOT_GT_SHORT, QScript::OpCode::OP_JUMP_IF_NOT_GT_LONG, true };
+		case NODE_GREATEREQUAL: return Branch_t{ QScript::OpCode::OP_JUMP_IF_NOT_GE_SHORT, QScript::OpCode::OP_JUMP_IF_NOT_GE_LONG, true };
+		case NODE_EQUALS: return Branch_t{ QScript::OpCode::OP_JUMP_IF_NOT_EQ_SHORT, QScript::OpCode::OP_JUMP_IF_NOT_EQ_LONG, true };
+		case NODE_NOTEQUALS: return Branch_t{ QScript::OpCode::OP_JUMP_IF_NOT_NE_SHORT, QScript::OpCode::OP_JUMP_IF_NOT_NE_LONG, true };
+		default: return Branch_t{ QScript::OpCode::OP_JUMP_IF_ZERO_SHORT, QScript::OpCode::OP_JUMP_IF_ZERO_LONG, false };
+		}
+	}
+
+	// Compiles the condition of a branch, the branch is placed with PlaceJump
+	Branch_t CompileCondition( BaseNode* condition, Assembler& assembler, uint32_t options )
+	{
+		auto branch = ConditionBranch( condition );
+
+		condition->Compile( assembler, branch.m_IsFused ? ( COMPILE_EXPRESSION( options ) | CO_BRANCH ) : COMPILE_EXPRESSION( options ) );
+		return branch;
+	}
+
 	void RequireAssignability( BaseNode* node )
 	{
 		switch ( node->Id() )
@@ -198,8 +229,46 @@ namespace Compiler
 		return argsList;
 	}
 
-	QScript::FunctionObject* CompileFunction( bool isAnonymous, bool isConst, bool isMember, const std::string& name, ListNode* funcNode,
-		Assembler& assembler, uint32_t* outReturnType = NULL, int lineNr = -1, int colNr = -1 )
+	// Compiles arguments and body of the function the assembler is in, and finishes it
+	void CompileFunctionBody( ListNode* funcNode, QScript::FunctionObject* function, bool addArguments, Assembler& assembler,
+		std::vector< Assembler::Upvalue_t >* upvalues, int lineNr = -1, int colNr = -1 )
+	{
+		auto& nodeList = funcNode->GetList();
+
+		assembler.PushScope();
+
+		// Create args in scope
+		auto argsList = ParseArgsList( static_cast< ListNode* >( nodeList[ 0 ] ) );
+		std::for_each( argsList.begin(), argsList.end(), [ &assembler, &function, addArguments ]( const Argument_t& item ) {
+			if ( addArguments )
+				function->AddArgument( item.m_Name, item.m_Type, TYPE_UNKNOWN ); // TODO: Return type support
+
+			assembler.AddLocal( item.m_Name, true, item.m_LineNr, item.m_ColNr, item.m_Type, TYPE_UNKNOWN );
+		} );
+
+		// Compile function body
+		for ( auto node : static_cast< ListNode* >( nodeList[ 1 ] )->GetList() )
+			node->Compile( assembler, COMPILE_STATEMENT( 0 ) );
+
+		// Remove body scope
+		assembler.FinishFunction( lineNr, colNr, upvalues );
+	}
+
+	void CompileDeferredFunction( ListNode* funcNode, QScript::FunctionObject* function, bool isAnonymous, bool isConst,
+		uint32_t returnType, Assembler& assembler )
+	{
+		std::vector< Assembler::Upvalue_t > upvalues;
+
+		assembler.EnterFunction( function, isConst, returnType, isAnonymous, true );
+		CompileFunctionBody( funcNode, function, false, assembler, &upvalues );
+
+		assert( upvalues.empty() );
+	}
+
+	// memberOf is the type of "this" in methods, TYPE_NONE for other functions. Class methods
+	// pass the layout of the class as memberRecord.
+	QScript::FunctionObject* CompileFunction( bool isAnonymous, bool isConst, uint32_t memberOf, const std::string& name, ListNode* funcNode,
+		Assembler& assembler, uint32_t* outReturnType = NULL, int lineNr = -1, int colNr = -1, const Record_t* memberRecord = NULL )
 	{
 		auto chunk = assembler.CurrentChunk();
 		auto& nodeList = funcNode->GetList();
@@ -207,32 +276,41 @@ namespace Compiler
 		auto argNode = static_cast< ListNode* >( nodeList[ 0 ] );
 		auto returnType = ResolveReturnType( funcNode, assembler );
 
-		// Allocate chunk & create function
-		auto function = assembler.CreateFunction( name, isConst, returnType, isAnonymous, !isMember, QScript::AllocChunk() );
-
 		if ( outReturnType )
 			*outReturnType = returnType;
 
-		if ( isMember )
-			assembler.AddLocal( "this", false, -1, -1, TYPE_TABLE );
+		// Functions declared at the top level can't capture anything, lazy scripts only generate
+		// their code once they are called
+		if ( memberOf == TYPE_NONE && assembler.IsLazy() && assembler.IsTopLevel() && assembler.StackDepth() == 0 )
+		{
+			auto function = QS_NEW QScript::FunctionObject( name, QScript::AllocChunk() );
 
-		assembler.PushScope();
+			for ( auto& arg : ParseArgsList( argNode ) )
+				function->AddArgument( arg.m_Name, arg.m_Type, TYPE_UNKNOWN );
 
-		// Create args in scope
-		auto argsList = ParseArgsList( argNode );
-		std::for_each( argsList.begin(), argsList.end(), [ &assembler, &function ]( const Argument_t& item ) {
-			function->AddArgument( item.m_Name, item.m_Type, TYPE_UNKNOWN ); // TODO: Return type support
-			assembler.AddLocal( item.m_Name, true, item.m_LineNr, item.m_ColNr, item.m_Type, TYPE_UNKNOWN );
-		} );
+			function->Defer( DeferFunction( assembler, funcNode, isAnonymous, isConst, returnType ) );
+			function->ShareClosure();
 
-		// Compile function body
-		for ( auto node : static_cast< ListNode* >( nodeList[ 1 ] )->GetList() )
-			node->Compile( assembler, COMPILE_STATEMENT( 0 ) );
+			EmitConstant( chunk, MAKE_OBJECT( function ), QScript::OpCode::OP_CLOSURE_SHORT,
+				QScript::OpCode::OP_CLOSURE_LONG, assembler );
+
+			return function;
+		}
+
+		// Allocate chunk & create function
+		auto function = assembler.CreateFunction( name, isConst, returnType, isAnonymous, memberOf == TYPE_NONE, QScript::AllocChunk() );
+
+		// Class methods are only ever called on instances of their class, their "this" can't be reassigned
+		if ( memberOf != TYPE_NONE )
+			assembler.AddLocal( "this", memberOf == TYPE_INSTANCE, -1, -1, memberOf, TYPE_UNKNOWN, NULL, memberRecord );
 
 		std::vector< Assembler::Upvalue_t > upvalues;
+		CompileFunctionBody( funcNode, function, true, assembler, &upvalues, lineNr, colNr );
 
-		// Remove body scope
-		assembler.FinishFunction( lineNr, colNr, &upvalues );
+		// Functions that capture nothing and are never bound evaluate to a single closure, const
+		// ones are also called directly through it. Class methods get "this" from the call.
+		if ( memberOf != TYPE_TABLE && upvalues.empty() )
+			function->ShareClosure();
 
 		// Create a constant (function) in enclosing chunk
 		EmitConstant( chunk, MAKE_OBJECT( function ), QScript::OpCode::OP_CLOSURE_SHORT,
@@ -251,7 +329,72 @@ namespace Compiler
 		return function;
 	}
 
-	BaseNode::BaseNode( int lineNr, int colNr, const std::string token, NodeType type, NodeId id )
+	static const size_t s_ArenaBlockSize = 64 * 1024;
+
+	NodeArena::NodeArena()
+	{
+		m_Blocks = NULL;
+		m_BlockCursor = NULL;
+		m_BlockLeft = 0;
+	}
+
+	NodeArena::~NodeArena()
+	{
+		for ( auto object : m_Objects )
+			delete object;
+
+		while ( m_Blocks )
+		{
+			auto next = *( uint8_t** ) m_Blocks;
+			std::free( m_Blocks );
+			m_Blocks = next;
+		}
+	}
+
+	void NodeArena::AllocateBlock( size_t size )
+	{
+		// Each block starts with a link to the previously allocated block
+		size_t header = s_Alignment;
+		size_t blockSize = std::max( size + header, s_ArenaBlockSize );
+
+		auto block = ( uint8_t* ) std::malloc( blockSize );
+
+		if ( !block )
+			throw std::bad_alloc();
+
+		*( uint8_t** ) block = m_Blocks;
+		m_Blocks = block;
+		m_BlockCursor = block + header;
+		m_BlockLeft = blockSize - header;
+	}
+
+	std::string_view NodeArena::CopyString( std::string_view string )
+	{
+		if ( string.empty() )
+			return std::string_view();
+
+		auto memory = ( char* ) Allocate( string.length() );
+		std::memcpy( memory, string.data(), string.length() );
+		return std::string_view( memory, string.length() );
+	}
+
+	NodeList_t NodeArena::CopyList( const std::vector< BaseNode* >& list )
+	{
+		if ( list.empty() )
+			return NodeList_t{ NULL, 0 };
+
+		auto memory = ( BaseNode** ) Allocate( list.size() * sizeof( BaseNode* ) );
+		std::memcpy( memory, list.data(), list.size() * sizeof( BaseNode* ) );
+		return NodeList_t{ memory, list.size() };
+	}
+
+	void NodeArena::AdoptObjects( std::vector< QScript::Object* >& objects )
+	{
+		m_Objects.insert( m_Objects.end(), objects.begin(), objects.end() );
+		objects.clear();
+	}
+
+	BaseNode::BaseNode( int lineNr, int colNr, std::string_view token, NodeType type, NodeId id )
 	{
 		m_LineNr		= lineNr;
 		m_ColNr			= colNr;
@@ -260,7 +403,7 @@ namespace Compiler
 		m_NodeId		= id;
 	}
 
-	TermNode::TermNode( int lineNr, int colNr, const std::string token, NodeId id )
+	TermNode::TermNode( int lineNr, int colNr, std::string_view token, NodeId id )
 		: BaseNode( lineNr, colNr, token, NT_TERM, id )
 	{
 	}
@@ -292,13 +435,13 @@ namespace Compiler
 			break;
 		}
 		default:
-			throw CompilerException( "cp_invalid_term_node", "Unknown terminating node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, m_Token );
+			throw CompilerException( "cp_invalid_term_node", "Unknown terminating node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, Token() );
 		}
 
-		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, m_Token );
+		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, Token() );
 	}
 
-	ValueNode::ValueNode( int lineNr, int colNr, const std::string token, NodeId id, const QScript::Value& value )
+	ValueNode::ValueNode( int lineNr, int colNr, std::string_view token, NodeId id, const QScript::Value& value )
 		: BaseNode( lineNr, colNr, token, NT_VALUE, id )
 	{
 		m_Value = value;
@@ -331,7 +474,7 @@ namespace Compiler
 					if ( ( options & CO_REASSIGN ) && varInfo.m_IsConst )
 					{
 						throw CompilerException( "cp_assign_to_const", "Assigning to constant variable: \"" + varInfo.m_Name + "\"",
-							m_LineNr, m_ColNr, m_Token );
+							m_LineNr, m_ColNr, Token() );
 					}
 
 					if ( nameIndex < QScript::OP_SET_LOCAL_MAX )
@@ -360,7 +503,7 @@ namespace Compiler
 				if ( ( options & CO_REASSIGN ) && varInfo.m_IsConst )
 				{
 					throw CompilerException( "cp_assign_to_const", "Assigning to constant variable: \"" + varInfo.m_Name + "\"",
-						m_LineNr, m_ColNr, m_Token );
+						m_LineNr, m_ColNr, Token() );
 				}
 
 				canEmit = true;
@@ -379,7 +522,7 @@ namespace Compiler
 					if ( ( options & CO_REASSIGN ) && varInfo.m_IsConst )
 					{
 						throw CompilerException( "cp_assign_to_const", "Assigning to constant variable: \"" + varInfo.m_Name + "\"",
-							m_LineNr, m_ColNr, m_Token );
+							m_LineNr, m_ColNr, Token() );
 					}
 
 					EmitConstant( chunk, m_Value, QScript::OpCode::OP_SET_GLOBAL_SHORT, QScript::OpCode::OP_SET_GLOBAL_LONG, assembler );
@@ -395,7 +538,7 @@ namespace Compiler
 			else
 			{
 				throw CompilerException( "cp_unknown_identifier", "Referenced an unknown identifier \"" + name + "\"",
-					m_LineNr, m_ColNr, m_Token );
+					m_LineNr, m_ColNr, Token() );
 			}
 
 			if ( canEmit )
@@ -446,40 +589,35 @@ namespace Compiler
 			break;
 		}
 		default:
-			throw CompilerException( "cp_invalid_value_node", "Unknown value node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, m_Token );
+			throw CompilerException( "cp_invalid_value_node", "Unknown value node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, Token() );
 		}
 
-		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, m_Token );
+		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, Token() );
 	}
 
-	ComplexNode::ComplexNode( int lineNr, int colNr, const std::string token, NodeId id, BaseNode* left, BaseNode* right )
+	ComplexNode::ComplexNode( int lineNr, int colNr, std::string_view token, NodeId id, BaseNode* left, BaseNode* right )
 		: BaseNode( lineNr, colNr, token, NT_COMPLEX, id )
 	{
 		m_Left = left;
 		m_Right = right;
 	}
 
-	void ComplexNode::Release()
+	const BaseNode* ComplexNode::GetLeft() const
 	{
-		if ( m_Left )
-		{
-			m_Left->Release();
-			delete m_Left;
-		}
+		return m_Left;
+	}
 
-		if ( m_Right )
-		{
-			m_Right->Release();
-			delete m_Right;
-		}
+	const BaseNode* ComplexNode::GetRight() const
+	{
+		return m_Right;
 	}
 
-	const BaseNode* ComplexNode::GetLeft() const
+	BaseNode* ComplexNode::GetLeft()
 	{
 		return m_Left;
 	}
 
-	const BaseNode* ComplexNode::GetRight() const
+	BaseNode* ComplexNode::GetRight()
 	{
 		return m_Right;
 	}
@@ -491,6 +629,11 @@ namespace Compiler
 
 		bool discardResult = IS_STATEMENT( options );
 
+		// Operands are compiled as usual, the branch does the comparison
+		bool isBranch = !!( options & CO_BRANCH );
+		bool isTailCall = !!( options & CO_TAIL_CALL );
+		options &= ~( CO_BRANCH | CO_TAIL_CALL );
+
 		switch ( m_NodeId )
 		{
 		case NODE_ACCESS_ARRAY:
@@ -523,6 +666,37 @@ namespace Compiler
 			// Right hand property string
 			auto propString = static_cast< ValueNode* >( m_Right )->GetValue();
 
+			// Fields of known class instances are accessed by slot
+			auto record = ResolveRecord( m_Left, TYPE_INSTANCE, assembler );
+			if ( record )
+			{
+				auto& propName = AS_STRING( propString )->GetString();
+				int field = record->FindField( propName );
+
+				if ( field == -1 && !record->HasMethod( propName ) )
+				{
+					throw CompilerException( "cp_unknown_property", "Class \"" + record->m_Name + "\" has no member \"" + propName + "\"",
+						m_Right->LineNr(), m_Right->ColNr(), m_Right->Token() );
+				}
+
+				if ( field != -1 && field <= 0xFF )
+				{
+					if ( IS_ASSIGN_TARGET( options ) )
+					{
+						// Number fields check the assigned value, others take anything
+						EmitByte( record->m_FieldTypes[ field ] == TYPE_NUMBER ? QScript::OpCode::OP_SET_SLOT_NUMBER : QScript::OpCode::OP_SET_SLOT, chunk );
+						discardResult = false;
+					}
+					else
+					{
+						EmitByte( QScript::OpCode::OP_LOAD_SLOT, chunk );
+					}
+
+					EmitByte( ( uint8_t ) field, chunk );
+					break;
+				}
+			}
+
 			if ( IS_ASSIGN_TARGET( options ) )
 			{
 				// stack@0: value_to_be_assigned
@@ -550,12 +724,12 @@ namespace Compiler
 				{
 					// Compile a named function
 					auto& varName = static_cast< ValueNode* >( m_Left )->GetValue();
-					CompileFunction( false, false, false, AS_STRING( varName )->GetString(), static_cast< ListNode* >( m_Right ), assembler );
+					CompileFunction( false, false, TYPE_NONE, AS_STRING( varName )->GetString(), static_cast< ListNode* >( m_Right ), assembler );
 				}
 				else
 				{
 					// Anonymous function
-					CompileFunction( true, false, false, "<anonymous>", static_cast< ListNode* >( m_Right ), assembler );
+					CompileFunction( true, false, TYPE_NONE, "<anonymous>", static_cast< ListNode* >( m_Right ), assembler );
 				}
 
 				m_Left->Compile( assembler, COMPILE_REASSIGN_TARGET( options ) );
@@ -574,7 +748,7 @@ namespace Compiler
 			{
 				throw CompilerException( "cp_invalid_expression_type", "Can not assign expression of type " +
 					TypeToString( rightType ) + " to variable of type " + TypeToString( leftType ),
-					m_LineNr, m_ColNr, m_Token );
+					m_LineNr, m_ColNr, Token() );
 			}
 			break;
 		}
@@ -684,10 +858,12 @@ namespace Compiler
 			auto args = static_cast< ListNode* >( m_Right )->GetList();
 
 			if ( args.size() > 255 )
-				throw CompilerException( "cp_too_many_args", "Too many arguments for a function call", m_LineNr, m_ColNr, m_Token );
+				throw CompilerException( "cp_too_many_args", "Too many arguments for a function call", m_LineNr, m_ColNr, Token() );
 
-			// Function object
-			m_Left->Compile( assembler, COMPILE_EXPRESSION( options ) );
+			QScript::FunctionObject* function = NULL;
+			Variable_t calleeInfo;
+			uint32_t calleeIndex = 0;
+			std::string calleeContext;
 
 			// Check arity if target can be resolved
 			if ( m_Left->Id() == NODE_NAME )
@@ -698,29 +874,29 @@ namespace Compiler
 				{
 					auto varName = AS_STRING( varNameValue )->GetString();
 
-					auto findFunction = [ &assembler ]( const std::string& name ) -> QScript::FunctionObject*
+					auto findFunction = [ &assembler, &calleeInfo, &calleeIndex, &calleeContext ]( const std::string& name ) -> QScript::FunctionObject*
 					{
-						Variable_t varInfo;
-						uint32_t nameIndex;
-
-						if ( !assembler.FindArgument( name, &varInfo ) &&
-							!assembler.FindLocal( name, &nameIndex, &varInfo ) &&
-							!assembler.FindUpvalue( name, &nameIndex, &varInfo ) &&
-							!assembler.FindGlobal( name, &varInfo ) )
-						{
+						if ( assembler.FindArgument( name, &calleeInfo ) )
+							calleeContext = "Argument";
+						else if ( assembler.FindLocal( name, &calleeIndex, &calleeInfo ) )
+							calleeContext = "Local";
+						else if ( assembler.FindUpvalue( name, &calleeIndex, &calleeInfo ) )
+							calleeContext = "Upvalue";
+						else if ( assembler.FindGlobal( name, &calleeInfo ) )
+							calleeContext = "Global";
+						else
 							return NULL;
-						}
 
-						if ( !varInfo.m_IsConst )
+						if ( !calleeInfo.m_IsConst )
 							return NULL;
 
-						if ( varInfo.m_Type != TYPE_FUNCTION )
+						if ( calleeInfo.m_Type != TYPE_FUNCTION )
 							return NULL;
 
-						return varInfo.m_Function;
+						return calleeInfo.m_Function;
 					};
 
-					auto function = findFunction( varName );
+					function = findFunction( varName );
 
 					if ( function )
 					{
@@ -755,11 +931,73 @@ namespace Compiler
 				}
 			}
 
+			// Const functions are called without loading them: a function calling itself by name
+			// calls the closure it runs in, a function that captures nothing is called through its
+			// shared closure. Arity was checked above.
+			bool isSelfCall = function && function == assembler.CurrentFunction() && calleeContext == "Local" && calleeIndex == 0;
+			bool isDirectCall = function && !isSelfCall && function->GetClosure();
+
+			// Property calls load the receiver in place of the callee, and look the method up
+			// when calling it. Methods are called with the receiver as "this" without binding them.
+			bool isInvoke = m_Left->Id() == NODE_ACCESS_PROP;
+
+			// Property calls stay regular calls, they look the callee up when calling it
+			if ( isInvoke )
+				isTailCall = false;
+
+			if ( isSelfCall || ( isDirectCall && !isTailCall ) )
+			{
+				if ( assembler.Config().m_IdentifierCb )
+					assembler.Config().m_IdentifierCb( m_Left->LineNr(), m_Left->ColNr(), calleeInfo, calleeContext );
+			}
+			else if ( isDirectCall )
+			{
+				if ( assembler.Config().m_IdentifierCb )
+					assembler.Config().m_IdentifierCb( m_Left->LineNr(), m_Left->ColNr(), calleeInfo, calleeContext );
+
+				EmitConstant( chunk, MAKE_OBJECT( function->GetClosure() ), QScript::OpCode::OP_LOAD_CONSTANT_SHORT,
+					QScript::OpCode::OP_LOAD_CONSTANT_LONG, assembler );
+			}
+			else if ( isInvoke )
+			{
+				static_cast< ComplexNode* >( m_Left )->GetLeft()->Compile( assembler, COMPILE_EXPRESSION( COMPILE_NON_ASSIGN( options ) ) );
+			}
+			else
+			{
+				// Function object
+				m_Left->Compile( assembler, COMPILE_EXPRESSION( options ) );
+			}
+
 			// Push arguments to stack
 			for ( auto arg : args )
 				arg->Compile( assembler, COMPILE_EXPRESSION( options ) );
 
-			if ( args.size() < QScript::OP_CALL_MAX )
+			if ( isTailCall )
+			{
+				// Followed by the return, which is reached when the callee doesn't replace the frame
+				EmitByte( isSelfCall ? QScript::OpCode::OP_TAIL_CALL_SELF : QScript::OpCode::OP_TAIL_CALL, chunk );
+				EmitByte( ( uint8_t ) args.size(), chunk );
+			}
+			else if ( isSelfCall )
+			{
+				EmitByte( QScript::OpCode::OP_CALL_SELF, chunk );
+				EmitByte( ( uint8_t ) args.size(), chunk );
+			}
+			else if ( isDirectCall )
+			{
+				EmitConstant( chunk, MAKE_OBJECT( function->GetClosure() ), QScript::OpCode::OP_CALL_DIRECT_SHORT,
+					QScript::OpCode::OP_CALL_DIRECT_LONG, assembler );
+
+				EmitByte( ( uint8_t ) args.size(), chunk );
+			}
+			else if ( isInvoke )
+			{
+				auto propString = static_cast< ValueNode* >( static_cast< ComplexNode* >( m_Left )->GetRight() )->GetValue();
+
+				EmitConstant( chunk, propString, QScript::OpCode::OP_INVOKE_SHORT, QScript::OpCode::OP_INVOKE_LONG, assembler );
+				EmitByte( ( uint8_t ) args.size(), chunk );
+			}
+			else if ( args.size() < QScript::OP_CALL_MAX )
 			{
 				EmitByte( QScript::OP_CALL_0 + ( uint8_t ) args.size(), chunk );
 			}
@@ -801,7 +1039,7 @@ namespace Compiler
 			{
 				throw CompilerException( "cp_invalid_expression_type", "Can not assign expression of type " +
 					TypeToString( TYPE_NUMBER ) + " to variable of type " + TypeToString( targetType ),
-					m_LineNr, m_ColNr, m_Token );
+					m_LineNr, m_ColNr, Token() );
 			}
 
 			// Place target variable's value on the stack
@@ -874,7 +1112,8 @@ namespace Compiler
 						m_Right->LineNr(), m_Right->ColNr(), m_Right->Token() );
 				}
 
-				EmitByte( opCode->second, chunk );
+				if ( !isBranch )
+					EmitByte( opCode->second, chunk );
 			}
 			else if ( ( opCode = otherOps.find( m_NodeId ) ) != otherOps.end() )
 			{
@@ -904,11 +1143,12 @@ namespace Compiler
 					isStringConcat = rightString || leftString;
 				}
 
-				EmitByte( opCode->second, chunk );
+				if ( !isBranch )
+					EmitByte( opCode->second, chunk );
 			}
 			else
 			{
-				throw CompilerException( "cp_invalid_complex_node", "Unknown complex node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, m_Token );
+				throw CompilerException( "cp_invalid_complex_node", "Unknown complex node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, Token() );
 			}
 
 			break;
@@ -918,24 +1158,15 @@ namespace Compiler
 		if ( discardResult )
 			EmitByte( QScript::OpCode::OP_POP, chunk );
 
-		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, m_Token );
+		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, Token() );
 	}
 
-	SimpleNode::SimpleNode( int lineNr, int colNr, const std::string token, NodeId id, BaseNode* node )
+	SimpleNode::SimpleNode( int lineNr, int colNr, std::string_view token, NodeId id, BaseNode* node )
 		: BaseNode( lineNr, colNr, token, NT_SIMPLE, id )
 	{
 		m_Node = node;
 	}
 
-	void SimpleNode::Release()
-	{
-		if ( m_Node )
-		{
-			m_Node->Release();
-			delete m_Node;
-		}
-	}
-
 	const BaseNode* SimpleNode::GetNode() const
 	{
 		return m_Node;
@@ -951,7 +1182,7 @@ namespace Compiler
 			if ( !assembler.IsTopLevel() || assembler.StackDepth() > 0 )
 			{
 				throw CompilerException( "cp_non_top_level_import", "Imports must be declared at top-level only",
-					LineNr(), ColNr(), m_Token );
+					LineNr(), ColNr(), Token() );
 			}
 
 			auto moduleName = static_cast< ValueNode* >( m_Node )->GetValue();
@@ -968,7 +1199,7 @@ namespace Compiler
 			module->Import( &assembler, m_Node->LineNr(), m_Node->ColNr() );
 
 			// Import in VM
-			uint32_t constIndex = AddConstant( moduleName, chunk );
+			uint32_t constIndex = assembler.AddConstant( moduleName, chunk );
 			EmitByte( QScript::OpCode::OP_IMPORT, chunk );
 			EmitByte( ENCODE_LONG( constIndex, 0 ), chunk );
 			EmitByte( ENCODE_LONG( constIndex, 1 ), chunk );
@@ -1003,7 +1234,11 @@ namespace Compiler
 			auto opCode = singleByte.find( m_NodeId );
 			if ( opCode != singleByte.end() )
 			{
-				if ( m_Node )
+				// Functions returning a call don't need their frame anymore when making it. The
+				// main function has nothing to return to.
+				if ( m_NodeId == NODE_RETURN && m_Node && m_Node->Id() == NODE_CALL && !assembler.IsTopLevel() )
+					m_Node->Compile( assembler, COMPILE_EXPRESSION( options ) | CO_TAIL_CALL );
+				else if ( m_Node )
 					m_Node->Compile( assembler, COMPILE_EXPRESSION( options ) );
 				else if ( m_NodeId == NODE_RETURN )
 					EmitByte( QScript::OpCode::OP_LOAD_NULL, chunk );
@@ -1012,34 +1247,20 @@ namespace Compiler
 			}
 			else
 			{
-				throw CompilerException( "cp_invalid_simple_node", "Unknown simple node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, m_Token );
+				throw CompilerException( "cp_invalid_simple_node", "Unknown simple node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, Token() );
 			}
 		}
 
-		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, m_Token );
+		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, Token() );
 	}
 
-	ListNode::ListNode( int lineNr, int colNr, const std::string token, NodeId id, const std::vector< BaseNode* >& nodeList )
+	ListNode::ListNode( int lineNr, int colNr, std::string_view token, NodeId id, const NodeList_t& nodeList )
 		: BaseNode( lineNr, colNr, token, NT_LIST, id )
 	{
 		m_NodeList = nodeList;
 	}
 
-	void ListNode::Release()
-	{
-		for ( auto node : m_NodeList )
-		{
-			if ( node )
-			{
-				node->Release();
-				delete node;
-			}
-		}
-
-		m_NodeList.clear();
-	}
-
-	const std::vector< BaseNode* >& ListNode::GetList() const
+	const NodeList_t& ListNode::GetList() const
 	{
 		return m_NodeList;
 	}
@@ -1085,7 +1306,7 @@ namespace Compiler
 					if ( !assembler.AddGlobal( varNameString, true, lineNr, colNr, TYPE_TABLE ) )
 					{
 						throw CompilerException( "cp_identifier_already_exists", "Identifier \"" + varNameString + "\" already exists",
-							m_LineNr, m_ColNr, m_Token );
+							m_LineNr, m_ColNr, Token() );
 					}
 
 					EmitConstant( chunk, varName, QScript::OpCode::OP_SET_GLOBAL_SHORT, QScript::OpCode::OP_SET_GLOBAL_LONG, assembler );
@@ -1135,7 +1356,7 @@ namespace Compiler
 						auto propNameNode = propNode->GetList()[ 0 ];
 
 						propName = static_cast< ValueNode* >( propNameNode )->GetValue();
-						CompileFunction( true, true, true, varNameString + "::" + AS_STRING( propName )->GetString(), funcNode, assembler, NULL,
+						CompileFunction( true, true, TYPE_TABLE, varNameString + "::" + AS_STRING( propName )->GetString(), funcNode, assembler, NULL,
 							propNameNode->LineNr(), propNameNode->ColNr() );
 
 						EmitByte( QScript::OpCode::OP_LOAD_TOP_SHORT, chunk );
@@ -1201,6 +1422,139 @@ namespace Compiler
 				EmitByte( QScript::OpCode::OP_POP, chunk );
 			break;
 		}
+		case NODE_CLASS:
+		{
+			if ( !IS_STATEMENT( options ) )
+				throw EXPECTED_EXPRESSION;
+
+			bool isLocal = ( assembler.StackDepth() > 0 );
+
+			// m_NodeList[ 0 ] should be NODE_NAME and is validated during parsing
+			auto& className = static_cast< ValueNode* >( m_NodeList[ 0 ] )->GetValue();
+			auto classNameString = AS_STRING( className )->GetString();
+
+			int lineNr = m_NodeList[ 0 ]->LineNr();
+			int colNr = m_NodeList[ 0 ]->ColNr();
+
+			auto& members = static_cast< ListNode* >( m_NodeList[ 1 ] )->GetList();
+
+			// Lay the class out before compiling its members, so their field accesses are compiled to slots
+			Record_t layout;
+			layout.m_Name = classNameString;
+
+			for ( auto member : members )
+			{
+				if ( member->Id() != NODE_FIELD && member->Id() != NODE_METHOD )
+					continue;
+
+				auto& memberList = static_cast< ListNode* >( member )->GetList();
+				auto memberNameString = AS_STRING( static_cast< ValueNode* >( memberList[ 0 ] )->GetValue() )->GetString();
+
+				if ( member->Id() == NODE_METHOD )
+				{
+					layout.m_Methods.push_back( memberNameString );
+					continue;
+				}
+
+				// Duplicates are reported below, the first declaration keeps the slot
+				if ( layout.FindField( memberNameString ) != -1 )
+					continue;
+
+				auto fieldType = ( uint32_t ) AS_NUMBER( static_cast< ValueNode* >( memberList[ 1 ] )->GetValue() );
+
+				if ( ( fieldType & TYPE_AUTO ) && memberList[ 2 ] && memberList[ 2 ]->ExprType( assembler ) == TYPE_NUMBER )
+					fieldType = TYPE_NUMBER;
+
+				layout.m_Fields.push_back( memberNameString );
+				layout.m_FieldTypes.push_back( fieldType == TYPE_NUMBER ? TYPE_NUMBER : TYPE_UNKNOWN );
+			}
+
+			auto record = assembler.AddRecord( layout );
+
+			EmitConstant( chunk, className, QScript::OpCode::OP_CREATE_CLASS_SHORT, QScript::OpCode::OP_CREATE_CLASS_LONG, assembler );
+
+			// Declare the class before its members, so methods can create instances of it
+			if ( !isLocal )
+			{
+				if ( !assembler.AddGlobal( classNameString, true, lineNr, colNr, TYPE_CLASS, TYPE_INSTANCE, NULL, record ) )
+				{
+					throw CompilerException( "cp_identifier_already_exists", "Identifier \"" + classNameString + "\" already exists",
+						lineNr, colNr, m_NodeList[ 0 ]->Token() );
+				}
+
+				EmitConstant( chunk, className, QScript::OpCode::OP_SET_GLOBAL_SHORT, QScript::OpCode::OP_SET_GLOBAL_LONG, assembler );
+			}
+			else
+			{
+				assembler.AddLocal( classNameString, true, lineNr, colNr, TYPE_CLASS, TYPE_INSTANCE, NULL, record );
+			}
+
+			std::unordered_set< std::string > memberNames;
+
+			for ( auto member : members )
+			{
+				if ( member->Id() != NODE_FIELD && member->Id() != NODE_METHOD )
+				{
+					throw CompilerException( "cp_invalid_class_member", "Classes can only declare fields and methods, got: \"" + member->Token() + "\"",
+						member->LineNr(), member->ColNr(), member->Token() );
+				}
+
+				auto memberNode = static_cast< ListNode* >( member );
+				auto memberNameNode = memberNode->GetList()[ 0 ];
+				auto& memberName = static_cast< ValueNode* >( memberNameNode )->GetValue();
+				auto memberNameString = AS_STRING( memberName )->GetString();
+
+				// Fields and methods share a namespace, instances look up either by name
+				if ( !memberNames.insert( memberNameString ).second )
+				{
+					throw CompilerException( "cp_identifier_already_exists", "Member \"" + memberNameString + "\" already exists",
+						memberNameNode->LineNr(), memberNameNode->ColNr(), memberNameNode->Token() );
+				}
+
+				if ( member->Id() == NODE_FIELD )
+				{
+					// Defaults are evaluated once, when the class is declared
+					auto defaultValueNode = memberNode->GetList()[ 2 ];
+					bool isNumber = record->m_FieldTypes[ record->FindField( memberNameString ) ] == TYPE_NUMBER;
+
+					if ( defaultValueNode )
+					{
+						auto defaultType = defaultValueNode->ExprType( assembler );
+
+						if ( isNumber && !TypeCheck( TYPE_NUMBER, defaultType ) )
+						{
+							throw CompilerException( "cp_invalid_expression_type", "Can not assign expression of type " +
+								TypeToString( defaultType ) + " to field of type " + TypeToString( TYPE_NUMBER ),
+								defaultValueNode->LineNr(), defaultValueNode->ColNr(), defaultValueNode->Token() );
+						}
+
+						defaultValueNode->Compile( assembler, COMPILE_EXPRESSION( options ) );
+					}
+					else
+					{
+						EmitByte( isNumber ? QScript::OpCode::OP_LOAD_0 : QScript::OpCode::OP_LOAD_NULL, chunk );
+					}
+
+					if ( isNumber )
+						EmitConstant( chunk, memberName, QScript::OpCode::OP_CLASS_NUMBER_FIELD_SHORT, QScript::OpCode::OP_CLASS_NUMBER_FIELD_LONG, assembler );
+					else
+						EmitConstant( chunk, memberName, QScript::OpCode::OP_CLASS_FIELD_SHORT, QScript::OpCode::OP_CLASS_FIELD_LONG, assembler );
+				}
+				else
+				{
+					auto funcNode = static_cast< ListNode* >( memberNode->GetList()[ 1 ] );
+
+					CompileFunction( true, true, TYPE_INSTANCE, classNameString + "::" + memberNameString, funcNode, assembler, NULL,
+						memberNameNode->LineNr(), memberNameNode->ColNr(), record );
+
+					EmitConstant( chunk, memberName, QScript::OpCode::OP_CLASS_METHOD_SHORT, QScript::OpCode::OP_CLASS_METHOD_LONG, assembler );
+				}
+			}
+
+			if ( !isLocal )
+				EmitByte( QScript::OpCode::OP_POP, chunk );
+			break;
+		}
 		case NODE_ARRAY:
 		{
 			auto isStatement = IS_STATEMENT( options );
@@ -1234,7 +1588,7 @@ namespace Compiler
 					if ( !assembler.AddGlobal( varNameString, true, lineNr, colNr, TYPE_ARRAY ) )
 					{
 						throw CompilerException( "cp_identifier_already_exists", "Identifier \"" + varNameString + "\" already exists",
-							m_LineNr, m_ColNr, m_Token );
+							m_LineNr, m_ColNr, Token() );
 					}
 
 					EmitConstant( chunk, varName, QScript::OpCode::OP_SET_GLOBAL_SHORT, QScript::OpCode::OP_SET_GLOBAL_LONG, assembler );
@@ -1267,25 +1621,27 @@ namespace Compiler
 			if ( !IS_STATEMENT( options ) )
 				throw EXPECTED_EXPRESSION;
 
+			auto branch = ConditionBranch( m_NodeList[ 1 ] );
+
 			// Jump over wrapper to pop conditional value
 			uint32_t condWrapperJump = ( uint32_t ) chunk->m_Code.size();
-
-			// Pop condition value
-			EmitByte( QScript::OpCode::OP_POP, chunk );
-
-			// Jump over wrapper on first iteration
 			uint32_t condWrapperBegin = condWrapperJump;
-			condWrapperBegin += PlaceJump( chunk, condWrapperJump, ( uint32_t ) chunk->m_Code.size() - condWrapperJump,
-				QScript::OpCode::OP_JUMP_SHORT, QScript::OpCode::OP_JUMP_LONG );
 
-			// Address to loop back to
-			uint32_t bodyBegin = ( uint32_t ) chunk->m_Code.size();
+			if ( !branch.m_IsFused )
+			{
+				// Pop condition value
+				EmitByte( QScript::OpCode::OP_POP, chunk );
+
+				// Jump over wrapper on first iteration
+				condWrapperBegin += PlaceJump( chunk, condWrapperJump, ( uint32_t ) chunk->m_Code.size() - condWrapperJump,
+					QScript::OpCode::OP_JUMP_SHORT, QScript::OpCode::OP_JUMP_LONG );
+			}
 
 			// Loop body
 			m_NodeList[ 0 ]->Compile( assembler, COMPILE_STATEMENT( options ) );
 
 			// Loop condition
-			m_NodeList[ 1 ]->Compile( assembler, COMPILE_EXPRESSION( options ) );
+			CompileCondition( m_NodeList[ 1 ], assembler, options );
 
 			uint32_t backJumpAddress = ( uint32_t ) chunk->m_Code.size();
 			uint32_t backJumpSize = backJumpAddress - condWrapperBegin;
@@ -1296,14 +1652,15 @@ namespace Compiler
 
 			// Skipping jump if condition is false
 			uint32_t overJumpPatchSize = PlaceJump( chunk, ( uint32_t ) chunk->m_Code.size() - backJumpPatchSize, backJumpPatchSize,
-				QScript::OpCode::OP_JUMP_IF_ZERO_SHORT, QScript::OpCode::OP_JUMP_IF_ZERO_LONG );
+				branch.m_Short, branch.m_Long );
 
 			// Correct backjump offset
 			PatchJump( chunk, backJumpAddress + overJumpPatchSize, backJumpSize + overJumpPatchSize,
 				QScript::OpCode::OP_JUMP_BACK_SHORT, QScript::OpCode::OP_JUMP_BACK_LONG );
 
 			// Pop condition value
-			EmitByte( QScript::OpCode::OP_POP, chunk );
+			if ( !branch.m_IsFused )
+				EmitByte( QScript::OpCode::OP_POP, chunk );
 			break;
 		}
 		case NODE_FOR:
@@ -1320,14 +1677,16 @@ namespace Compiler
 			uint32_t loopConditionBegin = ( uint32_t ) chunk->m_Code.size();
 
 			// Compile condition
+			Branch_t branch{ QScript::OpCode::OP_JUMP_IF_ZERO_SHORT, QScript::OpCode::OP_JUMP_IF_ZERO_LONG, false };
 			if ( m_NodeList[ 1 ] )
-				m_NodeList[ 1 ]->Compile( assembler, COMPILE_EXPRESSION( options ) );
+				branch = CompileCondition( m_NodeList[ 1 ], assembler, options );
 
 			// Jump to loop end
 			uint32_t loopSkipJump = ( uint32_t ) chunk->m_Code.size();
 
 			// Pop condition value
-			EmitByte( QScript::OpCode::OP_POP, chunk );
+			if ( !branch.m_IsFused )
+				EmitByte( QScript::OpCode::OP_POP, chunk );
 
 			uint32_t loopIncrementBegin = ( uint32_t ) chunk->m_Code.size();
 
@@ -1354,10 +1713,11 @@ namespace Compiler
 
 			// Jump to loop end
 			uint32_t jumpToLoopEndSize = PlaceJump( chunk, loopSkipJump, ( uint32_t ) chunk->m_Code.size() - loopSkipJump,
-				QScript::OpCode::OP_JUMP_IF_ZERO_SHORT, QScript::OpCode::OP_JUMP_IF_ZERO_LONG );
+				branch.m_Short, branch.m_Long );
 
 			// Pop condition value
-			EmitByte( QScript::OpCode::OP_POP, chunk );
+			if ( !branch.m_IsFused )
+				EmitByte( QScript::OpCode::OP_POP, chunk );
 
 			PatchJump( chunk, loopConditionJump + jumpToLoopEndSize + jumpToBodyOnFirstSize,
 				( loopConditionJump + jumpToBodyOnFirstSize + jumpToLoopEndSize ) - loopConditionBegin,
@@ -1371,7 +1731,7 @@ namespace Compiler
 			if ( IS_STATEMENT( options ) )
 				throw EXPECTED_STATEMENT;
 
-			CompileFunction( true, false, false, "<anonymous>", this, assembler );
+			CompileFunction( true, false, TYPE_NONE, "<anonymous>", this, assembler );
 			break;
 		}
 		case NODE_INLINE_IF:
@@ -1390,14 +1750,15 @@ namespace Compiler
 					throw EXPECTED_EXPRESSION;
 			}
 
-			// Compile condition, now the result is at the top of the stack
-			m_NodeList[ 0 ]->Compile( assembler, COMPILE_EXPRESSION( options ) );
+			// Compile condition, now the result is at the top of the stack unless it was fused with the branch
+			auto branch = CompileCondition( m_NodeList[ 0 ], assembler, options );
 
 			// Address of the next instruction from the jump
 			uint32_t thenBodyBegin = ( uint32_t ) chunk->m_Code.size();
 
 			// Pop condition value off stack
-			EmitByte( QScript::OpCode::OP_POP, chunk );
+			if ( !branch.m_IsFused )
+				EmitByte( QScript::OpCode::OP_POP, chunk );
 
 			// Compile body
 			m_NodeList[ 1 ]->Compile( assembler, isInline ? COMPILE_EXPRESSION( options ) : COMPILE_STATEMENT( options ) );
@@ -1405,7 +1766,8 @@ namespace Compiler
 			uint32_t elseBodyBegin = ( uint32_t ) chunk->m_Code.size();
 
 			// Pop condition value off stack
-			EmitByte( QScript::OpCode::OP_POP, chunk );
+			if ( !branch.m_IsFused )
+				EmitByte( QScript::OpCode::OP_POP, chunk );
 
 			// Compile optional else-branch
 			if ( m_NodeList[ 2 ] )
@@ -1413,13 +1775,15 @@ namespace Compiler
 
 			uint32_t elseBodyEnd = ( uint32_t ) chunk->m_Code.size();
 
-			// Jump over else branch
-			elseBodyBegin += PlaceJump( chunk, elseBodyBegin, elseBodyEnd - elseBodyBegin,
-				QScript::OpCode::OP_JUMP_SHORT, QScript::OpCode::OP_JUMP_LONG );
+			// Jump over else branch, if there is anything to jump over
+			if ( elseBodyEnd > elseBodyBegin )
+			{
+				elseBodyBegin += PlaceJump( chunk, elseBodyBegin, elseBodyEnd - elseBodyBegin,
+					QScript::OpCode::OP_JUMP_SHORT, QScript::OpCode::OP_JUMP_LONG );
+			}
 
 			// Create jump instruction
-			PlaceJump( chunk, thenBodyBegin, elseBodyBegin - thenBodyBegin,
-				QScript::OpCode::OP_JUMP_IF_ZERO_SHORT, QScript::OpCode::OP_JUMP_IF_ZERO_LONG );
+			PlaceJump( chunk, thenBodyBegin, elseBodyBegin - thenBodyBegin, branch.m_Short, branch.m_Long );
 
 			break;
 		}
@@ -1451,6 +1815,7 @@ namespace Compiler
 			bool isLocal = ( assembler.StackDepth() > 0 );
 			bool isConst = ( m_NodeId == NODE_CONSTVAR );
 			QScript::FunctionObject* fn = NULL;
+			const Record_t* record = NULL;
 
 			int lineNr = m_NodeList[ 0 ]->LineNr();
 			int colNr = m_NodeList[ 0 ]->ColNr();
@@ -1475,10 +1840,21 @@ namespace Compiler
 					varType = exprType;
 				}
 
+				// Constants holding an instance of a known class (or the class itself) keep its layout
+				if ( isConst && ( record = ResolveRecord( m_NodeList[ 1 ], TYPE_INSTANCE, assembler ) ) )
+				{
+					varType = TYPE_INSTANCE;
+				}
+				else if ( isConst && ( record = ResolveRecord( m_NodeList[ 1 ], TYPE_CLASS, assembler ) ) )
+				{
+					varType = TYPE_CLASS;
+					varReturnType = TYPE_INSTANCE;
+				}
+
 				if ( m_NodeList[ 1 ]->Id() == NODE_FUNC )
 				{
 					// Compile a named function
-					fn = CompileFunction( false, isConst, false, varString, static_cast< ListNode* >( m_NodeList[ 1 ] ), assembler, &varReturnType, lineNr, colNr );
+					fn = CompileFunction( false, isConst, TYPE_NONE, varString, static_cast< ListNode* >( m_NodeList[ 1 ] ), assembler, &varReturnType, lineNr, colNr );
 					varType = TYPE_FUNCTION;
 				}
 				else
@@ -1489,11 +1865,11 @@ namespace Compiler
 
 				if ( isLocal )
 				{
-					assembler.AddLocal( varString, isConst, lineNr, colNr, varType, varReturnType, fn );
+					assembler.AddLocal( varString, isConst, lineNr, colNr, varType, varReturnType, fn, record );
 				}
 				else
 				{
-					if ( !assembler.AddGlobal( varString, isConst, lineNr, colNr, varType, varReturnType, fn ) )
+					if ( !assembler.AddGlobal( varString, isConst, lineNr, colNr, varType, varReturnType, fn, record ) )
 					{
 						throw CompilerException( "cp_identifier_already_exists", "Identifier \"" + varString + "\" already exists",
 							lineNr, colNr, m_NodeList[ 0 ]->Token() );
@@ -1548,32 +1924,32 @@ namespace Compiler
 			uint32_t loopConditionBegin = ( uint32_t ) chunk->m_Code.size();
 
 			// Compile condition
-			m_NodeList[ 0 ]->Compile( assembler, COMPILE_EXPRESSION( options ) );
+			auto branch = CompileCondition( m_NodeList[ 0 ], assembler, options );
 
 			uint32_t loopBodyBegin = ( uint32_t ) chunk->m_Code.size();
 
-			EmitByte( QScript::OpCode::OP_POP, chunk );
+			if ( !branch.m_IsFused )
+				EmitByte( QScript::OpCode::OP_POP, chunk );
 
 			// Compile body
 			m_NodeList[ 1 ]->Compile( assembler, COMPILE_STATEMENT( options ) );
 
 			uint32_t firstJumpSize = ( uint32_t ) chunk->m_Code.size() - loopBodyBegin;
-			PlaceJump( chunk, loopBodyBegin, firstJumpSize + 5,
-				QScript::OpCode::OP_JUMP_IF_ZERO_SHORT, QScript::OpCode::OP_JUMP_IF_ZERO_LONG );
+			PlaceJump( chunk, loopBodyBegin, firstJumpSize + 5, branch.m_Short, branch.m_Long );
 
 			uint32_t patchSize = PlaceJump( chunk, ( uint32_t ) chunk->m_Code.size(), ( uint32_t ) chunk->m_Code.size() - loopConditionBegin,
 				QScript::OpCode::OP_JUMP_BACK_SHORT, QScript::OpCode::OP_JUMP_BACK_LONG );
 
-			PatchJump( chunk, loopBodyBegin, firstJumpSize + patchSize,
-				QScript::OpCode::OP_JUMP_IF_ZERO_SHORT, QScript::OpCode::OP_JUMP_IF_ZERO_LONG );
+			PatchJump( chunk, loopBodyBegin, firstJumpSize + patchSize, branch.m_Short, branch.m_Long );
 
-			EmitByte( QScript::OpCode::OP_POP, chunk );
+			if ( !branch.m_IsFused )
+				EmitByte( QScript::OpCode::OP_POP, chunk );
 			break;
 		}
 		default:
-			throw CompilerException( "cp_invalid_list_node", "Unknown list node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, m_Token );
+			throw CompilerException( "cp_invalid_list_node", "Unknown list node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, Token() );
 		}
 
-		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, m_Token );
+		AddDebugSymbol( assembler, start, m_LineNr, m_ColNr, Token() );
 	}
 }
@@ -3,6 +3,7 @@
 namespace Compiler
 {
 	class Assembler;
+	struct Record_t;
 
 	enum NodeType
 	{
@@ -31,6 +32,7 @@ namespace Compiler
 		NODE_ASSIGNSUB,
 		NODE_CALL,
 		NODE_TABLE,
+		NODE_CLASS,
 		NODE_CONSTANT,
 		NODE_CONSTVAR,
 		NODE_DEC,
@@ -74,6 +76,13 @@ namespace Compiler
 		// Expressions produce values, inform subsequent nodes that they should compile
 		// an expression.
 		CO_EXPRESSION			= ( 1 << 2 ),
+
+		// Condition of a branch, comparisons leave out the comparison and the branch
+		// compares its operands itself
+		CO_BRANCH				= ( 1 << 3 ),
+
+		// Call returned by a function, the callee takes over the frame of the caller
+		CO_TAIL_CALL			= ( 1 << 4 ),
 	};
 
 	enum CompileTypeInfo : uint32_t
@@ -99,6 +108,9 @@ namespace Compiler
 
 		// Hint compiler to deduce type
 		TYPE_AUTO				= ( 1 << 12 ),
+
+		// Objects, calling a class creates a TYPE_INSTANCE
+		TYPE_CLASS				= ( 1 << 13 ),
 	};
 
 	struct Argument_t
@@ -109,37 +121,112 @@ namespace Compiler
 		int				m_ColNr;
 	};
 
+	class BaseNode;
+
+	// Child nodes of a list node, stored in the node arena
+	struct NodeList_t
+	{
+		BaseNode**			m_Nodes;
+		size_t				m_Size;
+
+		size_t size()							const { return m_Size; }
+		bool empty()							const { return m_Size == 0; }
+		BaseNode* operator[]( size_t index )	const { return m_Nodes[ index ]; }
+		BaseNode* back()						const { return m_Nodes[ m_Size - 1 ]; }
+		BaseNode** begin()						const { return m_Nodes; }
+		BaseNode** end()						const { return m_Nodes + m_Size; }
+	};
+
+	// Compilation-scoped storage for AST nodes, their child lists and token strings.
+	// Nodes are never destructed one by one, the whole arena is freed at once.
+	class NodeArena
+	{
+	public:
+		// Nodes hold pointers, views and values, none needs more than 8 byte alignment
+		static const size_t s_Alignment = 8;
+
+		NodeArena();
+		~NodeArena();
+
+		NodeArena( const NodeArena& ) = delete;
+		NodeArena& operator=( const NodeArena& ) = delete;
+
+		FORCEINLINE void* Allocate( size_t size )
+		{
+			size = ( size + s_Alignment - 1 ) & ~( s_Alignment - 1 );
+
+			if ( size > m_BlockLeft )
+				AllocateBlock( size );
+
+			auto memory = m_BlockCursor;
+			m_BlockCursor += size;
+			m_BlockLeft -= size;
+			return memory;
+		}
+
+		std::string_view CopyString( std::string_view string );
+		NodeList_t CopyList( const std::vector< BaseNode* >& list );
+
+		// Take ownership of compiler objects referenced by the AST
+		void AdoptObjects( std::vector< QScript::Object* >& objects );
+
+		template <typename T, class... Args>
+		T* AllocateNode( int lineNr, int colNr, std::string_view token, Args&& ... args )
+		{
+			static_assert( std::is_base_of<BaseNode, T>::value, "Allocated node must derive from BaseNode" );
+			static_assert( std::is_trivially_destructible<T>::value, "Arena nodes are never destructed" );
+			static_assert( alignof( T ) <= s_Alignment, "Node alignment exceeds arena alignment" );
+
+			return new ( Allocate( sizeof( T ) ) ) T( lineNr, colNr, CopyString( token ), Store( std::forward< Args >( args ) )... );
+		}
+
+	private:
+		void AllocateBlock( size_t size );
+
+		NodeList_t Store( const std::vector< BaseNode* >& list ) { return CopyList( list ); }
+
+		template <typename T>
+		typename std::enable_if< !std::is_same< typename std::decay< T >::type, std::vector< BaseNode* > >::value, T&& >::type
+			Store( T&& arg ) { return std::forward< T >( arg ); }
+
+		uint8_t*							m_Blocks;
+		uint8_t*							m_BlockCursor;
+		size_t								m_BlockLeft;
+		std::vector< QScript::Object* >		m_Objects;
+	};
+
 	class BaseNode
 	{
 	public:
-		BaseNode( int lineNr, int colNr, const std::string token, NodeType type, NodeId id );
+		BaseNode( int lineNr, int colNr, std::string_view token, NodeType type, NodeId id );
 
 		NodeType Type()			const { return m_NodeType; }
 		NodeId Id()				const { return m_NodeId; }
 		int LineNr()			const { return m_LineNr; }
 		int ColNr()				const { return m_ColNr; }
-		std::string Token()		const { return m_Token; }
+		std::string Token()		const { return std::string( m_Token ); }
 		void SetId( NodeId id )	{ m_NodeId = id; }
 
-		virtual ~BaseNode() {}
-		virtual void Release() {};
 		virtual void Compile( Assembler& assembler, uint32_t options = CO_NONE ) = 0;
 		virtual std::string ToJson( const std::string& ind = "" ) const = 0;
 
 		virtual uint32_t ExprType( Assembler& assembler ) const { return Compiler::TYPE_NONE; }
 
+		// Optimize the subtree (QScript::Config_t::OptimizationFlags), returns the node replacing this one
+		virtual BaseNode* Optimize( NodeArena& arena, uint32_t flags ) { return this; }
+
 	protected:
 		NodeId				m_NodeId;
 		NodeType			m_NodeType;
 		int					m_LineNr;
 		int					m_ColNr;
-		std::string 		m_Token;
+		std::string_view	m_Token;
 	};
 
 	class TermNode : public BaseNode
 	{
 	public:
-		TermNode( int lineNr, int colNr, const std::string token, NodeId id );
+		TermNode( int lineNr, int colNr, std::string_view token, NodeId id );
 		void Compile( Assembler& assembler, uint32_t options = CO_NONE ) override;
 		std::string ToJson( const std::string& ind = "" ) const override;
 	};
@@ -147,7 +234,7 @@ namespace Compiler
 	class ValueNode : public BaseNode
 	{
 	public:
-		ValueNode( int lineNr, int colNr, const std::string token, NodeId id, const QScript::Value& value );
+		ValueNode( int lineNr, int colNr, std::string_view token, NodeId id, const QScript::Value& value );
 		void Compile( Assembler& assembler, uint32_t options = CO_NONE ) override;
 		uint32_t ExprType( Assembler& assembler ) const override;
 		std::string ToJson( const std::string& ind = "" ) const override;
@@ -161,15 +248,17 @@ namespace Compiler
 	class ComplexNode : public BaseNode
 	{
 	public:
-		ComplexNode( int lineNr, int colNr, const std::string token, NodeId id, BaseNode* left, BaseNode* right );
+		ComplexNode( int lineNr, int colNr, std::string_view token, NodeId id, BaseNode* left, BaseNode* right );
 
-		void Release() override;
 		void Compile( Assembler& assembler, uint32_t options = CO_NONE ) override;
 		uint32_t ExprType( Assembler& assembler ) const override;
+		BaseNode* Optimize( NodeArena& arena, uint32_t flags ) override;
 		std::string ToJson( const std::string& ind = "" ) const override;
 
 		const BaseNode* GetLeft() const;
 		const BaseNode* GetRight() const;
+		BaseNode* GetLeft();
+		BaseNode* GetRight();
 
 	private:
 		BaseNode*			m_Left;
@@ -179,11 +268,11 @@ namespace Compiler
 	class SimpleNode : public BaseNode
 	{
 	public:
-		SimpleNode( int lineNr, int colNr, const std::string token, NodeId id, BaseNode* node );
+		SimpleNode( int lineNr, int colNr, std::string_view token, NodeId id, BaseNode* node );
 
-		void Release() override;
 		void Compile( Assembler& assembler, uint32_t options = CO_NONE ) override;
 		uint32_t ExprType( Assembler& assembler ) const override;
+		BaseNode* Optimize( NodeArena& arena, uint32_t flags ) override;
 		std::string ToJson( const std::string& ind = "" ) const override;
 
 		const BaseNode* GetNode() const;
@@ -195,18 +284,26 @@ namespace Compiler
 	class ListNode : public BaseNode
 	{
 	public:
-		ListNode( int lineNr, int colNr, const std::string token, NodeId id, const std::vector< BaseNode* >& nodeList );
+		ListNode( int lineNr, int colNr, std::string_view token, NodeId id, const NodeList_t& nodeList );
 
-		void Release() override;
 		void Compile( Assembler& assembler, uint32_t options = CO_NONE ) override;
 		uint32_t ExprType( Assembler& assembler ) const override;
-		const std::vector< BaseNode* >& GetList() const;
+		BaseNode* Optimize( NodeArena& arena, uint32_t flags ) override;
+		const NodeList_t& GetList() const;
 		std::string ToJson( const std::string& ind = "" ) const override;
 
 	private:
-		std::vector< BaseNode* >		m_NodeList;
+		NodeList_t						m_NodeList;
 	};
 
 	uint32_t ResolveReturnType( const ListNode* funcNode, Assembler& assembler );
 	std::vector< Argument_t > ParseArgsList( ListNode* argNode );
+
+	// Generate the code of a function deferred by lazy compilation into its chunk
+	void CompileDeferredFunction( ListNode* funcNode, QScript::FunctionObject* function, bool isAnonymous, bool isConst,
+		uint32_t returnType, Assembler& assembler );
+
+	// Layout of the class (TYPE_CLASS) or instance (TYPE_INSTANCE) an expression is known to
+	// evaluate to, NULL if it can't be determined at compile time
+	const Record_t* ResolveRecord( const BaseNode* node, uint32_t kind, Assembler& assembler );
 }
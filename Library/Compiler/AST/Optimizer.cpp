@@ -0,0 +1,279 @@
+#include "QLibPCH.h"
+#include "../../Common/Value.h"
+#include "../../Common/Chunk.h"
+#include "../Compiler.h"
+#include "AST.h"
+
+// AST optimization pass. Every node optimizes its children first, and then returns the node
+// that takes its place in the tree. Constants are folded with the same Value operations the
+// VM runs, and only for operands that neither the compiler nor the VM would reject. Anything
+// that drops code, short-circuited operands included, is OF_DEAD_CODE and only runs on trees
+// that compile as written, see QScript::Compile.
+
+namespace Compiler
+{
+	using Config_t = QScript::Config_t;
+
+	static bool IsConstant( const BaseNode* node )
+	{
+		return node && node->Id() == NODE_CONSTANT;
+	}
+
+	static const QScript::Value& ConstantOf( const BaseNode* node )
+	{
+		return static_cast< const ValueNode* >( node )->GetValue();
+	}
+
+	static BaseNode* MakeConstant( NodeArena& arena, const BaseNode* node, const QScript::Value& value )
+	{
+		return arena.AllocateNode< ValueNode >( node->LineNr(), node->ColNr(), node->Token(), NODE_CONSTANT, value );
+	}
+
+	static BaseNode* MakeScope( NodeArena& arena, const BaseNode* node )
+	{
+		return arena.AllocateNode< ListNode >( node->LineNr(), node->ColNr(), node->Token(), NODE_SCOPE, std::vector< BaseNode* >{} );
+	}
+
+	static bool FoldBinary( NodeId id, const QScript::Value& a, const QScript::Value& b, QScript::Value* result )
+	{
+		// Value operators are not const in every build
+		QScript::Value left = a;
+		bool numbers = IS_NUMBER( a ) && IS_NUMBER( b );
+
+		switch ( id )
+		{
+		case NODE_ADD:
+		{
+			if ( numbers )
+			{
+				*result = MAKE_NUMBER( AS_NUMBER( a ) + AS_NUMBER( b ) );
+				return true;
+			}
+
+			// Concatenation, the compiler accepts strings and numbers only
+			bool concatenable = ( IS_STRING( a ) || IS_NUMBER( a ) ) && ( IS_STRING( b ) || IS_NUMBER( b ) );
+			if ( !concatenable )
+				return false;
+
+			*result = MAKE_STRING( a.ToString() + b.ToString() );
+			return true;
+		}
+		case NODE_SUB: if ( !numbers ) return false; *result = left - b; return true;
+		case NODE_MUL: if ( !numbers ) return false; *result = left * b; return true;
+		case NODE_DIV: if ( !numbers ) return false; *result = left / b; return true;
+		case NODE_MOD: if ( !numbers ) return false; *result = left % b; return true;
+		case NODE_POW: if ( !numbers ) return false; *result = left.Pow( b ); return true;
+		case NODE_GREATERTHAN: if ( !numbers ) return false; *result = left > b; return true;
+		case NODE_GREATEREQUAL: if ( !numbers ) return false; *result = left >= b; return true;
+		case NODE_LESSTHAN: if ( !numbers ) return false; *result = left < b; return true;
+		case NODE_LESSEQUAL: if ( !numbers ) return false; *result = left <= b; return true;
+		case NODE_EQUALS:
+		case NODE_NOTEQUALS:
+		{
+			bool equals = ( id == NODE_EQUALS );
+
+			if ( IS_STRING( a ) && IS_STRING( b ) )
+			{
+				bool same = AS_STRING( a )->GetString() == AS_STRING( b )->GetString();
+				*result = MAKE_BOOL( equals ? same : !same );
+				return true;
+			}
+
+			// Other objects compare by identity, which is only known at runtime
+			if ( IS_OBJECT( a ) || IS_OBJECT( b ) )
+				return false;
+
+			*result = equals ? ( left == b ) : ( left != b );
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+
+	static bool AlwaysReturns( const BaseNode* node )
+	{
+		switch ( node->Id() )
+		{
+		case NODE_RETURN:
+			return true;
+		case NODE_SCOPE:
+		{
+			auto& list = static_cast< const ListNode* >( node )->GetList();
+			return !list.empty() && AlwaysReturns( list.back() );
+		}
+		case NODE_IF:
+		{
+			auto& list = static_cast< const ListNode* >( node )->GetList();
+			return list[ 2 ] && AlwaysReturns( list[ 1 ] ) && AlwaysReturns( list[ 2 ] );
+		}
+		default:
+			return false;
+		}
+	}
+
+	BaseNode* ComplexNode::Optimize( NodeArena& arena, uint32_t flags )
+	{
+		if ( m_Left )
+			m_Left = m_Left->Optimize( arena, flags );
+
+		if ( m_Right )
+			m_Right = m_Right->Optimize( arena, flags );
+
+		if ( flags & Config_t::OF_CONSTANT_FOLDING )
+		{
+			bool deadCode = ( flags & Config_t::OF_DEAD_CODE ) != 0;
+
+			switch ( m_NodeId )
+			{
+			case NODE_AND:
+			{
+				// A falsy left operand is the result, otherwise the right one is
+				if ( deadCode && IsConstant( m_Left ) )
+					return ConstantOf( m_Left ).IsTruthy() ? m_Right : m_Left;
+				break;
+			}
+			case NODE_OR:
+			{
+				if ( deadCode && IsConstant( m_Left ) )
+					return ConstantOf( m_Left ).IsTruthy() ? m_Left : m_Right;
+				break;
+			}
+			default:
+			{
+				QScript::Value result;
+				if ( IsConstant( m_Left ) && IsConstant( m_Right ) && FoldBinary( m_NodeId, ConstantOf( m_Left ), ConstantOf( m_Right ), &result ) )
+					return MakeConstant( arena, this, result );
+				break;
+			}
+			}
+		}
+
+		if ( ( flags & Config_t::OF_STRENGTH_REDUCTION ) && IsConstant( m_Right ) && IS_NUMBER( ConstantOf( m_Right ) ) )
+		{
+			double operand = AS_NUMBER( ConstantOf( m_Right ) );
+
+			switch ( m_NodeId )
+			{
+			case NODE_POW:
+			{
+				// x ** 2 -> x * x, operand is a plain variable read so evaluating it twice is safe
+				if ( operand == 2.0 && m_Left->Id() == NODE_NAME )
+				{
+					m_NodeId = NODE_MUL;
+					m_Right = m_Left;
+				}
+				break;
+			}
+			case NODE_DIV:
+			{
+				// x / 2^n -> x * 2^-n, the reciprocal of a power of two is exact
+				int exponent;
+				double mantissa = std::frexp( operand, &exponent );
+				double reciprocal = 1.0 / operand;
+
+				if ( std::abs( mantissa ) == 0.5 && std::isfinite( reciprocal ) && reciprocal * operand == 1.0 )
+				{
+					m_NodeId = NODE_MUL;
+					m_Right = MakeConstant( arena, m_Right, MAKE_NUMBER( reciprocal ) );
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		return this;
+	}
+
+	BaseNode* SimpleNode::Optimize( NodeArena& arena, uint32_t flags )
+	{
+		if ( m_Node )
+			m_Node = m_Node->Optimize( arena, flags );
+
+		if ( !( flags & Config_t::OF_CONSTANT_FOLDING ) || !IsConstant( m_Node ) )
+			return this;
+
+		auto& value = ConstantOf( m_Node );
+
+		switch ( m_NodeId )
+		{
+		case NODE_NEG:
+			if ( IS_NUMBER( value ) )
+				return MakeConstant( arena, this, MAKE_NUMBER( -AS_NUMBER( value ) ) );
+			break;
+		case NODE_NOT:
+			if ( IS_BOOL( value ) )
+				return MakeConstant( arena, this, MAKE_BOOL( !AS_BOOL( value ) ) );
+			break;
+		default:
+			break;
+		}
+
+		return this;
+	}
+
+	BaseNode* ListNode::Optimize( NodeArena& arena, uint32_t flags )
+	{
+		for ( auto& node : m_NodeList )
+		{
+			if ( node )
+				node = node->Optimize( arena, flags );
+		}
+
+		if ( !( flags & Config_t::OF_DEAD_CODE ) )
+			return this;
+
+		switch ( m_NodeId )
+		{
+		case NODE_INLINE_IF:
+		{
+			if ( IsConstant( m_NodeList[ 0 ] ) )
+				return ConstantOf( m_NodeList[ 0 ] ).IsTruthy() ? m_NodeList[ 1 ] : m_NodeList[ 2 ];
+			break;
+		}
+		case NODE_IF:
+		{
+			if ( !IsConstant( m_NodeList[ 0 ] ) )
+				break;
+
+			// Both branches are parsed as scopes, an if without else leaves an empty one
+			auto branch = ConstantOf( m_NodeList[ 0 ] ).IsTruthy() ? m_NodeList[ 1 ] : m_NodeList[ 2 ];
+			return branch ? branch : MakeScope( arena, this );
+		}
+		case NODE_WHILE:
+		{
+			if ( IsConstant( m_NodeList[ 0 ] ) && !ConstantOf( m_NodeList[ 0 ] ).IsTruthy() )
+				return MakeScope( arena, this );
+			break;
+		}
+		case NODE_SCOPE:
+		{
+			// Statements after a return are unreachable
+			for ( size_t i = 0; i + 1 < m_NodeList.size(); ++i )
+			{
+				if ( AlwaysReturns( m_NodeList[ i ] ) )
+				{
+					m_NodeList.m_Size = i + 1;
+					break;
+				}
+			}
+			break;
+		}
+		default:
+			break;
+		}
+
+		return this;
+	}
+
+	void OptimizeIR( std::vector< BaseNode* >& nodes, NodeArena& arena, uint32_t flags )
+	{
+		if ( flags == Config_t::OF_NONE )
+			return;
+
+		for ( auto& node : nodes )
+			node = node->Optimize( arena, flags );
+	}
+}
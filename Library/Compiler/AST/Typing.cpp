@@ -31,6 +31,8 @@ namespace Compiler
 			{ TYPE_BOOL, 			"bool" },
 			{ TYPE_TABLE, 			"Table" },
 			{ TYPE_ARRAY, 			"Array" },
+			{ TYPE_CLASS, 			"Class" },
+			{ TYPE_INSTANCE, 		"instance" },
 			{ TYPE_FUNCTION, 		"function" },
 			{ TYPE_NATIVE, 			"native" },
 			{ TYPE_STRING, 			"string" },
@@ -148,6 +150,43 @@ namespace Compiler
 		return returnTypes;
 	}
 
+	const Record_t* ResolveRecord( const BaseNode* node, uint32_t kind, Assembler& assembler )
+	{
+		switch ( node->Id() )
+		{
+		case NODE_NAME:
+		{
+			uint32_t nameIndex;
+			auto name = AS_STRING( static_cast< const ValueNode* >( node )->GetValue() )->GetString();
+
+			Variable_t varInfo;
+			if ( !assembler.FindArgument( name, &varInfo )
+				&& !assembler.FindLocal( name, &nameIndex, &varInfo )
+				&& !assembler.FindUpvalue( name, &nameIndex, &varInfo )
+				&& !assembler.FindGlobal( name, &varInfo ) )
+			{
+				return NULL;
+			}
+
+			// Only constants are guaranteed to still hold what they were declared with
+			if ( !varInfo.m_IsConst || varInfo.m_Type != kind )
+				return NULL;
+
+			return varInfo.m_Record;
+		}
+		case NODE_CALL:
+		{
+			// Calling a known class creates an instance of it
+			if ( kind != TYPE_INSTANCE )
+				return NULL;
+
+			return ResolveRecord( static_cast< const ComplexNode* >( node )->GetLeft(), TYPE_CLASS, assembler );
+		}
+		default:
+			return NULL;
+		}
+	}
+
 	uint32_t ValueNode::ExprType( Assembler& assembler ) const
 	{
 		switch ( m_NodeId )
@@ -193,7 +232,7 @@ namespace Compiler
 			return TYPE_UNKNOWN;
 		}
 		default:
-			throw CompilerException( "cp_invalid_value_node", "Unknown value node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, m_Token );
+			throw CompilerException( "cp_invalid_value_node", "Unknown value node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, Token() );
 		}
 	}
 
@@ -203,8 +242,13 @@ namespace Compiler
 		{
 		case NODE_ACCESS_PROP:
 		{
-			// TODO: Resolve table property types compile-time
-			return TYPE_UNKNOWN;
+			// Fields of known class instances have the declared type. TODO: Resolve table property types compile-time
+			auto record = ResolveRecord( m_Left, TYPE_INSTANCE, assembler );
+			if ( !record )
+				return TYPE_UNKNOWN;
+
+			int field = record->FindField( AS_STRING( static_cast< ValueNode* >( m_Right )->GetValue() )->GetString() );
+			return field == -1 ? TYPE_UNKNOWN : record->m_FieldTypes[ field ];
 		}
 		case NODE_ACCESS_ARRAY:
 		{
@@ -281,7 +325,7 @@ namespace Compiler
 		case NODE_LESSTHAN: return TYPE_BOOL;
 		case NODE_LESSEQUAL: return TYPE_BOOL;
 		default:
-			throw CompilerException( "cp_invalid_complex_node", "Unknown complex node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, m_Token );
+			throw CompilerException( "cp_invalid_complex_node", "Unknown complex node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, Token() );
 		}
 	}
 
@@ -294,7 +338,7 @@ namespace Compiler
 		case NODE_NOT: return TYPE_BOOL;
 		case NODE_NEG: return TYPE_NUMBER;
 		default:
-			throw CompilerException( "cp_invalid_simple_node", "Unknown simple node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, m_Token );
+			throw CompilerException( "cp_invalid_simple_node", "Unknown simple node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, Token() );
 		}
 	}
 
@@ -303,6 +347,7 @@ namespace Compiler
 		switch ( m_NodeId )
 		{
 		case NODE_TABLE: return TYPE_TABLE;
+		case NODE_CLASS: return TYPE_CLASS;
 		case NODE_ARRAY: return TYPE_ARRAY;
 		case NODE_DO: return TYPE_NONE;
 		case NODE_FOR: return TYPE_NONE;
@@ -338,7 +383,7 @@ namespace Compiler
 			return type;
 		}
 		default:
-			throw CompilerException( "cp_invalid_list_node", "Unknown list node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, m_Token );
+			throw CompilerException( "cp_invalid_list_node", "Unknown list node: " + std::to_string( m_NodeId ), m_LineNr, m_ColNr, Token() );
 		}
 	}
 }
@@ -0,0 +1,268 @@
+#include "QLibPCH.h"
+#include "../Common/Chunk.h"
+#include "../Common/Bytecode.h"
+
+#include "Compiler.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Compilation cache. Compiled functions are cached as .qsc data, every lookup rebuilds
+// a fresh function the caller owns, so cached entries never alias user objects.
+//
+//   Memory tier: LRU of the most recently used scripts, shared by every thread
+//   Disk tier:   one .qsc file per script in the cache directory, survives process restarts
+
+namespace CompileCache
+{
+	struct Key_t
+	{
+		uint64_t		m_Hash[ 2 ];
+
+		bool operator==( const Key_t& other ) const
+		{
+			return m_Hash[ 0 ] == other.m_Hash[ 0 ] && m_Hash[ 1 ] == other.m_Hash[ 1 ];
+		}
+	};
+
+	struct KeyHash_t
+	{
+		size_t operator()( const Key_t& key ) const { return ( size_t ) key.m_Hash[ 0 ]; }
+	};
+
+	struct Entry_t
+	{
+		Key_t									m_Key;
+		std::shared_ptr< std::vector< uint8_t > >	m_Data;
+	};
+
+	static std::mutex												s_Lock;
+	static std::list< Entry_t >										s_Entries;
+	static std::unordered_map< Key_t, std::list< Entry_t >::iterator, KeyHash_t >	s_Index;
+	static size_t													s_Capacity = 256;
+	static std::string												s_Directory;
+	static QScript::CompileCacheStats_t								s_Stats = {};
+
+	// Two FNV-1a hashes with different seeds, 128 bits keep collisions out of the picture
+	static void Hash( Key_t* key, const void* data, size_t size )
+	{
+		static const uint64_t s_Prime = 0x100000001B3ULL;
+
+		for ( size_t i = 0; i < size; ++i )
+		{
+			auto byte = ( ( const uint8_t* ) data )[ i ];
+			key->m_Hash[ 0 ] = ( key->m_Hash[ 0 ] ^ byte ) * s_Prime;
+			key->m_Hash[ 1 ] = ( key->m_Hash[ 1 ] ^ byte ) * s_Prime;
+		}
+	}
+
+	static Key_t MakeKey( const std::string& source, const QScript::Config_t& config )
+	{
+		Key_t key;
+		key.m_Hash[ 0 ] = 0xCBF29CE484222325ULL;
+		key.m_Hash[ 1 ] = 0x84222325CBF29CE4ULL;
+
+		uint32_t version = Compiler::s_CompilerVersion;
+		uint8_t debugSymbols = config.m_DebugSymbols ? 1 : 0;
+
+		Hash( &key, &version, sizeof( version ) );
+		Hash( &key, &config.m_CompilerFlags, sizeof( config.m_CompilerFlags ) );
+		Hash( &key, &debugSymbols, sizeof( debugSymbols ) );
+
+		for ( auto& global : config.m_Globals )
+			Hash( &key, global.c_str(), global.size() + 1 );
+
+		uint64_t length = source.size();
+		Hash( &key, &length, sizeof( length ) );
+		Hash( &key, source.data(), source.size() );
+		return key;
+	}
+
+	static std::string FilePath( const Key_t& key )
+	{
+		char name[ 64 ];
+		std::snprintf( name, sizeof( name ), "%016llx%016llx.qsc",
+			( unsigned long long ) key.m_Hash[ 0 ], ( unsigned long long ) key.m_Hash[ 1 ] );
+
+		return s_Directory + "/" + name;
+	}
+
+	static std::shared_ptr< std::vector< uint8_t > > ReadFile( const std::string& path )
+	{
+		std::ifstream file( path, std::ios::binary | std::ios::ate );
+
+		if ( !file.is_open() )
+			return NULL;
+
+		auto data = std::make_shared< std::vector< uint8_t > >( ( size_t ) file.tellg() );
+		file.seekg( 0 );
+
+		if ( !file.read( ( char* ) data->data(), data->size() ) )
+			return NULL;
+
+		return data;
+	}
+
+	static void WriteFile( const std::string& path, const std::vector< uint8_t >& data )
+	{
+#ifdef _WIN32
+		_mkdir( s_Directory.c_str() );
+#else
+		mkdir( s_Directory.c_str(), 0755 );
+#endif
+
+		// Write aside and rename, so concurrent runs never read a partial file
+		auto tempPath = path + "." + std::to_string( std::hash< std::thread::id >()( std::this_thread::get_id() ) ) + ".tmp";
+
+		{
+			std::ofstream file( tempPath, std::ios::binary | std::ios::trunc );
+
+			if ( !file.is_open() )
+				return;
+
+			file.write( ( const char* ) data.data(), data.size() );
+		}
+
+		std::remove( path.c_str() );
+
+		if ( std::rename( tempPath.c_str(), path.c_str() ) != 0 )
+			std::remove( tempPath.c_str() );
+	}
+
+	static void Trim()
+	{
+		while ( s_Entries.size() > s_Capacity )
+		{
+			s_Index.erase( s_Entries.back().m_Key );
+			s_Entries.pop_back();
+		}
+	}
+
+	static void Insert( const Key_t& key, std::shared_ptr< std::vector< uint8_t > > data )
+	{
+		auto existing = s_Index.find( key );
+
+		if ( existing != s_Index.end() )
+		{
+			s_Entries.erase( existing->second );
+			s_Index.erase( existing );
+		}
+
+		s_Entries.push_front( Entry_t{ key, data } );
+		s_Index[ key ] = s_Entries.begin();
+
+		Trim();
+	}
+
+	static QScript::FunctionObject* Load( std::shared_ptr< std::vector< uint8_t > > data )
+	{
+		return Bytecode::Deserialize( data->data(), data->size(), data );
+	}
+}
+
+QScript::FunctionObject* QScript::CompileCached( const std::string& source, const Config_t& config )
+{
+	// Callbacks observe the compilation itself, those runs can't be skipped
+	if ( config.m_IdentifierCb || config.m_ImportCb )
+		return QScript::Compile( source, config );
+
+	auto key = CompileCache::MakeKey( source, config );
+	std::shared_ptr< std::vector< uint8_t > > data;
+	std::string directory;
+
+	{
+		std::lock_guard< std::mutex > lock( CompileCache::s_Lock );
+
+		auto entry = CompileCache::s_Index.find( key );
+
+		if ( entry != CompileCache::s_Index.end() )
+		{
+			// Move to the front of the LRU list
+			CompileCache::s_Entries.splice( CompileCache::s_Entries.begin(), CompileCache::s_Entries, entry->second );
+			data = entry->second->m_Data;
+			++CompileCache::s_Stats.m_MemoryHits;
+		}
+
+		directory = CompileCache::s_Directory;
+	}
+
+	if ( data )
+		return CompileCache::Load( data );
+
+	if ( directory.length() > 0 )
+	{
+		data = CompileCache::ReadFile( CompileCache::FilePath( key ) );
+
+		if ( data )
+		{
+			try
+			{
+				auto function = CompileCache::Load( data );
+
+				std::lock_guard< std::mutex > lock( CompileCache::s_Lock );
+				CompileCache::Insert( key, data );
+				++CompileCache::s_Stats.m_DiskHits;
+				return function;
+			}
+			catch ( const Exception& )
+			{
+				// Stale or damaged cache file, recompile and overwrite it
+				data = NULL;
+			}
+		}
+	}
+
+	{
+		std::lock_guard< std::mutex > lock( CompileCache::s_Lock );
+		++CompileCache::s_Stats.m_Misses;
+	}
+
+	auto function = QScript::Compile( source, config );
+
+	try
+	{
+		data = std::make_shared< std::vector< uint8_t > >( Bytecode::Serialize( *function, config.m_DebugSymbols ) );
+	}
+	catch ( const Exception& )
+	{
+		// Not representable as bytecode, hand out the function uncached
+		return function;
+	}
+
+	if ( directory.length() > 0 )
+		CompileCache::WriteFile( CompileCache::FilePath( key ), *data );
+
+	std::lock_guard< std::mutex > lock( CompileCache::s_Lock );
+	CompileCache::Insert( key, data );
+	return function;
+}
+
+void QScript::SetCompileCacheDirectory( const std::string& directory )
+{
+	std::lock_guard< std::mutex > lock( CompileCache::s_Lock );
+	CompileCache::s_Directory = directory;
+}
+
+void QScript::SetCompileCacheCapacity( size_t entries )
+{
+	std::lock_guard< std::mutex > lock( CompileCache::s_Lock );
+	CompileCache::s_Capacity = entries;
+	CompileCache::Trim();
+}
+
+void QScript::ClearCompileCache()
+{
+	std::lock_guard< std::mutex > lock( CompileCache::s_Lock );
+	CompileCache::s_Entries.clear();
+	CompileCache::s_Index.clear();
+	CompileCache::s_Stats = {};
+}
+
+QScript::CompileCacheStats_t QScript::CompileCacheStats()
+{
+	std::lock_guard< std::mutex > lock( CompileCache::s_Lock );
+	return CompileCache::s_Stats;
+}
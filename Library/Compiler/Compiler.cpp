@@ -12,7 +12,8 @@ Object::AllocateNative = &Compiler::AllocateNative; \
 Object::AllocateClosure = &Compiler::AllocateClosure; \
 Object::AllocateUpvalue = &Compiler::AllocateUpvalue; \
 Object::AllocateTable = &Compiler::AllocateTable; \
-Object::AllocateArray = &Compiler::AllocateArray;
+Object::AllocateArray = &Compiler::AllocateArray; \
+Object::AllocateFloat64Array = &Compiler::AllocateFloat64Array;
 
 #define END_COMPILER \
 Object::AllocateString = NULL; \
@@ -21,10 +22,49 @@ Object::AllocateNative = NULL; \
 Object::AllocateClosure = NULL; \
 Object::AllocateUpvalue = NULL; \
 Object::AllocateTable = NULL; \
-Object::AllocateArray = NULL;
+Object::AllocateArray = NULL; \
+Object::AllocateFloat64Array = NULL;
 
 namespace QScript
 {
+	// Compiles the AST as written and throws its errors away, so that optimizations dropping code
+	// can't hide an error in it
+	static void CheckIR( const std::vector< Compiler::BaseNode* >& astNodes, const Config_t& config )
+	{
+		// Tooling sees the compilation that is kept only
+		Config_t checkConfig( config );
+		checkConfig.m_IdentifierCb = NULL;
+		checkConfig.m_ImportCb = NULL;
+
+		Compiler::Assembler assembler( AllocChunk(), checkConfig );
+
+		auto systemModule = QScript::ResolveModule( "System" );
+		systemModule->Import( &assembler );
+
+		// Constants belong to the AST, only the functions and their chunks are released
+		auto release = []( const std::vector< FunctionObject* >& functions ) {
+			for ( auto function : functions )
+			{
+				delete function->GetChunk();
+				delete function;
+			}
+		};
+
+		try
+		{
+			for ( auto node : astNodes )
+				node->Compile( assembler );
+		}
+		catch ( ... )
+		{
+			release( assembler.TakeCompiled() );
+			assembler.Release();
+			throw;
+		}
+
+		release( assembler.Finish() );
+	}
+
 	FunctionObject* Compile( const std::string& source, const Config_t& config )
 	{
 		BEGIN_COMPILER;
@@ -33,7 +73,12 @@ namespace QScript
 		QScript::InitModules();
 
 		Chunk_t* chunk = AllocChunk();
-		Compiler::Assembler assembler( chunk, config );
+
+		// Deferred functions share the AST and assembler of the script, the unit is released
+		// along with the last one of them
+		auto unit = std::make_shared< Compiler::LazyUnit_t >( chunk, config );
+		auto& assembler = unit->m_Assembler;
+		auto& arena = unit->m_Arena;
 
 		// Import main system module (functions like exit(), print(), etc)
 		auto systemModule = QScript::ResolveModule( "System" );
@@ -47,27 +92,36 @@ namespace QScript
 			auto tokens = Compiler::Lexer( source );
 
 			// Generate IR
-			astNodes = Compiler::GenerateIR( tokens );
+			astNodes = Compiler::GenerateIR( tokens, arena );
 
-			// Run IR optimizers
+			// Run IR optimizers. Dead code is only dropped once it compiles, deferred functions
+			// aren't compiled until they're called so lazy scripts keep theirs.
+			auto irFlags = config.m_CompilerFlags;
+
+			if ( assembler.IsLazy() )
+				irFlags &= ~Config_t::OF_DEAD_CODE;
+			else if ( irFlags & Config_t::OF_DEAD_CODE )
+				CheckIR( astNodes, config );
+
+			Compiler::OptimizeIR( astNodes, arena, irFlags );
 
 			// Compile bytecode
 			for ( auto node : astNodes )
 				node->Compile( assembler );
 
-			for ( auto node : astNodes )
-			{
-				node->Release();
-				delete node;
-			}
-
-			astNodes.clear();
-
 			// Compiled funtions
 			auto functions = assembler.Finish();
 
-			// Clean up objects created in compilation process
-			Compiler::GarbageCollect( functions );
+			// Run bytecode optimizers
+			if ( config.m_CompilerFlags & ( Config_t::OF_PEEPHOLE | Config_t::OF_SUPERINSTRUCTIONS ) )
+			{
+				for ( auto function : functions )
+					Compiler::OptimizeChunk( function->GetChunk(), config.m_CompilerFlags );
+			}
+
+			// Clean up objects created in compilation process, values in the AST of deferred
+			// functions are kept with it
+			Compiler::GarbageCollect( functions, &arena );
 
 			// Reset allocators
 			END_COMPILER;
@@ -77,38 +131,24 @@ namespace QScript
 		}
 		catch ( const CompilerException& exception )
 		{
-			// Free created objects
-			Compiler::GarbageCollect( std::vector<QScript::FunctionObject*>{ } );
-
-			// Free compilation materials (also frees main chunk)
+			// Free compilation materials (also frees main chunk and deferred functions), before the
+			// objects its constants refer to
 			assembler.Release();
 
-			// Free AST
-			for ( auto node : astNodes )
-			{
-				node->Release();
-				delete node;
-			}
-			astNodes.clear();
+			// Free created objects
+			Compiler::GarbageCollect( std::vector<QScript::FunctionObject*>{ } );
 
 			// Rethrow
 			throw std::vector< CompilerException >{ exception };
 		}
 		catch ( ... )
 		{
-			// Free created objects
-			Compiler::GarbageCollect( std::vector<QScript::FunctionObject*>{ } );
-
-			// Free compilation materials (also frees main chunk)
+			// Free compilation materials (also frees main chunk and deferred functions), before the
+			// objects its constants refer to
 			assembler.Release();
 
-			// Free AST
-			for ( auto node : astNodes )
-			{
-				node->Release();
-				delete node;
-			}
-			astNodes.clear();
+			// Free created objects
+			Compiler::GarbageCollect( std::vector<QScript::FunctionObject*>{ } );
 
 			// Rethrow
 			throw;
@@ -129,6 +169,7 @@ namespace QScript
 		auto systemModule = QScript::ResolveModule( "System" );
 		systemModule->Import( &assembler );
 
+		Compiler::NodeArena arena;
 		std::vector< Compiler::BaseNode* > astNodes;
 		std::vector< std::pair< uint32_t, uint32_t > > exprTypes;
 
@@ -138,11 +179,10 @@ namespace QScript
 			auto tokens = Compiler::Lexer( source );
 
 			// Generate IR
-			astNodes = Compiler::GenerateIR( tokens );
+			astNodes = Compiler::GenerateIR( tokens, arena );
 
 			// Remove last return node
-			delete astNodes.back();
-			astNodes.erase( astNodes.end() - 1 );
+			astNodes.pop_back();
 
 			// Compile bytecode
 			for ( auto node : astNodes )
@@ -208,14 +248,6 @@ namespace QScript
 				exprTypes.push_back( std::make_pair( exprType, retnType ) );
 			}
 
-			for ( auto node : astNodes )
-			{
-				node->Release();
-				delete node;
-			}
-
-			astNodes.clear();
-
 			auto functions = assembler.Finish();
 
 			// Clean up objects created in compilation process
@@ -237,14 +269,6 @@ namespace QScript
 			// Free compilation materials (also frees main chunk)
 			assembler.Release();
 
-			// Free AST
-			for ( auto node : astNodes )
-			{
-				node->Release();
-				delete node;
-			}
-			astNodes.clear();
-
 			// Rethrow
 			throw std::vector< CompilerException >{ exception };
 		}
@@ -256,20 +280,12 @@ namespace QScript
 			// Free compilation materials (also frees main chunk)
 			assembler.Release();
 
-			// Free AST
-			for ( auto node : astNodes )
-			{
-				node->Release();
-				delete node;
-			}
-			astNodes.clear();
-
 			// Rethrow
 			throw;
 		}
 	}
 
-	std::vector< Compiler::BaseNode* > GenerateAST( const std::string& source )
+	std::vector< Compiler::BaseNode* > GenerateAST( const std::string& source, Compiler::NodeArena* arena )
 	{
 		BEGIN_COMPILER;
 
@@ -291,10 +307,13 @@ namespace QScript
 			auto tokens = Compiler::Lexer( source );
 
 			// Generate IR
-			astNodes = Compiler::GenerateIR( tokens );
+			astNodes = Compiler::GenerateIR( tokens, *arena );
 
-			// Clean up objects created in compilation process
-			Compiler::GarbageCollect( astNodes );
+			// Values in the AST live as long as its nodes
+			Compiler::TransferObjects( arena );
+
+			// Free compilation materials (also frees main chunk)
+			assembler.Release();
 
 			// Reset allocators
 			END_COMPILER;
@@ -308,14 +327,6 @@ namespace QScript
 			// Free compilation materials (also frees main chunk)
 			assembler.Release();
 
-			// Free AST
-			for ( auto node : astNodes )
-			{
-				node->Release();
-				delete node;
-			}
-			astNodes.clear();
-
 			// Rethrow
 			throw std::vector< CompilerException >{ exception };
 		}
@@ -327,15 +338,6 @@ namespace QScript
 			// Free compilation materials (also frees main chunk)
 			assembler.Release();
 
-			// Free AST
-			for ( auto node : astNodes )
-			{
-				node->Release();
-				delete node;
-			}
-
-			astNodes.clear();
-
 			// Rethrow
 			throw;
 		}
@@ -344,36 +346,8 @@ namespace QScript
 
 namespace Compiler
 {
-	// List of allocated objects for garbage collection
-	std::vector< QScript::Object* > ObjectList;
-
-	uint32_t AddConstant( const QScript::Value& value, QScript::Chunk_t* chunk )
-	{
-		if ( IS_STRING( value ) )
-		{
-			// De-duplicate strings
-			for ( uint32_t i = 0; i < chunk->m_Constants.size(); ++i )
-			{
-				if ( !IS_STRING( chunk->m_Constants[ i ] ) )
-					continue;
-
-				if ( AS_STRING( value )->GetString() == AS_STRING( chunk->m_Constants[ i ] )->GetString() )
-					return i;
-			}
-		}
-		else
-		{
-			// De-duplicate normal values
-			for ( uint32_t i = 0; i < chunk->m_Constants.size(); ++i )
-			{
-				if ( ( chunk->m_Constants[ i ] == value ).IsTruthy() )
-					return i;
-			}
-		}
-
-		chunk->m_Constants.push_back( value );
-		return ( uint32_t ) chunk->m_Constants.size() - 1;
-	}
+	// List of allocated objects for garbage collection, one per compiling thread
+	thread_local std::vector< QScript::Object* > ObjectList;
 
 	void EmitByte( uint8_t byte, QScript::Chunk_t* chunk )
 	{
@@ -410,7 +384,7 @@ namespace Compiler
 	{
 		assert( 0 );
 
-		auto closureObject = QS_NEW QScript::ClosureObject( function );
+		auto closureObject = QScript::ClosureObject::Create( function );
 		ObjectList.push_back( ( QScript::Object* ) closureObject );
 		return closureObject;
 	}
@@ -442,7 +416,16 @@ namespace Compiler
 		return arrayObject;
 	}
 
-	void GarbageCollect( const std::vector< QScript::FunctionObject* >& functions )
+	QScript::Float64ArrayObject* AllocateFloat64Array( const std::string& name )
+	{
+		assert( 0 );
+
+		auto arrayObject = QS_NEW QScript::Float64ArrayObject( name );
+		ObjectList.push_back( ( QScript::Object* ) arrayObject );
+		return arrayObject;
+	}
+
+	void GarbageCollect( const std::vector< QScript::FunctionObject* >& functions, NodeArena* keep )
 	{
 		std::vector< QScript::Value > values;
 		for ( auto function : functions )
@@ -454,85 +437,193 @@ namespace Compiler
 			}
 		}
 
-		GarbageCollect( values );
+		GarbageCollect( values, keep );
 	}
 
-	void GarbageCollect( const std::vector< Compiler::BaseNode* >& nodes )
+	void TransferObjects( NodeArena* arena )
 	{
-		std::vector< QScript::Value > values;
-		std::vector< const Compiler::BaseNode* > queue;
+		arena->AdoptObjects( ObjectList );
+	}
 
-		for ( auto node : nodes )
-			queue.push_back( node );
+	void GarbageCollect( const std::vector< QScript::Value >& values, NodeArena* keep )
+	{
+		std::unordered_set< QScript::Object* > referenced;
+		std::vector< QScript::Object* > kept;
 
-		while ( queue.size() > 0 )
+		for ( auto value : values )
 		{
-			auto node = queue[ 0 ];
+			if ( IS_OBJECT( value ) )
+				referenced.insert( AS_OBJECT( value ) );
+		}
 
-			if ( node )
-			{
-				switch( node->Type() )
-				{
-					case NT_TERM:
-						break;
-					case NT_VALUE:
-					{
-						auto value = static_cast< const ValueNode* >( node )->GetValue();
-						if ( IS_OBJECT( value ) )
-							values.push_back( value );
-						break;
-					}
-					case NT_SIMPLE:
-						queue.push_back( static_cast< const SimpleNode* >( node )->GetNode() );
-						break;
-					case NT_COMPLEX:
-					{
-						queue.push_back( static_cast< const ComplexNode* >( node )->GetLeft() );
-						queue.push_back( static_cast< const ComplexNode* >( node )->GetRight() );
-						break;
-					}
-					case NT_LIST:
-					{
-						auto list = static_cast< const ListNode* >( node )->GetList();
+		for ( auto object : ObjectList )
+		{
+			if ( referenced.find( object ) != referenced.end() )
+				continue;
 
-						for ( auto listNode : list )
-							queue.push_back( listNode );
+			if ( keep )
+				kept.push_back( object );
+			else
+				delete object;
+		}
 
-						break;
-					}
-					default:
-						break;
-				}
-			}
+		if ( keep )
+			keep->AdoptObjects( kept );
 
-			queue.erase( queue.begin() );
+		ObjectList.clear();
+	}
+
+	// Compiler allocators are installed for a deferred compilation, which runs in the middle of
+	// a VM, and the allocators and objects of the VM are put back afterwards
+	struct DeferredScope_t
+	{
+		DeferredScope_t()
+		{
+			m_String = QScript::Object::AllocateString;
+			m_Function = QScript::Object::AllocateFunction;
+			m_Native = QScript::Object::AllocateNative;
+			m_Closure = QScript::Object::AllocateClosure;
+			m_Upvalue = QScript::Object::AllocateUpvalue;
+			m_Table = QScript::Object::AllocateTable;
+			m_Array = QScript::Object::AllocateArray;
+			m_Float64Array = QScript::Object::AllocateFloat64Array;
+
+			QScript::Object::AllocateString = &AllocateString;
+			QScript::Object::AllocateFunction = &AllocateFunction;
+			QScript::Object::AllocateNative = &AllocateNative;
+			QScript::Object::AllocateClosure = &AllocateClosure;
+			QScript::Object::AllocateUpvalue = &AllocateUpvalue;
+			QScript::Object::AllocateTable = &AllocateTable;
+			QScript::Object::AllocateArray = &AllocateArray;
+			QScript::Object::AllocateFloat64Array = &AllocateFloat64Array;
+
+			m_Objects.swap( ObjectList );
 		}
 
-		GarbageCollect( values );
-	}
+		~DeferredScope_t()
+		{
+			QScript::Object::AllocateString = m_String;
+			QScript::Object::AllocateFunction = m_Function;
+			QScript::Object::AllocateNative = m_Native;
+			QScript::Object::AllocateClosure = m_Closure;
+			QScript::Object::AllocateUpvalue = m_Upvalue;
+			QScript::Object::AllocateTable = m_Table;
+			QScript::Object::AllocateArray = m_Array;
+			QScript::Object::AllocateFloat64Array = m_Float64Array;
+
+			m_Objects.swap( ObjectList );
+		}
 
-	void GarbageCollect( const std::vector< QScript::Value >& values )
+		QScript::Object::StringAllocatorFn			m_String;
+		QScript::Object::FunctionAllocatorFn		m_Function;
+		QScript::Object::NativeAllocatorFn			m_Native;
+		QScript::Object::ClosureAllocatorFn			m_Closure;
+		QScript::Object::UpvalueAllocatorFn			m_Upvalue;
+		QScript::Object::TableAllocatorFn			m_Table;
+		QScript::Object::ArrayAllocatorFn			m_Array;
+		QScript::Object::Float64ArrayAllocatorFn	m_Float64Array;
+		std::vector< QScript::Object* >				m_Objects;
+	};
+
+	class DeferredFunction_t : public QScript::FunctionObject::Deferred_t
 	{
-		for ( auto object : ObjectList )
+	public:
+		DeferredFunction_t( const std::shared_ptr< LazyUnit_t >& unit, ListNode* funcNode, bool isAnonymous, bool isConst,
+			uint32_t returnType, uint32_t numGlobals )
+		{
+			m_Unit = unit;
+			m_FuncNode = funcNode;
+			m_IsAnonymous = isAnonymous;
+			m_IsConst = isConst;
+			m_ReturnType = returnType;
+			m_NumGlobals = numGlobals;
+		}
+
+		void Compile( QScript::FunctionObject* function ) override
 		{
-			bool isReferenced = false;
+			std::lock_guard< std::mutex > lock( m_Unit->m_Lock );
 
-			for ( auto value : values )
+			// Another thread compiled it first
+			if ( !function->IsDeferred() )
+				return;
+
+			DeferredScope_t scope;
+			auto& assembler = m_Unit->m_Assembler;
+			auto flags = assembler.Config().m_CompilerFlags;
+
+			assembler.LimitGlobals( m_NumGlobals );
+
+			try
 			{
-				if ( IS_OBJECT( value ) && AS_OBJECT( value ) == object )
-					isReferenced = true;
+				CompileDeferredFunction( m_FuncNode, function, m_IsAnonymous, m_IsConst, m_ReturnType, assembler );
+
+				auto functions = assembler.TakeCompiled();
+
+				if ( flags & ( QScript::Config_t::OF_PEEPHOLE | QScript::Config_t::OF_SUPERINSTRUCTIONS ) )
+				{
+					for ( auto compiled : functions )
+						OptimizeChunk( compiled->GetChunk(), flags );
+				}
+
+				// Strings taken straight from the AST belong to it, chunks get copies of their own
+				std::unordered_set< QScript::Object* > allocated( ObjectList.begin(), ObjectList.end() );
+
+				for ( auto compiled : functions )
+				{
+					for ( auto& constant : compiled->GetChunk()->m_Constants )
+					{
+						if ( IS_STRING( constant ) && allocated.find( AS_OBJECT( constant ) ) == allocated.end() )
+							constant = MAKE_OBJECT( QS_NEW QScript::StringObject( AS_STRING( constant )->GetString() ) );
+					}
+				}
+
+				GarbageCollect( functions );
+				function->FinishDeferred();
 			}
+			catch ( CompilerException& exception )
+			{
+				// The function stays deferred, and fails the same way when it's called again
+				assembler.ReleaseDeferred();
+				GarbageCollect( std::vector< QScript::Value >{} );
 
-			if ( !isReferenced )
-				delete object;
+				throw RuntimeException( exception.id(), exception.What(), exception.LineNr(), exception.ColNr(), exception.Token() );
+			}
 		}
 
-		ObjectList.clear();
+	private:
+		std::shared_ptr< LazyUnit_t >	m_Unit;
+		ListNode*						m_FuncNode;
+		bool							m_IsAnonymous;
+		bool							m_IsConst;
+		uint32_t						m_ReturnType;
+		uint32_t						m_NumGlobals;
+	};
+
+	QScript::FunctionObject::Deferred_t* DeferFunction( Assembler& assembler, ListNode* funcNode, bool isAnonymous, bool isConst, uint32_t returnType )
+	{
+		return QS_NEW DeferredFunction_t( assembler.Unit()->shared_from_this(), funcNode, isAnonymous, isConst, returnType,
+			assembler.NumGlobals() );
+	}
+
+	LazyUnit_t::LazyUnit_t( QScript::Chunk_t* chunk, const QScript::Config_t& config )
+		: m_Assembler( chunk, config )
+	{
+		// Identifier callbacks are for tooling, which has to see every function compiled
+		if ( config.m_LazyCompilation && !config.m_IdentifierCb )
+			m_Assembler.m_Unit = this;
+	}
+
+	LazyUnit_t::~LazyUnit_t()
+	{
+		m_Assembler.Release();
 	}
 
 	Assembler::Assembler( QScript::Chunk_t* chunk, const QScript::Config_t& config )
 		: m_Config( config )
 	{
+		m_VisibleGlobals = UINT32_MAX;
+		m_Unit = NULL;
+
 		// Fill out globals for REPL
 		for ( auto identifier : config.m_Globals )
 			AddGlobal( identifier, -1, -1 );
@@ -547,10 +638,50 @@ namespace Compiler
 
 		for ( auto context : m_Functions )
 		{
+			// Deferred functions keep the unit of this assembler alive
+			for ( auto constant : context.m_Func->GetChunk()->m_Constants )
+			{
+				if ( IS_FUNCTION( constant ) && AS_FUNCTION( constant )->IsDeferred() )
+					QScript::FreeFunction( AS_FUNCTION( constant ) );
+			}
+
 			delete context.m_Func->GetChunk();
 			delete context.m_Func;
 			delete context.m_Stack;
 		}
+
+		m_Functions.clear();
+	}
+
+	void Assembler::ReleaseDeferred()
+	{
+		// Unfinished functions of a failed deferred compilation. The first one after <main> is
+		// the deferred function, it stays in its script with an empty chunk.
+		for ( size_t i = 1; i < m_Functions.size(); ++i )
+		{
+			auto& context = m_Functions[ i ];
+
+			if ( i == 1 )
+				*context.m_Func->GetChunk() = QScript::Chunk_t();
+			else
+			{
+				delete context.m_Func->GetChunk();
+				delete context.m_Func;
+			}
+
+			delete context.m_Stack;
+		}
+
+		m_Functions.resize( std::min( m_Functions.size(), ( size_t ) 1 ) );
+
+		// Constants of finished ones are either released by the caller or belong to the AST
+		for ( auto function : TakeCompiled() )
+		{
+			delete function->GetChunk();
+			delete function;
+		}
+
+		m_FunctionArgs.clear();
 	}
 
 	std::vector< QScript::FunctionObject* > Assembler::Finish()
@@ -562,7 +693,41 @@ namespace Compiler
 		m_Compiled.push_back( m_Functions[ 0 ].m_Func );
 		m_Functions.pop_back();
 
-		return m_Compiled;
+		// Deferred functions are compiled later in a <main> of their own, with the same globals
+		if ( m_Unit )
+			CreateFunction( "<main>", true, TYPE_UNKNOWN, true, true, QScript::AllocChunk() );
+
+		return TakeCompiled();
+	}
+
+	std::vector< QScript::FunctionObject* > Assembler::TakeCompiled()
+	{
+		std::vector< QScript::FunctionObject* > compiled;
+		compiled.swap( m_Compiled );
+
+		// Chunks may be released from now on, and their addresses reused
+		m_Constants.clear();
+		return compiled;
+	}
+
+	bool Assembler::IsLazy() const
+	{
+		return m_Unit != NULL;
+	}
+
+	LazyUnit_t* Assembler::Unit() const
+	{
+		return m_Unit;
+	}
+
+	uint32_t Assembler::NumGlobals() const
+	{
+		return ( uint32_t ) m_Globals.size();
+	}
+
+	void Assembler::LimitGlobals( uint32_t numGlobals )
+	{
+		m_VisibleGlobals = numGlobals;
 	}
 
 	const std::vector< Variable_t >& Assembler::CurrentArguments()
@@ -593,14 +758,19 @@ namespace Compiler
 	QScript::FunctionObject* Assembler::CreateFunction( const std::string& name, bool isConst, uint32_t retnType, bool isAnonymous, bool addLocal, QScript::Chunk_t* chunk )
 	{
 		auto function = QS_NEW QScript::FunctionObject( name, chunk );
+		EnterFunction( function, isConst, retnType, isAnonymous, addLocal );
+
+		return function;
+	}
+
+	void Assembler::EnterFunction( QScript::FunctionObject* function, bool isConst, uint32_t retnType, bool isAnonymous, bool addLocal )
+	{
 		auto context = FunctionContext_t{ function, QS_NEW Assembler::Stack_t(), retnType };
 
 		m_Functions.push_back( context );
 
 		if ( addLocal )
-			AddLocal( isAnonymous ? "" : name, isConst, -1, -1, TYPE_FUNCTION, retnType, function );
-
-		return function;
+			AddLocal( isAnonymous ? "" : function->GetName(), isConst, -1, -1, TYPE_FUNCTION, retnType, function );
 	}
 
 	void Assembler::FinishFunction( int lineNr, int colNr, std::vector< Upvalue_t >* upvalues )
@@ -628,9 +798,64 @@ namespace Compiler
 		m_Functions.pop_back();
 	}
 
+	static Assembler::ConstantKey_t ConstantKey( const QScript::Value& value )
+	{
+#ifdef QS_NAN_BOXING
+		return Assembler::ConstantKey_t{ value.m_Data.m_UInt64, 0 };
+#else
+		Assembler::ConstantKey_t key{ 0, ( uint32_t ) value.m_Type };
+
+		switch ( value.m_Type )
+		{
+		case QScript::VT_BOOL: key.m_Bits = value.m_Data.m_Bool ? 1 : 0; break;
+		case QScript::VT_NUMBER: std::memcpy( &key.m_Bits, &value.m_Data.m_Number, sizeof( double ) ); break;
+		case QScript::VT_OBJECT: key.m_Bits = ( uint64_t ) ( uintptr_t ) value.m_Data.m_Object; break;
+		default: break;
+		}
+
+		return key;
+#endif
+	}
+
+	uint32_t Assembler::AddConstant( const QScript::Value& value, QScript::Chunk_t* chunk )
+	{
+		auto& index = m_Constants[ chunk ];
+
+		// Pick up constants added to the chunk since it was last indexed
+		for ( ; index.m_NumIndexed < chunk->m_Constants.size(); ++index.m_NumIndexed )
+		{
+			auto& constant = chunk->m_Constants[ index.m_NumIndexed ];
+			auto constIndex = ( uint32_t ) index.m_NumIndexed;
+
+			if ( IS_STRING( constant ) )
+				index.m_Strings.emplace( AS_STRING( constant )->GetString(), constIndex );
+			else
+				index.m_Values.emplace( ConstantKey( constant ), constIndex );
+		}
+
+		// De-duplicate strings by content and other values by identity
+		if ( IS_STRING( value ) )
+		{
+			auto existing = index.m_Strings.find( AS_STRING( value )->GetString() );
+
+			if ( existing != index.m_Strings.end() )
+				return existing->second;
+		}
+		else
+		{
+			auto existing = index.m_Values.find( ConstantKey( value ) );
+
+			if ( existing != index.m_Values.end() )
+				return existing->second;
+		}
+
+		chunk->m_Constants.push_back( value );
+		return ( uint32_t ) chunk->m_Constants.size() - 1;
+	}
+
 	void Assembler::AddArgument( const std::string& name, bool isConstant, int lineNr, int colNr, uint32_t type, uint32_t returnType )
 	{
-		auto variable = Variable_t{ name, isConstant, type, returnType, NULL };
+		auto variable = Variable_t{ name, isConstant, type, returnType, NULL, NULL };
 
 		if ( m_Config.m_IdentifierCb )
 			m_Config.m_IdentifierCb( lineNr, colNr, variable, "Argument" );
@@ -643,11 +868,12 @@ namespace Compiler
 		return AddLocal( name, false, lineNr, colNr, TYPE_UNKNOWN, TYPE_UNKNOWN );
 	}
 
-	uint32_t Assembler::AddLocal( const std::string& name, bool isConstant, int lineNr, int colNr, uint32_t type, uint32_t returnType, QScript::FunctionObject* fn )
+	uint32_t Assembler::AddLocal( const std::string& name, bool isConstant, int lineNr, int colNr, uint32_t type, uint32_t returnType,
+		QScript::FunctionObject* fn, const Record_t* record )
 	{
 		auto stack = CurrentStack();
 
-		auto variable = Variable_t{ name, isConstant, type, returnType, fn };
+		auto variable = Variable_t{ name, isConstant, type, returnType, fn, record };
 
 		if ( m_Config.m_IdentifierCb )
 			m_Config.m_IdentifierCb( lineNr, colNr, variable, "Local" );
@@ -656,6 +882,29 @@ namespace Compiler
 		return ( uint32_t ) stack->m_Locals.size() - 1;
 	}
 
+	const Record_t* Assembler::AddRecord( const Record_t& record )
+	{
+		// Records are referred to by pointer from variables, a deque doesn't move them
+		m_Records.push_back( record );
+		return &m_Records.back();
+	}
+
+	int Record_t::FindField( const std::string& name ) const
+	{
+		for ( size_t i = 0; i < m_Fields.size(); ++i )
+		{
+			if ( m_Fields[ i ] == name )
+				return ( int ) i;
+		}
+
+		return -1;
+	}
+
+	bool Record_t::HasMethod( const std::string& name ) const
+	{
+		return std::find( m_Methods.begin(), m_Methods.end(), name ) != m_Methods.end();
+	}
+
 	Local_t* Assembler::GetLocal( int local )
 	{
 		return &CurrentStack()->m_Locals[ local ];
@@ -694,11 +943,11 @@ namespace Compiler
 	{
 		auto global = m_Globals.find( name );
 
-		if ( global == m_Globals.end() )
+		if ( global == m_Globals.end() || global->second.m_Order >= m_VisibleGlobals )
 			return false;
 
 		if ( out )
-			*out = global->second;
+			*out = global->second.m_Var;
 
 		return true;
 	}
@@ -729,13 +978,14 @@ namespace Compiler
 		return AddGlobal( name, false, lineNr, colNr, TYPE_UNKNOWN, TYPE_UNKNOWN, NULL );
 	}
 
-	bool Assembler::AddGlobal( const std::string& name, bool isConstant, int lineNr, int colNr, uint32_t type, uint32_t returnType, QScript::FunctionObject* fn )
+	bool Assembler::AddGlobal( const std::string& name, bool isConstant, int lineNr, int colNr, uint32_t type, uint32_t returnType,
+		QScript::FunctionObject* fn, const Record_t* record )
 	{
 		if ( m_Globals.find( name ) != m_Globals.end() )
 			return false;
 
-		Variable_t global = Variable_t{ name, isConstant, type, returnType, fn };
-		m_Globals.insert( std::make_pair( name, global ) );
+		Variable_t global = Variable_t{ name, isConstant, type, returnType, fn, record };
+		m_Globals.insert( std::make_pair( name, Global_t{ global, ( uint32_t ) m_Globals.size() } ) );
 
 		if ( m_Config.m_IdentifierCb )
 			m_Config.m_IdentifierCb( lineNr, colNr, global, "Global" );
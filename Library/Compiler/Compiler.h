@@ -8,12 +8,15 @@ class Object;
 
 namespace Compiler
 {
+	// Bump whenever generated bytecode changes, invalidates cached compilations
+	static const uint32_t s_CompilerVersion = 7;
+
 	std::vector< Token_t > Lexer( const std::string& source );
-	std::vector< BaseNode* > GenerateIR( const std::vector< Token_t >& tokens );
-	// std::vector< BaseNode* > OptimizeIR( std::vector< BaseNode* > nodes );
+	std::vector< BaseNode* > GenerateIR( const std::vector< Token_t >& tokens, NodeArena& arena );
+	void OptimizeIR( std::vector< BaseNode* >& nodes, NodeArena& arena, uint32_t flags );
+	void OptimizeChunk( QScript::Chunk_t* chunk, uint32_t flags );
 
 	// Bytecode
-	uint32_t AddConstant( const QScript::Value& value, QScript::Chunk_t* chunk );
 	void EmitByte( uint8_t byte, QScript::Chunk_t* chunk );
 
 	// Object allocation
@@ -24,10 +27,27 @@ namespace Compiler
 	QScript::UpvalueObject* AllocateUpvalue( QScript::Value* valuePtr );
 	QScript::TableObject* AllocateTable( const std::string& name );
 	QScript::ArrayObject* AllocateArray( const std::string& name );
+	QScript::Float64ArrayObject* AllocateFloat64Array( const std::string& name );
+
+	// Unreferenced objects are released, or handed over to keep if the AST still needs them
+	void GarbageCollect( const std::vector< QScript::FunctionObject* >& functions, NodeArena* keep = NULL );
+	void GarbageCollect( const std::vector< QScript::Value >& values, NodeArena* keep = NULL );
+
+	// Hand objects created during compilation over to an AST arena
+	void TransferObjects( NodeArena* arena );
+
+	// Compile-time layout of a class. Fields are numbered in declaration order, the same slots
+	// its instances have at runtime
+	struct Record_t
+	{
+		std::string						m_Name;
+		std::vector< std::string >		m_Fields;
+		std::vector< uint32_t >			m_FieldTypes;
+		std::vector< std::string >		m_Methods;
 
-	void GarbageCollect( const std::vector< QScript::FunctionObject* >& functions );
-	void GarbageCollect( const std::vector< Compiler::BaseNode* >& nodes );
-	void GarbageCollect( const std::vector< QScript::Value >& values );
+		int FindField( const std::string& name ) const;
+		bool HasMethod( const std::string& name ) const;
+	};
 
 	struct Variable_t
 	{
@@ -36,6 +56,9 @@ namespace Compiler
 		uint32_t					m_Type;
 		uint32_t					m_ReturnType;
 		QScript::FunctionObject*	m_Function;
+
+		// Layout of the class (TYPE_CLASS) or the instance (TYPE_INSTANCE) a const variable holds
+		const Record_t*				m_Record;
 	};
 
 	struct Local_t
@@ -45,6 +68,8 @@ namespace Compiler
 		bool			m_Captured;
 	};
 
+	struct LazyUnit_t;
+
 	class Assembler
 	{
 	public:
@@ -65,6 +90,32 @@ namespace Compiler
 			uint32_t 				m_Index;
 		};
 
+		// Constants already in a chunk, for de-duplication
+		struct ConstantKey_t
+		{
+			uint64_t				m_Bits;
+			uint32_t				m_Type;
+
+			bool operator==( const ConstantKey_t& other ) const { return m_Bits == other.m_Bits && m_Type == other.m_Type; }
+		};
+
+		struct ConstantKeyHash_t
+		{
+			size_t operator()( const ConstantKey_t& key ) const { return std::hash< uint64_t >()( key.m_Bits ) ^ key.m_Type; }
+		};
+
+		struct ConstantIndex_t
+		{
+			ConstantIndex_t()
+			{
+				m_NumIndexed = 0;
+			}
+
+			std::unordered_map< std::string, uint32_t >						m_Strings;
+			std::unordered_map< ConstantKey_t, uint32_t, ConstantKeyHash_t >	m_Values;
+			size_t															m_NumIndexed;
+		};
+
 		struct FunctionContext_t
 		{
 			QScript::FunctionObject*	m_Func;
@@ -75,19 +126,24 @@ namespace Compiler
 
 		Assembler( QScript::Chunk_t* chunk, const QScript::Config_t& config );
 
+		uint32_t									AddConstant( const QScript::Value& value, QScript::Chunk_t* chunk );
 		void 										AddArgument( const std::string& name, bool isConstant, int lineNr, int colNr, uint32_t type, uint32_t returnType = TYPE_UNKNOWN );
 		bool 										AddGlobal( const std::string& name, int lineNr, int colNr );
 		bool 										AddGlobal( const std::string& name, bool isConstant, int lineNr, int colNr,
-																uint32_t type, uint32_t returnType = TYPE_UNKNOWN, QScript::FunctionObject* fn = NULL );
+																uint32_t type, uint32_t returnType = TYPE_UNKNOWN, QScript::FunctionObject* fn = NULL,
+																const Record_t* record = NULL );
 
 		uint32_t 									AddLocal( const std::string& name, bool isConstant, int lineNr, int colNr,
-																uint32_t type, uint32_t returnType = TYPE_UNKNOWN, QScript::FunctionObject* fn = NULL );
+																uint32_t type, uint32_t returnType = TYPE_UNKNOWN, QScript::FunctionObject* fn = NULL,
+																const Record_t* record = NULL );
 
 		uint32_t									AddLocal( const std::string& name, int lineNr, int colNr );
+		const Record_t*								AddRecord( const Record_t& record );
 		uint32_t 									AddUpvalue( FunctionContext_t* context, uint32_t index, bool isLocal, int lineNr, int colNr, Variable_t* varInfo );
 		void 										ClearArguments();
 		const QScript::Config_t&					Config() const;
 		QScript::FunctionObject*					CreateFunction( const std::string& name, bool isConst, uint32_t retnType, bool isAnonymous, bool addLocal, QScript::Chunk_t* chunk );
+		void										EnterFunction( QScript::FunctionObject* function, bool isConst, uint32_t retnType, bool isAnonymous, bool addLocal );
 		const std::vector< Variable_t >& 			CurrentArguments();
 		QScript::Chunk_t*							CurrentChunk();
 		const FunctionContext_t*					CurrentContext();
@@ -108,12 +164,50 @@ namespace Compiler
 		bool 										RequestUpvalue( const std::string name, uint32_t* out, int lineNr, int colNr, Variable_t* varInfo );
 		int											StackDepth();
 
+		// Lazy compilation, see Config_t::m_LazyCompilation. Deferred functions are compiled by
+		// the assembler of their script, inside a <main> context standing in for the finished one.
+		bool										IsLazy() const;
+		LazyUnit_t*									Unit() const;
+		uint32_t									NumGlobals() const;
+		void										LimitGlobals( uint32_t numGlobals );
+		std::vector< QScript::FunctionObject* >		TakeCompiled();
+		void										ReleaseDeferred();
+
 	private:
+		friend struct LazyUnit_t;
+
+		struct Global_t
+		{
+			Variable_t		m_Var;
+			uint32_t		m_Order;
+		};
+
 		std::vector< Variable_t >						m_FunctionArgs;
 		std::vector< FunctionContext_t >				m_Functions;
 		QScript::Config_t								m_Config;
 
 		std::vector< QScript::FunctionObject* >			m_Compiled;
-		std::map< std::string, Variable_t >				m_Globals;
+		std::map< std::string, Global_t >				m_Globals;
+		std::deque< Record_t >							m_Records;
+		std::unordered_map< QScript::Chunk_t*, ConstantIndex_t >	m_Constants;
+
+		// Globals declared after a deferred function are hidden from it, as they were when it was parsed
+		uint32_t										m_VisibleGlobals;
+		LazyUnit_t*										m_Unit;
+	};
+
+	// A script compiled with lazy compilation. Its AST and assembler are kept for as long as any of
+	// its deferred functions exist, they are compiled one at a time.
+	struct LazyUnit_t : public std::enable_shared_from_this< LazyUnit_t >
+	{
+		LazyUnit_t( QScript::Chunk_t* chunk, const QScript::Config_t& config );
+		~LazyUnit_t();
+
+		NodeArena					m_Arena;
+		Assembler					m_Assembler;
+		std::mutex					m_Lock;
 	};
+
+	// Code generation for a function declared at the top level of a lazy script, called on first use
+	QScript::FunctionObject::Deferred_t* DeferFunction( Assembler& assembler, ListNode* funcNode, bool isAnonymous, bool isConst, uint32_t returnType );
 };
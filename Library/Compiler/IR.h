@@ -2,93 +2,71 @@
 
 namespace Compiler
 {
-	struct IrBuilder_t;
+	class ParserState;
 
-	using LedFn = std::function<BaseNode*( const IrBuilder_t& irBuilder, BaseNode* left )>;
-	using NudFn = std::function<BaseNode*( const IrBuilder_t& irBuilder )>;
+	using NudFn = BaseNode*( * )( ParserState& parserState, const Token_t& token );
+	using LedFn = BaseNode*( * )( ParserState& parserState, const Token_t& token, BaseNode* left );
 
-	struct IrBuilder_t
+	// Parsing functions of a token id, null- and left-denoted
+	struct ParseRule_t
 	{
-		IrBuilder_t( const Token_t& token )
-		{
-			m_Token = token;
-			m_Led = NULL;
-			m_Nud = NULL;
-		}
-
-		Token_t 		m_Token;
-		LedFn			m_Led;
 		NudFn			m_Nud;
+		LedFn			m_Led;
+		bool			m_IsValid;
 	};
 
 	class ParserState
 	{
 	public:
-		ParserState()
-		{
-			m_CurrentBuilder = 0;
-		}
-
-		~ParserState()
+		ParserState( const std::vector< Token_t >& tokens, NodeArena& arena )
+			: m_Tokens( tokens ), m_Arena( arena )
 		{
-			for ( auto builder : m_Builders )
-				delete builder;
-
-			if ( m_Errors.size() > 0 )
-			{
-				// A parsing error occurred, free all allocated nodes
-				for ( auto node : m_AllocatedNodes )
-					delete node;
-
-				m_AllocatedNodes.clear();
-			}
-
-			m_Builders.clear();
+			m_CurrentToken = 0;
 		}
 
 		void 								AddNode( BaseNode* node )	{ m_Ast.push_back( node ); }
 		std::vector< BaseNode* >& 			Product()					{ return m_Ast; }
-		std::vector< IrBuilder_t* >& 		Builders()					{ return m_Builders; }
+		const std::vector< Token_t >& 		Tokens()					{ return m_Tokens; }
 		std::vector< CompilerException >&	Errors()					{ return m_Errors; }
 
-		bool 							IsFinished()						const { return ( size_t ) m_CurrentBuilder >= m_Builders.size(); }
+		bool 							IsFinished()						const { return ( size_t ) m_CurrentToken >= m_Tokens.size(); }
 		bool 							IsError()							const { return m_Errors.size() > 0; }
-		IrBuilder_t*					CurrentBuilder()					const { CheckEOF(); return m_Builders[ m_CurrentBuilder ]; }
-		IrBuilder_t*					NextBuilder() 						{ CheckEOF(); return m_Builders[ m_CurrentBuilder++ ]; }
-		int 							Offset()							{ return m_CurrentBuilder; }
+		const Token_t&					CurrentToken()						const { CheckEOF(); return m_Tokens[ m_CurrentToken ]; }
+		const Token_t&					NextToken() 						{ CheckEOF(); return m_Tokens[ m_CurrentToken++ ]; }
+		int 							Offset()							{ return m_CurrentToken; }
 
-		IrBuilder_t*					Peek( int offset )
+		const Token_t*					Peek( int offset )
 		{
-			if ( offset < 0 || offset > ( int ) m_Builders.size() - 1 )
+			if ( offset < 0 || offset > ( int ) m_Tokens.size() - 1 )
 				return NULL;
 
-			return m_Builders[ offset ];
+			return &m_Tokens[ offset ];
 		}
 
 		void 							Expect( Token token, const std::string desc )
 		{
 			CheckEOF();
 
-			auto builder = CurrentBuilder();
-			if ( builder->m_Token.m_Id != token )
+			auto& current = CurrentToken();
+			if ( current.m_Id != token )
 			{
-				throw CompilerException( "ir_expect", desc, builder->m_Token.m_LineNr,
-					builder->m_Token.m_ColNr, builder->m_Token.m_String );
+				throw CompilerException( "ir_expect", desc, current.m_LineNr,
+					current.m_ColNr, current.m_String );
 			}
 
-			NextBuilder();
+			NextToken();
 		}
 
 		bool 							Match( Token token )
 		{
 			CheckEOF();
 
-			if ( ( size_t ) m_CurrentBuilder + 1 >= m_Builders.size() )
+			if ( ( size_t ) m_CurrentToken + 1 >= m_Tokens.size() )
 				return false;
 
-			if ( m_Builders[ m_CurrentBuilder + 1 ]->m_Token.m_Id == token )
+			if ( m_Tokens[ m_CurrentToken + 1 ].m_Id == token )
 			{
-				NextBuilder();
+				NextToken();
 				return true;
 			}
 
@@ -99,9 +77,9 @@ namespace Compiler
 		{
 			CheckEOF();
 
-			if ( m_Builders[ m_CurrentBuilder ]->m_Token.m_Id == token )
+			if ( m_Tokens[ m_CurrentToken ].m_Id == token )
 			{
-				NextBuilder();
+				NextToken();
 				return true;
 			}
 
@@ -114,14 +92,14 @@ namespace Compiler
 
 			while ( !IsFinished() )
 			{
-				switch ( m_Builders[ m_CurrentBuilder ]->m_Token.m_Id )
+				switch ( m_Tokens[ m_CurrentToken ].m_Id )
 				{
 				case Compiler::TOK_SCOLON:
-					++m_CurrentBuilder;
+					++m_CurrentToken;
 				case Compiler::TOK_BRACE_RIGHT:
 					break;
 				default:
-					++m_CurrentBuilder;
+					++m_CurrentToken;
 					continue;
 				}
 
@@ -145,16 +123,16 @@ namespace Compiler
 			if ( !IsFinished() )
 				return;
 
-			int lineNr, colNr;
+			int lineNr = -1, colNr = -1;
 			std::string token;
 
-			if ( m_Builders.size() > 0 )
+			if ( m_Tokens.size() > 0 )
 			{
-				auto lastToken = m_Builders[ m_Builders.size() - 1 ];
+				auto& lastToken = m_Tokens[ m_Tokens.size() - 1 ];
 
-				lineNr = lastToken->m_Token.m_LineNr;
-				colNr = lastToken->m_Token.m_ColNr;
-				token = lastToken->m_Token.m_String;
+				lineNr = lastToken.m_LineNr;
+				colNr = lastToken.m_ColNr;
+				token = lastToken.m_String;
 			}
 
 			throw CompilerException( "ir_parsing_past_eof", "Parsing past end of file", lineNr,
@@ -164,20 +142,15 @@ namespace Compiler
 		template <typename T, class... Args>
 		T* 								AllocateNode(Args&& ... args)
 		{
-			static_assert( std::is_base_of<BaseNode, T>::value, "Allocated node must derive from BaseNode" );
-
-			auto node = QS_NEW T( args... );
-			m_AllocatedNodes.push_back( ( BaseNode* ) node );
-
-			return node;
+			return m_Arena.AllocateNode< T >( std::forward< Args >( args )... );
 		}
 
 	private:
-		int 								m_CurrentBuilder;
+		int 								m_CurrentToken;
+		const std::vector< Token_t >&		m_Tokens;
+		NodeArena&							m_Arena;
 		std::vector< BaseNode* > 			m_Ast;
-		std::vector< IrBuilder_t* > 		m_Builders;
 
 		std::vector< CompilerException >	m_Errors;
-		std::vector< BaseNode* > 			m_AllocatedNodes;
 	};
 }
@@ -7,7 +7,8 @@
 
 namespace Compiler
 {
-	using NextExpressionFn = std::function< BaseNode*( int rbp ) >;
+	static BaseNode* NextExpression( ParserState& parserState, int rbp = 0 );
+	static BaseNode* NextStatement( ParserState& parserState );
 
 	bool IsString( BaseNode* node )
 	{
@@ -19,31 +20,31 @@ namespace Compiler
 
 	CompileTypeInfo ResolveTypeDef( ParserState& parserState )
 	{
-		std::map< Token, CompileTypeInfo > typeMap = {
-			{ TOK_AUTO, TYPE_AUTO },
-			{ TOK_STRING, TYPE_STRING },
-			{ TOK_BOOL, TYPE_BOOL },
-			{ TOK_NUMBER, TYPE_NUMBER },
-			{ TOK_VAR, TYPE_UNKNOWN },
-		};
+		CompileTypeInfo typeInfo;
 
-		for ( auto type : typeMap )
+		switch ( parserState.CurrentToken().m_Id )
 		{
-			if ( parserState.MatchCurrent( type.first ) )
-				return type.second;
+		case TOK_AUTO: typeInfo = TYPE_AUTO; break;
+		case TOK_STRING: typeInfo = TYPE_STRING; break;
+		case TOK_BOOL: typeInfo = TYPE_BOOL; break;
+		case TOK_NUMBER: typeInfo = TYPE_NUMBER; break;
+		case TOK_VAR: typeInfo = TYPE_UNKNOWN; break;
+		default:
+			return TYPE_NONE;
 		}
 
-		return TYPE_NONE;
+		parserState.NextToken();
+		return typeInfo;
 	}
 
-	ListNode* ParseFunction( ParserState& parserState, const IrBuilder_t& irBuilder, NextExpressionFn nextExpression )
+	ListNode* ParseFunction( ParserState& parserState, const Token_t& token )
 	{
 		int offset = parserState.Offset();
-		IrBuilder_t* builder = parserState.Peek( offset );
+		const Token_t* current = parserState.Peek( offset );
 
-		for ( ; builder; offset += 1, builder = parserState.Peek( offset ) )
+		for ( ; current; offset += 1, current = parserState.Peek( offset ) )
 		{
-			switch ( builder->m_Token.m_Id )
+			switch ( current->m_Id )
 			{
 			case Compiler::TOK_COMMA:
 			case Compiler::TOK_NAME:
@@ -60,12 +61,12 @@ namespace Compiler
 			break;
 		}
 
-		if ( builder == NULL )
+		if ( current == NULL )
 			return NULL;
 
 		auto arrowToken = parserState.Peek( ++offset );
 
-		if ( !arrowToken || arrowToken->m_Token.m_Id != Compiler::TOK_ARROW )
+		if ( !arrowToken || arrowToken->m_Id != Compiler::TOK_ARROW )
 			return NULL;
 
 		std::vector< BaseNode* > argsList;
@@ -74,7 +75,7 @@ namespace Compiler
 		{
 			do {
 				auto typeDef = ResolveTypeDef( parserState );
-				auto argName = nextExpression( BP_VAR );
+				auto argName = NextExpression( parserState, BP_VAR );
 
 				if ( typeDef == TYPE_NONE )
 					typeDef = TYPE_UNKNOWN; // no type specified, use unknown
@@ -85,19 +86,13 @@ namespace Compiler
 						argName->LineNr(), argName->ColNr(), argName->Token() );
 				}
 
-				std::vector< CompileTypeInfo > validTypes ={
-					TYPE_BOOL,
-					TYPE_STRING,
-					TYPE_NUMBER
-				};
-
-				if ( std::find( validTypes.begin(), validTypes.end(), typeDef ) != validTypes.end() )
+				if ( typeDef == TYPE_BOOL || typeDef == TYPE_STRING || typeDef == TYPE_NUMBER )
 				{
-					auto varTypeNode = parserState.AllocateNode< ValueNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_CONSTANT, MAKE_NUMBER( typeDef ) );
+					auto varTypeNode = parserState.AllocateNode< ValueNode >( token.m_LineNr, token.m_ColNr,
+						token.m_String, NODE_CONSTANT, MAKE_NUMBER( typeDef ) );
 
-					argsList.push_back( parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr,
-						irBuilder.m_Token.m_ColNr, irBuilder.m_Token.m_String, NODE_VAR,
+					argsList.push_back( parserState.AllocateNode< ListNode >( token.m_LineNr,
+						token.m_ColNr, token.m_String, NODE_VAR,
 						std::vector< BaseNode* >{ argName, NULL, varTypeNode } ) );
 				}
 				else
@@ -106,11 +101,11 @@ namespace Compiler
 				}
 			} while ( parserState.MatchCurrent( TOK_COMMA ) );
 
-			parserState.Expect( TOK_PAREN_RIGHT, "Expected \")\" after \"var <name> = (...\", got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
+			parserState.Expect( TOK_PAREN_RIGHT, "Expected \")\" after \"var <name> = (...\", got: \"" + parserState.CurrentToken().m_String + "\"" );
 		}
 
 		// Skip over arrow
-		parserState.Expect( TOK_ARROW, "Expected \"->\" after \"var <name> = (...)\", got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
+		parserState.Expect( TOK_ARROW, "Expected \"->\" after \"var <name> = (...)\", got: \"" + parserState.CurrentToken().m_String + "\"" );
 
 		// Check for explicit return type
 		uint32_t retnType = ResolveTypeDef( parserState );
@@ -119,24 +114,24 @@ namespace Compiler
 			retnType = TYPE_UNKNOWN; // use auto-deduction
 
 		// Append type information as a value node
-		auto retnTypeNode = parserState.AllocateNode< ValueNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-			irBuilder.m_Token.m_String, NODE_CONSTANT, MAKE_NUMBER( retnType ) );
+		auto retnTypeNode = parserState.AllocateNode< ValueNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_CONSTANT, MAKE_NUMBER( retnType ) );
 
-		auto body = parserState.ToScope( nextExpression( irBuilder.m_Token.m_LBP ) );
+		auto body = parserState.ToScope( NextExpression( parserState, token.m_LBP ) );
 
 		// Skip over "}"
-		parserState.Expect( TOK_BRACE_RIGHT, "Expected \"}\" after function body, got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
+		parserState.Expect( TOK_BRACE_RIGHT, "Expected \"}\" after function body, got: \"" + parserState.CurrentToken().m_String + "\"" );
 
-		auto args = parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-			irBuilder.m_Token.m_String, NODE_ARGUMENTS, argsList );
+		auto args = parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_ARGUMENTS, argsList );
 
-		return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-			irBuilder.m_Token.m_String, NODE_FUNC, std::vector< BaseNode* >{ args, body, retnTypeNode } );
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_FUNC, std::vector< BaseNode* >{ args, body, retnTypeNode } );
 	}
 
-	BaseNode* ParseMethod( ParserState& parserState, const IrBuilder_t& irBuilder, NextExpressionFn nextExpression )
+	BaseNode* ParseMethod( ParserState& parserState, const Token_t& token )
 	{
-		auto methodName = nextExpression( BP_OPENPAREN );
+		auto methodName = NextExpression( parserState, BP_OPENPAREN );
 
 		if ( !IsString( methodName ) )
 		{
@@ -145,46 +140,46 @@ namespace Compiler
 		}
 
 		// Skip over "(" in method declaration
-		parserState.Expect( TOK_PAREN_LEFT, "Expected \"(\" after \"<method name>...\", got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
+		parserState.Expect( TOK_PAREN_LEFT, "Expected \"(\" after \"<method name>...\", got: \"" + parserState.CurrentToken().m_String + "\"" );
 
-		auto funcNode = ParseFunction( parserState, irBuilder, nextExpression );
+		auto funcNode = ParseFunction( parserState, token );
 
 		if ( !funcNode )
 			return NULL;
 
-		return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-			irBuilder.m_Token.m_String, NODE_METHOD, std::vector< BaseNode* >{ methodName, funcNode } );
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_METHOD, std::vector< BaseNode* >{ methodName, funcNode } );
 	}
 
-	BaseNode* ParseField( ParserState& parserState, const IrBuilder_t& irBuilder, NextExpressionFn nextExpression )
+	BaseNode* ParseField( ParserState& parserState, const Token_t& token )
 	{
 		bool bMatchConst = parserState.MatchCurrent( TOK_CONST );
 
-		if ( parserState.CurrentBuilder()->m_Token.m_Id == TOK_TABLE )
-			return nextExpression( BP_NONE ); // nested table
+		if ( parserState.CurrentToken().m_Id == TOK_TABLE )
+			return NextExpression( parserState, BP_NONE ); // nested table
 
-		if ( parserState.CurrentBuilder()->m_Token.m_Id == TOK_ARRAY )
-			return nextExpression( BP_NONE );
+		if ( parserState.CurrentToken().m_Id == TOK_ARRAY )
+			return NextExpression( parserState, BP_NONE );
 
 		auto fieldType = ResolveTypeDef( parserState );
 
 		if ( !bMatchConst && fieldType == TYPE_NONE )
 			return NULL;
 
-		auto fieldTypeNode = parserState.AllocateNode< ValueNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-			irBuilder.m_Token.m_String, NODE_CONSTANT, MAKE_NUMBER( fieldType ) );
+		auto fieldTypeNode = parserState.AllocateNode< ValueNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_CONSTANT, MAKE_NUMBER( fieldType ) );
 
-		auto fieldNameNode = nextExpression( BP_VAR );
+		auto fieldNameNode = NextExpression( parserState, BP_VAR );
 
 		if ( parserState.MatchCurrent( TOK_EQUALS ) )
 		{
-			return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-				irBuilder.m_Token.m_String, NODE_FIELD, std::vector< BaseNode* >{ fieldNameNode, fieldTypeNode, nextExpression( BP_ASSIGN ) } );
+			return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+				token.m_String, NODE_FIELD, std::vector< BaseNode* >{ fieldNameNode, fieldTypeNode, NextExpression( parserState, BP_ASSIGN ) } );
 		}
 		else
 		{
-			return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-				irBuilder.m_Token.m_String, NODE_FIELD, std::vector< BaseNode* >{ fieldNameNode, fieldTypeNode, NULL } );
+			return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+				token.m_String, NODE_FIELD, std::vector< BaseNode* >{ fieldNameNode, fieldTypeNode, NULL } );
 		}
 	}
 
@@ -202,793 +197,759 @@ namespace Compiler
 		}
 	}
 
-	std::vector< BaseNode* > GenerateIR( const std::vector< Token_t >& tokens )
+	static BaseNode* NudConstant( ParserState& parserState, const Token_t& token )
 	{
-		ParserState parserState;
+		QScript::Value value;
 
-		// TDOP expression parsing
-		auto nextExpression = [ &parserState ]( int rbp = 0 ) -> BaseNode*
+		switch ( token.m_Id )
 		{
-			// Get the current builder, increment counter to the next one
-			auto builder = parserState.NextBuilder();
-
-			if ( builder->m_Nud == NULL )
+			case TOK_STR:
+				value = MAKE_STRING( token.m_String );
+				break;
+			case TOK_INT:
+				value = MAKE_NUMBER( ( double ) std::stoi( token.m_String ) );
+				break;
+			case TOK_DBL:
+				value = MAKE_NUMBER( std::stod( token.m_String ) );
+				break;
+			case TOK_NULL:
+				value = MAKE_NULL;
+				break;
+			case TOK_FALSE:
+				value = MAKE_BOOL( false );
+				break;
+			case TOK_TRUE:
+				value = MAKE_BOOL( true );
+				break;
+			default:
 			{
-				throw CompilerException( "ir_expect_lvalue_or_statement", "Expected a left-value or statement",
-					builder->m_Token.m_LineNr, builder->m_Token.m_ColNr, builder->m_Token.m_String );
+				throw CompilerException( "ir_invalid_token", "Invalid token: \"" + token.m_String + "\"",
+					token.m_LineNr, token.m_ColNr, token.m_String );
 			}
+		};
 
-			// parse null-denoted node
-			auto left = builder->m_Nud( *builder );
+		return parserState.AllocateNode< ValueNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_CONSTANT, value );
+	}
+
+	static BaseNode* NudName( ParserState& parserState, const Token_t& token )
+	{
+		return parserState.AllocateNode< ValueNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_NAME, MAKE_STRING( token.m_String ) );
+	}
 
-			if ( rbp == -1 )
-				return left;
+	static BaseNode* NudVariable( ParserState& parserState, const Token_t& token )
+	{
+		auto varType = TYPE_UNKNOWN;
 
-			// while the next builder has a larger binding power
-			// deliver it the left hand node instead
-			while ( !parserState.IsFinished() && rbp < parserState.CurrentBuilder()->m_Token.m_LBP )
-			{
-				parserState.CheckEOF();
+		switch ( token.m_Id )
+		{
+		case TOK_AUTO:
+			varType = TYPE_AUTO;
+			break;
+		case TOK_BOOL:
+			varType = TYPE_BOOL;
+			break;
+		case TOK_STRING:
+			varType = TYPE_STRING;
+			break;
+		case TOK_NUMBER:
+			varType = TYPE_NUMBER;
+			break;
+		case TOK_CONST:
+		{
+			varType = ResolveTypeDef( parserState );
 
-				builder = parserState.NextBuilder();
+			if ( varType == TYPE_NONE )
+				varType = TYPE_UNKNOWN;
+			break;
+		}
+		case TOK_VAR:
+		default:
+			break;
+		}
 
-				if ( builder->m_Led == NULL )
-				{
-					throw CompilerException( "ir_expect_rvalue", "Expected a right-value",
-						builder->m_Token.m_LineNr, builder->m_Token.m_ColNr, builder->m_Token.m_String );
-				}
+		auto varName = NextExpression( parserState, token.m_LBP );
 
-				left = builder->m_Led( *builder, left );
-			}
+		if ( !IsString( varName ) )
+		{
+			throw CompilerException( "ir_variable_name", "Invalid variable name: \"" + varName->Token() + "\"",
+				varName->LineNr(), varName->ColNr(), varName->Token() );
+		}
 
-			return left;
-		};
+		// Append type information as a value node
+		auto varTypeNode = parserState.AllocateNode< ValueNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_CONSTANT, MAKE_NUMBER( varType ) );
 
-		auto nextStatement = [ &parserState, &nextExpression ]() -> BaseNode*
+		if ( parserState.MatchCurrent( TOK_EQUALS ) )
 		{
-			try
-			{
-				auto headNode = nextExpression();
+			return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+				token.m_String, token.m_Id == TOK_CONST ? NODE_CONSTVAR : NODE_VAR,
+				std::vector< BaseNode* >{ varName, NextExpression( parserState, BP_ASSIGN ), varTypeNode } );
+		}
+		else
+		{
+			return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+				token.m_String, token.m_Id == TOK_CONST ? NODE_CONSTVAR : NODE_VAR,
+				std::vector< BaseNode* >{ varName, ( BaseNode* ) NULL, varTypeNode } );
+		}
+	}
 
-				if ( headNode )
-				{
-					switch ( headNode->Id() )
-					{
-					case NODE_NAME:
-					{
-						throw CompilerException( "ir_unknown_symbol", "Unknown symbol \"" + headNode->Token() + "\"", headNode->LineNr(), headNode->ColNr(), headNode->Token() );
-					}
-					default:
-						break;
-					}
+	static BaseNode* NudNot( ParserState& parserState, const Token_t& token )
+	{
+		return parserState.AllocateNode< SimpleNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_NOT, NextExpression( parserState, token.m_LBP ) );
+	}
 
-					switch ( headNode->Id() )
-					{
-					case NODE_ARRAY:
-					case NODE_TABLE:
-					{
-						// Allow trailing semicolon on table definitions
-						parserState.MatchCurrent( TOK_SCOLON );
-						break;
-					}
-					case NODE_FUNC:
-					{
-						// Allow trailing semicolon on function definitions
-						parserState.MatchCurrent( TOK_SCOLON );
-						break;
-					}
-					case NODE_ASSIGN:
-					{
-						auto assignNode = static_cast< ComplexNode* >( headNode );
-						EndStatement( assignNode->GetRight(), parserState );
-						break;
-					}
-					case NODE_CONSTVAR:
-					case NODE_VAR:
-					{
-						auto varNode = static_cast< ListNode* >( headNode );
-						EndStatement( varNode->GetList()[ 1 ], parserState );
-						break;
-					}
-					case NODE_RETURN:
-					{
-						auto returnNode = static_cast< SimpleNode* >( headNode );
-						EndStatement( returnNode->GetNode(), parserState );
-						break;
-					}
-					case NODE_IF:
-					case NODE_WHILE:
-					case NODE_FOR:
-					{
-						auto currentToken = parserState.CurrentBuilder()->m_Token.m_Id;
-						if ( currentToken != TOK_BRACE_RIGHT && currentToken != TOK_SCOLON )
-						{
-							auto builder = parserState.CurrentBuilder();
-							throw CompilerException( "ir_expect", "Expected end of if/for/while-statement", builder->m_Token.m_LineNr,
-								builder->m_Token.m_ColNr, builder->m_Token.m_String );
-						}
-
-						parserState.NextBuilder();
-						break;
-					}
-					default:
-					{
-						if ( headNode->Id() == NODE_SCOPE )
-						{
-							// Block declarations must end with a right brace
-							parserState.Expect( TOK_BRACE_RIGHT, "Expected end of block declaration" );
-						}
-						else
-						{
-							// Expression statements must end with a semicolon
-							parserState.Expect( TOK_SCOLON, "Expected end of expression" );
-						}
-						break;
-					}
-					}
-				}
+	static BaseNode* LedInlineIf( ParserState& parserState, const Token_t& token, BaseNode* left )
+	{
+		std::vector< BaseNode* > chain;
 
-				return headNode;
-			}
-			catch ( const CompilerException& exception )
-			{
-				// A compilation error occurred, resync and continue parsing
-				// to catch as many errors with a single pass as possible
-				parserState.AddErrorAndResync( exception );
-				return NULL;
-			}
-		};
+		// condition
+		chain.push_back( left );
+
+		// if-true expression
+		chain.push_back( NextExpression( parserState, token.m_LBP ) );
+
+		parserState.Expect( TOK_COLON, "Expected \":\" after \"?\" <expression>" );
+
+		// else expression
+		chain.push_back( NextExpression( parserState, token.m_LBP ) );
+
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_INLINE_IF, chain );
+	}
 
-		auto createBuilder = [ &parserState, &nextExpression, &nextStatement ]( const Token_t& token ) -> IrBuilder_t*
+	static BaseNode* NudNegate( ParserState& parserState, const Token_t& token )
+	{
+		return parserState.AllocateNode< SimpleNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_NEG, NextExpression( parserState, BP_IMMEDIATE ) );
+	}
+
+	static BaseNode* LedBinary( ParserState& parserState, const Token_t& token, BaseNode* left )
+	{
+		NodeId nodeId;
+		int rbp = token.m_LBP;
+
+		switch ( token.m_Id )
 		{
-			IrBuilder_t* builder = QS_NEW IrBuilder_t( token );
+		case TOK_MINUS: nodeId = NODE_SUB; break;
+		case TOK_STAR: nodeId = NODE_MUL; break;
+		case TOK_SLASH: nodeId = NODE_DIV; break;
+		case TOK_PLUS: nodeId = NODE_ADD; break;
+		case TOK_2STAR: nodeId = NODE_POW; break;
+		case TOK_PERCENT: nodeId = NODE_MOD; break;
+		case TOK_2EQUALS: nodeId = NODE_EQUALS; break;
+		case TOK_NOTEQUALS: nodeId = NODE_NOTEQUALS; break;
+		case TOK_GREATERTHAN: nodeId = NODE_GREATERTHAN; break;
+		case TOK_GREATEREQUAL: nodeId = NODE_GREATEREQUAL; break;
+		case TOK_LESSTHAN: nodeId = NODE_LESSTHAN; break;
+		case TOK_LESSEQUAL: nodeId = NODE_LESSEQUAL; break;
+		case TOK_AND: nodeId = NODE_AND; break;
+		case TOK_OR: nodeId = NODE_OR; break;
+		case TOK_EQUALS: nodeId = NODE_ASSIGN; rbp = BP_ASSIGN_FORWARD; break;
+		case TOK_EQUALSADD: nodeId = NODE_ASSIGNADD; rbp = BP_ASSIGN_FORWARD; break;
+		case TOK_EQUALSDIV: nodeId = NODE_ASSIGNDIV; rbp = BP_ASSIGN_FORWARD; break;
+		case TOK_EQUALSSUB: nodeId = NODE_ASSIGNSUB; rbp = BP_ASSIGN_FORWARD; break;
+		case TOK_EQUALSMUL: nodeId = NODE_ASSIGNMUL; rbp = BP_ASSIGN_FORWARD; break;
+		case TOK_EQUALSMOD: nodeId = NODE_ASSIGNMOD; rbp = BP_ASSIGN_FORWARD; break;
+		default:
+			throw CompilerException( "ir_invalid_token", "Invalid token: \"" + token.m_String + "\"",
+				token.m_LineNr, token.m_ColNr, token.m_String );
+		}
 
-			switch ( token.m_Id )
-			{
-			case TOK_NULL:
-			case TOK_FALSE:
-			case TOK_TRUE:
-			case TOK_DBL:
-			case TOK_INT:
-			case TOK_STR:
-			{
-				builder->m_Nud = [ &parserState ]( const IrBuilder_t& irBuilder )
-				{
-					QScript::Value value;
+		return parserState.AllocateNode< ComplexNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, nodeId, left, NextExpression( parserState, rbp ) );
+	}
 
-					switch ( irBuilder.m_Token.m_Id )
-					{
-						case TOK_STR:
-							value = MAKE_STRING( irBuilder.m_Token.m_String );
-							break;
-						case TOK_INT:
-							value = MAKE_NUMBER( ( double ) std::stoi( irBuilder.m_Token.m_String ) );
-							break;
-						case TOK_DBL:
-							value = MAKE_NUMBER( std::stod( irBuilder.m_Token.m_String ) );
-							break;
-						case TOK_NULL:
-							value = MAKE_NULL;
-							break;
-						case TOK_FALSE:
-							value = MAKE_BOOL( false );
-							break;
-						case TOK_TRUE:
-							value = MAKE_BOOL( true );
-							break;
-						default:
-						{
-							throw CompilerException( "ir_invalid_token", "Invalid token: \"" + irBuilder.m_Token.m_String + "\"",
-								irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr, irBuilder.m_Token.m_String );
-						}
-					};
-
-					return parserState.AllocateNode< ValueNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_CONSTANT, value );
-				};
-				break;
-			}
-			case TOK_NAME:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					return parserState.AllocateNode< ValueNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_NAME, MAKE_STRING( irBuilder.m_Token.m_String ) );
-				};
-				break;
-			}
-			case TOK_AUTO:
-			case TOK_BOOL:
-			case TOK_STRING:
-			case TOK_NUMBER:
-			case TOK_CONST:
-			case TOK_VAR:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder )
-				{
-					auto varType = TYPE_UNKNOWN;
+	static BaseNode* LedIncDec( ParserState& parserState, const Token_t& token, BaseNode* left )
+	{
+		return parserState.AllocateNode< ComplexNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, token.m_Id == TOK_2PLUS ? NODE_INC : NODE_DEC,
+			left, ( BaseNode* ) NULL );
+	}
 
-					switch ( irBuilder.m_Token.m_Id )
-					{
-					case TOK_AUTO:
-						varType = TYPE_AUTO;
-						break;
-					case TOK_BOOL:
-						varType = TYPE_BOOL;
-						break;
-					case TOK_STRING:
-						varType = TYPE_STRING;
-						break;
-					case TOK_NUMBER:
-						varType = TYPE_NUMBER;
-						break;
-					case TOK_CONST:
-					{
-						varType = ResolveTypeDef( parserState );
+	static BaseNode* NudIncDec( ParserState& parserState, const Token_t& token )
+	{
+		return parserState.AllocateNode< ComplexNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, token.m_Id == TOK_2PLUS ? NODE_INC : NODE_DEC,
+			( BaseNode* ) NULL, NextExpression( parserState, token.m_LBP ) );
+	}
 
-						if ( varType == TYPE_NONE )
-							varType = TYPE_UNKNOWN;
-						break;
-					}
-					case TOK_VAR:
-					default:
-						break;
-					}
+	static BaseNode* NudImport( ParserState& parserState, const Token_t& token )
+	{
+		auto moduleName = NextExpression( parserState, BP_VAR );
 
-					auto varName = nextExpression( irBuilder.m_Token.m_LBP );
+		if ( !IsString( moduleName ) )
+		{
+			throw CompilerException( "ir_invalid_import",
+				"Invalid import target \"" + moduleName->Token() + "\"",
+				moduleName->LineNr(), moduleName->ColNr(), moduleName->Token() );
+		}
 
-					if ( !IsString( varName ) )
-					{
-						throw CompilerException( "ir_variable_name", "Invalid variable name: \"" + varName->Token() + "\"",
-							varName->LineNr(), varName->ColNr(), varName->Token() );
-					}
+		return parserState.AllocateNode< SimpleNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_IMPORT, moduleName );
+	}
 
-					// Append type information as a value node
-					auto varTypeNode = parserState.AllocateNode< ValueNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_CONSTANT, MAKE_NUMBER( varType ) );
+	static BaseNode* NudIf( ParserState& parserState, const Token_t& token )
+	{
+		std::vector< BaseNode* > chain;
 
-					if ( parserState.MatchCurrent( TOK_EQUALS ) )
-					{
-						return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-							irBuilder.m_Token.m_String, irBuilder.m_Token.m_Id == TOK_CONST ? NODE_CONSTVAR : NODE_VAR,
-							std::vector< BaseNode* >{ varName, nextExpression( BP_ASSIGN ), varTypeNode } );
-					}
-					else
-					{
-						return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-							irBuilder.m_Token.m_String, irBuilder.m_Token.m_Id == TOK_CONST ? NODE_CONSTVAR : NODE_VAR,
-							std::vector< BaseNode* >{ varName, ( BaseNode* ) NULL, varTypeNode } );
-					}
-				};
-				break;
-			}
-			case TOK_BANG:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder )
-				{
-					return parserState.AllocateNode< SimpleNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_NOT, nextExpression( irBuilder.m_Token.m_LBP ) );
-				};
-				break;
-			}
-			case TOK_QUERY:
-			{
-				builder->m_Led = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder, BaseNode* left ) -> BaseNode*
-				{
-					std::vector< BaseNode* > chain;
+		// condition
+		chain.push_back( NextExpression( parserState, token.m_LBP ) );
+
+		auto body = parserState.ToScope( NextExpression( parserState, token.m_LBP ) );
+		chain.push_back( body );
+
+		// optional else block
+		if ( parserState.Match( TOK_ELSE ) )
+			chain.push_back( parserState.ToScope( NextExpression( parserState, token.m_LBP ) ) );
+		else
+			chain.push_back( NULL );
+
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_IF, chain );
+	}
 
-					// condition
-					chain.push_back( left );
+	static BaseNode* NudElse( ParserState& parserState, const Token_t& token )
+	{
+		return NextExpression( parserState, token.m_LBP );
+	}
 
-					// if-true expression
-					chain.push_back( nextExpression( irBuilder.m_Token.m_LBP ) );
+	static BaseNode* NudWhile( ParserState& parserState, const Token_t& token )
+	{
+		auto condition = NextExpression( parserState, token.m_LBP );
 
-					parserState.Expect( TOK_COLON, "Expected \":\" after \"?\" <expression>" );
+		auto body = parserState.ToScope( NextExpression( parserState, token.m_LBP ) );
 
-					// else expression
-					chain.push_back( nextExpression( irBuilder.m_Token.m_LBP ) );
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_WHILE, std::vector< BaseNode* >{ condition, body } );
+	}
 
-					return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_INLINE_IF, chain );
-				};
+	static BaseNode* NudDo( ParserState& parserState, const Token_t& token )
+	{
+		auto body = parserState.ToScope( NextExpression( parserState, token.m_LBP ) );
 
-				break;
-			}
-			case TOK_MINUS:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder )
-				{
-					return parserState.AllocateNode< SimpleNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_NEG, nextExpression( -1 ) );
-				};
-				/* Fall Through */
-			}
-			case TOK_PLUS:
-			case TOK_SLASH:
-			case TOK_STAR:
-			case TOK_PERCENT:
-			case TOK_2STAR:
+		// Skip over terminating token (either ; or })
+		parserState.NextToken();
+
+		parserState.Expect( TOK_WHILE, "Expected \"while\" after \"do <block>\", got: \"" + parserState.CurrentToken().m_String + "\"" );
+
+		auto condition = NextExpression( parserState, token.m_LBP );
+
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_DO, std::vector< BaseNode* >{ body, condition } );
+	}
+
+	static BaseNode* NudFor( ParserState& parserState, const Token_t& token )
+	{
+		std::vector< BaseNode* > forStatement;
+
+		parserState.Expect( TOK_PAREN_LEFT, "Expected \"(\" after \"for\", got: \"" + parserState.CurrentToken().m_String + "\"" );
+
+		for ( int i = 0; i < 4; ++i )
+		{
+			if ( parserState.MatchCurrent( TOK_PAREN_RIGHT ) )
 			{
-				builder->m_Led = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder, BaseNode* left )
+				if ( forStatement.size() == 0 )
 				{
-					std::map<Token, NodeId> map = {
-						{ TOK_MINUS, 	NODE_SUB },
-						{ TOK_STAR, 	NODE_MUL },
-						{ TOK_SLASH, 	NODE_DIV },
-						{ TOK_PLUS, 	NODE_ADD },
-						{ TOK_2STAR, 	NODE_POW },
-						{ TOK_PERCENT, 	NODE_MOD },
-					};
-
-					return parserState.AllocateNode< ComplexNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, map[ irBuilder.m_Token.m_Id ], left, nextExpression( irBuilder.m_Token.m_LBP ) );
-				};
+					auto& current = parserState.CurrentToken();
+					throw CompilerException( "ir_empty_forloop", "Empty forloop. Expected a list of expressions", current.m_LineNr,
+						current.m_ColNr, current.m_String );
+				}
+
+				// If the last parsed expression was null, add a NULL for the increment clause as well
+				if ( forStatement[ forStatement.size() - 1 ] == NULL )
+					forStatement.push_back( NULL );
+
+				// If only 2 expressions were parsed, add a NULL for the increment clause as well
+				if ( forStatement.size() == 2 )
+					forStatement.push_back( NULL );
+
 				break;
 			}
-			case TOK_EQUALS:
-			case TOK_EQUALSADD:
-			case TOK_EQUALSDIV:
-			case TOK_EQUALSSUB:
-			case TOK_EQUALSMUL:
-			case TOK_EQUALSMOD:
+			else if ( parserState.MatchCurrent( TOK_SCOLON ) )
 			{
-				builder->m_Led = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder, BaseNode* left )
-				{
-					std::map<Token, NodeId> map = {
-						{ TOK_EQUALS, 		NODE_ASSIGN },
-						{ TOK_EQUALSADD, 	NODE_ASSIGNADD },
-						{ TOK_EQUALSDIV, 	NODE_ASSIGNDIV },
-						{ TOK_EQUALSSUB, 	NODE_ASSIGNSUB },
-						{ TOK_EQUALSMUL, 	NODE_ASSIGNMUL },
-						{ TOK_EQUALSMOD, 	NODE_ASSIGNMOD },
-					};
-
-					return parserState.AllocateNode< ComplexNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, map[ irBuilder.m_Token.m_Id ], left, nextExpression( BP_ASSIGN_FORWARD ) );
-				};
-				break;
+				forStatement.push_back( NULL );
 			}
-			case TOK_NOTEQUALS:
-			case TOK_2EQUALS:
-			case TOK_GREATERTHAN:
-			case TOK_GREATEREQUAL:
-			case TOK_LESSTHAN:
-			case TOK_LESSEQUAL:
-			case TOK_AND:
-			case TOK_OR:
+			else
 			{
-				builder->m_Led = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder, BaseNode* left )
-				{
-					std::map<Token, NodeId> map = {
-						{ TOK_2EQUALS, 			NODE_EQUALS },
-						{ TOK_NOTEQUALS, 		NODE_NOTEQUALS },
-						{ TOK_GREATERTHAN, 		NODE_GREATERTHAN },
-						{ TOK_GREATEREQUAL, 	NODE_GREATEREQUAL },
-						{ TOK_LESSTHAN, 		NODE_LESSTHAN },
-						{ TOK_LESSEQUAL, 		NODE_LESSEQUAL },
-						{ TOK_AND, 				NODE_AND },
-						{ TOK_OR, 				NODE_OR },
-					};
-
-					return parserState.AllocateNode< ComplexNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, map[ irBuilder.m_Token.m_Id ], left, nextExpression( irBuilder.m_Token.m_LBP ) );
-				};
-				break;
+				forStatement.push_back( NextExpression( parserState, token.m_LBP ) );
+
+				if ( i < 2 )
+					parserState.Expect( TOK_SCOLON, "Expected end of expression" );
 			}
-			case TOK_2PLUS:
-			case TOK_2MINUS:
-			{
-				builder->m_Led = [ &parserState ]( const IrBuilder_t& irBuilder, BaseNode* left ) -> BaseNode*
-				{
-					return parserState.AllocateNode< ComplexNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, irBuilder.m_Token.m_Id == TOK_2PLUS ? NODE_INC : NODE_DEC,
-						left, ( BaseNode* ) NULL );
-				};
+		}
 
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					return parserState.AllocateNode< ComplexNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, irBuilder.m_Token.m_Id == TOK_2PLUS ? NODE_INC : NODE_DEC,
-						( BaseNode* ) NULL, nextExpression( irBuilder.m_Token.m_LBP ) );
-				};
-				break;
+		auto body = parserState.ToScope( NextExpression( parserState, token.m_LBP ) );
+		forStatement.push_back( body );
+
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_FOR, forStatement );
+	}
+
+	static BaseNode* NudTable( ParserState& parserState, const Token_t& token )
+	{
+		ListNode* propertyNode = NULL;
+		BaseNode* varName = NULL;
+
+		if ( parserState.CurrentToken().m_Id != TOK_BRACE_LEFT )
+		{
+			varName = NextExpression( parserState, BP_VAR );
+
+			if ( !IsString( varName ) )
+			{
+				throw CompilerException( "ir_table_name", "Invalid table name: \"" + varName->Token() + "\"",
+					varName->LineNr(), varName->ColNr(), varName->Token() );
 			}
-			case TOK_IMPORT:
+		}
+
+		if ( !parserState.MatchCurrent( TOK_SCOLON ) )
+		{
+			if ( varName )
+				parserState.Expect( TOK_EQUALS, "Expected \"=\" before table body, got: \"" + parserState.CurrentToken().m_String + "\"" );
+
+			if ( !parserState.MatchCurrent( TOK_BRACE_RIGHT ) )
 			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder )
+				parserState.Expect( TOK_BRACE_LEFT, "Expected \"{\" before table body, got: \"" + parserState.CurrentToken().m_String + "\"" );
+
+				std::vector< BaseNode* > properties;
+				while ( parserState.CurrentToken().m_Id != TOK_BRACE_RIGHT )
 				{
-					auto moduleName = nextExpression( BP_VAR );
+					auto node = ParseField( parserState, token );
 
-					if ( !IsString( moduleName ) )
+					if ( node )
+					{
+						properties.push_back( node );
+					}
+					else
 					{
-						throw CompilerException( "ir_invalid_import",
-							"Invalid import target \"" + moduleName->Token() + "\"",
-							moduleName->LineNr(), moduleName->ColNr(), moduleName->Token() );
+						node = ParseMethod( parserState, token );
+
+						if ( node )
+							properties.push_back( node );
 					}
 
-					return parserState.AllocateNode< SimpleNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_IMPORT, moduleName );
-				};
-				break;
+					// Check for trailing semicolon
+					parserState.Expect( TOK_SCOLON, "Expected end of expression" );
+				}
+
+				parserState.Expect( TOK_BRACE_RIGHT, "Expected \"}\" after table body, got: \"" + parserState.CurrentToken().m_String + "\"" );
+
+				propertyNode = parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+					token.m_String, NODE_PROPERTYLIST, properties );
 			}
-			case TOK_IF:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					std::vector< BaseNode* > chain;
+		}
+
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_TABLE, std::vector< BaseNode* >{ varName, propertyNode } );
+	}
 
-					// condition
-					chain.push_back( nextExpression( irBuilder.m_Token.m_LBP ) );
+	static BaseNode* NudClass( ParserState& parserState, const Token_t& token )
+	{
+		auto className = NextExpression( parserState, BP_VAR );
 
-					auto body = parserState.ToScope( nextExpression( irBuilder.m_Token.m_LBP ) );
-					chain.push_back( body );
+		if ( !IsString( className ) )
+		{
+			throw CompilerException( "ir_class_name", "Invalid class name: \"" + className->Token() + "\"",
+				className->LineNr(), className->ColNr(), className->Token() );
+		}
 
-					// optional else block
-					if ( parserState.Match( TOK_ELSE ) )
-						chain.push_back( parserState.ToScope( nextExpression( irBuilder.m_Token.m_LBP ) ) );
-					else
-						chain.push_back( NULL );
+		parserState.Expect( TOK_EQUALS, "Expected \"=\" before class body, got: \"" + parserState.CurrentToken().m_String + "\"" );
+		parserState.Expect( TOK_BRACE_LEFT, "Expected \"{\" before class body, got: \"" + parserState.CurrentToken().m_String + "\"" );
 
-					return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_IF, chain );
-				};
-				break;
-			}
-			case TOK_ELSE:
+		std::vector< BaseNode* > members;
+		while ( parserState.CurrentToken().m_Id != TOK_BRACE_RIGHT )
+		{
+			auto node = ParseField( parserState, token );
+
+			if ( !node )
+				node = ParseMethod( parserState, token );
+
+			if ( node )
+				members.push_back( node );
+
+			// Check for trailing semicolon
+			parserState.Expect( TOK_SCOLON, "Expected end of expression" );
+		}
+
+		parserState.Expect( TOK_BRACE_RIGHT, "Expected \"}\" after class body, got: \"" + parserState.CurrentToken().m_String + "\"" );
+
+		auto memberNode = parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_PROPERTYLIST, members );
+
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_CLASS, std::vector< BaseNode* >{ className, memberNode } );
+	}
+
+	static BaseNode* NudArray( ParserState& parserState, const Token_t& token )
+	{
+		BaseNode* varName = NULL;
+		ListNode* initializerNode = NULL;
+
+		if ( parserState.CurrentToken().m_Id != TOK_BRACE_LEFT )
+		{
+			varName = NextExpression( parserState, BP_VAR );
+
+			if ( !IsString( varName ) )
 			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					return nextExpression( irBuilder.m_Token.m_LBP );
-				};
-				break;
+				throw CompilerException( "ir_array_name", "Invalid array name: \"" + varName->Token() + "\"",
+					varName->LineNr(), varName->ColNr(), varName->Token() );
 			}
-			case TOK_WHILE:
+		}
+
+		if ( !varName || parserState.MatchCurrent( TOK_EQUALS ) )
+		{
+			parserState.Expect( TOK_BRACE_LEFT, "Expected \"{\" before array initializer, got: \"" + parserState.CurrentToken().m_String + "\"" );
+
+			std::vector< BaseNode* > initializers;
+			while ( parserState.CurrentToken().m_Id != TOK_BRACE_RIGHT )
 			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
+				auto valueNode = NextExpression( parserState, BP_COMMA );
+
+				switch ( valueNode->Id() )
+				{
+				case NODE_CONSTANT:
+				case NODE_NAME:
+				case NODE_TABLE:
+				case NODE_ARRAY:
+				case NODE_CALL:
+					break;
+				default:
 				{
-					auto condition = nextExpression( irBuilder.m_Token.m_LBP );
+					throw CompilerException( "ir_invalid_array_initializer", "Invalid array initializer: \"" + valueNode->Token() + "\"",
+						valueNode->LineNr(), valueNode->ColNr(), valueNode->Token() );
+				}
+				}
 
-					auto body = parserState.ToScope( nextExpression( irBuilder.m_Token.m_LBP ) );
+				initializers.push_back( valueNode );
 
-					return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_WHILE, std::vector< BaseNode* >{ condition, body } );
-				};
-				break;
+				if ( !parserState.MatchCurrent( TOK_COMMA ) )
+					break;
 			}
-			case TOK_DO:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					auto body = parserState.ToScope( nextExpression( irBuilder.m_Token.m_LBP ) );
 
-					// Skip over terminating token (either ; or })
-					parserState.NextBuilder();
+			parserState.Expect( TOK_BRACE_RIGHT, "Expected \"}\" after array initializer, got: \"" + parserState.CurrentToken().m_String + "\"" );
 
-					parserState.Expect( TOK_WHILE, "Expected \"while\" after \"do <block>\", got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
+			initializerNode = parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+				token.m_String, NODE_PROPERTYLIST, initializers );
+		}
 
-					auto condition = nextExpression( irBuilder.m_Token.m_LBP );
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_ARRAY, std::vector< BaseNode* >{ varName, initializerNode } );
+	}
 
-					return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_DO, std::vector< BaseNode* >{ body, condition } );
-				};
-				break;
-			}
-			case TOK_FOR:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					std::vector< BaseNode* > forStatement;
+	static BaseNode* LedDot( ParserState& parserState, const Token_t& token, BaseNode* left )
+	{
+		auto propName = NextExpression( parserState, token.m_LBP );
 
-					parserState.Expect( TOK_PAREN_LEFT, "Expected \"(\" after \"for\", got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
+		if ( !IsString( propName ) )
+		{
+			throw CompilerException( "ir_property_name", "Invalid property name: \"" + propName->Token() + "\"",
+				propName->LineNr(), propName->ColNr(), propName->Token() );
+		}
 
-					for ( int i = 0; i < 4; ++i )
-					{
-						if ( parserState.MatchCurrent( TOK_PAREN_RIGHT ) )
-						{
-							if ( forStatement.size() == 0 )
-							{
-								auto builder = parserState.CurrentBuilder();
-								throw CompilerException( "ir_empty_forloop", "Empty forloop. Expected a list of expressions", builder->m_Token.m_LineNr,
-									builder->m_Token.m_ColNr, builder->m_Token.m_String );
-							}
-
-							// If the last parsed expression was null, add a NULL for the increment clause as well
-							if ( forStatement[ forStatement.size() - 1 ] == NULL )
-								forStatement.push_back( NULL );
-
-							// If only 2 expressions were parsed, add a NULL for the increment clause as well
-							if ( forStatement.size() == 2 )
-								forStatement.push_back( NULL );
-
-							break;
-						}
-						else if ( parserState.MatchCurrent( TOK_SCOLON ) )
-						{
-							forStatement.push_back( NULL );
-						}
-						else
-						{
-							forStatement.push_back( nextExpression( irBuilder.m_Token.m_LBP ) );
-
-							if ( i < 2 )
-								parserState.Expect( TOK_SCOLON, "Expected end of expression" );
-						}
-					}
+		return parserState.AllocateNode< ComplexNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_ACCESS_PROP, left, propName );
+	}
 
-					auto body = parserState.ToScope( nextExpression( irBuilder.m_Token.m_LBP ) );
-					forStatement.push_back( body );
+	static BaseNode* NudScope( ParserState& parserState, const Token_t& token )
+	{
+		std::vector< BaseNode* > scopeExpressions;
 
-					return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_FOR, forStatement );
-				};
-				break;
-			}
-			case TOK_TABLE:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					ListNode* propertyNode = NULL;
-					BaseNode* varName = NULL;
+		while ( !parserState.IsFinished() && parserState.CurrentToken().m_Id != TOK_BRACE_RIGHT )
+		{
+			auto headNode = NextStatement( parserState );
 
-					if ( parserState.CurrentBuilder()->m_Token.m_Id != TOK_BRACE_LEFT )
-					{
-						varName = nextExpression( BP_VAR );
+			if ( headNode )
+				scopeExpressions.push_back( headNode );
+		}
 
-						if ( !IsString( varName ) )
-						{
-							throw CompilerException( "ir_table_name", "Invalid table name: \"" + varName->Token() + "\"",
-								varName->LineNr(), varName->ColNr(), varName->Token() );
-						}
-					}
+		return parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_SCOPE, scopeExpressions );
+	}
 
-					if ( !parserState.MatchCurrent( TOK_SCOLON ) )
-					{
-						if ( varName )
-							parserState.Expect( TOK_EQUALS, "Expected \"=\" before table body, got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
-
-						if ( !parserState.MatchCurrent( TOK_BRACE_RIGHT ) )
-						{
-							parserState.Expect( TOK_BRACE_LEFT, "Expected \"{\" before table body, got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
-
-							std::vector< BaseNode* > properties;
-							while ( parserState.CurrentBuilder()->m_Token.m_Id != TOK_BRACE_RIGHT )
-							{
-								auto node = ParseField( parserState, irBuilder, nextExpression );
-
-								if ( node )
-								{
-									properties.push_back( node );
-								}
-								else
-								{
-									node = ParseMethod( parserState, irBuilder, nextExpression );
-
-									if ( node )
-										properties.push_back( node );
-								}
-
-								// Check for trailing semicolon
-								parserState.Expect( TOK_SCOLON, "Expected end of expression" );
-							}
-
-							parserState.Expect( TOK_BRACE_RIGHT, "Expected \"}\" after table body, got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
-
-							propertyNode = parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-								irBuilder.m_Token.m_String, NODE_PROPERTYLIST, properties );
-						}
-					}
+	static BaseNode* NudCall( ParserState& parserState, const Token_t& token )
+	{
+		std::vector< BaseNode* > argsList;
+		auto target = NextExpression( parserState, BP_INLINE_IF /* Look ahead till ":" */ );
 
-					return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_TABLE, std::vector< BaseNode* >{ varName, propertyNode } );
-				};
-				break;
-			}
-			case TOK_ARRAY:
+		bool hasColon = parserState.MatchCurrent( TOK_COLON );
+		auto& afterColon = parserState.CurrentToken();
+
+		// Parse argument list
+		if ( !parserState.MatchCurrent( TOK_SQUARE_BRACKET_RIGHT ) )
+		{
+			if ( !hasColon )
 			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					BaseNode* varName = NULL;
-					ListNode* initializerNode = NULL;
+				auto& current = parserState.CurrentToken();
 
-					if ( parserState.CurrentBuilder()->m_Token.m_Id != TOK_BRACE_LEFT )
-					{
-						varName = nextExpression( BP_VAR );
+				throw CompilerException( "ir_expect", "Expected \":\" after function call target, got: \"" + current.m_String + "\"",
+					current.m_LineNr, current.m_ColNr, current.m_String );
+			}
 
-						if ( !IsString( varName ) )
-						{
-							throw CompilerException( "ir_array_name", "Invalid array name: \"" + varName->Token() + "\"",
-								varName->LineNr(), varName->ColNr(), varName->Token() );
-						}
-					}
+			do {
+				argsList.push_back( NextExpression( parserState ) );
+			} while ( parserState.MatchCurrent( TOK_COMMA ) );
 
-					if ( !varName || parserState.MatchCurrent( TOK_EQUALS ) )
-					{
-						parserState.Expect( TOK_BRACE_LEFT, "Expected \"{\" before array initializer, got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
-
-						std::vector< BaseNode* > initializers;
-						while ( parserState.CurrentBuilder()->m_Token.m_Id != TOK_BRACE_RIGHT )
-						{
-							auto valueNode = nextExpression( BP_COMMA );
-
-							switch ( valueNode->Id() )
-							{
-							case NODE_CONSTANT:
-							case NODE_NAME:
-							case NODE_TABLE:
-							case NODE_ARRAY:
-							case NODE_CALL:
-								break;
-							default:
-							{
-								throw CompilerException( "ir_invalid_array_initializer", "Invalid array initializer: \"" + valueNode->Token() + "\"",
-									valueNode->LineNr(), valueNode->ColNr(), valueNode->Token() );
-							}
-							}
-
-							initializers.push_back( valueNode );
-
-							if ( !parserState.MatchCurrent( TOK_COMMA ) )
-								break;
-						}
-
-						parserState.Expect( TOK_BRACE_RIGHT, "Expected \"}\" after array initializer, got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
-
-						initializerNode = parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-							irBuilder.m_Token.m_String, NODE_PROPERTYLIST, initializers );
-					}
+			parserState.Expect( TOK_SQUARE_BRACKET_RIGHT, "Expected \"]\" after function call, got: \"" + parserState.CurrentToken().m_String + "\"" );
+		}
+		else if( hasColon )
+		{
+			throw CompilerException( "ir_expect", "Expected arguments after \":\", got: \"" + afterColon.m_String + "\"",
+				afterColon.m_LineNr, afterColon.m_ColNr, afterColon.m_String );
+		}
 
-					return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_ARRAY, std::vector< BaseNode* >{ varName, initializerNode } );
-				};
-				break;
-			}
-			case TOK_DOT:
-			{
-				builder->m_Led = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder, BaseNode* left ) -> BaseNode*
-				{
-					auto propName = nextExpression( irBuilder.m_Token.m_LBP );
+		auto args = parserState.AllocateNode< ListNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_ARGUMENTS, argsList );
 
-					if ( !IsString( propName ) )
-					{
-						throw CompilerException( "ir_property_name", "Invalid property name: \"" + propName->Token() + "\"",
-							propName->LineNr(), propName->ColNr(), propName->Token() );
-					}
+		return parserState.AllocateNode< ComplexNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_CALL, target, args );
+	}
 
-					return parserState.AllocateNode< ComplexNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_ACCESS_PROP, left, propName );
-				};
-				break;
-			}
-			case TOK_BRACE_LEFT:
-			{
-				builder->m_Nud = [ &parserState, &nextStatement ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					std::vector< BaseNode* > scopeExpressions;
+	static BaseNode* NudParen( ParserState& parserState, const Token_t& token )
+	{
+		auto function = ParseFunction( parserState, token );
 
-					while ( !parserState.IsFinished() && parserState.CurrentBuilder()->m_Token.m_Id != TOK_BRACE_RIGHT )
-					{
-						auto headNode = nextStatement();
+		if ( function )
+			return function;
 
-						if ( headNode )
-							scopeExpressions.push_back( headNode );
-					}
+		auto expression = NextExpression( parserState );
 
-					return parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_SCOPE, scopeExpressions );
-				};
-				break;
-			}
-			case TOK_SQUARE_BRACKET_LEFT:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder )
-				{
-					std::vector< BaseNode* > argsList;
-					auto target = nextExpression( BP_INLINE_IF /* Look ahead till ":" */ );
+		if ( parserState.NextToken().m_Id != TOK_PAREN_RIGHT )
+		{
+			auto& current = parserState.CurrentToken();
+			throw CompilerException( "ir_missing_rparen", std::string( "Expected an end of expression, got: \"" + current.m_String + "\"" ),
+				current.m_LineNr, current.m_ColNr, current.m_String );
+		}
 
-					bool hasColon = parserState.MatchCurrent( TOK_COLON );
-					auto afterColon = parserState.CurrentBuilder();
+		return expression;
+	}
 
-					// Parse argument list
-					if ( !parserState.MatchCurrent( TOK_SQUARE_BRACKET_RIGHT ) )
-					{
-						if ( !hasColon )
-						{
-							auto current = parserState.CurrentBuilder();
+	static BaseNode* LedIndex( ParserState& parserState, const Token_t& token, BaseNode* left )
+	{
+		auto indexNode = NextExpression( parserState );
+		parserState.Expect( TOK_PAREN_RIGHT, "Expected \")\" after array index, got: \"" + parserState.CurrentToken().m_String + "\"" );
 
-							throw CompilerException( "ir_expect", "Expected \":\" after function call target, got: \"" + current->m_Token.m_String + "\"",
-								current->m_Token.m_LineNr, current->m_Token.m_ColNr, current->m_Token.m_String );
-						}
+		return parserState.AllocateNode< ComplexNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_ACCESS_ARRAY, left, indexNode );
+	}
 
-						do {
-							argsList.push_back( nextExpression() );
-						} while ( parserState.MatchCurrent( TOK_COMMA ) );
+	static BaseNode* NudReturn( ParserState& parserState, const Token_t& token )
+	{
+		BaseNode* returnValue = NULL;
 
-						parserState.Expect( TOK_SQUARE_BRACKET_RIGHT, "Expected \"]\" after function call, got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
-					}
-					else if( hasColon )
-					{
-						throw CompilerException( "ir_expect", "Expected arguments after \":\", got: \"" + afterColon->m_Token.m_String + "\"",
-							afterColon->m_Token.m_LineNr, afterColon->m_Token.m_ColNr, afterColon->m_Token.m_String );
-					}
+		if ( parserState.CurrentToken().m_Id != TOK_SCOLON )
+			returnValue = NextExpression( parserState, token.m_LBP );
 
-					auto args = parserState.AllocateNode< ListNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_ARGUMENTS, argsList );
+		return parserState.AllocateNode< SimpleNode >( token.m_LineNr, token.m_ColNr,
+			token.m_String, NODE_RETURN, returnValue );
+	}
 
-					return parserState.AllocateNode< ComplexNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_CALL, target, args );
-				};
+	// Parsing functions indexed by token id. Tokens that only terminate or
+	// separate expressions are valid but have no functions of their own.
+	static const struct ParseRules_t
+	{
+		ParseRules_t()
+		{
+			for ( auto& rule : m_Rules )
+				rule = ParseRule_t{ NULL, NULL, false };
+
+			for ( auto token : { TOK_NULL, TOK_FALSE, TOK_TRUE, TOK_DBL, TOK_INT, TOK_STR } )
+				Set( token, NudConstant, NULL );
+
+			for ( auto token : { TOK_AUTO, TOK_BOOL, TOK_STRING, TOK_NUMBER, TOK_CONST, TOK_VAR } )
+				Set( token, NudVariable, NULL );
+
+			for ( auto token : { TOK_PLUS, TOK_SLASH, TOK_STAR, TOK_PERCENT, TOK_2STAR,
+				TOK_EQUALS, TOK_EQUALSADD, TOK_EQUALSDIV, TOK_EQUALSSUB, TOK_EQUALSMUL, TOK_EQUALSMOD,
+				TOK_NOTEQUALS, TOK_2EQUALS, TOK_GREATERTHAN, TOK_GREATEREQUAL, TOK_LESSTHAN, TOK_LESSEQUAL,
+				TOK_AND, TOK_OR } )
+				Set( token, NULL, LedBinary );
+
+			for ( auto token : { TOK_SQUARE_BRACKET_RIGHT, TOK_BRACE_RIGHT, TOK_PAREN_RIGHT, TOK_SCOLON,
+				TOK_COMMA, TOK_ARROW, TOK_COLON } )
+				Set( token, NULL, NULL );
+
+			Set( TOK_NAME, NudName, NULL );
+			Set( TOK_BANG, NudNot, NULL );
+			Set( TOK_QUERY, NULL, LedInlineIf );
+			Set( TOK_MINUS, NudNegate, LedBinary );
+			Set( TOK_2PLUS, NudIncDec, LedIncDec );
+			Set( TOK_2MINUS, NudIncDec, LedIncDec );
+			Set( TOK_IMPORT, NudImport, NULL );
+			Set( TOK_IF, NudIf, NULL );
+			Set( TOK_ELSE, NudElse, NULL );
+			Set( TOK_WHILE, NudWhile, NULL );
+			Set( TOK_DO, NudDo, NULL );
+			Set( TOK_FOR, NudFor, NULL );
+			Set( TOK_TABLE, NudTable, NULL );
+			Set( TOK_CLASS, NudClass, NULL );
+			Set( TOK_ARRAY, NudArray, NULL );
+			Set( TOK_DOT, NULL, LedDot );
+			Set( TOK_BRACE_LEFT, NudScope, NULL );
+			Set( TOK_SQUARE_BRACKET_LEFT, NudCall, NULL );
+			Set( TOK_PAREN_LEFT, NudParen, LedIndex );
+			Set( TOK_RETURN, NudReturn, NULL );
+		}
 
-				break;
-			}
-			case TOK_PAREN_LEFT:
-			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder ) -> BaseNode*
-				{
-					auto function = ParseFunction( parserState, irBuilder, nextExpression );
+		void Set( Token token, NudFn nud, LedFn led )
+		{
+			m_Rules[ token ] = ParseRule_t{ nud, led, true };
+		}
 
-					if ( function )
-						return function;
+		ParseRule_t m_Rules[ TOK_COUNT ];
+	} s_ParseRules;
 
-					auto expression = nextExpression();
+	// TDOP expression parsing
+	static BaseNode* NextExpression( ParserState& parserState, int rbp )
+	{
+		// Get the current token, increment counter to the next one
+		auto& token = parserState.NextToken();
+		auto nud = s_ParseRules.m_Rules[ token.m_Id ].m_Nud;
 
-					if ( parserState.NextBuilder()->m_Token.m_Id != TOK_PAREN_RIGHT )
-					{
-						auto curBuilder = parserState.CurrentBuilder();
-						throw CompilerException( "ir_missing_rparen", std::string( "Expected an end of expression, got: \"" + curBuilder->m_Token.m_String + "\"" ),
-							curBuilder->m_Token.m_LineNr, curBuilder->m_Token.m_ColNr, curBuilder->m_Token.m_String );
-					}
+		if ( nud == NULL )
+		{
+			throw CompilerException( "ir_expect_lvalue_or_statement", "Expected a left-value or statement",
+				token.m_LineNr, token.m_ColNr, token.m_String );
+		}
 
-					return expression;
-				};
+		// parse null-denoted node
+		auto left = nud( parserState, token );
 
-				builder->m_Led = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder, BaseNode* left )
-				{
-					auto indexNode = nextExpression();
-					parserState.Expect( TOK_PAREN_RIGHT, "Expected \")\" after array index, got: \"" + parserState.CurrentBuilder()->m_Token.m_String + "\"" );
+		if ( rbp == BP_IMMEDIATE )
+			return left;
 
-					return parserState.AllocateNode< ComplexNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_ACCESS_ARRAY, left, indexNode );
-				};
+		// while the next token has a larger binding power
+		// deliver it the left hand node instead
+		while ( !parserState.IsFinished() && rbp < parserState.CurrentToken().m_LBP )
+		{
+			auto& next = parserState.NextToken();
+			auto led = s_ParseRules.m_Rules[ next.m_Id ].m_Led;
 
-				break;
+			if ( led == NULL )
+			{
+				throw CompilerException( "ir_expect_rvalue", "Expected a right-value",
+					next.m_LineNr, next.m_ColNr, next.m_String );
 			}
-			case TOK_SQUARE_BRACKET_RIGHT:
-			case TOK_BRACE_RIGHT:
-			case TOK_PAREN_RIGHT:
-			case TOK_SCOLON:
-			case TOK_COMMA:
-			case TOK_ARROW:
-			case TOK_COLON:
-				break;
-			case TOK_RETURN:
+
+			left = led( parserState, next, left );
+		}
+
+		return left;
+	}
+
+	static BaseNode* NextStatement( ParserState& parserState )
+	{
+		try
+		{
+			auto headNode = NextExpression( parserState );
+
+			if ( headNode )
 			{
-				builder->m_Nud = [ &parserState, &nextExpression ]( const IrBuilder_t& irBuilder )
+				switch ( headNode->Id() )
 				{
-					BaseNode* returnValue = NULL;
-					
-					if ( parserState.CurrentBuilder()->m_Token.m_Id != TOK_SCOLON )
-						returnValue = nextExpression( irBuilder.m_Token.m_LBP );
-
-					return parserState.AllocateNode< SimpleNode >( irBuilder.m_Token.m_LineNr, irBuilder.m_Token.m_ColNr,
-						irBuilder.m_Token.m_String, NODE_RETURN, returnValue );
-				};
-				break;
+				case NODE_NAME:
+				{
+					throw CompilerException( "ir_unknown_symbol", "Unknown symbol \"" + headNode->Token() + "\"", headNode->LineNr(), headNode->ColNr(), headNode->Token() );
+				}
+				default:
+					break;
+				}
+
+				switch ( headNode->Id() )
+				{
+				case NODE_ARRAY:
+				case NODE_TABLE:
+				case NODE_CLASS:
+				{
+					// Allow trailing semicolon on table definitions
+					parserState.MatchCurrent( TOK_SCOLON );
+					break;
+				}
+				case NODE_FUNC:
+				{
+					// Allow trailing semicolon on function definitions
+					parserState.MatchCurrent( TOK_SCOLON );
+					break;
+				}
+				case NODE_ASSIGN:
+				{
+					auto assignNode = static_cast< ComplexNode* >( headNode );
+					EndStatement( assignNode->GetRight(), parserState );
+					break;
+				}
+				case NODE_CONSTVAR:
+				case NODE_VAR:
+				{
+					auto varNode = static_cast< ListNode* >( headNode );
+					EndStatement( varNode->GetList()[ 1 ], parserState );
+					break;
+				}
+				case NODE_RETURN:
+				{
+					auto returnNode = static_cast< SimpleNode* >( headNode );
+					EndStatement( returnNode->GetNode(), parserState );
+					break;
+				}
+				case NODE_IF:
+				case NODE_WHILE:
+				case NODE_FOR:
+				{
+					auto& current = parserState.CurrentToken();
+					if ( current.m_Id != TOK_BRACE_RIGHT && current.m_Id != TOK_SCOLON )
+					{
+						throw CompilerException( "ir_expect", "Expected end of if/for/while-statement", current.m_LineNr,
+							current.m_ColNr, current.m_String );
+					}
+
+					parserState.NextToken();
+					break;
+				}
+				default:
+				{
+					if ( headNode->Id() == NODE_SCOPE )
+					{
+						// Block declarations must end with a right brace
+						parserState.Expect( TOK_BRACE_RIGHT, "Expected end of block declaration" );
+					}
+					else
+					{
+						// Expression statements must end with a semicolon
+						parserState.Expect( TOK_SCOLON, "Expected end of expression" );
+					}
+					break;
+				}
+				}
 			}
-			default:
+
+			return headNode;
+		}
+		catch ( const CompilerException& exception )
+		{
+			// A compilation error occurred, resync and continue parsing
+			// to catch as many errors with a single pass as possible
+			parserState.AddErrorAndResync( exception );
+			return NULL;
+		}
+	}
+
+	std::vector< BaseNode* > GenerateIR( const std::vector< Token_t >& tokens, NodeArena& arena )
+	{
+		for ( auto& token : tokens )
+		{
+			if ( !s_ParseRules.m_Rules[ token.m_Id ].m_IsValid )
+			{
 				throw CompilerException( "ir_unknown_token", std::string( "Unknown token id: " ) + std::to_string( token.m_Id ) + " \"" +  token.m_String  + "\"",
 					token.m_LineNr, token.m_ColNr, token.m_String );
 			}
+		}
 
-			return builder;
-		};
-
-		// Map all tokens to IR builders
-		std::transform( tokens.begin(), tokens.end(), std::back_inserter( parserState.Builders() ), createBuilder );
+		ParserState parserState( tokens, arena );
 
 		// Parse from top-level down
 		while ( !parserState.IsFinished() )
 		{
-			auto headNode = nextStatement();
+			auto headNode = NextStatement( parserState );
 
 			if ( headNode )
 				parserState.AddNode( headNode );
@@ -1001,7 +962,6 @@ namespace Compiler
 		if ( parserState.IsError() )
 			throw parserState.Errors();
 
-		// Builders are freed once parserState gets destructed
 		return parserState.Product();
 	}
 }
@@ -60,6 +60,7 @@ namespace Compiler
 		{ TOK_ARRAY, 				{ TOK_ARRAY, 					"Array", 	BP_NONE,					true } },
 		{ TOK_AUTO, 				{ TOK_AUTO, 					"auto", 	BP_VAR,						true } },
 		{ TOK_BOOL, 				{ TOK_BOOL, 					"bool", 	BP_VAR,						true } },
+		{ TOK_CLASS, 				{ TOK_CLASS, 					"Class", 	BP_NONE,					true } },
 		{ TOK_CONST, 				{ TOK_CONST, 					"const", 	BP_VAR, 					true } },
 		{ TOK_DO,					{ TOK_DO,						"do",		BP_NONE,					true } },
 		{ TOK_ELSE,					{ TOK_ELSE,						"else",		BP_NONE,					true } },
@@ -77,290 +78,239 @@ namespace Compiler
 		{ TOK_WHILE, 				{ TOK_WHILE, 					"while", 	BP_NONE,					true } },
 	};
 
-	std::vector< Token_t > Lexer( const std::string& source )
+	enum CharClass : uint8_t
 	{
-		static std::vector< KeywordInfo_t > languageOperators;
-		static std::vector< KeywordInfo_t > languageWords;
-
-		std::string_view sourceView( source );
-		std::vector< Token_t > results;
-		std::string backBuffer;
+		CC_WORD,
+		CC_SPACE,
+		CC_NEWLINE,
+		CC_QUOTE,
+		CC_OPERATOR,
+	};
 
-		int lineNumber = 1;
-		int columnNumber = 0;
+	// Lookup tables built once from LanguageSymbols. Static initialization is thread safe,
+	// so several compilers can lex concurrently.
+	struct LexerTables_t
+	{
+		static const uint32_t s_KeywordSlots = 64;
 
-		if ( languageOperators.size() == 0 )
+		LexerTables_t()
 		{
-			for ( auto it = LanguageSymbols.begin(); it != LanguageSymbols.end(); ++it )
-			{
-				if ( it->second.m_IsWord )
-					languageWords.push_back( it->second );
-				else
-					languageOperators.push_back( it->second );
-			}
+			for ( int c = 0; c < 256; ++c )
+				m_Class[ c ] = CC_WORD;
 
-			// Sort the language keywords to have longest character sequence at the top
-			std::sort( languageOperators.begin(), languageOperators.end(), []( KeywordInfo_t a, KeywordInfo_t b ) -> bool
-			{
-				return a.m_String.length() > b.m_String.length();
-			} );
+			m_Class[ ( uint8_t ) ' ' ] = CC_SPACE;
+			m_Class[ ( uint8_t ) '\t' ] = CC_SPACE;
+			m_Class[ ( uint8_t ) '\r' ] = CC_SPACE;
+			m_Class[ ( uint8_t ) '\v' ] = CC_SPACE;
+			m_Class[ ( uint8_t ) '\f' ] = CC_SPACE;
+			m_Class[ ( uint8_t ) '\n' ] = CC_NEWLINE;
+			m_Class[ ( uint8_t ) '"' ] = CC_QUOTE;
+
+			std::vector< const KeywordInfo_t* > words;
 
-			std::sort( languageWords.begin(), languageWords.end(), []( KeywordInfo_t a, KeywordInfo_t b ) -> bool
+			for ( auto it = LanguageSymbols.begin(); it != LanguageSymbols.end(); ++it )
 			{
-				return a.m_String.length() > b.m_String.length();
-			} );
-		}
+				auto info = &it->second;
 
-		auto lookAhead = []( const std::string_view& view, const std::string& word, size_t* out )
-		{
-			auto pos = view.find( word );
+				if ( info->m_IsWord )
+				{
+					words.push_back( info );
+					continue;
+				}
 
-			if ( pos == view.npos )
-			{
-				*out = pos;
-				return false;
+				auto first = ( uint8_t ) info->m_String[ 0 ];
+				m_Class[ first ] = CC_OPERATOR;
+				m_Operators[ first ].push_back( info );
 			}
 
-			*out = pos;
-			return true;
-		};
+			// Longest operators are tried first
+			for ( auto& operators : m_Operators )
+			{
+				std::sort( operators.begin(), operators.end(), []( const KeywordInfo_t* a, const KeywordInfo_t* b ) {
+					return a->m_String.length() > b->m_String.length();
+				} );
+			}
 
-		auto matchItem = []( const std::string_view& input, const std::vector< KeywordInfo_t >& list, KeywordInfo_t* out ) -> bool
-		{
-			for ( auto keyword : list )
+			// Search for a seed that places every keyword in its own slot
+			for ( m_Seed = 1; ; ++m_Seed )
 			{
-				if ( input.compare( 0, keyword.m_String.length(), keyword.m_String ) == 0 )
+				std::fill( m_Keywords, m_Keywords + s_KeywordSlots, ( const KeywordInfo_t* ) NULL );
+
+				bool perfect = true;
+				for ( auto word : words )
 				{
-					*out = keyword;
-					return true;
+					auto& slot = m_Keywords[ KeywordSlot( word->m_String ) ];
+
+					if ( slot )
+					{
+						perfect = false;
+						break;
+					}
+
+					slot = word;
 				}
+
+				if ( perfect )
+					break;
 			}
+		}
 
-			return false;
-		};
+		FORCEINLINE uint32_t KeywordSlot( std::string_view word ) const
+		{
+			auto hash = ( uint32_t ) ( ( uint8_t ) word[ 0 ] * 31 + ( uint8_t ) word[ word.length() - 1 ] ) * m_Seed + ( uint32_t ) word.length();
+			return ( hash >> 8 ) % s_KeywordSlots;
+		}
+
+		FORCEINLINE const KeywordInfo_t* FindKeyword( std::string_view word ) const
+		{
+			auto keyword = m_Keywords[ KeywordSlot( word ) ];
+			return keyword && keyword->m_String == word ? keyword : NULL;
+		}
 
-		auto isNumber = []( const std::string_view& input )
+		FORCEINLINE const KeywordInfo_t* FindOperator( std::string_view source, size_t cursor ) const
 		{
-			for ( char c : input )
+			for ( auto op : m_Operators[ ( uint8_t ) source[ cursor ] ] )
 			{
-				if ( !isdigit( c ) )
-					return false;
+				if ( source.compare( cursor, op->m_String.length(), op->m_String ) == 0 )
+					return op;
 			}
 
-			return input.length() > 0;
-		};
+			return NULL;
+		}
 
-		auto flushName = [ &backBuffer, &sourceView, &results, &lineNumber, &columnNumber ]()
-		{
-			if ( backBuffer.length() > 0 )
-			{
-				Token tokenType = TOK_INT;
-				for ( auto c : backBuffer )
-				{
-					if ( !isdigit( c ) && c != '.' )
-						tokenType = TOK_NAME;
-					else if ( c == '.' && tokenType == TOK_INT )
-						tokenType = TOK_DBL;
-				}
+		CharClass								m_Class[ 256 ];
+		std::vector< const KeywordInfo_t* >		m_Operators[ 256 ];
+		const KeywordInfo_t*					m_Keywords[ s_KeywordSlots ];
+		uint32_t								m_Seed;
+	};
+
+	std::vector< Token_t > Lexer( const std::string& source )
+	{
+		static const LexerTables_t tables;
+
+		std::string_view sourceView( source );
+		std::vector< Token_t > results;
+		results.reserve( source.length() / 4 );
 
-				results.push_back( Token_t{ tokenType, 0, lineNumber, columnNumber, backBuffer } );
+		size_t length = sourceView.length();
+		size_t lineStart = 0;
+		int lineNumber = 1;
 
-				columnNumber += backBuffer.length();
-				backBuffer = "";
+		// Keep line bookkeeping right for tokens and comments spanning several lines
+		auto skipLines = [ &sourceView, &lineNumber, &lineStart ]( size_t from, size_t to ) {
+			for ( auto newLine = sourceView.find( '\n', from ); newLine < to; newLine = sourceView.find( '\n', newLine + 1 ) )
+			{
+				++lineNumber;
+				lineStart = newLine + 1;
 			}
 		};
 
-		for ( size_t cursor = 0; cursor < source.length(); ++cursor )
+		auto isDigit = []( char c ) { return c >= '0' && c <= '9'; };
+
+		for ( size_t cursor = 0; cursor < length; )
 		{
-			std::string_view cursorView( source );
-			cursorView = cursorView.substr( cursor );
+			auto c = sourceView[ cursor ];
+			int columnNumber = ( int ) ( cursor - lineStart );
 
-			std::string wordBuffer = backBuffer + cursorView.at( 0 );
+			const KeywordInfo_t* op = NULL;
 
-			KeywordInfo_t wordInfo, opInfo;
-			if ( matchItem( wordBuffer, languageWords, &wordInfo ) )
+			switch ( tables.m_Class[ ( uint8_t ) c ] )
 			{
-				/*
-					Next needs to either be an operator
-					e.g while(...
-					or a space
-				*/
-				if ( wordBuffer[ wordInfo.m_String.length() ] == ' ' )
+			case CC_SPACE:
+				++cursor;
+				continue;
+			case CC_NEWLINE:
+				++lineNumber;
+				lineStart = ++cursor;
+				continue;
+			case CC_QUOTE:
+			{
+				auto end = sourceView.find( '"', cursor + 1 );
+
+				// Unterminated strings swallow the rest of the input
+				if ( end == sourceView.npos )
 				{
-					results.push_back( Token_t{ wordInfo.m_Token, wordInfo.m_LBP, lineNumber, columnNumber, wordInfo.m_String } );
-					backBuffer = "";
-					columnNumber += wordInfo.m_String.length() + 1;
+					cursor = length;
 					continue;
 				}
-				else if ( matchItem( wordBuffer.substr( wordInfo.m_String.length() ), languageOperators, &opInfo ) )
-				{
-					/*
-						A word followed by an operator
-						e.g while(...
-					*/
-					results.push_back( Token_t{ wordInfo.m_Token, wordInfo.m_LBP, lineNumber, columnNumber, wordInfo.m_String } );
-					results.push_back( Token_t{ opInfo.m_Token, opInfo.m_LBP, lineNumber, columnNumber, opInfo.m_String } );
 
-					columnNumber += wordInfo.m_String.length();
-					columnNumber += opInfo.m_String.length();
+				results.push_back( Token_t{ TOK_STR, 0, lineNumber, columnNumber,
+					std::string( sourceView.substr( cursor + 1, end - cursor - 1 ) ) } );
 
-					backBuffer = "";
-					continue;
-				}
-				else
-				{
-					/*
-						This is a part of some other word
-						e.g whileVariable = ...
-					*/
-				}
+				skipLines( cursor + 1, end );
+				cursor = end + 1;
+				continue;
 			}
-			
-			if ( matchItem( cursorView, languageOperators, &opInfo ) )
+			case CC_OPERATOR:
 			{
-				switch ( opInfo.m_Token )
+				if ( c == '/' && cursor + 1 < length && sourceView[ cursor + 1 ] == '/' )
 				{
-				case TOK_DOT:
+					// Per-line comment
+					auto end = sourceView.find( '\n', cursor + 2 );
+					cursor = end == sourceView.npos ? length : end;
+					continue;
+				}
+
+				if ( c == '/' && cursor + 1 < length && sourceView[ cursor + 1 ] == '*' )
 				{
-					if ( isNumber( backBuffer ) )
-					{
-						std::string_view fractionString = cursorView.substr( 1 );
+					// Multiline comment
+					auto end = sourceView.find( "*/", cursor + 2 );
+					end = end == sourceView.npos ? length : end + 2;
 
-						size_t i = 0;
-						for ( ; i < fractionString.length(); ++i )
-						{
-							if ( !isdigit( fractionString[ i ] ) )
-								break;
-						}
+					skipLines( cursor + 2, end );
+					cursor = end;
+					continue;
+				}
 
-						/*
-							Numeric values on both sides of "." operator
-							e.g: 5.123
-							batch together and flush
-						*/
+				op = tables.FindOperator( sourceView, cursor );
 
-						backBuffer += cursorView.substr( 0, i + 1 );
-						flushName();
+				if ( op )
+				{
+					results.push_back( Token_t{ op->m_Token, op->m_LBP, lineNumber, columnNumber, op->m_String } );
+					cursor += op->m_String.length();
+					continue;
+				}
 
-						columnNumber += i + 1;
+				// Characters like a single "&" don't form an operator, they are a part of a word
+				break;
+			}
+			default:
+				break;
+			}
 
-						cursor += i;
-						continue;
-					}
-					break;
-				}
-				case TOK_SLASH:
-				{
-					flushName();
+			// Words: names, keywords and numbers
+			size_t start = cursor;
+			bool isNumber = true;
 
-					if ( cursorView.at( 1 ) == '/' )
-					{
-						// Per-line comment
-						size_t nextCursor = 0;
-						if ( lookAhead( cursorView.substr( 2 ), "\n", &nextCursor ) )
-						{
-							cursor += nextCursor;
-							++lineNumber;
-							columnNumber = 0;
-						}
-						else
-						{
-							cursor += cursorView.length();
-						}
-
-						cursor += 2;
-						continue;
-					}
-					else if ( cursorView.at( 1 ) == '*' )
-					{
-						// Multiline comment
-						size_t nextCursor = 0;
-						if ( lookAhead( cursorView.substr( 2 ), "*/", &nextCursor ) )
-							cursor += nextCursor;
-						else
-							cursor += cursorView.length();
-
-						auto subString = cursorView.substr( 2, nextCursor );
-
-						int newChars = 0, newLines = 0;
-						std::for_each( subString.begin(), subString.end(), [ &newChars, &newLines ]( char c ) {
-							if ( c == '\n' )
-							{
-								newChars = 0;
-								++newLines;
-							}
-							else
-							{
-								++newChars;
-							}
-						} );
-
-						lineNumber += newLines;
-						columnNumber += newChars + 2;
-
-						cursor += 3;
-						continue;
-					}
+			for ( ; cursor < length; ++cursor )
+			{
+				auto wordChar = sourceView[ cursor ];
+				auto charClass = tables.m_Class[ ( uint8_t ) wordChar ];
 
+				if ( charClass != CC_WORD && ( charClass != CC_OPERATOR || cursor == start || tables.FindOperator( sourceView, cursor ) ) )
 					break;
-				}
-				default:
-					break;
-				}
-
-				flushName();
 
-				results.push_back( Token_t{ opInfo.m_Token, opInfo.m_LBP, lineNumber, columnNumber, opInfo.m_String } );
-				cursor += opInfo.m_String.length() - 1;
+				isNumber = isNumber && isDigit( wordChar );
+			}
 
-				columnNumber += opInfo.m_String.length();
+			if ( isNumber && cursor < length && sourceView[ cursor ] == '.' )
+			{
+				// Fraction: digits on both sides of "."
+				for ( ++cursor; cursor < length && isDigit( sourceView[ cursor ] ); ++cursor );
 
-				backBuffer = "";
+				results.push_back( Token_t{ TOK_DBL, 0, lineNumber, columnNumber, std::string( sourceView.substr( start, cursor - start ) ) } );
 				continue;
 			}
 
-			switch ( cursorView.at( 0 ) )
-			{
-			case '\"':
-			{
-				flushName();
+			auto word = sourceView.substr( start, cursor - start );
+			auto keyword = tables.FindKeyword( word );
 
-				size_t nextCursor = 0;
-				if ( lookAhead( cursorView.substr( 1 ), "\"", &nextCursor ) )
-				{
-					results.push_back( Token_t{ TOK_STR, 0, lineNumber, columnNumber, std::string( cursorView.substr( 1, nextCursor ) ) } );
-					columnNumber += nextCursor + 2;
-					cursor += nextCursor + 1;
-				}
-				else
-				{
-					cursor += cursorView.length();
-				}
-				break;
-			}
-			case ' ':
-			{
-				flushName();
-				++columnNumber;
-				break;
-			}
-			case '\n':
-			{
-				flushName();
-				++lineNumber;
-				columnNumber = 0;
-				break;
-			}
-			case '\t':
-				++columnNumber;
-				break;
-			default:
-				backBuffer += cursorView.at( 0 );
-				break;
-			}
+			if ( keyword )
+				results.push_back( Token_t{ keyword->m_Token, keyword->m_LBP, lineNumber, columnNumber, keyword->m_String } );
+			else
+				results.push_back( Token_t{ isNumber ? TOK_INT : TOK_NAME, 0, lineNumber, columnNumber, std::string( word ) } );
 		}
 
-		flushName();
 		return results;
 	}
 }
@@ -0,0 +1,685 @@
+#include "QLibPCH.h"
+#include "../Common/Chunk.h"
+#include "../Common/Disassembler.h"
+
+#include "Instructions.h"
+#include "Compiler.h"
+
+// Peephole optimizer, runs on the finished code of a chunk. The code is decoded into a list of
+// instructions with jumps pointing at instruction indices, rewritten, and laid out again so
+// that jumps get the shortest encoding their distance allows.
+//
+//   SET_LOCAL/SET_GLOBAL, POP	-> STORE_LOCAL/STORE_GLOBAL
+//   LOAD_<side effect free>, POP	-> (removed)
+//   JUMP -> JUMP -> X			-> JUMP -> X
+//   RETURN, <unreachable>		-> RETURN
+//   LOAD_LOCAL, LOAD_<constant>, JUMP_IF_NOT_<cmp>	-> JUMP_IF_NOT_<cmp>_LOCAL_CONSTANT
+//   LOAD_LOCAL, LOAD_LOCAL, JUMP_IF_NOT_<cmp>		-> JUMP_IF_NOT_<cmp>_LOCAL_LOCAL
+//
+// Superinstructions (OF_SUPERINSTRUCTIONS) are fused last. The first part of a match becomes the
+// head of the superinstruction, the other parts only contribute their operands to it.
+
+namespace Compiler
+{
+	struct Instruction_t
+	{
+		uint32_t		m_Offset;		// Offset in the original code
+		uint32_t		m_Size;			// Size in the original code
+		uint8_t			m_OpCode;
+		uint32_t		m_Operand;		// Operand in the original code, jump distance of jumps
+		uint32_t		m_Operands;		// Operand bytes when emitted, a single byte is m_Operand
+		int				m_Target;		// Jump target index, the end of the code is index == size
+		bool			m_IsTarget;
+		bool			m_Removed;
+		uint8_t			m_Super;		// Superinstruction this instruction is the head of, OP_NOP if none
+		int				m_Head;			// Head of the superinstruction this is a later part of, -1 if none
+	};
+
+	struct Superinstruction_t
+	{
+		uint8_t			m_OpCode;
+		uint8_t			m_Parts[ 4 ];
+		size_t			m_Length;
+	};
+
+	#define _PEEPHOLE_SUPERINSTRUCTION( arg, name, a, b, c, d ) Superinstruction_t{ QScript::OpCode::name, \
+		{ QScript::OpCode::a, QScript::OpCode::b, QScript::OpCode::c, QScript::OpCode::d }, 0 },
+
+	// Longest first, so that the longest match is taken
+	static const std::vector< Superinstruction_t >& Superinstructions()
+	{
+		static std::vector< Superinstruction_t > superinstructions = []() {
+			std::vector< Superinstruction_t > list = { QS_SUPERINSTRUCTIONS( _PEEPHOLE_SUPERINSTRUCTION, _ ) };
+
+			for ( auto& super : list )
+			{
+				while ( super.m_Length < 4 && super.m_Parts[ super.m_Length ] != QScript::OpCode::OP_NOP )
+					++super.m_Length;
+			}
+
+			std::stable_sort( list.begin(), list.end(), []( const Superinstruction_t& a, const Superinstruction_t& b ) {
+				return a.m_Length > b.m_Length;
+			} );
+
+			return list;
+		}();
+
+		return superinstructions;
+	}
+
+	enum JumpType
+	{
+		JT_NONE,
+		JT_FORWARD,
+		JT_BACK,
+		JT_IF_ZERO,
+		JT_BRANCH,		// Compare-and-branch, pops its operands
+	};
+
+	static JumpType GetJumpType( uint8_t opCode )
+	{
+		switch ( opCode )
+		{
+		case QScript::OpCode::OP_JUMP_SHORT:
+		case QScript::OpCode::OP_JUMP_LONG:
+			return JT_FORWARD;
+		case QScript::OpCode::OP_JUMP_BACK_SHORT:
+		case QScript::OpCode::OP_JUMP_BACK_LONG:
+			return JT_BACK;
+		case QScript::OpCode::OP_JUMP_IF_ZERO_SHORT:
+		case QScript::OpCode::OP_JUMP_IF_ZERO_LONG:
+			return JT_IF_ZERO;
+		default:
+			if ( opCode >= QScript::OpCode::OP_JUMP_IF_NOT_LT_SHORT && opCode <= QScript::OpCode::OP_JUMP_IF_NOT_NE_LONG )
+				return JT_BRANCH;
+
+			return JT_NONE;
+		}
+	}
+
+	// Compare-and-branch with the same comparison, jumpForm is the first opcode of the form
+	static uint8_t BranchOpCode( uint8_t opCode, uint8_t jumpForm )
+	{
+		return jumpForm + ( opCode - QScript::OpCode::OP_JUMP_IF_NOT_LT_SHORT ) % QScript::OpCode::OP_JUMP_IF_NOT_MAX;
+	}
+
+	// Pushes a value without any other effect, popping it right away does nothing
+	static bool IsPureLoad( uint8_t opCode )
+	{
+		if ( opCode >= QScript::OpCode::OP_LOAD_LOCAL_0 && opCode <= QScript::OpCode::OP_LOAD_LOCAL_11 )
+			return true;
+
+		if ( opCode >= QScript::OpCode::OP_LOAD_NULL && opCode <= QScript::OpCode::OP_LOAD_5 )
+			return true;
+
+		switch ( opCode )
+		{
+		case QScript::OpCode::OP_LOAD_CONSTANT_SHORT:
+		case QScript::OpCode::OP_LOAD_CONSTANT_LONG:
+		case QScript::OpCode::OP_LOAD_LOCAL_SHORT:
+		case QScript::OpCode::OP_LOAD_LOCAL_LONG:
+		case QScript::OpCode::OP_LOAD_UPVALUE_SHORT:
+		case QScript::OpCode::OP_LOAD_UPVALUE_LONG:
+		case QScript::OpCode::OP_LOAD_TOP_SHORT:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Store variant of an assignment that leaves its value on the stack, OP_NOP if none
+	static uint8_t StoreOpCode( uint8_t opCode )
+	{
+		if ( opCode >= QScript::OpCode::OP_SET_LOCAL_0 && opCode <= QScript::OpCode::OP_SET_LOCAL_11 )
+			return QScript::OpCode::OP_STORE_LOCAL_0 + ( opCode - QScript::OpCode::OP_SET_LOCAL_0 );
+
+		switch ( opCode )
+		{
+		case QScript::OpCode::OP_SET_LOCAL_SHORT: return QScript::OpCode::OP_STORE_LOCAL_SHORT;
+		case QScript::OpCode::OP_SET_LOCAL_LONG: return QScript::OpCode::OP_STORE_LOCAL_LONG;
+		case QScript::OpCode::OP_SET_GLOBAL_SHORT: return QScript::OpCode::OP_STORE_GLOBAL_SHORT;
+		case QScript::OpCode::OP_SET_GLOBAL_LONG: return QScript::OpCode::OP_STORE_GLOBAL_LONG;
+		default: return QScript::OpCode::OP_NOP;
+		}
+	}
+
+	static bool Decode( const QScript::Chunk_t& chunk, std::vector< Instruction_t >* instructions )
+	{
+		auto& code = chunk.m_Code;
+		std::vector< int > indexOf( code.size() + 1, -1 );
+
+		for ( uint32_t offset = 0; offset < code.size(); )
+		{
+			uint8_t opCode = code[ offset ];
+
+			if ( opCode >= QScript::OpCode::OP_SUPERINSTRUCTION_FIRST )
+				return false;
+
+			if ( opCode >= QScript::OpCode::OP_JUMP_IF_NOT_LT_LOCAL_CONSTANT && opCode <= QScript::OpCode::OP_JUMP_IF_NOT_NE_LOCAL_LOCAL )
+				return false;
+
+			uint32_t size = ( uint32_t ) Disassembler::InstructionSize( opCode );
+			uint32_t operand = 0;
+
+			if ( opCode == QScript::OpCode::OP_CLOSURE_SHORT || opCode == QScript::OpCode::OP_CLOSURE_LONG )
+			{
+				// Captured upvalues follow the instruction, 5 bytes each
+				uint32_t constant = ( opCode == QScript::OpCode::OP_CLOSURE_SHORT ) ? code[ offset + 1 ]
+					: DECODE_LONG( code[ offset + 1 ], code[ offset + 2 ], code[ offset + 3 ], code[ offset + 4 ] );
+
+				size += AS_FUNCTION( chunk.m_Constants[ constant ] )->NumUpvalues() * 5;
+				operand = constant;
+			}
+			else if ( size == 2 )
+			{
+				operand = code[ offset + 1 ];
+			}
+			else if ( size == 5 )
+			{
+				operand = DECODE_LONG( code[ offset + 1 ], code[ offset + 2 ], code[ offset + 3 ], code[ offset + 4 ] );
+			}
+
+			if ( offset + size > code.size() )
+				return false;
+
+			indexOf[ offset ] = ( int ) instructions->size();
+			instructions->push_back( Instruction_t{ offset, size, opCode, operand, size - 1, -1, false, false, QScript::OpCode::OP_NOP, -1 } );
+			offset += size;
+		}
+
+		indexOf[ code.size() ] = ( int ) instructions->size();
+
+		// Resolve jump targets to instruction indices
+		for ( auto& inst : *instructions )
+		{
+			int64_t target;
+
+			switch ( GetJumpType( inst.m_OpCode ) )
+			{
+			case JT_NONE: continue;
+			case JT_BACK: target = ( int64_t ) inst.m_Offset - inst.m_Operand; break;
+			default: target = ( int64_t ) inst.m_Offset + inst.m_Size + inst.m_Operand; break;
+			}
+
+			if ( target < 0 || target > ( int64_t ) code.size() || indexOf[ ( size_t ) target ] == -1 )
+				return false;
+
+			inst.m_Target = indexOf[ ( size_t ) target ];
+		}
+
+		return true;
+	}
+
+	static int NextLive( const std::vector< Instruction_t >& instructions, int index )
+	{
+		while ( index < ( int ) instructions.size() && instructions[ index ].m_Removed )
+			++index;
+
+		return index;
+	}
+
+	static void ThreadJumps( std::vector< Instruction_t >& instructions )
+	{
+		for ( int i = 0; i < ( int ) instructions.size(); ++i )
+		{
+			auto& inst = instructions[ i ];
+			auto type = GetJumpType( inst.m_OpCode );
+
+			if ( type == JT_NONE )
+				continue;
+
+			// Hops are bounded, jump cycles would never settle otherwise
+			int target = inst.m_Target;
+			for ( size_t hops = 0; hops < instructions.size() && target < ( int ) instructions.size(); ++hops )
+			{
+				auto& next = instructions[ target ];
+				auto nextType = GetJumpType( next.m_OpCode );
+
+				// JUMP_IF_ZERO doesn't pop, a second test of the same value takes the same branch
+				bool follow = ( nextType == JT_FORWARD || nextType == JT_BACK ) || ( type == JT_IF_ZERO && nextType == JT_IF_ZERO );
+
+				if ( !follow || next.m_Target == target )
+					break;
+
+				target = next.m_Target;
+
+				// Conditional jumps can only go forward
+				if ( ( type != JT_IF_ZERO && type != JT_BRANCH ) || target > i )
+					inst.m_Target = target;
+			}
+		}
+	}
+
+	static void MarkTargets( std::vector< Instruction_t >& instructions )
+	{
+		for ( auto& inst : instructions )
+			inst.m_IsTarget = false;
+
+		for ( auto& inst : instructions )
+		{
+			if ( inst.m_Removed || inst.m_Target == -1 )
+				continue;
+
+			int target = NextLive( instructions, inst.m_Target );
+			if ( target < ( int ) instructions.size() )
+				instructions[ target ].m_IsTarget = true;
+		}
+	}
+
+	static bool RemoveDeadCode( std::vector< Instruction_t >& instructions )
+	{
+		bool changed = false;
+		bool reachable = true;
+
+		for ( int i = 0; i < ( int ) instructions.size(); ++i )
+		{
+			auto& inst = instructions[ i ];
+
+			if ( inst.m_Removed )
+				continue;
+
+			if ( inst.m_IsTarget )
+				reachable = true;
+
+			if ( !reachable )
+			{
+				inst.m_Removed = true;
+				changed = true;
+				continue;
+			}
+
+			auto type = GetJumpType( inst.m_OpCode );
+
+			// Jumps to the next live instruction do nothing, except for popping the operands of a comparison
+			if ( type != JT_NONE && type != JT_BRANCH && inst.m_Target > i && NextLive( instructions, i + 1 ) == NextLive( instructions, inst.m_Target ) )
+			{
+				inst.m_Removed = true;
+				changed = true;
+				continue;
+			}
+
+			if ( type == JT_FORWARD || type == JT_BACK || inst.m_OpCode == QScript::OpCode::OP_RETURN )
+				reachable = false;
+		}
+
+		return changed;
+	}
+
+	static void CombinePairs( std::vector< Instruction_t >& instructions )
+	{
+		// Live instructions so far, the last one is the one a POP follows
+		std::vector< int > live;
+
+		for ( int i = 0; i < ( int ) instructions.size(); ++i )
+		{
+			auto& inst = instructions[ i ];
+
+			if ( inst.m_Removed )
+				continue;
+
+			if ( inst.m_OpCode == QScript::OpCode::OP_POP && !inst.m_IsTarget && !live.empty() )
+			{
+				auto& first = instructions[ live.back() ];
+				uint8_t store = StoreOpCode( first.m_OpCode );
+
+				if ( store != QScript::OpCode::OP_NOP )
+				{
+					first.m_OpCode = store;
+					inst.m_Removed = true;
+					continue;
+				}
+
+				if ( IsPureLoad( first.m_OpCode ) )
+				{
+					first.m_Removed = true;
+					inst.m_Removed = true;
+
+					// Jumps to the removed pair now land on the next instruction
+					if ( first.m_IsTarget && i + 1 < ( int ) instructions.size() )
+						instructions[ i + 1 ].m_IsTarget = true;
+
+					live.pop_back();
+					continue;
+				}
+			}
+
+			live.push_back( i );
+		}
+	}
+
+	// Local a load reads, -1 if it isn't a load of a local an operand byte can address
+	static int LoadedLocal( const Instruction_t& inst )
+	{
+		if ( inst.m_OpCode >= QScript::OpCode::OP_LOAD_LOCAL_0 && inst.m_OpCode <= QScript::OpCode::OP_LOAD_LOCAL_11 )
+			return inst.m_OpCode - QScript::OpCode::OP_LOAD_LOCAL_0;
+
+		if ( inst.m_OpCode == QScript::OpCode::OP_LOAD_LOCAL_SHORT )
+			return ( int ) inst.m_Operand;
+
+		return -1;
+	}
+
+	// Constant a load reads, -1 if it isn't a load of a constant an operand byte can address. Numbers of
+	// the LOAD_n instructions are added to the constant pool
+	static int LoadedConstant( QScript::Chunk_t* chunk, const Instruction_t& inst )
+	{
+		if ( inst.m_OpCode == QScript::OpCode::OP_LOAD_CONSTANT_SHORT )
+			return ( int ) inst.m_Operand;
+
+		if ( inst.m_OpCode < QScript::OpCode::OP_LOAD_MINUS_1 || inst.m_OpCode > QScript::OpCode::OP_LOAD_5 )
+			return -1;
+
+		double number = ( double ) ( ( int ) inst.m_OpCode - QScript::OpCode::OP_LOAD_0 );
+		auto& constants = chunk->m_Constants;
+
+		for ( size_t i = 0; i < constants.size() && i <= 255; ++i )
+		{
+			if ( IS_NUMBER( constants[ i ] ) && AS_NUMBER( constants[ i ] ) == number && !std::signbit( AS_NUMBER( constants[ i ] ) ) )
+				return ( int ) i;
+		}
+
+		if ( constants.size() > 255 )
+			return -1;
+
+		constants.push_back( MAKE_NUMBER( number ) );
+		return ( int ) constants.size() - 1;
+	}
+
+	static void FuseBranches( QScript::Chunk_t* chunk, std::vector< Instruction_t >& instructions )
+	{
+		MarkTargets( instructions );
+
+		std::vector< int > live;
+		for ( int i = 0; i < ( int ) instructions.size(); ++i )
+		{
+			auto& inst = instructions[ i ];
+
+			if ( inst.m_Removed )
+				continue;
+
+			live.push_back( i );
+
+			if ( GetJumpType( inst.m_OpCode ) != JT_BRANCH || inst.m_IsTarget || live.size() < 3 )
+				continue;
+
+			// Jumps can only land on the first load
+			auto& left = instructions[ live[ live.size() - 3 ] ];
+			auto& right = instructions[ live[ live.size() - 2 ] ];
+
+			int leftLocal = LoadedLocal( left );
+			if ( leftLocal == -1 || right.m_IsTarget )
+				continue;
+
+			int rightOperand = LoadedLocal( right );
+			bool isConstant = ( rightOperand == -1 );
+
+			if ( isConstant )
+				rightOperand = LoadedConstant( chunk, right );
+
+			if ( rightOperand == -1 )
+				continue;
+
+			// Loads get their one byte operand forms, in case the branch is too long and split up again
+			left.m_OpCode = QScript::OpCode::OP_LOAD_LOCAL_SHORT;
+			left.m_Operand = ( uint32_t ) leftLocal;
+			left.m_Operands = 1;
+
+			right.m_OpCode = isConstant ? QScript::OpCode::OP_LOAD_CONSTANT_SHORT : QScript::OpCode::OP_LOAD_LOCAL_SHORT;
+			right.m_Operand = ( uint32_t ) rightOperand;
+			right.m_Operands = 1;
+
+			left.m_Super = BranchOpCode( inst.m_OpCode, isConstant ? QScript::OpCode::OP_JUMP_IF_NOT_LT_LOCAL_CONSTANT
+				: QScript::OpCode::OP_JUMP_IF_NOT_LT_LOCAL_LOCAL );
+
+			right.m_Head = live[ live.size() - 3 ];
+			inst.m_Head = live[ live.size() - 3 ];
+		}
+	}
+
+	static void FuseSuperinstructions( std::vector< Instruction_t >& instructions )
+	{
+		MarkTargets( instructions );
+
+		std::vector< int > live;
+		for ( int i = 0; i < ( int ) instructions.size(); ++i )
+		{
+			if ( !instructions[ i ].m_Removed )
+				live.push_back( i );
+		}
+
+		for ( size_t i = 0; i < live.size(); ++i )
+		{
+			for ( auto& super : Superinstructions() )
+			{
+				if ( i + super.m_Length > live.size() )
+					continue;
+
+				bool match = true;
+				for ( size_t part = 0; part < super.m_Length && match; ++part )
+				{
+					auto& inst = instructions[ live[ i + part ] ];
+
+					// Jumps are laid out later, any width matches the short form
+					uint8_t opCode = GetJumpType( inst.m_OpCode ) == JT_IF_ZERO ? ( uint8_t ) QScript::OpCode::OP_JUMP_IF_ZERO_SHORT : inst.m_OpCode;
+
+					// Jumps can only land on the head, fused branches are already as short as they get
+					match = opCode == super.m_Parts[ part ] && ( part == 0 || !inst.m_IsTarget )
+						&& inst.m_Super == QScript::OpCode::OP_NOP && inst.m_Head == -1;
+				}
+
+				if ( !match )
+					continue;
+
+				instructions[ live[ i ] ].m_Super = super.m_OpCode;
+
+				for ( size_t part = 1; part < super.m_Length; ++part )
+					instructions[ live[ i + part ] ].m_Head = live[ i ];
+
+				i += super.m_Length - 1;
+				break;
+			}
+		}
+	}
+
+	void OptimizeChunk( QScript::Chunk_t* chunk, uint32_t flags )
+	{
+		std::vector< Instruction_t > instructions;
+
+		// Leave code the optimizer doesn't understand as it is
+		if ( !Decode( *chunk, &instructions ) )
+			return;
+
+		if ( flags & QScript::Config_t::OF_PEEPHOLE )
+		{
+			ThreadJumps( instructions );
+
+			do
+			{
+				MarkTargets( instructions );
+			} while ( RemoveDeadCode( instructions ) );
+
+			CombinePairs( instructions );
+			FuseBranches( chunk, instructions );
+		}
+
+		if ( flags & QScript::Config_t::OF_SUPERINSTRUCTIONS )
+			FuseSuperinstructions( instructions );
+
+		// Jumps start out short and are widened until every distance fits
+		size_t count = instructions.size();
+		std::vector< uint32_t > newOffset( count + 1 );
+		std::vector< bool > isLong( count, false );
+
+		for ( auto& inst : instructions )
+		{
+			if ( GetJumpType( inst.m_OpCode ) == JT_NONE )
+				continue;
+
+			inst.m_Target = NextLive( instructions, inst.m_Target );
+		}
+
+		for ( bool changed = true; changed; )
+		{
+			changed = false;
+
+			uint32_t offset = 0;
+			for ( size_t i = 0; i < count; ++i )
+			{
+				newOffset[ i ] = offset;
+
+				auto& inst = instructions[ i ];
+				if ( inst.m_Removed )
+					continue;
+
+				// Stores are encoded like the assignments they replace, later parts of a
+				// superinstruction or a fused branch only add their operands
+				uint32_t opCodeSize = ( inst.m_Head == -1 ) ? 1 : 0;
+
+				if ( GetJumpType( inst.m_OpCode ) != JT_NONE )
+					offset += opCodeSize + ( isLong[ i ] ? 4 : 1 );
+				else
+					offset += opCodeSize + inst.m_Operands;
+			}
+
+			newOffset[ count ] = offset;
+
+			for ( size_t i = 0; i < count; ++i )
+			{
+				auto& inst = instructions[ i ];
+				if ( inst.m_Removed || isLong[ i ] || GetJumpType( inst.m_OpCode ) == JT_NONE )
+					continue;
+
+				// A jump in a superinstruction or a fused branch is its last part, so its operand ends it
+				uint32_t end = newOffset[ i ] + ( ( inst.m_Head == -1 ) ? 2 : 1 );
+
+				int64_t distance = ( inst.m_Target <= ( int ) i )
+					? ( int64_t ) newOffset[ i ] - newOffset[ inst.m_Target ]
+					: ( int64_t ) newOffset[ inst.m_Target ] - end;
+
+				if ( distance <= 255 )
+					continue;
+
+				if ( inst.m_Head != -1 )
+				{
+					// Too far for the short jump of a superinstruction or a fused branch, split it up again
+					int head = inst.m_Head;
+					instructions[ head ].m_Super = QScript::OpCode::OP_NOP;
+
+					for ( size_t part = head; part <= i; ++part )
+					{
+						if ( instructions[ part ].m_Head == head )
+							instructions[ part ].m_Head = -1;
+					}
+				}
+				else
+				{
+					isLong[ i ] = true;
+				}
+
+				changed = true;
+			}
+		}
+
+		// Emit
+		auto& oldCode = chunk->m_Code;
+		std::vector< uint8_t > code;
+		code.reserve( newOffset[ count ] );
+
+		auto emitOperands = [ &code, &oldCode ]( const Instruction_t& inst ) {
+			if ( inst.m_Operands == 1 )
+				code.push_back( ( uint8_t ) inst.m_Operand );
+			else
+				code.insert( code.end(), oldCode.begin() + inst.m_Offset + 1, oldCode.begin() + inst.m_Offset + 1 + inst.m_Operands );
+		};
+
+		auto emitOperand = [ &code ]( uint32_t operand, bool isLongOperand ) {
+			if ( isLongOperand )
+			{
+				code.push_back( ENCODE_LONG( operand, 0 ) );
+				code.push_back( ENCODE_LONG( operand, 1 ) );
+				code.push_back( ENCODE_LONG( operand, 2 ) );
+				code.push_back( ENCODE_LONG( operand, 3 ) );
+			}
+			else
+			{
+				code.push_back( ( uint8_t ) operand );
+			}
+		};
+
+		for ( size_t i = 0; i < count; ++i )
+		{
+			auto& inst = instructions[ i ];
+			if ( inst.m_Removed )
+				continue;
+
+			auto type = GetJumpType( inst.m_OpCode );
+
+			if ( inst.m_Head != -1 )
+			{
+				// Later part of a superinstruction or a fused branch, the only jump it can be is a short forward one
+				if ( type != JT_NONE )
+					code.push_back( ( uint8_t ) ( newOffset[ inst.m_Target ] - ( newOffset[ i ] + 1 ) ) );
+				else
+					emitOperands( inst );
+			}
+			else if ( type != JT_NONE )
+			{
+				bool backwards = ( inst.m_Target <= ( int ) i );
+				uint32_t size = isLong[ i ] ? 5 : 2;
+				uint32_t distance = backwards ? newOffset[ i ] - newOffset[ inst.m_Target ]
+					: newOffset[ inst.m_Target ] - ( newOffset[ i ] + size );
+
+				QScript::OpCode opCode;
+				if ( type == JT_IF_ZERO )
+					opCode = isLong[ i ] ? QScript::OpCode::OP_JUMP_IF_ZERO_LONG : QScript::OpCode::OP_JUMP_IF_ZERO_SHORT;
+				else if ( type == JT_BRANCH )
+					opCode = ( QScript::OpCode ) BranchOpCode( inst.m_OpCode, isLong[ i ] ? QScript::OpCode::OP_JUMP_IF_NOT_LT_LONG
+						: QScript::OpCode::OP_JUMP_IF_NOT_LT_SHORT );
+				else if ( backwards )
+					opCode = isLong[ i ] ? QScript::OpCode::OP_JUMP_BACK_LONG : QScript::OpCode::OP_JUMP_BACK_SHORT;
+				else
+					opCode = isLong[ i ] ? QScript::OpCode::OP_JUMP_LONG : QScript::OpCode::OP_JUMP_SHORT;
+
+				code.push_back( opCode );
+				emitOperand( distance, isLong[ i ] );
+			}
+			else
+			{
+				// Opcode may have been replaced
+				code.push_back( inst.m_Super != QScript::OpCode::OP_NOP ? inst.m_Super : inst.m_OpCode );
+				emitOperands( inst );
+			}
+		}
+
+		// Map every old code offset to the instruction it now belongs to, removed
+		// instructions map to the next live one
+		std::vector< uint32_t > remap( oldCode.size() + 1 );
+		for ( size_t i = 0; i < count; ++i )
+		{
+			auto& inst = instructions[ i ];
+			uint32_t mapped = newOffset[ inst.m_Removed ? NextLive( instructions, ( int ) i ) : i ];
+
+			for ( uint32_t offset = inst.m_Offset; offset < inst.m_Offset + inst.m_Size; ++offset )
+				remap[ offset ] = mapped;
+		}
+
+		remap[ oldCode.size() ] = newOffset[ count ];
+
+		std::vector< QScript::Chunk_t::Debug_t > debug;
+		for ( auto& symbol : chunk->m_Debug )
+		{
+			uint32_t from = remap[ symbol.m_From ];
+			uint32_t to = remap[ symbol.m_To ];
+
+			if ( from >= to )
+				continue;
+
+			debug.push_back( symbol );
+			debug.back().m_From = from;
+			debug.back().m_To = to;
+		}
+
+		chunk->m_Code.assign( code.data(), code.data() + code.size() );
+		chunk->m_Debug = debug;
+	}
+}
@@ -39,6 +39,7 @@ namespace Compiler
 		TOK_BRACE_LEFT,
 		TOK_BRACE_RIGHT,
 		TOK_TABLE,
+		TOK_CLASS,
 		TOK_COLON,
 		TOK_COMMA,
 		TOK_CONST,
@@ -84,6 +85,9 @@ namespace Compiler
 		TOK_SQUARE_BRACKET_LEFT,
 		TOK_SQUARE_BRACKET_RIGHT,
 		TOK_WHILE,
+
+		// Number of token ids
+		TOK_COUNT,
 	};
 
 	struct Token_t
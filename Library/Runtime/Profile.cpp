@@ -0,0 +1,140 @@
+#include "QLibPCH.h"
+#include "../Common/Chunk.h"
+
+#include "Instructions.h"
+#include "QVM.h"
+
+// Opcode sequence profile, and the superinstruction list generated from it. A QVM_PROFILE build
+// records every dispatch, so the counts are of sequences as they were executed, including
+// sequences across jumps and calls. Only sequences the compiler can fuse are considered.
+
+#define _QS_OPCODE_NAME( opcode ) #opcode
+
+namespace QVM
+{
+	static Profile_t	s_Profile;
+	static std::mutex	s_ProfileMutex;
+
+	void MergeProfile( const Profile_t& profile )
+	{
+		std::lock_guard< std::mutex > lock( s_ProfileMutex );
+		s_Profile.Merge( profile );
+	}
+
+	Profile_t CollectProfile()
+	{
+		std::lock_guard< std::mutex > lock( s_ProfileMutex );
+		return s_Profile;
+	}
+}
+
+void Profile_t::Merge( const Profile_t& other )
+{
+	for ( int i = 0; i < s_MaxSequence - 1; ++i )
+	{
+		for ( auto& sequence : other.m_Counts[ i ] )
+			m_Counts[ i ][ sequence.first ] += sequence.second;
+	}
+}
+
+std::string QScript::GenerateSuperinstructions( int maxCount )
+{
+	static const char* s_Names[] = { QS_OPCODES( _QS_OPCODE_NAME ) };
+
+	struct Candidate_t
+	{
+		std::vector< uint8_t >		m_Parts;
+		uint64_t					m_Count;
+	};
+
+	auto profile = QVM::CollectProfile();
+	std::vector< Candidate_t > candidates;
+
+	for ( int i = 0; i < Profile_t::s_MaxSequence - 1; ++i )
+	{
+		uint32_t length = ( uint32_t ) i + 2;
+
+		for ( auto& sequence : profile.m_Counts[ i ] )
+		{
+			Candidate_t candidate{ {}, sequence.second };
+			bool valid = true;
+
+			// First opcode of the sequence is in the highest byte
+			for ( uint32_t part = 0; part < length && valid; ++part )
+			{
+				uint8_t opCode = ( uint8_t ) ( sequence.first >> ( ( length - 1 - part ) * 8 ) );
+
+				valid = opCode < QScript::OpCode::OP_SUPERINSTRUCTION_FIRST
+					&& QVM::IsSuperinstructionPart( opCode, part == length - 1 );
+
+				candidate.m_Parts.push_back( opCode );
+			}
+
+			if ( valid )
+				candidates.push_back( candidate );
+		}
+	}
+
+	// Opcodes are a byte, superinstructions take what the other instructions leave over
+	int available = 256 - ( int ) QScript::OpCode::OP_SUPERINSTRUCTION_FIRST;
+	int count = std::min( maxCount, available );
+
+	auto saved = []( const Candidate_t& candidate ) {
+		return candidate.m_Count * ( candidate.m_Parts.size() - 1 );
+	};
+
+	std::string output;
+
+	// True if the sequences can't both be fused where they meet, because one contains the other
+	// or the end of one is the start of the other
+	auto overlaps = []( const std::vector< uint8_t >& a, const std::vector< uint8_t >& b ) {
+		if ( std::search( a.begin(), a.end(), b.begin(), b.end() ) != a.end() )
+			return true;
+
+		for ( size_t length = 1; length < std::min( a.size(), b.size() ); ++length )
+		{
+			if ( std::equal( a.end() - length, a.end(), b.begin() ) || std::equal( b.end() - length, b.end(), a.begin() ) )
+				return true;
+		}
+
+		return false;
+	};
+
+	// Pick the sequence that saves the most dispatches, the sequences it overlaps with then only
+	// occur where it doesn't
+	for ( int picked = 0; picked < count && candidates.size() > 0; ++picked )
+	{
+		auto best = std::max_element( candidates.begin(), candidates.end(), [ &saved ]( const Candidate_t& a, const Candidate_t& b ) {
+			return saved( a ) < saved( b );
+		} );
+
+		if ( saved( *best ) == 0 )
+			break;
+
+		Candidate_t chosen = *best;
+		candidates.erase( best );
+
+		for ( auto& candidate : candidates )
+		{
+			if ( overlaps( chosen.m_Parts, candidate.m_Parts ) )
+				candidate.m_Count -= std::min( candidate.m_Count, chosen.m_Count );
+		}
+
+		std::string name = "OP";
+		std::string parts;
+
+		for ( size_t part = 0; part < 4; ++part )
+		{
+			std::string partName = part < chosen.m_Parts.size() ? s_Names[ chosen.m_Parts[ part ] ] : "OP_NOP";
+
+			if ( part < chosen.m_Parts.size() )
+				name += partName.substr( 2 );
+
+			parts += ", " + partName;
+		}
+
+		output += "fmt( arg, " + name + parts + " ) \\\n";
+	}
+
+	return output;
+}
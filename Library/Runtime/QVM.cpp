@@ -8,6 +8,13 @@
 
 #include "../STL/NativeModule.h"
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
 #define INTERP_INIT \
 QVM::VirtualMachine = &vm; \
 QScript::Object::AllocateString = &QVM::AllocateString; \
@@ -16,7 +23,8 @@ QScript::Object::AllocateNative = &QVM::AllocateNative; \
 QScript::Object::AllocateClosure = &QVM::AllocateClosure; \
 QScript::Object::AllocateUpvalue = &QVM::AllocateUpvalue; \
 QScript::Object::AllocateTable = &QVM::AllocateTable; \
-QScript::Object::AllocateArray = &QVM::AllocateArray;
+QScript::Object::AllocateArray = &QVM::AllocateArray; \
+QScript::Object::AllocateFloat64Array = &QVM::AllocateFloat64Array;
 
 #define INTERP_SHUTDOWN \
 QScript::Object::AllocateString = NULL; \
@@ -25,19 +33,30 @@ QScript::Object::AllocateNative = NULL; \
 QScript::Object::AllocateClosure = NULL; \
 QScript::Object::AllocateUpvalue = NULL; \
 QScript::Object::AllocateTable = NULL; \
-QScript::Object::AllocateArray = NULL;
+QScript::Object::AllocateArray = NULL; \
+QScript::Object::AllocateFloat64Array = NULL;
+
+#ifdef QVM_PROFILE
+#define INTERP_PROFILE( inst ) vm.m_Profile.Record( inst )
+#else
+#define INTERP_PROFILE( inst ) ((void)0)
+#endif
 
 #if !defined(QVM_DEBUG) && defined(_OSX)
 #define _INTERP_JMP_PREFIX( opcode ) &&code_##opcode
 #define INTERP_JMPTABLE static void* opcodeTable[] = { QS_OPCODES( _INTERP_JMP_PREFIX ) };
 #define INTERP_SWITCH( inst ) INTERP_DISPATCH;
 #define INTERP_OPCODE( opcode ) code_##opcode
+#ifdef QVM_PROFILE
+#define INTERP_DISPATCH inst = ( QScript::OpCode ) READ_BYTE( ); INTERP_PROFILE( inst ); goto *opcodeTable[inst]
+#else
 #define INTERP_DISPATCH goto *opcodeTable[inst = ( QScript::OpCode ) READ_BYTE( )]
+#endif
 #define INTERP_DEFAULT ((void)0)
 #else
 #define INTERP_JMPTABLE ((void)0)
-#ifdef QVM_DEBUG
-#define INTERP_SWITCH( inst ) inst = ( QScript::OpCode ) READ_BYTE( ); \
+#if defined(QVM_DEBUG) || defined(QVM_PROFILE)
+#define INTERP_SWITCH( inst ) inst = ( QScript::OpCode ) READ_BYTE( ); INTERP_PROFILE( inst ); \
 switch ( inst )
 #else
 #define INTERP_SWITCH( inst ) switch ( inst = ( QScript::OpCode ) READ_BYTE( ) )
@@ -61,15 +80,14 @@ switch ( inst )
 }
 
 #define RESTORE_FRAME( ) \
-frame = &vm.m_Frames.back(); \
+frame = vm.m_FrameTop; \
 ip = frame->m_IP; \
-function = frame->m_Closure->GetFunction(); \
-chunk = function->GetChunk() \
+constants = frame->m_Constants \
 
-#define READ_CONST_SHORT() (chunk->m_Constants[ READ_BYTE() ])
+#define READ_CONST_SHORT() (constants[ READ_BYTE() ])
 #define READ_CONST_LONG( constant ) QScript::Value constant; { \
 	READ_LONG( cnstIndex ); \
-	constant = chunk->m_Constants[ cnstIndex ]; \
+	constant = constants[ cnstIndex ]; \
 }
 #define BINARY_OP( op, require ) { \
 	auto b = vm.Pop(); auto a = vm.Pop(); \
@@ -78,10 +96,100 @@ chunk = function->GetChunk() \
 	vm.Push( a op b ); \
 }
 
+#define _INTERP_SUPERINSTRUCTION( arg, name, a, b, c, d ) INTERP_OPCODE( name ): \
+	RunPart< QScript::OpCode::a >( vm, frame, constants, ip ); \
+	RunPart< QScript::OpCode::b >( vm, frame, constants, ip ); \
+	RunPart< QScript::OpCode::c >( vm, frame, constants, ip ); \
+	RunPart< QScript::OpCode::d >( vm, frame, constants, ip ); \
+	INTERP_DISPATCH;
+
+// Compare-and-branch, jumps forward when the comparison is false. The operands are popped off
+// the stack, or read from a local and a constant or two locals
+#define _INTERP_BRANCH( comparison ) \
+	INTERP_OPCODE( OP_JUMP_IF_NOT_##comparison##_SHORT ): \
+	{ \
+		auto offset = READ_BYTE(); \
+		auto b = vm.Pop(); \
+		auto a = vm.Pop(); \
+		if ( !Compare< QScript::OpCode::OP_JUMP_IF_NOT_##comparison##_SHORT >( a, b ) ) \
+			ip += offset; \
+		INTERP_DISPATCH; \
+	} \
+	INTERP_OPCODE( OP_JUMP_IF_NOT_##comparison##_LONG ): \
+	{ \
+		READ_LONG( offset ); \
+		auto b = vm.Pop(); \
+		auto a = vm.Pop(); \
+		if ( !Compare< QScript::OpCode::OP_JUMP_IF_NOT_##comparison##_SHORT >( a, b ) ) \
+			ip += offset; \
+		INTERP_DISPATCH; \
+	} \
+	INTERP_OPCODE( OP_JUMP_IF_NOT_##comparison##_LOCAL_CONSTANT ): \
+	{ \
+		auto a = frame->m_Base[ READ_BYTE() ]; \
+		auto b = READ_CONST_SHORT(); \
+		auto offset = READ_BYTE(); \
+		if ( !Compare< QScript::OpCode::OP_JUMP_IF_NOT_##comparison##_SHORT >( a, b ) ) \
+			ip += offset; \
+		INTERP_DISPATCH; \
+	} \
+	INTERP_OPCODE( OP_JUMP_IF_NOT_##comparison##_LOCAL_LOCAL ): \
+	{ \
+		auto a = frame->m_Base[ READ_BYTE() ]; \
+		auto b = frame->m_Base[ READ_BYTE() ]; \
+		auto offset = READ_BYTE(); \
+		if ( !Compare< QScript::OpCode::OP_JUMP_IF_NOT_##comparison##_SHORT >( a, b ) ) \
+			ip += offset; \
+		INTERP_DISPATCH; \
+	}
+
 namespace QVM
 {
-	// Let allocators to access the currently running machine
-	VM_t* VirtualMachine = NULL;
+	// Let allocators to access the machine running on this thread
+	thread_local VM_t* VirtualMachine = NULL;
+
+	// Stacks are reserved as address space only. Committing makes a prefix of the reservation
+	// usable, pages that are already committed keep their contents.
+	QScript::Value* ReserveStack( int size )
+	{
+		auto bytes = ( size_t ) size * sizeof( QScript::Value );
+
+#ifdef _WIN32
+		auto stack = VirtualAlloc( NULL, bytes, MEM_RESERVE, PAGE_NOACCESS );
+
+		if ( !stack )
+			throw std::bad_alloc();
+#else
+		auto stack = mmap( NULL, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+
+		if ( stack == MAP_FAILED )
+			throw std::bad_alloc();
+#endif
+
+		return ( QScript::Value* ) stack;
+	}
+
+	void CommitStack( QScript::Value* stack, int size )
+	{
+		auto bytes = ( size_t ) size * sizeof( QScript::Value );
+
+#ifdef _WIN32
+		if ( !VirtualAlloc( stack, bytes, MEM_COMMIT, PAGE_READWRITE ) )
+			throw std::bad_alloc();
+#else
+		if ( mprotect( stack, bytes, PROT_READ | PROT_WRITE ) != 0 )
+			throw std::bad_alloc();
+#endif
+	}
+
+	void ReleaseStack( QScript::Value* stack, int size )
+	{
+#ifdef _WIN32
+		VirtualFree( stack, 0, MEM_RELEASE );
+#else
+		munmap( stack, ( size_t ) size * sizeof( QScript::Value ) );
+#endif
+	}
 
 	void RuntimeError( Frame_t* frame, const std::string& id, const std::string& desc )
 	{
@@ -103,14 +211,11 @@ namespace QVM
 		throw RuntimeException( id, desc, lineNr, colNr, token );
 	}
 
-	FORCEINLINE void LoadField( VM_t& vm, Frame_t* frame, QScript::Value& name )
+	QScript::Value GetProperty( VM_t& vm, Frame_t* frame, QScript::Value target, const std::string& propName )
 	{
-		auto propName = AS_STRING( name )->GetString();
-		auto value = vm.Peek( 0 );
-
-		if ( IS_TABLE( value ) )
+		if ( IS_TABLE( target ) )
 		{
-			auto table = AS_TABLE( value );
+			auto table = AS_TABLE( target );
 			auto& props = table->GetProperties();
 
 			auto prop = props.find( propName );
@@ -118,38 +223,116 @@ namespace QVM
 			if ( prop == props.end() )
 			{
 				QVM::RuntimeError( frame, "rt_unknown_property",
-					"Unknown property \"" + propName + "\" of table \"" + value.ToString() + "\"" );
+					"Unknown property \"" + propName + "\" of table \"" + target.ToString() + "\"" );
 			}
 
-			vm.Peek( 0 ) = prop->second;
+			return prop->second;
 		}
-		else if ( IS_ARRAY( value ) )
+		else if ( IS_INSTANCE( target ) )
 		{
-			auto arr = AS_ARRAY( value );
-			auto& methods = arr->GetMethods();
+			auto instance = AS_INSTANCE( target );
+			auto classObject = instance->GetClass();
+			int slot = classObject->FindField( propName );
+
+			if ( slot != -1 && slot < instance->NumFields() )
+				return instance->GetFields()[ slot ];
 
-			auto prop = methods.find( propName );
+			auto method = classObject->FindMethod( propName );
 
-			if ( prop == methods.end() )
+			if ( !method )
 			{
 				QVM::RuntimeError( frame, "rt_unknown_property",
-					"Unknown property \"" + propName + "\" of array \"" + value.ToString() + "\"" );
+					"Unknown property \"" + propName + "\" of instance \"" + target.ToString() + "\"" );
 			}
 
-			vm.Peek( 0 ) = prop->second;
+			// Methods are shared by every instance, reading one out binds a copy to the instance
+			auto boundMethod = QScript::Object::AllocateClosure( ( QScript::FunctionObject* ) method->GetFunction() );
+			std::copy_n( method->GetUpvalues(), method->NumUpvalues(), boundMethod->GetUpvalues() );
+			boundMethod->Bind( instance );
+
+			return MAKE_OBJECT( boundMethod );
 		}
-		else
+		else if ( IS_ARRAY( target ) || IS_FLOAT64_ARRAY( target ) )
+		{
+			// Arrays don't carry a method table, bind the method on access
+			auto method = vm.m_ArrayMethods.find( propName );
+
+			if ( method == vm.m_ArrayMethods.end() )
+			{
+				QVM::RuntimeError( frame, "rt_unknown_property",
+					"Unknown property \"" + propName + "\" of array \"" + target.ToString() + "\"" );
+			}
+
+			auto methodNative = QScript::Object::AllocateNative( ( void* ) method->second );
+			methodNative->SetThis( AS_OBJECT( target ) );
+
+			return MAKE_OBJECT( methodNative );
+		}
+
+		QVM::RuntimeError( frame, "rt_invalid_instance",
+			"Can not read property \"" + propName + "\" of invalid table/array instance \"" + target.ToString() + "\"" );
+
+		return MAKE_NULL;
+	}
+
+	FORCEINLINE void LoadField( VM_t& vm, Frame_t* frame, const QScript::Value& name )
+	{
+		vm.Peek( 0 ) = GetProperty( vm, frame, vm.Peek( 0 ), AS_STRING( name )->GetString() );
+	}
+
+	void FieldTypeError( Frame_t* frame, QScript::ClassObject* classObject, int slot, const QScript::Value& value )
+	{
+		QVM::RuntimeError( frame, "rt_invalid_field_type", "Field \"" + classObject->GetFieldNames()[ slot ] + "\" of class \"" +
+			classObject->GetName() + "\" can only hold numbers, got \"" + value.ToString() + "\"" );
+	}
+
+	// Slot accesses are only compiled for values known to be instances of a class with that
+	// slot. Instances created while their class was still being declared may be shorter.
+	FORCEINLINE QScript::Value* GetSlot( Frame_t* frame, const QScript::Value& target, uint8_t slot )
+	{
+#ifdef QVM_DEBUG
+		if ( !IS_INSTANCE( target ) )
 		{
 			QVM::RuntimeError( frame, "rt_invalid_instance",
-				"Can not read property \"" + propName + "\" of invalid table/array instance \"" + value.ToString() + "\"" );
+				"Can not access slot " + std::to_string( slot ) + " of invalid instance \"" + target.ToString() + "\"" );
 		}
+#endif
+
+		auto instance = AS_INSTANCE( target );
+
+		if ( slot >= instance->NumFields() )
+		{
+			QVM::RuntimeError( frame, "rt_unknown_property",
+				"Unknown field slot " + std::to_string( slot ) + " of instance \"" + target.ToString() + "\"" );
+		}
+
+		return instance->GetFields() + slot;
 	}
 
-	void SetField( VM_t& vm, Frame_t* frame, QScript::Value& name )
+	void SetField( VM_t& vm, Frame_t* frame, const QScript::Value& name )
 	{
-		auto propName = AS_STRING( name )->GetString();
+		auto& propName = AS_STRING( name )->GetString();
 		auto value = vm.Pop();
 
+		if ( IS_INSTANCE( value ) )
+		{
+			// Instances have the fixed layout of their class, fields can't be added
+			auto instance = AS_INSTANCE( value );
+			int slot = instance->GetClass()->FindField( propName );
+
+			if ( slot == -1 || slot >= instance->NumFields() )
+			{
+				QVM::RuntimeError( frame, "rt_unknown_property",
+					"Unknown field \"" + propName + "\" of instance \"" + value.ToString() + "\"" );
+			}
+
+			if ( instance->GetClass()->IsNumberField( slot ) && !IS_NUMBER( vm.Peek( 0 ) ) )
+				FieldTypeError( frame, instance->GetClass(), slot, vm.Peek( 0 ) );
+
+			instance->GetFields()[ slot ] = vm.Peek( 0 );
+			return;
+		}
+
 		if ( !IS_TABLE( value ) )
 		{
 			QVM::RuntimeError( frame, "rt_invalid_instance",
@@ -162,13 +345,242 @@ namespace QVM
 		props[ propName ] = vm.Peek( 0 );
 	}
 
+	// Call a property of the receiver below the arguments. Methods of instances and arrays are
+	// called with the receiver in place as "this", other properties are read and called as values.
+	FORCEINLINE void Invoke( VM_t& vm, Frame_t* frame, const QScript::Value& name, uint8_t numArgs )
+	{
+		auto& propName = AS_STRING( name )->GetString();
+		auto receiver = vm.Peek( numArgs );
+
+		if ( IS_INSTANCE( receiver ) )
+		{
+			auto instance = AS_INSTANCE( receiver );
+			auto method = instance->GetClass()->FindMethod( propName );
+
+			if ( method )
+			{
+				auto function = method->GetFunction();
+
+				if ( function->NumArgs() != numArgs )
+				{
+					QVM::RuntimeError( frame, "rt_invalid_call_arity",
+						"Arguments provided is different from what the callee accepts, got: + " +
+						std::to_string( numArgs ) + " expected: " + std::to_string( function->NumArgs() ) );
+				}
+
+				vm.PushFrame( method, vm.m_StackTop - numArgs - 1, false );
+				return;
+			}
+		}
+		else if ( IS_ARRAY( receiver ) || IS_FLOAT64_ARRAY( receiver ) )
+		{
+			auto method = vm.m_ArrayMethods.find( propName );
+
+			if ( method != vm.m_ArrayMethods.end() )
+			{
+				auto returnValue = method->second( frame, vm.m_StackTop - numArgs - 1, numArgs + 1 );
+				vm.m_StackTop -= numArgs + 1;
+
+				vm.Push( returnValue );
+				return;
+			}
+		}
+
+		auto callee = GetProperty( vm, frame, receiver, propName );
+		vm.Peek( numArgs ) = callee;
+		vm.Call( frame, numArgs, vm.Peek( numArgs ) );
+	}
+
+	FORCEINLINE void Add( VM_t& vm, Frame_t* frame )
+	{
+		auto b = vm.Pop();
+		auto a = vm.Pop();
+
+		if ( IS_NUMBER( a ) && IS_NUMBER( b ) )
+		{
+			vm.Push( MAKE_NUMBER( AS_NUMBER( a ) + AS_NUMBER( b ) ) );
+		}
+		else if ( IS_STRING( a ) || IS_STRING( b ) )
+		{
+			auto stringA = a.ToString();
+			auto stringB = b.ToString();
+
+			vm.Push( MAKE_STRING( stringA + stringB ) );
+		}
+		else
+		{
+			QVM::RuntimeError( frame, "rt_invalid_operand_type", "Operands of \"+\" operation must be numbers or strings" );
+		}
+	}
+
+	FORCEINLINE void Equals( VM_t& vm, bool equals )
+	{
+		auto b = vm.Pop();
+		auto a = vm.Pop();
+
+		if ( IS_STRING( a ) && IS_STRING( b ) )
+			vm.Push( MAKE_BOOL( ( AS_STRING( a )->GetString() == AS_STRING( b )->GetString() ) == equals ) );
+		else
+			vm.Push( equals ? ( a == b ) : ( a != b ) );
+	}
+
+	// Call a closure resolved at compile time. The callee was never loaded, so the arguments move
+	// up to make room for its slot. Arity was checked by the compiler.
+	FORCEINLINE void CallDirect( VM_t& vm, QScript::ClosureObject* closure, uint8_t numArgs )
+	{
+		vm.Push( MAKE_NULL );
+
+		auto base = vm.m_StackTop - numArgs - 1;
+		std::memmove( base + 1, base, numArgs * sizeof( QScript::Value ) );
+		*base = MAKE_OBJECT( closure );
+
+		vm.PushFrame( closure, base, false );
+	}
+
+	// Comparison of a compare-and-branch, the branch is given by its short stack form. Same
+	// result as the comparison instruction followed by a truthiness test
+	template < uint8_t branch >
+	FORCEINLINE bool Compare( QScript::Value a, QScript::Value b )
+	{
+		if ( branch == QScript::OpCode::OP_JUMP_IF_NOT_EQ_SHORT || branch == QScript::OpCode::OP_JUMP_IF_NOT_NE_SHORT )
+		{
+			bool equals = ( branch == QScript::OpCode::OP_JUMP_IF_NOT_EQ_SHORT );
+
+			if ( IS_STRING( a ) && IS_STRING( b ) )
+				return ( AS_STRING( a )->GetString() == AS_STRING( b )->GetString() ) == equals;
+
+			return ( equals ? ( a == b ) : ( a != b ) ).IsTruthy();
+		}
+
+		if ( IS_NUMBER( a ) && IS_NUMBER( b ) )
+		{
+			switch ( branch )
+			{
+			case QScript::OpCode::OP_JUMP_IF_NOT_LT_SHORT: return AS_NUMBER( a ) < AS_NUMBER( b );
+			case QScript::OpCode::OP_JUMP_IF_NOT_LE_SHORT: return AS_NUMBER( a ) <= AS_NUMBER( b );
+			case QScript::OpCode::OP_JUMP_IF_NOT_GT_SHORT: return AS_NUMBER( a ) > AS_NUMBER( b );
+			default: return AS_NUMBER( a ) >= AS_NUMBER( b );
+			}
+		}
+
+		switch ( branch )
+		{
+		case QScript::OpCode::OP_JUMP_IF_NOT_LT_SHORT: return ( a < b ).IsTruthy();
+		case QScript::OpCode::OP_JUMP_IF_NOT_LE_SHORT: return ( a <= b ).IsTruthy();
+		case QScript::OpCode::OP_JUMP_IF_NOT_GT_SHORT: return ( a > b ).IsTruthy();
+		default: return ( a >= b ).IsTruthy();
+		}
+	}
+
+	// Runs one part of a superinstruction. Every part is its own instantiation, the branches on
+	// the opcode fold away and leave the same code as the instruction's own handler.
+	template < uint8_t opCode >
+	FORCEINLINE void RunPart( VM_t& vm, Frame_t* frame, QScript::Value* constants, uint8_t*& ip )
+	{
+		if ( opCode >= QScript::OpCode::OP_LOAD_LOCAL_0 && opCode <= QScript::OpCode::OP_LOAD_LOCAL_11 )
+		{
+			vm.Push( frame->m_Base[ opCode - QScript::OpCode::OP_LOAD_LOCAL_0 ] );
+			return;
+		}
+
+		if ( opCode >= QScript::OpCode::OP_SET_LOCAL_0 && opCode <= QScript::OpCode::OP_SET_LOCAL_11 )
+		{
+			frame->m_Base[ opCode - QScript::OpCode::OP_SET_LOCAL_0 ] = vm.Peek( 0 );
+			return;
+		}
+
+		if ( opCode >= QScript::OpCode::OP_STORE_LOCAL_0 && opCode <= QScript::OpCode::OP_STORE_LOCAL_11 )
+		{
+			frame->m_Base[ opCode - QScript::OpCode::OP_STORE_LOCAL_0 ] = vm.Pop();
+			return;
+		}
+
+		// LOAD_MINUS_1 is right before LOAD_0
+		if ( opCode >= QScript::OpCode::OP_LOAD_MINUS_1 && opCode <= QScript::OpCode::OP_LOAD_5 )
+		{
+			vm.Push( MAKE_NUMBER( ( double ) ( ( int ) opCode - QScript::OpCode::OP_LOAD_0 ) ) );
+			return;
+		}
+
+		switch ( opCode )
+		{
+		case QScript::OpCode::OP_NOP: break;
+		case QScript::OpCode::OP_LOAD_NULL: vm.Push( MAKE_NULL ); break;
+		case QScript::OpCode::OP_LOAD_CONSTANT_SHORT: vm.Push( READ_CONST_SHORT() ); break;
+		case QScript::OpCode::OP_LOAD_LOCAL_SHORT: vm.Push( frame->m_Base[ READ_BYTE() ] ); break;
+		case QScript::OpCode::OP_SET_LOCAL_SHORT: frame->m_Base[ READ_BYTE() ] = vm.Peek( 0 ); break;
+		case QScript::OpCode::OP_STORE_LOCAL_SHORT: frame->m_Base[ READ_BYTE() ] = vm.Pop(); break;
+		case QScript::OpCode::OP_POP: vm.Pop(); break;
+		case QScript::OpCode::OP_ADD: Add( vm, frame ); break;
+		case QScript::OpCode::OP_SUB: BINARY_OP( -, IS_NUMBER ); break;
+		case QScript::OpCode::OP_MUL: BINARY_OP( *, IS_NUMBER ); break;
+		case QScript::OpCode::OP_DIV: BINARY_OP( /, IS_NUMBER ); break;
+		case QScript::OpCode::OP_MOD: BINARY_OP( %, IS_NUMBER ); break;
+		case QScript::OpCode::OP_EQUALS: Equals( vm, true ); break;
+		case QScript::OpCode::OP_NOT_EQUALS: Equals( vm, false ); break;
+		case QScript::OpCode::OP_GREATERTHAN: BINARY_OP( >, IS_ANY ); break;
+		case QScript::OpCode::OP_LESSTHAN: BINARY_OP( <, IS_ANY ); break;
+		case QScript::OpCode::OP_LESSTHAN_OR_EQUAL: BINARY_OP( <=, IS_ANY ); break;
+		case QScript::OpCode::OP_GREATERTHAN_OR_EQUAL: BINARY_OP( >=, IS_ANY ); break;
+		case QScript::OpCode::OP_JUMP_IF_ZERO_SHORT:
+		{
+			auto offset = READ_BYTE();
+			if ( !vm.Peek( 0 ).IsTruthy() )
+				ip += offset;
+			break;
+		}
+		default:
+			assert( 0 );
+			break;
+		}
+	}
+
+	bool IsSuperinstructionPart( uint8_t opCode, bool isLast )
+	{
+		if ( opCode >= QScript::OpCode::OP_LOAD_LOCAL_0 && opCode <= QScript::OpCode::OP_LOAD_LOCAL_11 )
+			return true;
+
+		if ( opCode >= QScript::OpCode::OP_SET_LOCAL_0 && opCode <= QScript::OpCode::OP_SET_LOCAL_11 )
+			return true;
+
+		if ( opCode >= QScript::OpCode::OP_STORE_LOCAL_0 && opCode <= QScript::OpCode::OP_STORE_LOCAL_11 )
+			return true;
+
+		if ( opCode >= QScript::OpCode::OP_LOAD_NULL && opCode <= QScript::OpCode::OP_LOAD_5 )
+			return true;
+
+		switch ( opCode )
+		{
+		case QScript::OpCode::OP_LOAD_CONSTANT_SHORT:
+		case QScript::OpCode::OP_LOAD_LOCAL_SHORT:
+		case QScript::OpCode::OP_SET_LOCAL_SHORT:
+		case QScript::OpCode::OP_STORE_LOCAL_SHORT:
+		case QScript::OpCode::OP_POP:
+		case QScript::OpCode::OP_ADD:
+		case QScript::OpCode::OP_SUB:
+		case QScript::OpCode::OP_MUL:
+		case QScript::OpCode::OP_DIV:
+		case QScript::OpCode::OP_MOD:
+		case QScript::OpCode::OP_EQUALS:
+		case QScript::OpCode::OP_NOT_EQUALS:
+		case QScript::OpCode::OP_GREATERTHAN:
+		case QScript::OpCode::OP_LESSTHAN:
+		case QScript::OpCode::OP_LESSTHAN_OR_EQUAL:
+		case QScript::OpCode::OP_GREATERTHAN_OR_EQUAL:
+			return true;
+		case QScript::OpCode::OP_JUMP_IF_ZERO_SHORT:
+			// The rest of a superinstruction would run even when the jump is taken
+			return isLast;
+		default:
+			return false;
+		}
+	}
+
 	QScript::Value Run( VM_t& vm, bool enableDebugging )
 	{
-		Frame_t* frame = &vm.m_Frames.back();
+		Frame_t* frame = vm.m_FrameTop;
 		uint8_t* ip = frame->m_IP;
-
-		const QScript::FunctionObject* function = frame->m_Closure->GetFunction();
-		QScript::Chunk_t* chunk = function->GetChunk();
+		QScript::Value* constants = frame->m_Constants;
 
 #ifdef QVM_DEBUG
 		const uint8_t* runTill = NULL;
@@ -181,6 +593,7 @@ namespace QVM
 #ifdef QVM_DEBUG
 			if ( ( !runTill || ip > runTill ) && enableDebugging )
 			{
+				auto function = frame->m_Closure->GetFunction();
 				std::string input;
 
 				for( ;; )
@@ -213,7 +626,7 @@ namespace QVM
 						std::function< void( const QScript::FunctionObject* function ) > visitFunction;
 						visitFunction = [ &visitFunction, &ip, &vm ]( const QScript::FunctionObject* function ) -> void
 						{
-							auto isExecuting = vm.m_Frames.back().m_Closure->GetFunction() == function;
+							auto isExecuting = vm.m_FrameTop->m_Closure->GetFunction() == function;
 
 							auto disasm = Disassembler::DisassembleChunk( *function->GetChunk(), "<function, " + function->GetName() + ">",
 								isExecuting ? ( unsigned int ) ( ip - ( uint8_t* ) &function->GetChunk()->m_Code[ 0 ] ) : -1 );
@@ -320,6 +733,18 @@ namespace QVM
 				vm.m_Globals[ AS_STRING( constant )->GetString() ] = vm.Peek( 0 );
 				INTERP_DISPATCH;
 			}
+			INTERP_OPCODE( OP_STORE_GLOBAL_SHORT ):
+			{
+				auto constant = READ_CONST_SHORT();
+				vm.m_Globals[ AS_STRING( constant )->GetString() ] = vm.Pop();
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_STORE_GLOBAL_LONG ):
+			{
+				READ_CONST_LONG( constant );
+				vm.m_Globals[ AS_STRING( constant )->GetString() ] = vm.Pop();
+				INTERP_DISPATCH;
+			}
 			INTERP_OPCODE( OP_CREATE_ARRAY_SHORT ): vm.Push( MAKE_ARRAY( AS_STRING( READ_CONST_SHORT() )->GetString() ) ); INTERP_DISPATCH;
 			INTERP_OPCODE( OP_CREATE_ARRAY_LONG ):
 			{
@@ -327,6 +752,99 @@ namespace QVM
 				vm.Push( MAKE_ARRAY( AS_STRING( constant )->GetString() ) );
 				INTERP_DISPATCH;
 			}
+			INTERP_OPCODE( OP_CREATE_CLASS_SHORT ):
+			{
+				auto classObject = QS_NEW QScript::ClassObject( AS_STRING( READ_CONST_SHORT() )->GetString() );
+				vm.AddObject( classObject );
+				vm.Push( MAKE_OBJECT( classObject ) );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CREATE_CLASS_LONG ):
+			{
+				READ_CONST_LONG( constant );
+				auto classObject = QS_NEW QScript::ClassObject( AS_STRING( constant )->GetString() );
+				vm.AddObject( classObject );
+				vm.Push( MAKE_OBJECT( classObject ) );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CLASS_FIELD_SHORT ):
+			{
+				auto constant = READ_CONST_SHORT();
+				auto defaultValue = vm.Pop();
+				AS_CLASS( vm.Peek( 0 ) )->AddField( AS_STRING( constant )->GetString(), defaultValue, false );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CLASS_FIELD_LONG ):
+			{
+				READ_CONST_LONG( constant );
+				auto defaultValue = vm.Pop();
+				AS_CLASS( vm.Peek( 0 ) )->AddField( AS_STRING( constant )->GetString(), defaultValue, false );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CLASS_NUMBER_FIELD_SHORT ):
+			{
+				auto constant = READ_CONST_SHORT();
+				auto defaultValue = vm.Pop();
+
+				if ( !IS_NUMBER( defaultValue ) )
+				{
+					QVM::RuntimeError( frame, "rt_invalid_field_type", "Field \"" + AS_STRING( constant )->GetString() +
+						"\" can only hold numbers, got \"" + defaultValue.ToString() + "\"" );
+				}
+
+				AS_CLASS( vm.Peek( 0 ) )->AddField( AS_STRING( constant )->GetString(), defaultValue, true );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CLASS_NUMBER_FIELD_LONG ):
+			{
+				READ_CONST_LONG( constant );
+				auto defaultValue = vm.Pop();
+
+				if ( !IS_NUMBER( defaultValue ) )
+				{
+					QVM::RuntimeError( frame, "rt_invalid_field_type", "Field \"" + AS_STRING( constant )->GetString() +
+						"\" can only hold numbers, got \"" + defaultValue.ToString() + "\"" );
+				}
+
+				AS_CLASS( vm.Peek( 0 ) )->AddField( AS_STRING( constant )->GetString(), defaultValue, true );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_LOAD_SLOT ):
+			{
+				vm.Peek( 0 ) = *GetSlot( frame, vm.Peek( 0 ), READ_BYTE() );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_SET_SLOT ):
+			{
+				auto target = vm.Pop();
+				*GetSlot( frame, target, READ_BYTE() ) = vm.Peek( 0 );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_SET_SLOT_NUMBER ):
+			{
+				auto target = vm.Pop();
+				uint8_t slot = READ_BYTE();
+
+				if ( !IS_NUMBER( vm.Peek( 0 ) ) )
+					FieldTypeError( frame, AS_INSTANCE( target )->GetClass(), slot, vm.Peek( 0 ) );
+
+				*GetSlot( frame, target, slot ) = vm.Peek( 0 );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CLASS_METHOD_SHORT ):
+			{
+				auto constant = READ_CONST_SHORT();
+				auto method = vm.Pop();
+				AS_CLASS( vm.Peek( 0 ) )->GetMethods()[ AS_STRING( constant )->GetString() ] = AS_CLOSURE( method );
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CLASS_METHOD_LONG ):
+			{
+				READ_CONST_LONG( constant );
+				auto method = vm.Pop();
+				AS_CLASS( vm.Peek( 0 ) )->GetMethods()[ AS_STRING( constant )->GetString() ] = AS_CLOSURE( method );
+				INTERP_DISPATCH;
+			}
 			INTERP_OPCODE( OP_CREATE_TABLE_SHORT ): vm.Push( MAKE_TABLE( AS_STRING( READ_CONST_SHORT() )->GetString() ) ); INTERP_DISPATCH;
 			INTERP_OPCODE( OP_CREATE_TABLE_LONG ):
 			{
@@ -348,6 +866,19 @@ namespace QVM
 
 					vm.Push( AS_ARRAY( target )->GetArray()[ ( int ) AS_NUMBER( key ) ] );
 				}
+				else if ( IS_FLOAT64_ARRAY( target ) )
+				{
+					if ( !IS_NUMBER( key ) )
+						QVM::RuntimeError( frame, "rt_invalid_array_index", "Invalid array index \"" + target.ToString() + "\"" );
+
+					int keyInt = ( int ) AS_NUMBER( key );
+					auto& arr = AS_FLOAT64_ARRAY( target )->GetArray();
+
+					if ( keyInt < 0 || keyInt >= ( int ) arr.size() )
+						QVM::RuntimeError( frame, "rt_invalid_array_index", "Invalid array index \"" + target.ToString() + "\", array capacity = " + std::to_string( arr.size() ) );
+
+					vm.Push( MAKE_NUMBER( arr[ keyInt ] ) );
+				}
 				else
 				{
 					QVM::RuntimeError( frame, "rt_invalid_instance",
@@ -375,6 +906,22 @@ namespace QVM
 
 					arr[ keyInt ] = value;
 				}
+				else if ( IS_FLOAT64_ARRAY( target ) )
+				{
+					if ( !IS_NUMBER( key ) )
+						QVM::RuntimeError( frame, "rt_invalid_array_index", "Invalid array index \"" + target.ToString() + "\"" );
+
+					if ( !IS_NUMBER( value ) )
+						QVM::RuntimeError( frame, "rt_invalid_array_value", "Float64Array can only hold numbers, got \"" + value.ToString() + "\"" );
+
+					int keyInt = ( int ) AS_NUMBER( key );
+					auto& arr = AS_FLOAT64_ARRAY( target )->GetArray();
+
+					if ( keyInt < 0 || keyInt >= ( int ) arr.size() )
+						QVM::RuntimeError( frame, "rt_invalid_array_index", "Invalid array index \"" + target.ToString() + "\", array capacity = " + std::to_string( arr.size() ) );
+
+					arr[ keyInt ] = AS_NUMBER( value );
+				}
 				else
 				{
 					QVM::RuntimeError( frame, "rt_invalid_instance",
@@ -473,6 +1020,30 @@ namespace QVM
 				frame->m_Base[ offset ] = vm.Peek( 0 );
 				INTERP_DISPATCH;
 			}
+			INTERP_OPCODE( OP_STORE_LOCAL_0 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_1 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_2 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_3 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_4 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_5 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_6 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_7 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_8 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_9 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_10 ):
+			INTERP_OPCODE( OP_STORE_LOCAL_11 ):
+			{
+				uint8_t offset = inst - QScript::OP_STORE_LOCAL_0;
+				frame->m_Base[ offset ] = vm.Pop();
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_STORE_LOCAL_SHORT ): frame->m_Base[ READ_BYTE() ] = vm.Pop(); INTERP_DISPATCH;
+			INTERP_OPCODE( OP_STORE_LOCAL_LONG ):
+			{
+				READ_LONG( offset );
+				frame->m_Base[ offset ] = vm.Pop();
+				INTERP_DISPATCH;
+			}
 			INTERP_OPCODE( OP_SET_UPVALUE_SHORT ):
 			{
 				*( frame->m_Closure->GetUpvalues()[ READ_BYTE() ]->GetValue() ) = vm.Peek( 0 );
@@ -516,43 +1087,135 @@ namespace QVM
 					ip += offset;
 				INTERP_DISPATCH;
 			}
-			INTERP_OPCODE( OP_JUMP_IF_ZERO_LONG ):
+			INTERP_OPCODE( OP_JUMP_IF_ZERO_LONG ):
+			{
+				READ_LONG( offset );
+				if ( !vm.Peek( 0 ).IsTruthy() )
+					ip += offset;
+				INTERP_DISPATCH;
+			}
+			_INTERP_BRANCH( LT )
+			_INTERP_BRANCH( LE )
+			_INTERP_BRANCH( GT )
+			_INTERP_BRANCH( GE )
+			_INTERP_BRANCH( EQ )
+			_INTERP_BRANCH( NE )
+			INTERP_OPCODE( OP_CALL ):
+			{
+				uint8_t numArgs = READ_BYTE();
+
+				frame->m_IP = ip;
+				vm.Call( frame, numArgs, vm.Peek( numArgs ) );
+
+				RESTORE_FRAME();
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CALL_0 ):
+			INTERP_OPCODE( OP_CALL_1 ):
+			INTERP_OPCODE( OP_CALL_2 ):
+			INTERP_OPCODE( OP_CALL_3 ):
+			INTERP_OPCODE( OP_CALL_4 ):
+			INTERP_OPCODE( OP_CALL_5 ):
+			INTERP_OPCODE( OP_CALL_6 ):
+			INTERP_OPCODE( OP_CALL_7 ):
+			{
+				uint8_t numArgs = inst - QScript::OP_CALL_0;
+
+				frame->m_IP = ip;
+				vm.Call( frame, numArgs, vm.Peek( numArgs ) );
+
+				RESTORE_FRAME();
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CALL_DIRECT_SHORT ):
+			{
+				auto closure = AS_CLOSURE( READ_CONST_SHORT() );
+				uint8_t numArgs = READ_BYTE();
+
+				frame->m_IP = ip;
+				CallDirect( vm, closure, numArgs );
+
+				RESTORE_FRAME();
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CALL_DIRECT_LONG ):
+			{
+				READ_CONST_LONG( constant );
+				uint8_t numArgs = READ_BYTE();
+
+				frame->m_IP = ip;
+				CallDirect( vm, AS_CLOSURE( constant ), numArgs );
+
+				RESTORE_FRAME();
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_CALL_SELF ):
+			{
+				uint8_t numArgs = READ_BYTE();
+
+				frame->m_IP = ip;
+				CallDirect( vm, frame->m_Closure, numArgs );
+
+				RESTORE_FRAME();
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_TAIL_CALL ):
+			{
+				uint8_t numArgs = READ_BYTE();
+
+				frame->m_IP = ip;
+				vm.TailCall( frame, numArgs, vm.Peek( numArgs ) );
+
+				RESTORE_FRAME();
+				INTERP_DISPATCH;
+			}
+			INTERP_OPCODE( OP_TAIL_CALL_SELF ):
 			{
-				READ_LONG( offset );
-				if ( !vm.Peek( 0 ).IsTruthy() )
-					ip += offset;
+				uint8_t numArgs = READ_BYTE();
+
+				// Run the function again in the same frame, with the new arguments in place of the old ones.
+				// Arity was checked by the compiler.
+				vm.CloseUpvalues( frame->m_Base );
+
+				std::memmove( frame->m_Base + 1, vm.m_StackTop - numArgs, numArgs * sizeof( QScript::Value ) );
+				vm.m_StackTop = frame->m_Base + 1 + numArgs;
+
+				ip = frame->m_Code;
 				INTERP_DISPATCH;
 			}
-			INTERP_OPCODE( OP_CALL ):
+			INTERP_OPCODE( OP_INVOKE_SHORT ):
 			{
+				auto constant = READ_CONST_SHORT();
 				uint8_t numArgs = READ_BYTE();
 
 				frame->m_IP = ip;
-				vm.Call( frame, numArgs, vm.Peek( numArgs ) );
+				Invoke( vm, frame, constant, numArgs );
 
 				RESTORE_FRAME();
 				INTERP_DISPATCH;
 			}
-			INTERP_OPCODE( OP_CALL_0 ):
-			INTERP_OPCODE( OP_CALL_1 ):
-			INTERP_OPCODE( OP_CALL_2 ):
-			INTERP_OPCODE( OP_CALL_3 ):
-			INTERP_OPCODE( OP_CALL_4 ):
-			INTERP_OPCODE( OP_CALL_5 ):
-			INTERP_OPCODE( OP_CALL_6 ):
-			INTERP_OPCODE( OP_CALL_7 ):
+			INTERP_OPCODE( OP_INVOKE_LONG ):
 			{
-				uint8_t numArgs = inst - QScript::OP_CALL_0;
+				READ_CONST_LONG( constant );
+				uint8_t numArgs = READ_BYTE();
 
 				frame->m_IP = ip;
-				vm.Call( frame, numArgs, vm.Peek( numArgs ) );
+				Invoke( vm, frame, constant, numArgs );
 
 				RESTORE_FRAME();
 				INTERP_DISPATCH;
 			}
 			INTERP_OPCODE( OP_CLOSURE_SHORT ):
 			{
-				auto closure = MAKE_CLOSURE( AS_FUNCTION( READ_CONST_SHORT() ) );
+				auto fn = AS_FUNCTION( READ_CONST_SHORT() );
+
+				if ( fn->GetClosure() )
+				{
+					vm.Push( MAKE_OBJECT( fn->GetClosure() ) );
+					INTERP_DISPATCH;
+				}
+
+				auto closure = MAKE_CLOSURE( fn );
 				vm.Push( closure );
 
 				ip = vm.OpenUpvalues( AS_CLOSURE( closure ), frame, ip );
@@ -561,7 +1224,15 @@ namespace QVM
 			INTERP_OPCODE( OP_CLOSURE_LONG ):
 			{
 				READ_CONST_LONG( constant );
-				auto closure = MAKE_CLOSURE( AS_FUNCTION( constant ) );
+				auto fn = AS_FUNCTION( constant );
+
+				if ( fn->GetClosure() )
+				{
+					vm.Push( MAKE_OBJECT( fn->GetClosure() ) );
+					INTERP_DISPATCH;
+				}
+
+				auto closure = MAKE_CLOSURE( fn );
 				vm.Push( closure );
 
 				ip = vm.OpenUpvalues( AS_CLOSURE( closure ), frame, ip );
@@ -648,58 +1319,14 @@ namespace QVM
 				vm.Push( a.Pow( b ) );
 				INTERP_DISPATCH;
 			}
-			INTERP_OPCODE( OP_ADD ) :
-			{
-				auto b = vm.Pop();
-				auto a = vm.Pop();
-
-				if ( IS_NUMBER( a ) && IS_NUMBER( b ) )
-				{
-					vm.Push( MAKE_NUMBER( AS_NUMBER( a ) + AS_NUMBER( b ) ) );
-				}
-				else if ( IS_STRING( a ) || IS_STRING( b ) )
-				{
-					auto stringA = a.ToString();
-					auto stringB = b.ToString();
-
-					vm.Push( MAKE_STRING( stringA + stringB ) );
-				}
-				else
-				{
-					QVM::RuntimeError( frame, "rt_invalid_operand_type", "Operands of \"+\" operation must be numbers or strings" );
-				}
-
-				INTERP_DISPATCH;
-			}
+			INTERP_OPCODE( OP_ADD ): Add( vm, frame ); INTERP_DISPATCH;
 			INTERP_OPCODE( OP_NOP ): INTERP_DISPATCH;
 			INTERP_OPCODE( OP_SUB ): BINARY_OP( -, IS_NUMBER ); INTERP_DISPATCH;
 			INTERP_OPCODE( OP_MUL ): BINARY_OP( *, IS_NUMBER ); INTERP_DISPATCH;
 			INTERP_OPCODE( OP_DIV ): BINARY_OP( /, IS_NUMBER ); INTERP_DISPATCH;
 			INTERP_OPCODE( OP_MOD ): BINARY_OP( %, IS_NUMBER ); INTERP_DISPATCH;
-			INTERP_OPCODE( OP_EQUALS ):
-			{
-				auto b = vm.Pop();
-				auto a = vm.Pop();
-
-				if ( IS_STRING( a ) && IS_STRING( b ) )
-					vm.Push( MAKE_BOOL( AS_STRING( a )->GetString() == AS_STRING( b )->GetString() ) );
-				else
-					vm.Push( a == b );
-
-				INTERP_DISPATCH;
-			}
-			INTERP_OPCODE( OP_NOT_EQUALS ):
-			{
-				auto b = vm.Pop();
-				auto a = vm.Pop();
-
-				if ( IS_STRING( a ) && IS_STRING( b ) )
-					vm.Push( MAKE_BOOL( AS_STRING( a )->GetString() != AS_STRING( b )->GetString() ) );
-				else
-					vm.Push( a != b );
-
-				INTERP_DISPATCH;
-			}
+			INTERP_OPCODE( OP_EQUALS ): Equals( vm, true ); INTERP_DISPATCH;
+			INTERP_OPCODE( OP_NOT_EQUALS ): Equals( vm, false ); INTERP_DISPATCH;
 			INTERP_OPCODE( OP_GREATERTHAN ): BINARY_OP( >, IS_ANY ); INTERP_DISPATCH;
 			INTERP_OPCODE( OP_LESSTHAN ): BINARY_OP( <, IS_ANY ); INTERP_DISPATCH;
 			INTERP_OPCODE( OP_LESSTHAN_OR_EQUAL ): BINARY_OP( <=, IS_ANY ); INTERP_DISPATCH;
@@ -712,7 +1339,15 @@ namespace QVM
 				// Close everything from the exiting stack frame
 				vm.CloseUpvalues( frame->m_Base );
 
-				if ( vm.m_Frames.size() == 1 )
+				if ( frame->m_Stub && frame->m_Stub->Result( returnValue ) && frame->m_Stub->Next( frame->m_Base + 1 ) )
+				{
+					// Prepared call, run the callee again with the arguments the stub filled in
+					vm.m_StackTop = frame->m_Base + 1 + frame->m_Closure->GetFunction()->NumArgs();
+					ip = frame->m_Code;
+					INTERP_DISPATCH;
+				}
+
+				if ( frame == vm.m_Frames )
 				{
 #ifdef QVM_DEBUG
 					std::cout << "Exit: " << returnValue.ToString() << std::endl;
@@ -720,11 +1355,11 @@ namespace QVM
 					return returnValue;
 				}
 
-				auto fromNative = vm.m_Frames.back().m_FromNative;
+				auto fromNative = frame->m_FromNative;
 
 				vm.m_StackTop = frame->m_Base;
 
-				vm.m_Frames.pop_back();
+				vm.PopFrame();
 
 				vm.Push( returnValue );
 
@@ -737,6 +1372,7 @@ namespace QVM
 				RESTORE_FRAME();
 				INTERP_DISPATCH;
 			}
+			QS_SUPERINSTRUCTIONS( _INTERP_SUPERINSTRUCTION, _ )
 			INTERP_DEFAULT;
 			}
 		}
@@ -769,7 +1405,7 @@ namespace QVM
 
 	QScript::ClosureObject* AllocateClosure( QScript::FunctionObject* function )
 	{
-		auto closureObject = QS_NEW QScript::ClosureObject( function );
+		auto closureObject = QScript::ClosureObject::Create( function );
 		VirtualMachine->AddObject( ( QScript::Object* ) closureObject );
 		return closureObject;
 	}
@@ -792,52 +1428,80 @@ namespace QVM
 	{
 		auto arrayObject = QS_NEW QScript::ArrayObject( name );
 		VirtualMachine->AddObject( ( QScript::Object* ) arrayObject );
+		return arrayObject;
+	}
 
-		VirtualMachine->Push( MAKE_OBJECT( arrayObject ) );
-
-		auto& arrayMethodTable = arrayObject->GetMethods();
-		for ( auto method : VirtualMachine->m_ArrayMethods )
-		{
-			auto methodNative = QVM::AllocateNative( ( void* ) method.second );
-			methodNative->SetThis( arrayObject );
-
-			arrayMethodTable[ method.first ] = MAKE_OBJECT( methodNative );
-		}
-
-		VirtualMachine->Pop();
-
+	QScript::Float64ArrayObject* AllocateFloat64Array( const std::string& name )
+	{
+		auto arrayObject = QS_NEW QScript::Float64ArrayObject( name );
+		VirtualMachine->AddObject( ( QScript::Object* ) arrayObject );
 		return arrayObject;
 	}
 }
 
-void VM_t::Init( const QScript::FunctionObject* mainFunction )
+void VM_t::Init( const QScript::FunctionObject* mainFunction, const QScript::Config_t& config )
 {
 	// Make sure module system is initialized
 	QScript::InitModules();
 
 	m_Objects.clear();
 	m_Globals.clear();
+	m_Natives.clear();
 
-	// Allocate initial stack
-	m_Stack = QS_NEW QScript::Value[ s_InitStackSize ];
+	// Reserve the stack and commit its first part
+	m_StackReserved = ( int ) std::min< uint32_t >( std::max< uint32_t >( config.m_MaxStackSize, s_InitStackSize ), INT32_MAX );
+	m_Stack = QVM::ReserveStack( m_StackReserved );
 	m_StackCapacity = s_InitStackSize;
 	m_StackTop = &m_Stack[ 0 ];
 
+	QVM::CommitStack( m_Stack, m_StackCapacity );
+
+	// No upvalues are open yet
+	m_OpenUpvalues.assign( s_InitStackSize, NULL );
+	m_OpenUpvaluesEnd = 0;
+
 	// Get GC ready
 	m_ObjectsToNextGC = 32;
+	m_NumAllocations = 0;
+	m_EnableGC = true;
 
 	// Wrap the main function in a closure
-	m_Main = QS_NEW QScript::ClosureObject( mainFunction );
+	m_Main = QScript::ClosureObject::Create( mainFunction );
+
+	// Allocate every call frame up front, main runs in the first one
+	auto maxCallDepth = std::max( config.m_MaxCallDepth, 1u );
+
+	m_Frames = QS_NEW Frame_t[ maxCallDepth ];
+	m_FramesEnd = m_Frames + maxCallDepth;
+	m_FrameTop = m_Frames;
 
-	// Create initial call frame
-	m_Frames.emplace_back( m_Main, m_Stack, mainFunction->GetChunk()->m_Code.data(), false );
+	*m_FrameTop = Frame_t( m_Main, m_Stack, false );
 
 	// Push main function to stack slot 0. This is directly allocated, so
 	// the VM garbage collection won't ever release it
 	Push( MAKE_OBJECT( m_Main ) );
+}
+
+void VM_t::GrowStack()
+{
+	if ( m_StackCapacity == m_StackReserved )
+	{
+		QVM::RuntimeError( m_FrameTop, "rt_stack_overflow", "Stack size of " +
+			std::to_string( m_StackReserved ) + " values exceeded" );
+	}
+
+	// Commit more of the reservation in place, nothing on the stack moves
+	int newCapacity = std::min( m_StackCapacity * 2, m_StackReserved );
+	QVM::CommitStack( m_Stack, newCapacity );
+
+	m_OpenUpvalues.resize( newCapacity, NULL );
+	m_StackCapacity = newCapacity;
+}
 
-	// Init upvalues linked list
-	m_LivingUpvalues = NULL;
+void VM_t::StackOverflow()
+{
+	QVM::RuntimeError( m_FrameTop, "rt_stack_overflow", "Maximum call depth of " +
+		std::to_string( m_FramesEnd - m_Frames ) + " exceeded" );
 }
 
 void VM_t::Release()
@@ -849,11 +1513,21 @@ void VM_t::Release()
 	for ( auto object : m_Objects )
 		delete object;
 
-	delete[] m_Stack;
+	QVM::ReleaseStack( m_Stack, m_StackReserved );
+	m_Stack = NULL;
 	m_StackCapacity = 0;
+	m_StackReserved = 0;
 	m_StackTop = NULL;
 
+	delete[] m_Frames;
+	m_Frames = m_FrameTop = m_FramesEnd = NULL;
+
 	m_Objects.clear();
+
+#ifdef QVM_PROFILE
+	QVM::MergeProfile( m_Profile );
+	m_Profile = Profile_t();
+#endif
 }
 
 void VM_t::Call( Frame_t* frame, uint8_t numArgs, QScript::Value& target, bool fromNative )
@@ -876,7 +1550,7 @@ void VM_t::Call( Frame_t* frame, uint8_t numArgs, QScript::Value& target, bool f
 		}
 
 		m_StackTop[ -numArgs - 1 ] = MAKE_OBJECT( closure->GetThis() );
-		m_Frames.emplace_back( closure, m_StackTop - numArgs - 1, &function->GetChunk()->m_Code[ 0 ], fromNative );
+		PushFrame( closure, m_StackTop - numArgs - 1, fromNative );
 		break;
 	}
 	case QScript::ObjectType::OT_NATIVE:
@@ -894,6 +1568,134 @@ void VM_t::Call( Frame_t* frame, uint8_t numArgs, QScript::Value& target, bool f
 		Push( returnValue );
 		break;
 	}
+	case QScript::ObjectType::OT_CLASS:
+	{
+		// Calling a class creates an instance, arguments initialize the leading fields in order
+		auto classObject = AS_CLASS( target );
+
+		if ( numArgs > classObject->NumFields() )
+		{
+			QVM::RuntimeError( frame, "rt_invalid_call_arity",
+				"Class \"" + classObject->GetName() + "\" has " + std::to_string( classObject->NumFields() ) +
+				" fields, got: " + std::to_string( numArgs ) + " arguments" );
+		}
+
+		for ( int i = 0; i < numArgs; ++i )
+		{
+			if ( classObject->IsNumberField( i ) && !IS_NUMBER( m_StackTop[ i - numArgs ] ) )
+				QVM::FieldTypeError( frame, classObject, i, m_StackTop[ i - numArgs ] );
+		}
+
+		auto instance = QScript::InstanceObject::Create( classObject );
+		AddObject( instance );
+
+		std::copy_n( m_StackTop - numArgs, numArgs, instance->GetFields() );
+		m_StackTop -= numArgs + 1;
+
+		Push( MAKE_OBJECT( instance ) );
+		break;
+	}
+	default:
+		QVM::RuntimeError( frame, "rt_invalid_call_target", "Invalid call value object type" );
+	}
+}
+
+void VM_t::TailCall( Frame_t* frame, uint8_t numArgs, QScript::Value& target )
+{
+	// Prepared calls run their callee again when it returns, and the main frame ends the program,
+	// so they keep their frames. Natives and classes return right away, the caller returns their result.
+	if ( !IS_CLOSURE( target ) || frame->m_Stub || frame == m_Frames )
+	{
+		Call( frame, numArgs, target );
+		return;
+	}
+
+	auto closure = AS_CLOSURE( target );
+	auto function = closure->GetFunction();
+
+	if ( function->NumArgs() != numArgs )
+	{
+		QVM::RuntimeError( frame, "rt_invalid_call_arity",
+			"Arguments provided is different from what the callee accepts, got: + " +
+			std::to_string( numArgs ) + " expected: " + std::to_string( function->NumArgs() ) );
+	}
+
+	// Nothing of the caller is used after the call, the callee takes over its frame and stack window
+	CloseUpvalues( frame->m_Base );
+
+	auto callee = m_StackTop - numArgs - 1;
+	callee[ 0 ] = MAKE_OBJECT( closure->GetThis() );
+
+	std::memmove( frame->m_Base, callee, ( numArgs + 1 ) * sizeof( QScript::Value ) );
+	m_StackTop = frame->m_Base + numArgs + 1;
+
+	frame->Enter( closure );
+}
+
+void VM_t::CallStub( Frame_t* frame, uint8_t numArgs, QScript::Value target, CallStub_t* stub )
+{
+	if ( !IS_OBJECT( target ) )
+		QVM::RuntimeError( frame, "rt_invalid_call_target", "Call value was not object type" );
+
+	switch ( AS_OBJECT( target )->m_Type )
+	{
+	case QScript::ObjectType::OT_CLOSURE:
+	{
+		auto closure = AS_CLOSURE( target );
+		auto function = closure->GetFunction();
+
+		if ( function->NumArgs() != numArgs )
+		{
+			QVM::RuntimeError( frame, "rt_invalid_call_arity",
+				"Arguments provided is different from what the callee accepts, got: + " +
+				std::to_string( numArgs ) + " expected: " + std::to_string( function->NumArgs() ) );
+		}
+
+		// Reserve the callee slots, the stub writes the arguments in place
+		Push( MAKE_OBJECT( closure->GetThis() ) );
+		for ( int i = 0; i < numArgs; ++i )
+			Push( MAKE_NULL );
+
+		auto base = m_StackTop - numArgs - 1;
+
+		if ( !stub->Next( base + 1 ) )
+		{
+			m_StackTop = base;
+			return;
+		}
+
+		// The callee frame stays in place until the stub runs dry, see OP_RETURN
+		PushFrame( closure, base, true )->m_Stub = stub;
+
+		QVM::Run( *this, false );
+
+		// Discard the return value of the final call
+		Pop();
+		break;
+	}
+	case QScript::ObjectType::OT_NATIVE:
+	{
+		auto native = AS_NATIVE( target );
+		auto nativeFn = native->GetNative();
+		auto receiver = native->GetThis();
+
+		// Natives are called directly, the arguments are kept on the stack so they stay visible to the GC
+		Push( receiver ? MAKE_OBJECT( receiver ) : target );
+		for ( int i = 0; i < numArgs; ++i )
+			Push( MAKE_NULL );
+
+		// Natives may grow the stack, so address the arguments by index
+		auto baseIndex = m_StackTop - m_Stack - numArgs - 1;
+
+		while ( stub->Next( m_Stack + baseIndex + 1 ) )
+		{
+			if ( !stub->Result( nativeFn( frame, m_Stack + baseIndex, numArgs + 1 ) ) )
+				break;
+		}
+
+		m_StackTop = m_Stack + baseIndex;
+		break;
+	}
 	default:
 		QVM::RuntimeError( frame, "rt_invalid_call_target", "Invalid call value object type" );
 	}
@@ -902,11 +1704,12 @@ void VM_t::Call( Frame_t* frame, uint8_t numArgs, QScript::Value& target, bool f
 void VM_t::AddObject( QScript::Object* object )
 {
 	m_Objects.push_back( object );
+	++m_NumAllocations;
 
 #ifdef QVM_AGGRESSIVE_GC
-	if ( true )
+	if ( m_EnableGC )
 #else
-	if ( m_Objects.size() >= ( size_t ) m_ObjectsToNextGC )
+	if ( m_EnableGC && m_Objects.size() >= ( size_t ) m_ObjectsToNextGC )
 #endif
 	{
 		// Mark object
@@ -947,12 +1750,12 @@ void VM_t::MarkReachable()
 	}
 
 	// Mark closures of the current callstack
-	for ( auto& frame : m_Frames )
-		MarkObject( frame.m_Closure );
+	for ( auto frame = m_Frames; frame <= m_FrameTop; ++frame )
+		MarkObject( frame->m_Closure );
 
-	// Mark living upvalues
-	for ( auto upval = m_LivingUpvalues; upval; upval = upval->GetNext() )
-		MarkObject( upval );
+	// Mark open upvalues
+	for ( uint32_t slot = 0; slot < m_OpenUpvaluesEnd; ++slot )
+		MarkObject( m_OpenUpvalues[ slot ] );
 }
 
 void VM_t::MarkObject( QScript::Object* object )
@@ -980,10 +1783,10 @@ void VM_t::MarkObject( QScript::Object* object )
 	case QScript::OT_CLOSURE:
 	{
 		auto closureObj = ( QScript::ClosureObject* ) object;
-		auto& upvalues = ( closureObj )->GetUpvalues();
+		auto upvalues = closureObj->GetUpvalues();
 
-		for ( auto upval : upvalues )
-			MarkObject( upval );
+		for ( int i = 0; i < closureObj->NumUpvalues(); ++i )
+			MarkObject( upvalues[ i ] );
 
 		MarkObject( closureObj->GetThis() );
 		break;
@@ -1010,11 +1813,41 @@ void VM_t::MarkObject( QScript::Object* object )
 
 		break;
 	}
+	case QScript::OT_CLASS:
+	{
+		auto classObj = ( ( QScript::ClassObject* ) object );
+
+		for ( auto& defaultValue : classObj->GetDefaults() )
+		{
+			if ( IS_OBJECT( defaultValue ) )
+				MarkObject( AS_OBJECT( defaultValue ) );
+		}
+
+		for ( auto& method : classObj->GetMethods() )
+			MarkObject( method.second );
+
+		break;
+	}
+	case QScript::OT_INSTANCE:
+	{
+		auto instanceObj = ( ( QScript::InstanceObject* ) object );
+		auto fields = instanceObj->GetFields();
+
+		MarkObject( instanceObj->GetClass() );
+
+		// Number fields can't hold objects, only the rest need to be scanned
+		for ( auto slot : instanceObj->GetClass()->GetReferenceFields() )
+		{
+			if ( ( int ) slot < instanceObj->NumFields() && IS_OBJECT( fields[ slot ] ) )
+				MarkObject( AS_OBJECT( fields[ slot ] ) );
+		}
+
+		break;
+	}
 	case QScript::OT_ARRAY:
 	{
 		auto arrayObj = ( ( QScript::ArrayObject* ) object );
 		auto& itemList = arrayObj->GetArray();
-		auto& methodList = arrayObj->GetMethods();
 
 		for ( auto item : itemList )
 		{
@@ -1022,9 +1855,11 @@ void VM_t::MarkObject( QScript::Object* object )
 				MarkObject( AS_OBJECT( item ) );
 		}
 
-		for ( auto method : methodList )
-			MarkObject( AS_OBJECT( method.second ) );
-
+		break;
+	}
+	case QScript::OT_FLOAT64_ARRAY:
+	{
+		// Raw doubles, nothing to trace
 		break;
 	}
 	default:
@@ -1061,54 +1896,30 @@ void VM_t::Recycle()
 
 uint8_t* VM_t::OpenUpvalues( QScript::ClosureObject* closure, Frame_t* frame, uint8_t* ip )
 {
-	auto function = closure->GetFunction();
-	auto& upvalues = closure->GetUpvalues();
+	auto upvalues = closure->GetUpvalues();
 
-	upvalues.reserve( function->NumUpvalues() );
-
-	for ( int i = 0; i < function->NumUpvalues(); i++ )
+	for ( int i = 0; i < closure->NumUpvalues(); i++ )
 	{
 		bool isLocal = READ_BYTE() == 1;
 		READ_LONG( index );
 
 		if ( isLocal )
 		{
-			QScript::Value* value = frame->m_Base + index;
-
-			QScript::UpvalueObject* previous = NULL;
-			QScript::UpvalueObject* current = m_LivingUpvalues;
-
-			// Check if another upvalue exists that closes over the same variable
-			while ( current && current->GetValue() > value )
-			{
-				previous = current;
-				current = previous->GetNext();
-			}
+			auto slot = ( uint32_t ) ( frame->m_Base + index - m_Stack );
 
-			if ( current && current->GetValue() == value )
+			// Closures capturing the same variable share its upvalue
+			if ( !m_OpenUpvalues[ slot ] )
 			{
-				// Upvalue was found on in the list, reference the same variable
-				upvalues.push_back( current );
-				return ip;
+				m_OpenUpvalues[ slot ] = QScript::Object::AllocateUpvalue( m_Stack + slot );
+				m_OpenUpvaluesEnd = std::max( m_OpenUpvaluesEnd, slot + 1 );
 			}
-			else
-			{
-				// No other function closes over this stack slot, create a new upvalue
-				auto upvalue = QScript::Object::AllocateUpvalue( value );
-
-				// Link it to the upvalue chain
-				if ( !previous )
-					m_LivingUpvalues = upvalue;
-				else
-					previous->SetNext( upvalue );
 
-				upvalues.push_back( upvalue );
-			}
+			upvalues[ i ] = m_OpenUpvalues[ slot ];
 		}
 		else
 		{
 			// Refer to a parent's upvalue
-			upvalues.push_back( frame->m_Closure->GetUpvalues()[ index ] );
+			upvalues[ i ] = frame->m_Closure->GetUpvalues()[ index ];
 		}
 	}
 
@@ -1117,23 +1928,36 @@ uint8_t* VM_t::OpenUpvalues( QScript::ClosureObject* closure, Frame_t* frame, ui
 
 void VM_t::CloseUpvalues( QScript::Value* last )
 {
+	auto first = ( uint32_t ) ( last - m_Stack );
+
 	// Box in every upvalue that lives at the given stack slot (or further)
-	while ( m_LivingUpvalues != NULL && m_LivingUpvalues->GetValue() >= last )
+	for ( auto slot = first; slot < m_OpenUpvaluesEnd; ++slot )
 	{
-		m_LivingUpvalues->Close();
-		m_LivingUpvalues = m_LivingUpvalues->GetNext();
+		if ( m_OpenUpvalues[ slot ] )
+		{
+			m_OpenUpvalues[ slot ]->Close();
+			m_OpenUpvalues[ slot ] = NULL;
+		}
 	}
+
+	m_OpenUpvaluesEnd = std::min( m_OpenUpvaluesEnd, first );
 }
 
 void VM_t::CreateNative( const std::string name, QScript::NativeFn native )
 {
-	auto global = std::pair<std::string, QScript::Value>( name, MAKE_OBJECT( QVM::AllocateNative( ( void* ) native ) ) );
+	auto nativeObject = QS_NEW QScript::NativeFunctionObject( native );
+	AddObject( ( QScript::Object* ) nativeObject );
+
+	auto global = std::pair<std::string, QScript::Value>( name, MAKE_OBJECT( nativeObject ) );
 	m_Globals.insert( global );
+
+	m_Natives[ name ] = native;
 }
 
 void VM_t::CreateArrayMethod( const std::string name, QScript::NativeFn native )
 {
 	m_ArrayMethods[ name ] = native;
+	m_Natives[ "[]." + name ] = native;
 }
 
 void QScript::Repl()
@@ -1183,11 +2007,9 @@ void QScript::Repl()
 			// New closure to stack@0
 			vm.Push( MAKE_OBJECT( newClosure ) );
 
-			// Main frame out
-			vm.m_Frames.pop_back();
-
-			// New frame in
-			vm.m_Frames.emplace_back( newClosure, vm.m_Stack, &newMain->GetChunk()->m_Code[ 0 ], false );
+			// Replace the main frame
+			vm.m_FrameTop = vm.m_Frames;
+			*vm.m_FrameTop = Frame_t( newClosure, vm.m_Stack, false );
 
 			// Run code
 			QVM::Run( vm );
@@ -1222,9 +2044,76 @@ void QScript::Repl()
 	QScript::FreeFunction( function );
 }
 
+// Point the allocators back at the given VM, or clear them
+static void RestoreInterpreter( VM_t* previous )
+{
+	if ( previous )
+	{
+		VM_t& vm = *previous;
+		INTERP_INIT;
+	}
+	else
+	{
+		INTERP_SHUTDOWN;
+		QVM::VirtualMachine = NULL;
+	}
+}
+
+void QVM::RunWorker( const QScript::FunctionObject* function, uint8_t numArgs, CallStub_t* stub,
+	std::vector< QScript::Object* >* objects )
+{
+	// The calling thread may be in the middle of running its own VM
+	auto previous = QVM::VirtualMachine;
+
+	// Worker callbacks are pure, they make no calls and only need room for their own locals
+	// and temporaries. Keep each chunk's VM small rather than reserving a full-size stack.
+	static const uint32_t s_WorkerCallDepth = 4;
+	static const uint32_t s_WorkerStackSize = 4096;
+
+	QScript::Config_t config( false );
+	config.m_MaxCallDepth = s_WorkerCallDepth;
+	config.m_MaxStackSize = s_WorkerStackSize;
+
+	VM_t vm( function, config );
+	vm.m_EnableGC = false;
+
+	INTERP_INIT;
+
+	try
+	{
+		// The function runs as main, its arguments follow the closure in slot 0
+		for ( int i = 0; i < numArgs; ++i )
+			vm.Push( MAKE_NULL );
+
+		if ( stub->Next( vm.m_Stack + 1 ) )
+		{
+			vm.m_FrameTop->m_Stub = stub;
+			QVM::Run( vm, false );
+		}
+	}
+	catch ( ... )
+	{
+		vm.Release();
+		RestoreInterpreter( previous );
+		throw;
+	}
+
+	// Results may point into the worker heap, let the caller decide what to keep
+	objects->insert( objects->end(), vm.m_Objects.begin(), vm.m_Objects.end() );
+	vm.m_Objects.clear();
+
+	vm.Release();
+	RestoreInterpreter( previous );
+}
+
 void QScript::Interpret( const QScript::FunctionObject& function )
 {
-	VM_t vm( &function );
+	Interpret( function, Config_t( false ) );
+}
+
+void QScript::Interpret( const QScript::FunctionObject& function, const Config_t& config )
+{
+	VM_t vm( &function, config );
 
 	INTERP_INIT;
 
@@ -1232,7 +2121,17 @@ void QScript::Interpret( const QScript::FunctionObject& function )
 	auto systemModule = QScript::ResolveModule( "System" );
 	systemModule->Import( &vm );
 
-	auto exitCode = QVM::Run( vm );
+	try
+	{
+		QVM::Run( vm );
+	}
+	catch ( ... )
+	{
+		// Frames and the stack are sized for the deepest run, they go with the VM on errors too
+		vm.Release();
+		INTERP_SHUTDOWN;
+		throw;
+	}
 
 	// Clear allocated objects
 	vm.Release();
@@ -1255,3 +2154,43 @@ void QScript::Interpret( VM_t& vm, Value* out )
 
 	INTERP_SHUTDOWN;
 }
+
+QScript::Value QScript::CallFunction( VM_t& vm, const std::string& name, const std::vector< Value >& args )
+{
+	auto global = vm.m_Globals.find( name );
+
+	if ( global == vm.m_Globals.end() )
+		throw RuntimeException( "rt_unknown_global", "Referring to an unknown global: \"" + name + "\"", -1, -1, "" );
+
+	INTERP_INIT;
+
+	auto target = global->second;
+	auto stackTop = vm.m_StackTop - vm.m_Stack;
+	auto frameTop = vm.m_FrameTop;
+
+	try
+	{
+		vm.Push( target );
+
+		for ( auto& arg : args )
+			vm.Push( arg );
+
+		vm.Call( vm.m_FrameTop, ( uint8_t ) args.size(), target, true );
+
+		// Natives push their result directly, closures need to be run first
+		if ( vm.m_FrameTop > frameTop )
+			QVM::Run( vm, false );
+	}
+	catch ( ... )
+	{
+		vm.m_FrameTop = frameTop;
+		vm.m_StackTop = vm.m_Stack + stackTop;
+		INTERP_SHUTDOWN;
+		throw;
+	}
+
+	auto result = vm.Pop();
+
+	INTERP_SHUTDOWN;
+	return result;
+}
@@ -1,19 +1,81 @@
 #pragma once
 
+// Prepared call, runs the same callee repeatedly from within a single interpreter loop.
+// The callee frame is set up once, and its argument slots are refilled for every call.
+struct CallStub_t
+{
+	virtual ~CallStub_t() {}
+
+	// Write the arguments of the next call, returns false when there is nothing left to call
+	virtual bool Next( QScript::Value* args ) = 0;
+
+	// Receive the return value of the last call, returns false to stop early
+	virtual bool Result( const QScript::Value& value ) = 0;
+};
+
 struct Frame_t
 {
-	Frame_t( QScript::ClosureObject* closure, QScript::Value* stackFrame, uint8_t* ip, bool fromNative )
+	Frame_t()
 	{
-		m_Closure = closure;
+	}
+
+	Frame_t( QScript::ClosureObject* closure, QScript::Value* stackFrame, bool fromNative )
+	{
+		Enter( closure );
 		m_Base = stackFrame;
-		m_IP = ip;
 		m_FromNative = fromNative;
+		m_Stub = NULL;
+	}
+
+	// Start running a closure from its first instruction. Code and constants of its chunk are
+	// kept in the frame, so the interpreter doesn't look them up again when returning to it.
+	// Functions of lazily compiled scripts get their code the first time they are entered.
+	FORCEINLINE void Enter( QScript::ClosureObject* closure )
+	{
+		auto function = closure->GetFunction();
+
+		if ( function->IsDeferred() )
+			function->CompileDeferred();
+
+		auto chunk = function->GetChunk();
+
+		m_Closure = closure;
+		m_Code = chunk->m_Code.data();
+		m_Constants = chunk->m_Constants.data();
+		m_IP = m_Code;
 	}
 
 	QScript::ClosureObject*			m_Closure;
 	QScript::Value*					m_Base;
 	uint8_t*						m_IP;
+	uint8_t*						m_Code;
+	QScript::Value*					m_Constants;
 	bool							m_FromNative;
+	CallStub_t*						m_Stub;
+};
+
+// Counts of opcode sequences the interpreter has dispatched, recorded by QVM_PROFILE builds.
+// Sequences are keyed by their opcodes packed into bytes, the last opcode in the lowest one.
+struct Profile_t
+{
+	static const int s_MaxSequence = 4;
+
+	FORCEINLINE void Record( uint8_t opCode )
+	{
+		m_History = ( m_History << 8 ) | opCode;
+
+		if ( m_Length < s_MaxSequence )
+			++m_Length;
+
+		for ( uint32_t length = 2; length <= m_Length; ++length )
+			++m_Counts[ length - 2 ][ m_History & ( uint32_t ) ( ( 1ull << ( length * 8 ) ) - 1 ) ];
+	}
+
+	void Merge( const Profile_t& other );
+
+	uint32_t												m_History = 0;
+	uint32_t												m_Length = 0;
+	std::unordered_map< uint32_t, uint64_t >				m_Counts[ s_MaxSequence - 1 ];
 };
 
 struct VM_t
@@ -22,34 +84,18 @@ struct VM_t
 
 	VM_t( const QScript::FunctionObject* function )
 	{
-		Init( function );
+		Init( function, QScript::Config_t( false ) );
+	}
+
+	VM_t( const QScript::FunctionObject* function, const QScript::Config_t& config )
+	{
+		Init( function, config );
 	}
 
 	FORCEINLINE void Push( QScript::Value value )
 	{
 		if ( m_StackTop - m_Stack == m_StackCapacity )
-		{
-			// Reallocate more stack space
-			int newCapacity = m_StackCapacity * 2;
-			QScript::Value* newStack = QS_NEW QScript::Value[ newCapacity ];
-
-			// Copy previous contents to new stack
-			std::memcpy( newStack, m_Stack, ( m_StackTop - m_Stack ) * sizeof( QScript::Value ) );
-
-			// Free previous stack space
-			delete[] m_Stack;
-
-			// Relocate call frame stack pointers
-			for ( auto& frame : m_Frames )
-			{
-				auto stackIndex = ( uint32_t ) ( frame.m_Base - m_Stack );
-				frame.m_Base = &newStack[ stackIndex ];
-			}
-
-			m_StackTop = newStack + m_StackCapacity;
-			m_Stack = newStack;
-			m_StackCapacity = newCapacity;
-		}
+			GrowStack();
 
 		*m_StackTop = value;
 		++m_StackTop;
@@ -70,8 +116,26 @@ struct VM_t
 		return m_StackTop[ -1 - offset ];
 	}
 
-	void Init( const QScript::FunctionObject* function );
+	FORCEINLINE Frame_t* PushFrame( QScript::ClosureObject* closure, QScript::Value* stackFrame, bool fromNative )
+	{
+		if ( m_FrameTop == m_FramesEnd - 1 )
+			StackOverflow();
+
+		*++m_FrameTop = Frame_t( closure, stackFrame, fromNative );
+		return m_FrameTop;
+	}
+
+	FORCEINLINE void PopFrame()
+	{
+		--m_FrameTop;
+	}
+
+	void Init( const QScript::FunctionObject* function, const QScript::Config_t& config );
+	void GrowStack();
+	void StackOverflow();
 	void Call( Frame_t* frame, uint8_t numArgs, QScript::Value& target, bool fromNative = false );
+	void TailCall( Frame_t* frame, uint8_t numArgs, QScript::Value& target );
+	void CallStub( Frame_t* frame, uint8_t numArgs, QScript::Value target, CallStub_t* stub );
 	void AddObject( QScript::Object* object );
 
 	uint8_t* OpenUpvalues( QScript::ClosureObject* closure, Frame_t* frame, uint8_t* ip );
@@ -85,9 +149,12 @@ struct VM_t
 	void MarkObject( QScript::Object* object );
 	void Recycle();
 
-	// Call frames
+	// Call frames, allocated up front for the maximum call depth. Frames never move, m_FrameTop
+	// is the one running.
 	QScript::ClosureObject*									m_Main;
-	std::vector< Frame_t >									m_Frames;
+	Frame_t*												m_Frames;
+	Frame_t*												m_FrameTop;
+	Frame_t*												m_FramesEnd;
 
 	// Keep track of allocated objects in the VM
 	std::vector< QScript::Object* >							m_Objects;
@@ -95,23 +162,56 @@ struct VM_t
 	// Global scope
 	std::unordered_map< std::string, QScript::Value >		m_Globals;
 
-	// Stack
+	// Stack. The whole reservation is set aside when the VM is created and committed from the
+	// bottom up, so values never move: frames, upvalues and natives can keep pointers to them.
 	QScript::Value*											m_StackTop;
 	QScript::Value* 										m_Stack;
 	int														m_StackCapacity;
+	int														m_StackReserved;
 
-	// Upvalues in use (not closed over)
-	QScript::UpvalueObject*									m_LivingUpvalues;
+	// Upvalues in use (not closed over), indexed by the stack slot they refer to
+	std::vector< QScript::UpvalueObject* >					m_OpenUpvalues;
+
+	// One past the highest stack slot that may have an open upvalue
+	uint32_t												m_OpenUpvaluesEnd;
 
 	// Number of allocations until garbage collection
 	int 													m_ObjectsToNextGC;
 
+	// Objects the VM has allocated over its lifetime
+	uint64_t												m_NumAllocations;
+
+	// Worker VMs reference objects owned by another VM, so they must never collect
+	bool													m_EnableGC;
+
 	// Built-in array methods
 	std::unordered_map< std::string, QScript::NativeFn >	m_ArrayMethods;
+
+	// Every native registered by a module, array methods are prefixed with "[]."
+	std::unordered_map< std::string, QScript::NativeFn >	m_Natives;
+
+#ifdef QVM_PROFILE
+	// Dispatched opcode sequences, merged to the process-wide profile on release
+	Profile_t												m_Profile;
+#endif
 };
 
 namespace QVM
 {
 	QScript::Value Run( VM_t& vm, bool enableDebugging = true );
-	extern VM_t* VirtualMachine;
+
+	// Run a function in a standalone VM on the calling thread, once for every set of arguments
+	// the stub provides. Objects allocated by the run are handed over to the caller.
+	void RunWorker( const QScript::FunctionObject* function, uint8_t numArgs, CallStub_t* stub,
+		std::vector< QScript::Object* >* objects );
+
+	// Superinstruction parts the interpreter can run, see QS_SUPERINSTRUCTIONS
+	bool IsSuperinstructionPart( uint8_t opCode, bool isLast );
+
+	// Opcode sequences recorded by every VM released so far
+	void MergeProfile( const Profile_t& profile );
+	Profile_t CollectProfile();
+
+	// VM running on the calling thread, this is how natives and allocators reach their isolate
+	extern thread_local VM_t* VirtualMachine;
 }
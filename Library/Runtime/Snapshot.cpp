@@ -0,0 +1,901 @@
+#include "QLibPCH.h"
+#include "../Common/Chunk.h"
+#include "../Common/Serializer.h"
+#include "../STL/NativeModule.h"
+
+#include "QVM.h"
+
+// Snapshot layout:
+//   Header_t
+//   Object shells    (type, ownership and everything that isn't a reference to another object)
+//   Object links     (constants, upvalues, properties, elements, receivers, fields, methods)
+//   Globals          (name, value)
+//   Array methods    (name)
+//
+// Objects are stored by index, and rebuilt in two passes so cycles resolve. Native functions
+// are stored by the name they were registered under, and resolved on load against the natives
+// of every module, so a snapshot never holds an address.
+
+namespace Snapshot
+{
+	static const uint32_t s_Magic = 0x504E5351; // "QSNP"
+	static const uint32_t s_Version = 5;
+
+	struct Header_t
+	{
+		uint32_t		m_Magic;
+		uint32_t		m_Version;
+		char			m_Build[ 32 ];
+		uint32_t		m_ValueSize;
+		uint32_t		m_NumObjects;
+		uint32_t		m_MainFunction;
+	};
+
+	enum ValueTag : uint8_t
+	{
+		VTAG_NULL,
+		VTAG_BOOL,
+		VTAG_NUMBER,
+		VTAG_OBJECT,
+	};
+
+	// Compiled objects (functions, their constants and shared closures) are freed through
+	// FreeFunction(), heap objects belong to the VM
+	enum Ownership : uint8_t
+	{
+		OWNER_COMPILED,
+		OWNER_HEAP,
+	};
+
+	// Bytecode and object layouts may change from build to build, natives are resolved by name
+	static const char* BuildStamp()
+	{
+		return __DATE__ " " __TIME__;
+	}
+
+	class Writer : public BinaryWriter
+	{
+	public:
+		Writer( const std::unordered_map< QScript::Object*, uint32_t >& indices, const std::unordered_map< QScript::NativeFn, std::string >& natives )
+			: m_Indices( indices ), m_Natives( natives )
+		{
+		}
+
+		void WriteObject( QScript::Object* object )
+		{
+			Write( object ? m_Indices.at( object ) + 1 : ( uint32_t ) 0 );
+		}
+
+		void WriteValue( const QScript::Value& value )
+		{
+			if ( IS_NULL( value ) )
+			{
+				Write( ( uint8_t ) VTAG_NULL );
+			}
+			else if ( IS_BOOL( value ) )
+			{
+				Write( ( uint8_t ) VTAG_BOOL );
+				Write( ( uint8_t ) ( AS_BOOL( value ) ? 1 : 0 ) );
+			}
+			else if ( IS_NUMBER( value ) )
+			{
+				Write( ( uint8_t ) VTAG_NUMBER );
+				Write( AS_NUMBER( value ) );
+			}
+			else
+			{
+				Write( ( uint8_t ) VTAG_OBJECT );
+				WriteObject( AS_OBJECT( value ) );
+			}
+		}
+
+		void WriteNative( QScript::NativeFn native )
+		{
+			auto name = m_Natives.find( native );
+
+			if ( name == m_Natives.end() )
+				throw Exception( "snapshot_unsupported", "Can not snapshot a native function that wasn't registered by a module" );
+
+			WriteString( name->second );
+		}
+
+	private:
+		const std::unordered_map< QScript::Object*, uint32_t >&		m_Indices;
+		const std::unordered_map< QScript::NativeFn, std::string >&	m_Natives;
+	};
+
+	class Reader : public BinaryReader
+	{
+	public:
+		Reader( const std::vector< uint8_t >& data, const std::vector< QScript::Object* >& objects )
+			: BinaryReader( data.data(), data.size(), "snapshot_invalid" ), m_Objects( objects )
+		{
+		}
+
+		QScript::Object* ReadObject()
+		{
+			auto index = Read< uint32_t >();
+
+			if ( index == 0 )
+				return NULL;
+
+			if ( index > m_Objects.size() )
+				Fail( "Object index out of range" );
+
+			return m_Objects[ index - 1 ];
+		}
+
+		QScript::Value ReadValue()
+		{
+			switch ( Read< uint8_t >() )
+			{
+			case VTAG_NULL: return MAKE_NULL;
+			case VTAG_BOOL: return MAKE_BOOL( Read< uint8_t >() != 0 );
+			case VTAG_NUMBER: return MAKE_NUMBER( Read< double >() );
+			case VTAG_OBJECT:
+			{
+				auto object = ReadObject();
+
+				if ( !object )
+					Fail( "Null object reference" );
+
+				return MAKE_OBJECT( object );
+			}
+			default:
+				Fail( "Unknown value tag" );
+			}
+		}
+
+	private:
+		const std::vector< QScript::Object* >&		m_Objects;
+	};
+
+	// Gives every object reachable from the roots an index, compiled objects come first
+	class ObjectGraph
+	{
+	public:
+		void AddCompiled( QScript::Object* object )
+		{
+			Visit( object, OWNER_COMPILED );
+		}
+
+		void AddHeap( const QScript::Value& value )
+		{
+			if ( IS_OBJECT( value ) )
+				Visit( AS_OBJECT( value ), OWNER_HEAP );
+		}
+
+		std::unordered_map< QScript::Object*, uint32_t >		m_Indices;
+		std::vector< QScript::Object* >							m_Objects;
+		std::vector< Ownership >								m_Owners;
+
+	private:
+		void Visit( QScript::Object* root, Ownership owner )
+		{
+			std::vector< QScript::Object* > queue = { root };
+
+			while ( !queue.empty() )
+			{
+				auto object = queue.back();
+				queue.pop_back();
+
+				if ( !object || m_Indices.find( object ) != m_Indices.end() )
+					continue;
+
+				auto objectOwner = owner;
+
+				if ( object->m_Type == QScript::OT_CLOSURE )
+				{
+					auto function = ( QScript::FunctionObject* ) ( ( QScript::ClosureObject* ) object )->GetFunction();
+
+					// Closure shells refer to their function, so it has to come first
+					if ( m_Indices.find( function ) == m_Indices.end() )
+					{
+						queue.push_back( object );
+						queue.push_back( function );
+						continue;
+					}
+
+					if ( function->GetClosure() == object )
+						objectOwner = OWNER_COMPILED;
+				}
+				else if ( object->m_Type == QScript::OT_INSTANCE )
+				{
+					auto classObject = ( ( QScript::InstanceObject* ) object )->GetClass();
+
+					// Instance shells refer to their class, so it has to come first
+					if ( m_Indices.find( classObject ) == m_Indices.end() )
+					{
+						queue.push_back( object );
+						queue.push_back( classObject );
+						continue;
+					}
+				}
+
+				m_Indices[ object ] = ( uint32_t ) m_Objects.size();
+				m_Objects.push_back( object );
+				m_Owners.push_back( objectOwner );
+
+				auto pushValue = [ &queue ]( const QScript::Value& value ) {
+					if ( IS_OBJECT( value ) )
+						queue.push_back( AS_OBJECT( value ) );
+				};
+
+				switch ( object->m_Type )
+				{
+				case QScript::OT_FUNCTION:
+				{
+					auto function = ( QScript::FunctionObject* ) object;
+
+					if ( function->IsDeferred() )
+						throw Exception( "snapshot_unsupported", "Can not snapshot function \"" + function->GetName() + "\" before it is compiled" );
+
+					for ( auto& constant : function->GetChunk()->m_Constants )
+						pushValue( constant );
+					break;
+				}
+				case QScript::OT_CLOSURE:
+				{
+					auto closure = ( QScript::ClosureObject* ) object;
+					queue.push_back( ( QScript::Object* ) closure->GetFunction() );
+					queue.push_back( closure->GetThis() );
+
+					for ( int i = 0; i < closure->NumUpvalues(); ++i )
+						queue.push_back( closure->GetUpvalues()[ i ] );
+					break;
+				}
+				case QScript::OT_UPVALUE:
+					pushValue( *( ( QScript::UpvalueObject* ) object )->GetValue() );
+					break;
+				case QScript::OT_NATIVE:
+					queue.push_back( ( ( QScript::NativeFunctionObject* ) object )->GetThis() );
+					break;
+				case QScript::OT_TABLE:
+				{
+					for ( auto& prop : ( ( QScript::TableObject* ) object )->GetProperties() )
+						pushValue( prop.second );
+					break;
+				}
+				case QScript::OT_ARRAY:
+				{
+					for ( auto& value : ( ( QScript::ArrayObject* ) object )->GetArray() )
+						pushValue( value );
+					break;
+				}
+				case QScript::OT_CLASS:
+				{
+					auto classObject = ( QScript::ClassObject* ) object;
+
+					for ( auto& value : classObject->GetDefaults() )
+						pushValue( value );
+
+					for ( auto& method : classObject->GetMethods() )
+						queue.push_back( method.second );
+					break;
+				}
+				case QScript::OT_INSTANCE:
+				{
+					auto instance = ( QScript::InstanceObject* ) object;
+
+					for ( int i = 0; i < instance->NumFields(); ++i )
+						pushValue( instance->GetFields()[ i ] );
+					break;
+				}
+				default:
+					break;
+				}
+			}
+		}
+	};
+
+	static std::vector< uint8_t > Serialize( VM_t& vm, QScript::FunctionObject* main )
+	{
+		ObjectGraph graph;
+		graph.AddCompiled( main );
+
+		for ( auto& global : vm.m_Globals )
+			graph.AddHeap( global.second );
+
+		std::unordered_map< QScript::NativeFn, std::string > natives;
+
+		for ( auto& native : vm.m_Natives )
+			natives[ native.second ] = native.first;
+
+		Writer writer( graph.m_Indices, natives );
+
+		Header_t header;
+		std::memset( &header, 0, sizeof( header ) );
+		header.m_Magic = s_Magic;
+		header.m_Version = s_Version;
+		std::strncpy( header.m_Build, BuildStamp(), sizeof( header.m_Build ) - 1 );
+		header.m_ValueSize = sizeof( QScript::Value );
+		header.m_NumObjects = ( uint32_t ) graph.m_Objects.size();
+		header.m_MainFunction = graph.m_Indices.at( main );
+		writer.Write( header );
+
+		// Shells
+		for ( size_t i = 0; i < graph.m_Objects.size(); ++i )
+		{
+			auto object = graph.m_Objects[ i ];
+
+			writer.Write( ( uint8_t ) object->m_Type );
+			writer.Write( ( uint8_t ) graph.m_Owners[ i ] );
+
+			switch ( object->m_Type )
+			{
+			case QScript::OT_STRING:
+				writer.WriteString( ( ( QScript::StringObject* ) object )->GetString() );
+				break;
+			case QScript::OT_FUNCTION:
+			{
+				auto function = ( QScript::FunctionObject* ) object;
+				auto chunk = function->GetChunk();
+
+				writer.WriteString( function->GetName() );
+				writer.Write( ( uint32_t ) function->NumUpvalues() );
+				writer.Write( ( uint8_t ) ( function->GetClosure() ? 1 : 0 ) );
+				writer.Write( ( uint32_t ) function->GetArgs().size() );
+
+				for ( auto& arg : function->GetArgs() )
+				{
+					writer.WriteString( arg.m_Name );
+					writer.Write( arg.m_Type );
+					writer.Write( arg.m_RetType );
+				}
+
+				writer.WriteBytes( chunk->m_Code.data(), chunk->m_Code.size() );
+				writer.Write( ( uint32_t ) chunk->m_Debug.size() );
+
+				for ( auto& debug : chunk->m_Debug )
+				{
+					writer.Write( debug.m_From );
+					writer.Write( debug.m_To );
+					writer.Write( debug.m_Line );
+					writer.Write( debug.m_Column );
+					writer.WriteString( debug.m_Token );
+				}
+				break;
+			}
+			case QScript::OT_NATIVE:
+				writer.WriteNative( ( ( QScript::NativeFunctionObject* ) object )->GetNative() );
+				break;
+			case QScript::OT_TABLE:
+				writer.WriteString( ( ( QScript::TableObject* ) object )->GetName() );
+				break;
+			case QScript::OT_ARRAY:
+				writer.WriteString( ( ( QScript::ArrayObject* ) object )->GetName() );
+				break;
+			case QScript::OT_FLOAT64_ARRAY:
+			{
+				auto arrayObj = ( QScript::Float64ArrayObject* ) object;
+				writer.WriteString( arrayObj->GetName() );
+				writer.WriteBytes( arrayObj->GetArray().data(), arrayObj->GetArray().size() * sizeof( double ) );
+				break;
+			}
+			case QScript::OT_CLOSURE:
+				// Functions always precede their closures, see ObjectGraph
+				writer.WriteObject( ( QScript::Object* ) ( ( QScript::ClosureObject* ) object )->GetFunction() );
+				break;
+			case QScript::OT_UPVALUE:
+				break;
+			case QScript::OT_CLASS:
+			{
+				auto classObject = ( QScript::ClassObject* ) object;
+				writer.WriteString( classObject->GetName() );
+				writer.Write( ( uint32_t ) classObject->NumFields() );
+
+				for ( int f = 0; f < classObject->NumFields(); ++f )
+				{
+					writer.WriteString( classObject->GetFieldNames()[ f ] );
+					writer.Write( ( uint8_t ) ( classObject->IsNumberField( f ) ? 1 : 0 ) );
+				}
+				break;
+			}
+			case QScript::OT_INSTANCE:
+			{
+				// Classes always precede their instances, see ObjectGraph
+				auto instance = ( QScript::InstanceObject* ) object;
+				writer.WriteObject( instance->GetClass() );
+				writer.Write( ( uint32_t ) instance->NumFields() );
+				break;
+			}
+			default:
+				throw Exception( "snapshot_unsupported", "Can not snapshot object of type " + std::to_string( object->m_Type ) );
+			}
+		}
+
+		// Links
+		for ( auto object : graph.m_Objects )
+		{
+			switch ( object->m_Type )
+			{
+			case QScript::OT_FUNCTION:
+			{
+				auto& constants = ( ( QScript::FunctionObject* ) object )->GetChunk()->m_Constants;
+				writer.Write( ( uint32_t ) constants.size() );
+
+				for ( auto& constant : constants )
+					writer.WriteValue( constant );
+				break;
+			}
+			case QScript::OT_CLOSURE:
+			{
+				auto closure = ( QScript::ClosureObject* ) object;
+				writer.WriteObject( closure->GetThis() );
+				writer.Write( ( uint32_t ) closure->NumUpvalues() );
+
+				for ( int i = 0; i < closure->NumUpvalues(); ++i )
+					writer.WriteObject( closure->GetUpvalues()[ i ] );
+				break;
+			}
+			case QScript::OT_UPVALUE:
+			{
+				auto upvalue = ( QScript::UpvalueObject* ) object;
+
+				// Only closed upvalues can be captured, once main returns every upvalue is closed
+				if ( upvalue->GetValue() >= vm.m_Stack && upvalue->GetValue() < vm.m_Stack + vm.m_StackCapacity )
+					throw Exception( "snapshot_unsupported", "Can not snapshot an open upvalue" );
+
+				writer.WriteValue( *upvalue->GetValue() );
+				break;
+			}
+			case QScript::OT_NATIVE:
+				writer.WriteObject( ( ( QScript::NativeFunctionObject* ) object )->GetThis() );
+				break;
+			case QScript::OT_TABLE:
+			{
+				auto& props = ( ( QScript::TableObject* ) object )->GetProperties();
+				writer.Write( ( uint32_t ) props.size() );
+
+				for ( auto& prop : props )
+				{
+					writer.WriteString( prop.first );
+					writer.WriteValue( prop.second );
+				}
+				break;
+			}
+			case QScript::OT_ARRAY:
+			{
+				auto& arrayRef = ( ( QScript::ArrayObject* ) object )->GetArray();
+				writer.Write( ( uint32_t ) arrayRef.size() );
+
+				for ( auto& value : arrayRef )
+					writer.WriteValue( value );
+				break;
+			}
+			case QScript::OT_CLASS:
+			{
+				auto classObject = ( QScript::ClassObject* ) object;
+
+				for ( auto& value : classObject->GetDefaults() )
+					writer.WriteValue( value );
+
+				writer.Write( ( uint32_t ) classObject->GetMethods().size() );
+
+				for ( auto& method : classObject->GetMethods() )
+				{
+					writer.WriteString( method.first );
+					writer.WriteObject( method.second );
+				}
+				break;
+			}
+			case QScript::OT_INSTANCE:
+			{
+				auto instance = ( QScript::InstanceObject* ) object;
+
+				for ( int i = 0; i < instance->NumFields(); ++i )
+					writer.WriteValue( instance->GetFields()[ i ] );
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		writer.Write( ( uint32_t ) vm.m_Globals.size() );
+		for ( auto& global : vm.m_Globals )
+		{
+			writer.WriteString( global.first );
+			writer.WriteValue( global.second );
+		}
+
+		writer.Write( ( uint32_t ) vm.m_ArrayMethods.size() );
+		for ( auto& method : vm.m_ArrayMethods )
+			writer.WriteString( method.first );
+
+		return writer.m_Data;
+	}
+
+	static VM_t* Deserialize( const std::vector< uint8_t >& snapshot )
+	{
+		std::vector< QScript::Object* > objects;
+		std::vector< Ownership > owners;
+		std::vector< std::pair< QScript::NativeFunctionObject*, std::string > > natives;
+
+		Reader reader( snapshot, objects );
+
+		auto header = reader.Read< Header_t >();
+
+		if ( header.m_Magic != s_Magic || header.m_Version != s_Version )
+			reader.Fail( "Not a snapshot, or an unsupported version" );
+
+		if ( std::strncmp( header.m_Build, BuildStamp(), sizeof( header.m_Build ) - 1 ) != 0 || header.m_ValueSize != sizeof( QScript::Value ) )
+			reader.Fail( "Snapshot was created by a different build" );
+
+		if ( header.m_MainFunction >= header.m_NumObjects )
+			reader.Fail( "Main function index out of range" );
+
+		auto release = [ &objects, &owners ]() {
+			// Free compiled objects one by one, their constants are in the object list as well
+			for ( size_t i = 0; i < objects.size(); ++i )
+			{
+				// Shared closures are released with their function
+				if ( objects[ i ]->m_Type == QScript::OT_CLOSURE && owners[ i ] == OWNER_COMPILED )
+					continue;
+
+				if ( objects[ i ]->m_Type == QScript::OT_FUNCTION )
+					delete ( ( QScript::FunctionObject* ) objects[ i ] )->GetChunk();
+
+				delete objects[ i ];
+			}
+		};
+
+		try
+		{
+			objects.reserve( header.m_NumObjects );
+
+			// Pass 1, create every object
+			for ( uint32_t i = 0; i < header.m_NumObjects; ++i )
+			{
+				auto type = reader.Read< uint8_t >();
+				auto owner = ( Ownership ) reader.Read< uint8_t >();
+
+				// Track objects as soon as they exist, so a failed read can release them
+				auto adopt = [ &objects, &owners, owner ]( QScript::Object* object ) {
+					objects.push_back( object );
+					owners.push_back( owner );
+				};
+
+				switch ( type )
+				{
+				case QScript::OT_STRING:
+					adopt( QS_NEW QScript::StringObject( reader.ReadString() ) );
+					break;
+				case QScript::OT_FUNCTION:
+				{
+					auto chunk = QScript::AllocChunk();
+					auto function = QS_NEW QScript::FunctionObject( reader.ReadString(), chunk );
+					adopt( function );
+
+					auto numUpvalues = reader.Read< uint32_t >();
+					for ( uint32_t u = 0; u < numUpvalues; ++u )
+						function->SetUpvalues( 0 );
+
+					if ( reader.Read< uint8_t >() != 0 )
+						function->ShareClosure();
+
+					auto numArgs = reader.Read< uint32_t >();
+					for ( uint32_t a = 0; a < numArgs; ++a )
+					{
+						auto name = reader.ReadString();
+						auto argType = reader.Read< uint32_t >();
+						auto retType = reader.Read< uint32_t >();
+						function->AddArgument( name, argType, retType );
+					}
+
+					reader.ReadArray< uint8_t >( &chunk->m_Code );
+
+					auto numDebug = reader.Read< uint32_t >();
+					chunk->m_Debug.resize( numDebug );
+
+					for ( auto& debug : chunk->m_Debug )
+					{
+						debug.m_From = reader.Read< uint32_t >();
+						debug.m_To = reader.Read< uint32_t >();
+						debug.m_Line = reader.Read< int >();
+						debug.m_Column = reader.Read< int >();
+						debug.m_Token = reader.ReadString();
+					}
+					break;
+				}
+				case QScript::OT_NATIVE:
+				{
+					// Resolved once the modules are imported
+					auto native = QS_NEW QScript::NativeFunctionObject( NULL );
+					adopt( native );
+					natives.push_back( std::make_pair( native, reader.ReadString() ) );
+					break;
+				}
+				case QScript::OT_TABLE:
+					adopt( QS_NEW QScript::TableObject( reader.ReadString() ) );
+					break;
+				case QScript::OT_ARRAY:
+					adopt( QS_NEW QScript::ArrayObject( reader.ReadString() ) );
+					break;
+				case QScript::OT_FLOAT64_ARRAY:
+				{
+					auto arrayObj = QS_NEW QScript::Float64ArrayObject( reader.ReadString() );
+					adopt( arrayObj );
+					reader.ReadArray< double >( &arrayObj->GetArray() );
+					break;
+				}
+				case QScript::OT_CLOSURE:
+				{
+					auto function = reader.ReadObject();
+
+					if ( !function || function->m_Type != QScript::OT_FUNCTION )
+						reader.Fail( "Closure without a function" );
+
+					if ( owner == OWNER_COMPILED )
+					{
+						auto shared = ( ( QScript::FunctionObject* ) function )->GetClosure();
+
+						if ( !shared )
+							reader.Fail( "Shared closure of a function that doesn't share one" );
+
+						adopt( shared );
+						break;
+					}
+
+					adopt( QScript::ClosureObject::Create( ( QScript::FunctionObject* ) function ) );
+					break;
+				}
+				case QScript::OT_CLASS:
+				{
+					auto classObject = QS_NEW QScript::ClassObject( reader.ReadString() );
+					adopt( classObject );
+
+					// Defaults are filled in with the links
+					auto numFields = reader.Read< uint32_t >();
+					for ( uint32_t f = 0; f < numFields; ++f )
+					{
+						auto fieldName = reader.ReadString();
+						bool isNumber = reader.Read< uint8_t >() != 0;
+
+						classObject->AddField( fieldName, isNumber ? MAKE_NUMBER( 0 ) : MAKE_NULL, isNumber );
+					}
+
+					if ( classObject->NumFields() != ( int ) numFields )
+						reader.Fail( "Class with duplicate fields" );
+					break;
+				}
+				case QScript::OT_INSTANCE:
+				{
+					auto classObject = reader.ReadObject();
+
+					if ( !classObject || classObject->m_Type != QScript::OT_CLASS )
+						reader.Fail( "Instance without a class" );
+
+					if ( reader.Read< uint32_t >() != ( uint32_t ) ( ( QScript::ClassObject* ) classObject )->NumFields() )
+						reader.Fail( "Instance fields don't match its class" );
+
+					adopt( QScript::InstanceObject::Create( ( QScript::ClassObject* ) classObject ) );
+					break;
+				}
+				case QScript::OT_UPVALUE:
+				{
+					QScript::Value unused = MAKE_NULL;
+					auto upvalue = QS_NEW QScript::UpvalueObject( &unused );
+					upvalue->Close();
+					adopt( upvalue );
+					break;
+				}
+				default:
+					reader.Fail( "Unknown object type " + std::to_string( type ) );
+				}
+
+			}
+
+			// Pass 2, link objects together
+			for ( auto object : objects )
+			{
+				switch ( object->m_Type )
+				{
+				case QScript::OT_FUNCTION:
+				{
+					auto& constants = ( ( QScript::FunctionObject* ) object )->GetChunk()->m_Constants;
+					constants.resize( reader.Read< uint32_t >() );
+
+					for ( auto& constant : constants )
+						constant = reader.ReadValue();
+					break;
+				}
+				case QScript::OT_CLOSURE:
+				{
+					auto closure = ( QScript::ClosureObject* ) object;
+					closure->Bind( reader.ReadObject() );
+
+					if ( reader.Read< uint32_t >() != ( uint32_t ) closure->NumUpvalues() )
+						reader.Fail( "Closure upvalues don't match its function" );
+
+					for ( int i = 0; i < closure->NumUpvalues(); ++i )
+						closure->GetUpvalues()[ i ] = ( QScript::UpvalueObject* ) reader.ReadObject();
+					break;
+				}
+				case QScript::OT_UPVALUE:
+					*( ( QScript::UpvalueObject* ) object )->GetValue() = reader.ReadValue();
+					break;
+				case QScript::OT_NATIVE:
+					( ( QScript::NativeFunctionObject* ) object )->SetThis( reader.ReadObject() );
+					break;
+				case QScript::OT_TABLE:
+				{
+					auto& props = ( ( QScript::TableObject* ) object )->GetProperties();
+					auto numProps = reader.Read< uint32_t >();
+
+					for ( uint32_t p = 0; p < numProps; ++p )
+					{
+						auto name = reader.ReadString();
+						props[ name ] = reader.ReadValue();
+					}
+					break;
+				}
+				case QScript::OT_ARRAY:
+				{
+					auto& arrayRef = ( ( QScript::ArrayObject* ) object )->GetArray();
+					arrayRef.resize( reader.Read< uint32_t >() );
+
+					for ( auto& value : arrayRef )
+						value = reader.ReadValue();
+					break;
+				}
+				case QScript::OT_CLASS:
+				{
+					auto classObject = ( QScript::ClassObject* ) object;
+
+					for ( int f = 0; f < classObject->NumFields(); ++f )
+					{
+						auto value = reader.ReadValue();
+
+						if ( classObject->IsNumberField( f ) && !IS_NUMBER( value ) )
+							reader.Fail( "Number field holds a non-number" );
+
+						classObject->GetDefaults()[ f ] = value;
+					}
+
+					auto numMethods = reader.Read< uint32_t >();
+					for ( uint32_t m = 0; m < numMethods; ++m )
+					{
+						auto name = reader.ReadString();
+						auto method = reader.ReadObject();
+
+						if ( !method || method->m_Type != QScript::OT_CLOSURE )
+							reader.Fail( "Class method is not a closure" );
+
+						classObject->GetMethods()[ name ] = ( QScript::ClosureObject* ) method;
+					}
+					break;
+				}
+				case QScript::OT_INSTANCE:
+				{
+					auto instance = ( QScript::InstanceObject* ) object;
+
+					for ( int i = 0; i < instance->NumFields(); ++i )
+					{
+						auto value = reader.ReadValue();
+
+						if ( instance->GetClass()->IsNumberField( i ) && !IS_NUMBER( value ) )
+							reader.Fail( "Number field holds a non-number" );
+
+						instance->GetFields()[ i ] = value;
+					}
+					break;
+				}
+				default:
+					break;
+				}
+			}
+
+			auto main = objects[ header.m_MainFunction ];
+
+			if ( main->m_Type != QScript::OT_FUNCTION )
+				reader.Fail( "Main function index does not point to a function" );
+
+			auto vm = QS_NEW VM_t( ( QScript::FunctionObject* ) main );
+
+			try
+			{
+				// Import every module, so natives resolve no matter which ones the script imported
+				vm->m_EnableGC = false;
+
+				for ( auto module : QScript::GetModules() )
+					module->Import( vm );
+
+				vm->m_EnableGC = true;
+				vm->m_Globals.clear();
+
+				for ( auto& native : natives )
+				{
+					auto registered = vm->m_Natives.find( native.second );
+
+					if ( registered == vm->m_Natives.end() )
+						reader.Fail( "Unknown native function \"" + native.second + "\"" );
+
+					native.first->SetNative( registered->second );
+				}
+
+				auto numGlobals = reader.Read< uint32_t >();
+				for ( uint32_t i = 0; i < numGlobals; ++i )
+				{
+					auto name = reader.ReadString();
+					vm->m_Globals[ name ] = reader.ReadValue();
+				}
+
+				auto numMethods = reader.Read< uint32_t >();
+				for ( uint32_t i = 0; i < numMethods; ++i )
+				{
+					auto name = reader.ReadString();
+
+					if ( vm->m_ArrayMethods.find( name ) == vm->m_ArrayMethods.end() )
+						reader.Fail( "Unknown array method \"" + name + "\"" );
+				}
+			}
+			catch ( ... )
+			{
+				vm->Release();
+				delete vm;
+				throw;
+			}
+
+			// Hand heap objects over to the VM, compiled objects stay reachable through main
+			for ( size_t i = 0; i < objects.size(); ++i )
+			{
+				if ( owners[ i ] == OWNER_HEAP )
+					vm->m_Objects.push_back( objects[ i ] );
+			}
+
+			vm->m_ObjectsToNextGC = std::max( 32, ( int ) vm->m_Objects.size() * 2 );
+			return vm;
+		}
+		catch ( ... )
+		{
+			release();
+			throw;
+		}
+	}
+}
+
+std::vector< uint8_t > QScript::CreateSnapshot( const QScript::FunctionObject& function )
+{
+	VM_t vm( &function );
+
+	try
+	{
+		QScript::Interpret( vm, NULL );
+	}
+	catch ( ... )
+	{
+		vm.Release();
+		throw;
+	}
+
+	std::vector< uint8_t > snapshot;
+
+	try
+	{
+		snapshot = Snapshot::Serialize( vm, ( QScript::FunctionObject* ) &function );
+	}
+	catch ( ... )
+	{
+		vm.Release();
+		throw;
+	}
+
+	vm.Release();
+	return snapshot;
+}
+
+VM_t* QScript::LoadSnapshot( const std::vector< uint8_t >& snapshot )
+{
+	return Snapshot::Deserialize( snapshot );
+}
+
+void QScript::FreeSnapshot( VM_t* vm )
+{
+	auto main = ( QScript::FunctionObject* ) vm->m_Main->GetFunction();
+
+	vm->Release();
+	delete vm;
+
+	QScript::FreeFunction( main );
+}
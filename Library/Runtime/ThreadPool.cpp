@@ -0,0 +1,107 @@
+#include "QLibPCH.h"
+#include "ThreadPool.h"
+
+ThreadPool& ThreadPool::Instance()
+{
+	static ThreadPool pool( std::max( 1u, std::thread::hardware_concurrency() ) - 1 );
+	return pool;
+}
+
+ThreadPool::ThreadPool( size_t numWorkers )
+	: m_Stop( false )
+{
+	for ( size_t i = 0; i < numWorkers; ++i )
+		m_Threads.emplace_back( &ThreadPool::WorkerLoop, this );
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock< std::mutex > lock( m_Mutex );
+		m_Stop = true;
+	}
+
+	m_TaskReady.notify_all();
+
+	for ( auto& thread : m_Threads )
+		thread.join();
+}
+
+void ThreadPool::ParallelFor( size_t count, const std::function< void( size_t ) >& fn )
+{
+	if ( count == 0 )
+		return;
+
+	size_t remaining = count;
+	std::exception_ptr error = NULL;
+
+	std::unique_lock< std::mutex > lock( m_Mutex );
+
+	for ( size_t i = 0; i < count; ++i )
+	{
+		m_Tasks.emplace_back( [ this, i, &fn, &remaining, &error ]() {
+			std::exception_ptr taskError = NULL;
+
+			try
+			{
+				fn( i );
+			}
+			catch ( ... )
+			{
+				taskError = std::current_exception();
+			}
+
+			std::unique_lock< std::mutex > lock( m_Mutex );
+
+			if ( taskError && !error )
+				error = taskError;
+
+			if ( --remaining == 0 )
+				m_TaskDone.notify_all();
+		} );
+	}
+
+	m_TaskReady.notify_all();
+
+	// Help out until the queue is drained, then wait for tasks still running elsewhere
+	while ( remaining > 0 )
+	{
+		if ( !RunNextTask( lock ) )
+			m_TaskDone.wait( lock );
+	}
+
+	lock.unlock();
+
+	if ( error )
+		std::rethrow_exception( error );
+}
+
+bool ThreadPool::RunNextTask( std::unique_lock< std::mutex >& lock )
+{
+	if ( m_Tasks.empty() )
+		return false;
+
+	auto task = std::move( m_Tasks.front() );
+	m_Tasks.pop_front();
+
+	lock.unlock();
+	task();
+	lock.lock();
+
+	return true;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	std::unique_lock< std::mutex > lock( m_Mutex );
+
+	for ( ;; )
+	{
+		m_TaskReady.wait( lock, [ this ]() { return m_Stop || !m_Tasks.empty(); } );
+
+		if ( m_Stop )
+			return;
+
+		RunNextTask( lock );
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Fixed set of worker threads, one per hardware thread (the caller counts as one)
+class ThreadPool
+{
+public:
+	static ThreadPool& Instance();
+
+	~ThreadPool();
+
+	// Run fn( index ) for every index in [0, count) and wait until all of them are done.
+	// The calling thread works on the batch as well. The first exception thrown by fn is
+	// rethrown here, once the whole batch has finished.
+	void ParallelFor( size_t count, const std::function< void( size_t ) >& fn );
+
+	FORCEINLINE size_t NumThreads() const { return m_Threads.size() + 1; }
+
+private:
+	ThreadPool( size_t numWorkers );
+
+	bool RunNextTask( std::unique_lock< std::mutex >& lock );
+	void WorkerLoop();
+
+	std::vector< std::thread >					m_Threads;
+	std::deque< std::function< void() > >		m_Tasks;
+	std::mutex									m_Mutex;
+	std::condition_variable						m_TaskReady;
+	std::condition_variable						m_TaskDone;
+	bool										m_Stop;
+};
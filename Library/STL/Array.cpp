@@ -1,15 +1,123 @@
 #include "QLibPCH.h"
 #include "Array.h"
+#include "ArrayKernels.h"
+#include "Instructions.h"
+#include "../Common/Chunk.h"
 #include "../Common/Object.h"
+#include "../Common/Disassembler.h"
 #include "../Runtime/QVM.h"
+#include "../Runtime/ThreadPool.h"
 
 namespace ArrayModule
 {
+	// Contiguous view over the numbers of an array. Packed arrays are used in place, and so are
+	// all-number arrays when values are NaN-boxed. Otherwise the numbers are copied out, and
+	// Commit() writes them back after an in-place kernel.
+	class NumericView
+	{
+	public:
+		NumericView( const QScript::Value& arr )
+			: m_Data( NULL ), m_Size( 0 ), m_IsNumeric( true ), m_Source( NULL )
+		{
+			if ( IS_FLOAT64_ARRAY( arr ) )
+			{
+				auto& arrayRef = AS_FLOAT64_ARRAY( arr )->GetArray();
+				m_Data = arrayRef.data();
+				m_Size = arrayRef.size();
+				return;
+			}
+
+			auto& arrayRef = AS_ARRAY( arr )->GetArray();
+			m_Size = arrayRef.size();
+
+			for ( auto& value : arrayRef )
+			{
+				if ( !IS_NUMBER( value ) )
+				{
+					m_IsNumeric = false;
+					return;
+				}
+			}
+
+#ifdef QS_NAN_BOXING
+			static_assert( sizeof( QScript::Value ) == sizeof( double ), "NaN-boxed values must be plain doubles" );
+
+			if ( m_Size > 0 )
+				m_Data = &arrayRef[ 0 ].m_Data.m_Number;
+#else
+			m_Source = AS_ARRAY( arr );
+			m_Scratch.reserve( m_Size );
+
+			for ( auto& value : arrayRef )
+				m_Scratch.push_back( AS_NUMBER( value ) );
+
+			m_Data = m_Scratch.data();
+#endif
+		}
+
+		FORCEINLINE double* Data()						{ return m_Data; }
+		FORCEINLINE size_t Size()				const	{ return m_Size; }
+		FORCEINLINE bool IsNumeric()			const	{ return m_IsNumeric; }
+
+		void Commit()
+		{
+			if ( !m_Source )
+				return;
+
+			auto& arrayRef = m_Source->GetArray();
+			for ( size_t i = 0; i < m_Size; ++i )
+				arrayRef[ i ] = MAKE_NUMBER( m_Scratch[ i ] );
+		}
+
+	private:
+		double*						m_Data;
+		size_t						m_Size;
+		bool						m_IsNumeric;
+		QScript::ArrayObject*		m_Source;
+		std::vector< double >		m_Scratch;
+	};
+
+	static void ExpectNumeric( const NumericView& view, const QScript::Value& arr )
+	{
+		if ( !view.IsNumeric() )
+		{
+			throw RuntimeException( "rt_native_expected",
+				"Expected array of numbers, got \"" + arr.ToString() + "\"", 0, 0, "" );
+		}
+	}
+
+	static void ExpectArgs( int argCount, int expected )
+	{
+		if ( argCount != expected + 1 )
+		{
+			throw RuntimeException( "rt_native_argcount",
+				"Expected " + std::to_string( expected ) + " arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
+		}
+	}
+
+	static void ExpectArray( const QScript::Value& arr )
+	{
+		if ( !IS_ARRAY( arr ) && !IS_FLOAT64_ARRAY( arr ) )
+		{
+			throw RuntimeException( "rt_native_expected",
+				"Expected array object, got \"" + arr.ToString() + "\"", 0, 0, "" );
+		}
+	}
+
+	static void ExpectNumber( const QScript::Value& value )
+	{
+		if ( !IS_NUMBER( value ) )
+		{
+			throw RuntimeException( "rt_native_expected",
+				"Expected number, got \"" + value.ToString() + "\"", 0, 0, "" );
+		}
+	}
+
 	QScript::Value ArrayPush( void* frame, const QScript::Value* args, int argCount )
 	{
 		auto arr = args[ 0 ];
 
-		if ( !IS_ARRAY( arr ) )
+		if ( !IS_ARRAY( arr ) && !IS_FLOAT64_ARRAY( arr ) )
 		{
 			throw RuntimeException( "rt_native_expected",
 				"Expected array object, got \"" + arr.ToString() + "\"", 0, 0, "" );
@@ -21,6 +129,24 @@ namespace ArrayModule
 				"Expected >= 1 arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
 		}
 		
+		if ( IS_FLOAT64_ARRAY( arr ) )
+		{
+			auto& arrayRef = AS_FLOAT64_ARRAY( arr )->GetArray();
+
+			for ( int i = 1; i < argCount; ++i )
+			{
+				if ( !IS_NUMBER( args[ i ] ) )
+				{
+					throw RuntimeException( "rt_native_expected",
+						"Expected number, got \"" + args[ i ].ToString() + "\"", 0, 0, "" );
+				}
+
+				arrayRef.push_back( AS_NUMBER( args[ i ] ) );
+			}
+
+			return MAKE_NUMBER( arrayRef.size() - 1 );
+		}
+
 		auto& arrayRef = AS_ARRAY( arr )->GetArray();
 
 		for ( int i = 1; i < argCount; ++i )
@@ -33,7 +159,7 @@ namespace ArrayModule
 	{
 		auto arr = args[ 0 ];
 
-		if ( !IS_ARRAY( arr ) )
+		if ( !IS_ARRAY( arr ) && !IS_FLOAT64_ARRAY( arr ) )
 		{
 			throw RuntimeException( "rt_native_expected",
 				"Expected array object, got \"" + arr.ToString() + "\"", 0, 0, "" );
@@ -45,13 +171,15 @@ namespace ArrayModule
 				"Expected >= 1 arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
 		}
 
-		auto newArray = MAKE_ARRAY( "" );
-		auto& newArrayRef = AS_ARRAY( newArray )->GetArray();
-		auto& thisArrayRef = AS_ARRAY( arr )->GetArray();
-
-		size_t totalSize = thisArrayRef.size();
-		for ( int i = 1; i < argCount; ++i )
+		size_t totalSize = 0;
+		for ( int i = 0; i < argCount; ++i )
 		{
+			if ( IS_FLOAT64_ARRAY( args[ i ] ) )
+			{
+				totalSize += AS_FLOAT64_ARRAY( args[ i ] )->GetArray().size();
+				continue;
+			}
+
 			if ( !IS_ARRAY( args[ i ] ) )
 			{
 				throw RuntimeException( "rt_native_expected",
@@ -61,11 +189,53 @@ namespace ArrayModule
 			totalSize += AS_ARRAY( args[ i ] )->GetArray().size();
 		}
 
+		if ( IS_FLOAT64_ARRAY( arr ) )
+		{
+			// Packed arrays stay packed, so every appended element must be a number
+			auto newArray = MAKE_FLOAT64_ARRAY( "" );
+			auto& newArrayRef = AS_FLOAT64_ARRAY( newArray )->GetArray();
+
+			newArrayRef.reserve( totalSize );
+
+			for ( int i = 0; i < argCount; ++i )
+			{
+				if ( IS_FLOAT64_ARRAY( args[ i ] ) )
+				{
+					auto& otherArrayRef = AS_FLOAT64_ARRAY( args[ i ] )->GetArray();
+					newArrayRef.insert( newArrayRef.end(), otherArrayRef.begin(), otherArrayRef.end() );
+					continue;
+				}
+
+				for ( auto value : AS_ARRAY( args[ i ] )->GetArray() )
+				{
+					if ( !IS_NUMBER( value ) )
+					{
+						throw RuntimeException( "rt_native_expected",
+							"Expected number, got \"" + value.ToString() + "\"", 0, 0, "" );
+					}
+
+					newArrayRef.push_back( AS_NUMBER( value ) );
+				}
+			}
+
+			return newArray;
+		}
+
+		auto newArray = MAKE_ARRAY( "" );
+		auto& newArrayRef = AS_ARRAY( newArray )->GetArray();
+
 		newArrayRef.reserve( totalSize );
-		newArrayRef.insert( newArrayRef.end(), thisArrayRef.begin(), thisArrayRef.end() );
 
-		for ( int i = 1; i < argCount; ++i )
+		for ( int i = 0; i < argCount; ++i )
 		{
+			if ( IS_FLOAT64_ARRAY( args[ i ] ) )
+			{
+				for ( auto value : AS_FLOAT64_ARRAY( args[ i ] )->GetArray() )
+					newArrayRef.push_back( MAKE_NUMBER( value ) );
+
+				continue;
+			}
+
 			auto& otherArrayRef = AS_ARRAY( args[ i ] )->GetArray();
 			newArrayRef.insert( newArrayRef.end(), otherArrayRef.begin(), otherArrayRef.end() );
 		}
@@ -77,7 +247,7 @@ namespace ArrayModule
 	{
 		auto arr = args[ 0 ];
 
-		if ( !IS_ARRAY( arr ) )
+		if ( !IS_ARRAY( arr ) && !IS_FLOAT64_ARRAY( arr ) )
 		{
 			throw RuntimeException( "rt_native_expected",
 				"Expected array object, got \"" + arr.ToString() + "\"", 0, 0, "" );
@@ -89,6 +259,9 @@ namespace ArrayModule
 				"Expected 0 arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
 		}
 
+		if ( IS_FLOAT64_ARRAY( arr ) )
+			return MAKE_NUMBER( ( int ) AS_FLOAT64_ARRAY( arr )->GetArray().size() );
+
 		return MAKE_NUMBER( ( int ) AS_ARRAY( arr )->GetArray().size() );
 	}
 
@@ -96,7 +269,7 @@ namespace ArrayModule
 	{
 		auto arr = args[ 0 ];
 
-		if ( !IS_ARRAY( arr ) )
+		if ( !IS_ARRAY( arr ) && !IS_FLOAT64_ARRAY( arr ) )
 		{
 			throw RuntimeException( "rt_native_expected",
 				"Expected array object, got \"" + arr.ToString() + "\"", 0, 0, "" );
@@ -108,88 +281,631 @@ namespace ArrayModule
 				"Expected 0 arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
 		}
 
+		if ( IS_FLOAT64_ARRAY( arr ) )
+		{
+			auto& arrayRef = AS_FLOAT64_ARRAY( arr )->GetArray();
+
+			if ( arrayRef.empty() )
+				return MAKE_NULL;
+
+			auto returnValue = arrayRef.back();
+
+			arrayRef.pop_back();
+			return MAKE_NUMBER( returnValue );
+		}
+
 		auto& arrayRef = AS_ARRAY( arr )->GetArray();
+
+		if ( arrayRef.empty() )
+			return MAKE_NULL;
+
 		auto returnValue = arrayRef.back();
-		
+
 		arrayRef.pop_back();
 		return returnValue;
 	}
 
+	static size_t ElementCount( const QScript::Value& arr )
+	{
+		return IS_FLOAT64_ARRAY( arr ) ? AS_FLOAT64_ARRAY( arr )->GetArray().size() : AS_ARRAY( arr )->GetArray().size();
+	}
+
+	static QScript::Value ElementAt( const QScript::Value& arr, size_t index )
+	{
+		return IS_FLOAT64_ARRAY( arr ) ? MAKE_NUMBER( AS_FLOAT64_ARRAY( arr )->GetArray()[ index ] ) : AS_ARRAY( arr )->GetArray()[ index ];
+	}
+
+	// Feeds the elements of an array to a callback one at a time. onResult( index, value )
+	// receives every return value, and stops the iteration by returning false.
+	template< typename ResultFn >
+	class ElementStub : public CallStub_t
+	{
+	public:
+		ElementStub( const QScript::Value& arr, ResultFn& onResult )
+			: m_Array( arr ), m_Index( 0 ), m_OnResult( onResult )
+		{
+		}
+
+		bool Next( QScript::Value* args ) override
+		{
+			// The callback may resize the array, so check bounds on every call
+			if ( m_Index >= ElementCount( m_Array ) )
+				return false;
+
+			args[ 0 ] = ElementAt( m_Array, m_Index );
+			return true;
+		}
+
+		bool Result( const QScript::Value& value ) override
+		{
+			return m_OnResult( m_Index++, value );
+		}
+
+	private:
+		QScript::Value				m_Array;
+		size_t						m_Index;
+		ResultFn&					m_OnResult;
+	};
+
+	template< typename ResultFn >
+	static void ForEachElement( void* frame, const QScript::Value& arr, const QScript::Value& callback, ResultFn onResult )
+	{
+		ElementStub< ResultFn > stub( arr, onResult );
+		QVM::VirtualMachine->CallStub( ( Frame_t* ) frame, 1, callback, &stub );
+	}
+
+	template< typename T >
+	static void Compact( std::vector< T >& arrayRef, const std::vector< bool >& keep )
+	{
+		size_t count = 0;
+
+		for ( size_t i = 0; i < arrayRef.size() && i < keep.size(); ++i )
+		{
+			if ( keep[ i ] )
+				arrayRef[ count++ ] = arrayRef[ i ];
+		}
+
+		arrayRef.resize( count );
+	}
+
 	QScript::Value ArrayFilter( void* frame, const QScript::Value* args, int argCount )
 	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		// Arguments live on the stack, which may move while the callback runs
+		auto arr = args[ 0 ];
+		std::vector< bool > keep;
+
+		ForEachElement( frame, arr, args[ 1 ], [ &keep ]( size_t, const QScript::Value& value ) {
+			keep.push_back( value.IsTruthy() );
+			return true;
+		} );
+
+		if ( IS_FLOAT64_ARRAY( arr ) )
+			Compact( AS_FLOAT64_ARRAY( arr )->GetArray(), keep );
+		else
+			Compact( AS_ARRAY( arr )->GetArray(), keep );
+
+		return arr;
+	}
+
+	QScript::Value ArrayFind( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
 		auto arr = args[ 0 ];
+		QScript::Value found = MAKE_NULL;
+
+		ForEachElement( frame, arr, args[ 1 ], [ &arr, &found ]( size_t index, const QScript::Value& value ) {
+			if ( !value.IsTruthy() )
+				return true;
 
-		if ( !IS_ARRAY( arr ) )
+			found = ElementAt( arr, index );
+			return false;
+		} );
+
+		return found;
+	}
+
+	QScript::Value ArrayMap( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		auto arr = args[ 0 ];
+		auto callback = args[ 1 ];
+
+		// Packed arrays map into packed arrays. Keep the result on the stack so the GC sees it.
+		bool isPacked = IS_FLOAT64_ARRAY( arr );
+		auto newArray = isPacked ? MAKE_FLOAT64_ARRAY( "" ) : MAKE_ARRAY( "" );
+		QVM::VirtualMachine->Push( newArray );
+
+		if ( isPacked )
 		{
-			throw RuntimeException( "rt_native_expected",
-				"Expected array object, got \"" + arr.ToString() + "\"", 0, 0, "" );
+			auto& newArrayRef = AS_FLOAT64_ARRAY( newArray )->GetArray();
+			newArrayRef.reserve( ElementCount( arr ) );
+
+			ForEachElement( frame, arr, callback, [ &newArrayRef ]( size_t, const QScript::Value& value ) {
+				if ( !IS_NUMBER( value ) )
+				{
+					throw RuntimeException( "rt_invalid_array_value",
+						"Float64Array can only hold numbers, got \"" + value.ToString() + "\"", 0, 0, "" );
+				}
+
+				newArrayRef.push_back( AS_NUMBER( value ) );
+				return true;
+			} );
+		}
+		else
+		{
+			auto& newArrayRef = AS_ARRAY( newArray )->GetArray();
+			newArrayRef.reserve( ElementCount( arr ) );
+
+			ForEachElement( frame, arr, callback, [ &newArrayRef ]( size_t, const QScript::Value& value ) {
+				newArrayRef.push_back( value );
+				return true;
+			} );
+		}
+
+		QVM::VirtualMachine->Pop();
+		return newArray;
+	}
+
+	QScript::Value ArrayForEach( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		auto arr = args[ 0 ];
+
+		ForEachElement( frame, arr, args[ 1 ], []( size_t, const QScript::Value& ) {
+			return true;
+		} );
+
+		return arr;
+	}
+
+	QScript::Value ArraySome( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		bool result = false;
+
+		ForEachElement( frame, args[ 0 ], args[ 1 ], [ &result ]( size_t, const QScript::Value& value ) {
+			result = value.IsTruthy();
+			return !result;
+		} );
+
+		return MAKE_BOOL( result );
+	}
+
+	QScript::Value ArrayEvery( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		bool result = true;
+
+		ForEachElement( frame, args[ 0 ], args[ 1 ], [ &result ]( size_t, const QScript::Value& value ) {
+			result = value.IsTruthy();
+			return result;
+		} );
+
+		return MAKE_BOOL( result );
+	}
+
+	// Call stub for reduce, passes ( accumulator, element ) to the callback. The accumulator is
+	// always back in an argument slot before anything can allocate, so the GC keeps it alive.
+	class ReduceStub : public CallStub_t
+	{
+	public:
+		ReduceStub( const QScript::Value& arr, size_t first, const QScript::Value& initial )
+			: m_Array( arr ), m_Index( first ), m_Accumulator( initial )
+		{
+		}
+
+		bool Next( QScript::Value* args ) override
+		{
+			if ( m_Index >= ElementCount( m_Array ) )
+				return false;
+
+			args[ 0 ] = m_Accumulator;
+			args[ 1 ] = ElementAt( m_Array, m_Index );
+			return true;
+		}
+
+		bool Result( const QScript::Value& value ) override
+		{
+			m_Accumulator = value;
+			++m_Index;
+			return true;
 		}
 
-		if ( argCount != 2 )
+		FORCEINLINE const QScript::Value& Accumulator() const { return m_Accumulator; }
+
+	private:
+		QScript::Value				m_Array;
+		size_t						m_Index;
+		QScript::Value				m_Accumulator;
+	};
+
+	QScript::Value ArrayReduce( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+
+		if ( argCount != 2 && argCount != 3 )
 		{
 			throw RuntimeException( "rt_native_argcount",
-				"Expected 1 arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
+				"Expected 1 or 2 arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
 		}
 
-		auto filterFn = args[ 1 ];
-		auto& arrayRef = AS_ARRAY( arr )->GetArray();
+		auto arr = args[ 0 ];
 
-		arrayRef.erase( std::remove_if( arrayRef.begin(), arrayRef.end(), [ &filterFn, frame ]( QScript::Value value ) {
-			QVM::VirtualMachine->Push( filterFn );
-			QVM::VirtualMachine->Push( value );
+		if ( argCount == 3 )
+		{
+			ReduceStub stub( arr, 0, args[ 2 ] );
+			QVM::VirtualMachine->CallStub( ( Frame_t* ) frame, 2, args[ 1 ], &stub );
+			return stub.Accumulator();
+		}
 
-			QVM::VirtualMachine->Call( ( Frame_t* ) frame, 1, filterFn, true );
-			QVM::Run( *QVM::VirtualMachine, false );
+		// Without an initial value, the first element seeds the accumulator
+		if ( ElementCount( arr ) == 0 )
+			return MAKE_NULL;
 
-			return !QVM::VirtualMachine->Pop().IsTruthy();
-		} ), arrayRef.end() );
+		ReduceStub stub( arr, 1, ElementAt( arr, 0 ) );
+		QVM::VirtualMachine->CallStub( ( Frame_t* ) frame, 2, args[ 1 ], &stub );
+		return stub.Accumulator();
+	}
 
-		// filterFn is currently at the top of the stack, but within our call frame,
-		// so it will get cleaned up when we return here
+	// Parallel variants. Callbacks run on the thread pool in worker VMs, one per chunk of
+	// the array. Anything that isn't provably pure falls back to the sequential method.
 
-		return args[ 0 ];
+	// Fewest elements worth handing to a worker
+	static const size_t s_MinParallelChunk = 1024;
+
+	struct SuperinstructionParts_t
+	{
+		uint8_t			m_Parts[ 4 ];
+	};
+
+	#define _ARRAY_SUPERINSTRUCTION_PARTS( arg, name, a, b, c, d ) SuperinstructionParts_t{ \
+		{ QScript::OpCode::a, QScript::OpCode::b, QScript::OpCode::c, QScript::OpCode::d } },
+
+	// Parts of every superinstruction, indexed from OP_SUPERINSTRUCTION_FIRST
+	static const std::vector< SuperinstructionParts_t >& SuperinstructionParts()
+	{
+		static const std::vector< SuperinstructionParts_t > s_Parts = { QS_SUPERINSTRUCTIONS( _ARRAY_SUPERINSTRUCTION_PARTS, _ ) };
+		return s_Parts;
 	}
 
-	QScript::Value ArrayFind( void* frame, const QScript::Value* args, int argCount )
+	// Conservative purity check, a callback may only compute on its arguments, locals and
+	// constants. No upvalues, globals, calls, property access by name, stores or allocation of
+	// tables and arrays.
+	bool IsPureOpCode( uint8_t opCode )
 	{
+		switch ( opCode )
+		{
+		case QScript::OP_ADD: case QScript::OP_SUB: case QScript::OP_MUL: case QScript::OP_DIV:
+		case QScript::OP_MOD: case QScript::OP_POW: case QScript::OP_NEGATE: case QScript::OP_NOT:
+		case QScript::OP_EQUALS: case QScript::OP_NOT_EQUALS:
+		case QScript::OP_GREATERTHAN: case QScript::OP_GREATERTHAN_OR_EQUAL:
+		case QScript::OP_LESSTHAN: case QScript::OP_LESSTHAN_OR_EQUAL:
+		case QScript::OP_JUMP_SHORT: case QScript::OP_JUMP_LONG:
+		case QScript::OP_JUMP_BACK_SHORT: case QScript::OP_JUMP_BACK_LONG:
+		case QScript::OP_JUMP_IF_ZERO_SHORT: case QScript::OP_JUMP_IF_ZERO_LONG:
+		case QScript::OP_LOAD_CONSTANT_SHORT: case QScript::OP_LOAD_CONSTANT_LONG:
+		case QScript::OP_LOAD_LOCAL_SHORT: case QScript::OP_LOAD_LOCAL_LONG:
+		case QScript::OP_SET_LOCAL_SHORT: case QScript::OP_SET_LOCAL_LONG:
+		case QScript::OP_STORE_LOCAL_SHORT: case QScript::OP_STORE_LOCAL_LONG:
+		case QScript::OP_LOAD_NULL: case QScript::OP_LOAD_MINUS_1:
+		case QScript::OP_LOAD_TOP_SHORT: case QScript::OP_LOAD_PROP_STACK:
+		case QScript::OP_POP: case QScript::OP_RETURN: case QScript::OP_NOP:
+			return true;
+		default:
+			break;
+		}
+
+		if ( opCode >= QScript::OP_LOAD_0 && opCode <= QScript::OP_LOAD_5 )
+			return true;
+		if ( opCode >= QScript::OP_LOAD_LOCAL_0 && opCode <= QScript::OP_LOAD_LOCAL_11 )
+			return true;
+		if ( opCode >= QScript::OP_SET_LOCAL_0 && opCode <= QScript::OP_SET_LOCAL_11 )
+			return true;
+		if ( opCode >= QScript::OP_STORE_LOCAL_0 && opCode <= QScript::OP_STORE_LOCAL_11 )
+			return true;
+		if ( opCode >= QScript::OP_JUMP_IF_NOT_LT_SHORT && opCode <= QScript::OP_JUMP_IF_NOT_NE_LOCAL_LOCAL )
+			return true;
+
+		// The superinstruction set can be regenerated, so each one is only as pure as its parts
+		if ( opCode >= QScript::OP_SUPERINSTRUCTION_FIRST && opCode < QScript::OP_OPCODE_COUNT )
+			return IsPureSuperinstruction( SuperinstructionParts()[ opCode - QScript::OP_SUPERINSTRUCTION_FIRST ].m_Parts );
+
+		return false;
+	}
+
+	bool IsPureSuperinstruction( const uint8_t* parts )
+	{
+		for ( int i = 0; i < 4; ++i )
+		{
+			// Parts are never superinstructions themselves
+			if ( parts[ i ] >= QScript::OP_SUPERINSTRUCTION_FIRST || !IsPureOpCode( parts[ i ] ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	static bool IsPureCallback( const QScript::Value& callback )
+	{
+		if ( !IS_CLOSURE( callback ) )
+			return false;
+
+		auto function = AS_CLOSURE( callback )->GetFunction();
+
+		if ( function->NumUpvalues() > 0 )
+			return false;
+
+		// Only the code tells, lazily compiled callbacks are compiled before they are checked
+		if ( function->IsDeferred() )
+			function->CompileDeferred();
+
+		auto& code = function->GetChunk()->m_Code;
+
+		for ( size_t offset = 0; offset < code.size(); offset += Disassembler::InstructionSize( code[ offset ] ) )
+		{
+			if ( !IsPureOpCode( code[ offset ] ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	// Feeds a range of elements to a worker VM. With an accumulator the callback
+	// receives ( accumulator, element ), otherwise just the element.
+	class ChunkStub : public CallStub_t
+	{
+	public:
+		ChunkStub( const QScript::Value& arr, size_t begin, size_t end, bool accumulate )
+			: m_Array( arr ), m_Index( begin ), m_End( end ), m_Accumulate( accumulate )
+		{
+			if ( m_Accumulate )
+				m_Results.push_back( ElementAt( m_Array, m_Index++ ) );
+		}
+
+		bool Next( QScript::Value* args ) override
+		{
+			if ( m_Index >= m_End )
+				return false;
+
+			if ( m_Accumulate )
+				*args++ = m_Results.back();
+
+			args[ 0 ] = ElementAt( m_Array, m_Index );
+			return true;
+		}
+
+		bool Result( const QScript::Value& value ) override
+		{
+			if ( m_Accumulate )
+				m_Results.back() = value;
+			else
+				m_Results.push_back( value );
+
+			++m_Index;
+			return true;
+		}
+
+		FORCEINLINE const std::vector< QScript::Value >& Results() const { return m_Results; }
+
+	private:
+		QScript::Value					m_Array;
+		size_t							m_Index;
+		size_t							m_End;
+		bool							m_Accumulate;
+		std::vector< QScript::Value >	m_Results;
+	};
+
+	// Runs the callback over the whole array in parallel. Owns what the worker VMs allocated
+	// until the results have been merged into the calling VM.
+	class ParallelRun
+	{
+	public:
+		ParallelRun( const QScript::Value& arr, const QScript::Value& callback, bool accumulate )
+		{
+			auto count = ElementCount( arr );
+			auto numChunks = std::min( ThreadPool::Instance().NumThreads() * 2, count / s_MinParallelChunk );
+			auto function = AS_CLOSURE( callback )->GetFunction();
+
+			for ( size_t i = 0; i < numChunks; ++i )
+				m_Stubs.emplace_back( arr, count * i / numChunks, count * ( i + 1 ) / numChunks, accumulate );
+
+			std::vector< std::vector< QScript::Object* > > heaps( numChunks );
+
+			try
+			{
+				ThreadPool::Instance().ParallelFor( numChunks, [ this, function, accumulate, &heaps ]( size_t chunk ) {
+					QVM::RunWorker( function, accumulate ? 2 : 1, &m_Stubs[ chunk ], &heaps[ chunk ] );
+				} );
+			}
+			catch ( ... )
+			{
+				for ( auto& heap : heaps )
+					m_Objects.insert( m_Objects.end(), heap.begin(), heap.end() );
+
+				Free();
+				throw;
+			}
+
+			for ( auto& heap : heaps )
+				m_Objects.insert( m_Objects.end(), heap.begin(), heap.end() );
+
+			std::sort( m_Objects.begin(), m_Objects.end() );
+		}
+
+		~ParallelRun()
+		{
+			Free();
+		}
+
+		FORCEINLINE const std::vector< ChunkStub >& Chunks() const { return m_Stubs; }
+
+		// Move a result into the calling VM. Pure callbacks can only allocate strings, anything
+		// else would be freed along with the worker heap.
+		QScript::Value Adopt( const QScript::Value& value ) const
+		{
+			if ( !IS_OBJECT( value ) || !std::binary_search( m_Objects.begin(), m_Objects.end(), AS_OBJECT( value ) ) )
+				return value;
+
+			if ( !IS_STRING( value ) )
+			{
+				throw RuntimeException( "rt_invalid_parallel_result",
+					"Parallel callback returned an object it allocated: \"" + value.ToString() + "\"", 0, 0, "" );
+			}
+
+			return MAKE_STRING( AS_STRING( value )->GetString() );
+		}
+
+	private:
+		void Free()
+		{
+			for ( auto object : m_Objects )
+				delete object;
+
+			m_Objects.clear();
+		}
+
+		std::vector< ChunkStub >				m_Stubs;
+		std::vector< QScript::Object* >			m_Objects;
+	};
+
+	static bool CanRunParallel( const QScript::Value& arr, const QScript::Value& callback, int numArgs )
+	{
+		return ElementCount( arr ) >= 2 * s_MinParallelChunk && IsPureCallback( callback ) && AS_CLOSURE( callback )->GetFunction()->NumArgs() == numArgs;
+	}
+
+	QScript::Value ArrayParallelMap( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		if ( !CanRunParallel( args[ 0 ], args[ 1 ], 1 ) )
+			return ArrayMap( frame, args, argCount );
+
 		auto arr = args[ 0 ];
+		ParallelRun run( arr, args[ 1 ], false );
 
-		if ( !IS_ARRAY( arr ) )
+		bool isPacked = IS_FLOAT64_ARRAY( arr );
+		auto newArray = isPacked ? MAKE_FLOAT64_ARRAY( "" ) : MAKE_ARRAY( "" );
+
+		if ( isPacked )
 		{
-			throw RuntimeException( "rt_native_expected",
-				"Expected array object, got \"" + arr.ToString() + "\"", 0, 0, "" );
+			auto& newArrayRef = AS_FLOAT64_ARRAY( newArray )->GetArray();
+			newArrayRef.reserve( ElementCount( arr ) );
+
+			for ( auto& chunk : run.Chunks() )
+			{
+				for ( auto& value : chunk.Results() )
+				{
+					if ( !IS_NUMBER( value ) )
+					{
+						throw RuntimeException( "rt_invalid_array_value",
+							"Float64Array can only hold numbers, got \"" + value.ToString() + "\"", 0, 0, "" );
+					}
+
+					newArrayRef.push_back( AS_NUMBER( value ) );
+				}
+			}
+
+			return newArray;
+		}
+
+		// Adopting strings allocates, keep the new array on the stack so the GC sees it
+		QVM::VirtualMachine->Push( newArray );
+
+		auto& newArrayRef = AS_ARRAY( newArray )->GetArray();
+		newArrayRef.reserve( ElementCount( arr ) );
+
+		for ( auto& chunk : run.Chunks() )
+		{
+			for ( auto& value : chunk.Results() )
+				newArrayRef.push_back( run.Adopt( value ) );
 		}
 
-		if ( argCount != 2 )
+		QVM::VirtualMachine->Pop();
+		return newArray;
+	}
+
+	QScript::Value ArrayParallelFilter( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		if ( !CanRunParallel( args[ 0 ], args[ 1 ], 1 ) )
+			return ArrayFilter( frame, args, argCount );
+
+		auto arr = args[ 0 ];
+		ParallelRun run( arr, args[ 1 ], false );
+
+		std::vector< bool > keep;
+		keep.reserve( ElementCount( arr ) );
+
+		for ( auto& chunk : run.Chunks() )
+		{
+			for ( auto& value : chunk.Results() )
+				keep.push_back( value.IsTruthy() );
+		}
+
+		if ( IS_FLOAT64_ARRAY( arr ) )
+			Compact( AS_FLOAT64_ARRAY( arr )->GetArray(), keep );
+		else
+			Compact( AS_ARRAY( arr )->GetArray(), keep );
+
+		return arr;
+	}
+
+	QScript::Value ArrayParallelReduce( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+
+		if ( argCount != 2 && argCount != 3 )
 		{
 			throw RuntimeException( "rt_native_argcount",
-				"Expected 1 arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
+				"Expected 1 or 2 arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
 		}
 
-		auto findFn = args[ 1 ];
-		auto& arrayRef = AS_ARRAY( arr )->GetArray();
+		if ( !CanRunParallel( args[ 0 ], args[ 1 ], 2 ) )
+			return ArrayReduce( frame, args, argCount );
 
-		auto element = std::find_if( arrayRef.begin(), arrayRef.end(), [ &findFn, frame ]( QScript::Value value ) {
-			QVM::VirtualMachine->Push( findFn );
-			QVM::VirtualMachine->Push( value );
+		// Chunks are reduced independently, so the callback must be associative
+		ParallelRun run( args[ 0 ], args[ 1 ], true );
 
-			QVM::VirtualMachine->Call( ( Frame_t* ) frame, 1, findFn, true );
-			QVM::Run( *QVM::VirtualMachine, false );
+		auto partials = MAKE_ARRAY( "" );
+		QVM::VirtualMachine->Push( partials );
 
-			return QVM::VirtualMachine->Pop().IsTruthy();
-		} );
+		auto& partialsRef = AS_ARRAY( partials )->GetArray();
 
-		if ( element == arrayRef.end() )
-			return MAKE_NULL;
+		if ( argCount == 3 )
+			partialsRef.push_back( args[ 2 ] );
 
-		return *element;
+		for ( auto& chunk : run.Chunks() )
+			partialsRef.push_back( run.Adopt( chunk.Results().back() ) );
+
+		// Fold the partial results in order on the calling VM
+		ReduceStub stub( partials, 1, partialsRef[ 0 ] );
+		QVM::VirtualMachine->CallStub( ( Frame_t* ) frame, 2, args[ 1 ], &stub );
+
+		QVM::VirtualMachine->Pop();
+		return stub.Accumulator();
 	}
 
 	QScript::Value ArraySlice( void* frame, const QScript::Value* args, int argCount )
 	{
 		auto arr = args[ 0 ];
 
-		if ( !IS_ARRAY( arr ) )
+		if ( !IS_ARRAY( arr ) && !IS_FLOAT64_ARRAY( arr ) )
 		{
 			throw RuntimeException( "rt_native_expected",
 				"Expected array object, got \"" + arr.ToString() + "\"", 0, 0, "" );
@@ -208,28 +924,286 @@ namespace ArrayModule
 				+ args[ 1 ].ToString() + ( argCount > 2 ? "\", \"" + args[ 2 ].ToString() + "\"" : "\"" ), 0, 0, "" );
 		}
 
-		auto newArray = MAKE_ARRAY( "" );
-		auto& arrayRef = AS_ARRAY( arr )->GetArray();
+		bool isPacked = IS_FLOAT64_ARRAY( arr );
+		auto newArray = isPacked ? MAKE_FLOAT64_ARRAY( "" ) : MAKE_ARRAY( "" );
+		int arraySize = isPacked ? ( int ) AS_FLOAT64_ARRAY( arr )->GetArray().size() : ( int ) AS_ARRAY( arr )->GetArray().size();
 
 		int startSlice = std::max( 0, ( int ) AS_NUMBER( args[ 1 ] ) );
 
-		if ( startSlice >= ( int ) arrayRef.size() )
+		if ( startSlice >= arraySize )
 			return newArray;
 
-		int endSlice = ( int ) arrayRef.size();
+		int endSlice = arraySize;
 		
 		if ( argCount > 2 )
 		{
-			endSlice = std::min( ( int ) arrayRef.size(), std::max( 0, ( int ) AS_NUMBER( args[ 2 ] ) ) );
+			endSlice = std::min( arraySize, std::max( 0, ( int ) AS_NUMBER( args[ 2 ] ) ) );
 
 			if ( endSlice < startSlice )
 				return newArray;
 		}
 
+		if ( isPacked )
+		{
+			auto& arrayRef = AS_FLOAT64_ARRAY( arr )->GetArray();
+			AS_FLOAT64_ARRAY( newArray )->GetArray() = std::vector< double >( arrayRef.begin() + startSlice, arrayRef.begin() + endSlice );
+			return newArray;
+		}
+
+		auto& arrayRef = AS_ARRAY( arr )->GetArray();
 		AS_ARRAY( newArray )->GetArray() = std::vector< QScript::Value >( arrayRef.begin() + startSlice, arrayRef.begin() + endSlice );
 		return newArray;
 	}
 
+	// Longest Float64Array a length may ask for, 2 GiB of elements
+	static const size_t s_MaxFloat64ArrayLength = ( size_t ) 1 << 28;
+
+	QScript::Value NewFloat64Array( void* frame, const QScript::Value* args, int argCount )
+	{
+		if ( argCount > 2 )
+		{
+			throw RuntimeException( "rt_native_argcount",
+				"Expected <= 1 arguments, got " + std::to_string( argCount - 1 ), 0, 0, "" );
+		}
+
+		auto newArray = MAKE_FLOAT64_ARRAY( "" );
+		auto& newArrayRef = AS_FLOAT64_ARRAY( newArray )->GetArray();
+
+		if ( argCount < 2 )
+			return newArray;
+
+		auto source = args[ 1 ];
+
+		if ( IS_NUMBER( source ) )
+		{
+			// Zero-filled array of the given length, which must be a whole number within bounds
+			auto length = AS_NUMBER( source );
+
+			if ( !( length >= 0.0 && length <= ( double ) s_MaxFloat64ArrayLength ) || std::floor( length ) != length )
+			{
+				throw RuntimeException( "rt_invalid_array_length",
+					"Invalid array length: " + source.ToString(), 0, 0, "" );
+			}
+
+			try
+			{
+				newArrayRef.resize( ( size_t ) length );
+			}
+			catch ( const std::bad_alloc& )
+			{
+				throw RuntimeException( "rt_invalid_array_length",
+					"Out of memory allocating array of length " + source.ToString(), 0, 0, "" );
+			}
+		}
+		else if ( IS_FLOAT64_ARRAY( source ) )
+		{
+			newArrayRef = AS_FLOAT64_ARRAY( source )->GetArray();
+		}
+		else if ( IS_ARRAY( source ) )
+		{
+			auto& arrayRef = AS_ARRAY( source )->GetArray();
+			newArrayRef.reserve( arrayRef.size() );
+
+			for ( auto value : arrayRef )
+			{
+				if ( !IS_NUMBER( value ) )
+				{
+					throw RuntimeException( "rt_native_expected",
+						"Expected number, got \"" + value.ToString() + "\"", 0, 0, "" );
+				}
+
+				newArrayRef.push_back( AS_NUMBER( value ) );
+			}
+		}
+		else
+		{
+			throw RuntimeException( "rt_native_expected",
+				"Expected length or array object, got \"" + source.ToString() + "\"", 0, 0, "" );
+		}
+
+		return newArray;
+	}
+
+	QScript::Value ArraySum( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 0 );
+
+		NumericView view( args[ 0 ] );
+		ExpectNumeric( view, args[ 0 ] );
+
+		return MAKE_NUMBER( ArrayKernels::Sum( view.Data(), view.Size() ) );
+	}
+
+	QScript::Value ArrayMin( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 0 );
+
+		NumericView view( args[ 0 ] );
+		ExpectNumeric( view, args[ 0 ] );
+
+		if ( view.Size() == 0 )
+			return MAKE_NULL;
+
+		return MAKE_NUMBER( ArrayKernels::Min( view.Data(), view.Size() ) );
+	}
+
+	QScript::Value ArrayMax( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 0 );
+
+		NumericView view( args[ 0 ] );
+		ExpectNumeric( view, args[ 0 ] );
+
+		if ( view.Size() == 0 )
+			return MAKE_NULL;
+
+		return MAKE_NUMBER( ArrayKernels::Max( view.Data(), view.Size() ) );
+	}
+
+	QScript::Value ArrayDot( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+		ExpectArray( args[ 1 ] );
+
+		NumericView view( args[ 0 ] );
+		NumericView other( args[ 1 ] );
+		ExpectNumeric( view, args[ 0 ] );
+		ExpectNumeric( other, args[ 1 ] );
+
+		if ( view.Size() != other.Size() )
+		{
+			throw RuntimeException( "rt_native_expected",
+				"Array lengths differ: " + std::to_string( view.Size() ) + " and " + std::to_string( other.Size() ), 0, 0, "" );
+		}
+
+		return MAKE_NUMBER( ArrayKernels::Dot( view.Data(), other.Data(), view.Size() ) );
+	}
+
+	QScript::Value ArrayScale( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+		ExpectNumber( args[ 1 ] );
+
+		NumericView view( args[ 0 ] );
+		ExpectNumeric( view, args[ 0 ] );
+
+		ArrayKernels::Scale( view.Data(), view.Size(), AS_NUMBER( args[ 1 ] ) );
+		view.Commit();
+
+		return args[ 0 ];
+	}
+
+	QScript::Value ArrayAdd( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		NumericView view( args[ 0 ] );
+		ExpectNumeric( view, args[ 0 ] );
+
+		if ( IS_NUMBER( args[ 1 ] ) )
+		{
+			ArrayKernels::Add( view.Data(), view.Size(), AS_NUMBER( args[ 1 ] ) );
+		}
+		else
+		{
+			// Element-wise addition
+			ExpectArray( args[ 1 ] );
+
+			NumericView other( args[ 1 ] );
+			ExpectNumeric( other, args[ 1 ] );
+
+			if ( view.Size() != other.Size() )
+			{
+				throw RuntimeException( "rt_native_expected",
+					"Array lengths differ: " + std::to_string( view.Size() ) + " and " + std::to_string( other.Size() ), 0, 0, "" );
+			}
+
+			ArrayKernels::AddArray( view.Data(), other.Data(), view.Size() );
+		}
+
+		view.Commit();
+		return args[ 0 ];
+	}
+
+	QScript::Value ArrayIndexOf( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		auto needle = args[ 1 ];
+
+		if ( IS_FLOAT64_ARRAY( args[ 0 ] ) )
+		{
+			if ( !IS_NUMBER( needle ) )
+				return MAKE_NUMBER( -1 );
+
+			auto& arrayRef = AS_FLOAT64_ARRAY( args[ 0 ] )->GetArray();
+			return MAKE_NUMBER( ( double ) ArrayKernels::IndexOf( arrayRef.data(), arrayRef.size(), AS_NUMBER( needle ) ) );
+		}
+
+#ifdef QS_NAN_BOXING
+		if ( IS_NUMBER( needle ) )
+		{
+			NumericView view( args[ 0 ] );
+
+			if ( view.IsNumeric() )
+				return MAKE_NUMBER( ( double ) ArrayKernels::IndexOf( view.Data(), view.Size(), AS_NUMBER( needle ) ) );
+		}
+#endif
+
+		// Mixed content, compare the same way as the "==" operator
+		auto& arrayRef = AS_ARRAY( args[ 0 ] )->GetArray();
+		for ( size_t i = 0; i < arrayRef.size(); ++i )
+		{
+			auto& value = arrayRef[ i ];
+			bool equals = ( IS_STRING( value ) && IS_STRING( needle ) )
+				? AS_STRING( value )->GetString() == AS_STRING( needle )->GetString()
+				: ( value == needle ).IsTruthy();
+
+			if ( equals )
+				return MAKE_NUMBER( ( double ) i );
+		}
+
+		return MAKE_NUMBER( -1 );
+	}
+
+	QScript::Value ArrayFill( void* frame, const QScript::Value* args, int argCount )
+	{
+		ExpectArray( args[ 0 ] );
+		ExpectArgs( argCount, 1 );
+
+		auto value = args[ 1 ];
+
+		if ( IS_FLOAT64_ARRAY( args[ 0 ] ) )
+		{
+			ExpectNumber( value );
+
+			auto& arrayRef = AS_FLOAT64_ARRAY( args[ 0 ] )->GetArray();
+			ArrayKernels::Fill( arrayRef.data(), arrayRef.size(), AS_NUMBER( value ) );
+			return args[ 0 ];
+		}
+
+		auto& arrayRef = AS_ARRAY( args[ 0 ] )->GetArray();
+
+#ifdef QS_NAN_BOXING
+		if ( IS_NUMBER( value ) && arrayRef.size() > 0 )
+		{
+			// Previous contents are overwritten, so the array needn't be all-number
+			ArrayKernels::Fill( &arrayRef[ 0 ].m_Data.m_Number, arrayRef.size(), AS_NUMBER( value ) );
+			return args[ 0 ];
+		}
+#endif
+
+		std::fill( arrayRef.begin(), arrayRef.end(), value );
+		return args[ 0 ];
+	}
+
 	void LoadMethods( VM_t* vm )
 	{
 		vm->CreateArrayMethod( "push", ArrayPush );
@@ -238,6 +1212,22 @@ namespace ArrayModule
 		vm->CreateArrayMethod( "pop", ArrayPop );
 		vm->CreateArrayMethod( "filter", ArrayFilter );
 		vm->CreateArrayMethod( "find", ArrayFind );
+		vm->CreateArrayMethod( "map", ArrayMap );
+		vm->CreateArrayMethod( "forEach", ArrayForEach );
+		vm->CreateArrayMethod( "some", ArraySome );
+		vm->CreateArrayMethod( "every", ArrayEvery );
+		vm->CreateArrayMethod( "reduce", ArrayReduce );
+		vm->CreateArrayMethod( "parallelMap", ArrayParallelMap );
+		vm->CreateArrayMethod( "parallelFilter", ArrayParallelFilter );
+		vm->CreateArrayMethod( "parallelReduce", ArrayParallelReduce );
 		vm->CreateArrayMethod( "slice", ArraySlice );
+		vm->CreateArrayMethod( "sum", ArraySum );
+		vm->CreateArrayMethod( "min", ArrayMin );
+		vm->CreateArrayMethod( "max", ArrayMax );
+		vm->CreateArrayMethod( "dot", ArrayDot );
+		vm->CreateArrayMethod( "scale", ArrayScale );
+		vm->CreateArrayMethod( "add", ArrayAdd );
+		vm->CreateArrayMethod( "indexOf", ArrayIndexOf );
+		vm->CreateArrayMethod( "fill", ArrayFill );
 	}
 }
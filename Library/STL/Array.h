@@ -2,7 +2,18 @@
 
 struct VM_t;
 
+namespace QScript
+{
+	struct Value;
+}
+
 namespace ArrayModule
 {
+	QScript::Value NewFloat64Array( void* frame, const QScript::Value* args, int argCount );
 	void LoadMethods( VM_t* vm );
+
+	// Opcodes a parallel callback may run on a worker VM. A superinstruction is pure when its
+	// four parts (see QS_SUPERINSTRUCTIONS) all are.
+	bool IsPureOpCode( uint8_t opCode );
+	bool IsPureSuperinstruction( const uint8_t* parts );
 }
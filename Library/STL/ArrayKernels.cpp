@@ -0,0 +1,460 @@
+#include "QLibPCH.h"
+#include "ArrayKernels.h"
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+#define QS_KERNELS_X86
+#include <immintrin.h>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define QS_TARGET_AVX2
+#else
+#define QS_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#endif
+#endif
+
+namespace ArrayKernels
+{
+	struct KernelTable_t
+	{
+		const char*		m_Name;
+		double			( *m_Sum )( const double* data, size_t count );
+		double			( *m_Min )( const double* data, size_t count );
+		double			( *m_Max )( const double* data, size_t count );
+		double			( *m_Dot )( const double* a, const double* b, size_t count );
+		void			( *m_Scale )( double* data, size_t count, double factor );
+		void			( *m_Add )( double* data, size_t count, double value );
+		void			( *m_AddArray )( double* data, const double* other, size_t count );
+		void			( *m_Fill )( double* data, size_t count, double value );
+		int64_t			( *m_IndexOf )( const double* data, size_t count, double value );
+	};
+
+	namespace Scalar
+	{
+		double Sum( const double* data, size_t count )
+		{
+			double sum = 0;
+			for ( size_t i = 0; i < count; ++i )
+				sum += data[ i ];
+
+			return sum;
+		}
+
+		double Min( const double* data, size_t count )
+		{
+			double min = data[ 0 ];
+			for ( size_t i = 1; i < count; ++i )
+				min = data[ i ] < min ? data[ i ] : min;
+
+			return min;
+		}
+
+		double Max( const double* data, size_t count )
+		{
+			double max = data[ 0 ];
+			for ( size_t i = 1; i < count; ++i )
+				max = data[ i ] > max ? data[ i ] : max;
+
+			return max;
+		}
+
+		double Dot( const double* a, const double* b, size_t count )
+		{
+			double sum = 0;
+			for ( size_t i = 0; i < count; ++i )
+				sum += a[ i ] * b[ i ];
+
+			return sum;
+		}
+
+		void Scale( double* data, size_t count, double factor )
+		{
+			for ( size_t i = 0; i < count; ++i )
+				data[ i ] *= factor;
+		}
+
+		void Add( double* data, size_t count, double value )
+		{
+			for ( size_t i = 0; i < count; ++i )
+				data[ i ] += value;
+		}
+
+		void AddArray( double* data, const double* other, size_t count )
+		{
+			for ( size_t i = 0; i < count; ++i )
+				data[ i ] += other[ i ];
+		}
+
+		void Fill( double* data, size_t count, double value )
+		{
+			for ( size_t i = 0; i < count; ++i )
+				data[ i ] = value;
+		}
+
+		int64_t IndexOf( const double* data, size_t count, double value )
+		{
+			for ( size_t i = 0; i < count; ++i )
+			{
+				if ( data[ i ] == value )
+					return ( int64_t ) i;
+			}
+
+			return -1;
+		}
+	}
+
+#ifdef QS_KERNELS_X86
+	namespace SSE2
+	{
+		double Sum( const double* data, size_t count )
+		{
+			__m128d acc0 = _mm_setzero_pd();
+			__m128d acc1 = _mm_setzero_pd();
+			size_t i = 0;
+
+			for ( ; i + 4 <= count; i += 4 )
+			{
+				acc0 = _mm_add_pd( acc0, _mm_loadu_pd( data + i ) );
+				acc1 = _mm_add_pd( acc1, _mm_loadu_pd( data + i + 2 ) );
+			}
+
+			double lanes[ 2 ];
+			_mm_storeu_pd( lanes, _mm_add_pd( acc0, acc1 ) );
+
+			return lanes[ 0 ] + lanes[ 1 ] + Scalar::Sum( data + i, count - i );
+		}
+
+		// Same rule as the scalar kernels: every lane starts from the first element, and an element
+		// only replaces the lane if it compares less (greater). NaN never compares, so it can't.
+		double Min( const double* data, size_t count )
+		{
+			__m128d acc = _mm_set1_pd( data[ 0 ] );
+			size_t i = 1;
+
+			for ( ; i + 2 <= count; i += 2 )
+			{
+				__m128d value = _mm_loadu_pd( data + i );
+				__m128d less = _mm_cmplt_pd( value, acc );
+				acc = _mm_or_pd( _mm_and_pd( less, value ), _mm_andnot_pd( less, acc ) );
+			}
+
+			double lanes[ 2 ];
+			_mm_storeu_pd( lanes, acc );
+
+			double min = Scalar::Min( lanes, 2 );
+			for ( ; i < count; ++i )
+				min = data[ i ] < min ? data[ i ] : min;
+
+			return min;
+		}
+
+		double Max( const double* data, size_t count )
+		{
+			__m128d acc = _mm_set1_pd( data[ 0 ] );
+			size_t i = 1;
+
+			for ( ; i + 2 <= count; i += 2 )
+			{
+				__m128d value = _mm_loadu_pd( data + i );
+				__m128d greater = _mm_cmpgt_pd( value, acc );
+				acc = _mm_or_pd( _mm_and_pd( greater, value ), _mm_andnot_pd( greater, acc ) );
+			}
+
+			double lanes[ 2 ];
+			_mm_storeu_pd( lanes, acc );
+
+			double max = Scalar::Max( lanes, 2 );
+			for ( ; i < count; ++i )
+				max = data[ i ] > max ? data[ i ] : max;
+
+			return max;
+		}
+
+		double Dot( const double* a, const double* b, size_t count )
+		{
+			__m128d acc0 = _mm_setzero_pd();
+			__m128d acc1 = _mm_setzero_pd();
+			size_t i = 0;
+
+			for ( ; i + 4 <= count; i += 4 )
+			{
+				acc0 = _mm_add_pd( acc0, _mm_mul_pd( _mm_loadu_pd( a + i ), _mm_loadu_pd( b + i ) ) );
+				acc1 = _mm_add_pd( acc1, _mm_mul_pd( _mm_loadu_pd( a + i + 2 ), _mm_loadu_pd( b + i + 2 ) ) );
+			}
+
+			double lanes[ 2 ];
+			_mm_storeu_pd( lanes, _mm_add_pd( acc0, acc1 ) );
+
+			return lanes[ 0 ] + lanes[ 1 ] + Scalar::Dot( a + i, b + i, count - i );
+		}
+
+		void Scale( double* data, size_t count, double factor )
+		{
+			__m128d factors = _mm_set1_pd( factor );
+			size_t i = 0;
+
+			for ( ; i + 2 <= count; i += 2 )
+				_mm_storeu_pd( data + i, _mm_mul_pd( _mm_loadu_pd( data + i ), factors ) );
+
+			Scalar::Scale( data + i, count - i, factor );
+		}
+
+		void Add( double* data, size_t count, double value )
+		{
+			__m128d values = _mm_set1_pd( value );
+			size_t i = 0;
+
+			for ( ; i + 2 <= count; i += 2 )
+				_mm_storeu_pd( data + i, _mm_add_pd( _mm_loadu_pd( data + i ), values ) );
+
+			Scalar::Add( data + i, count - i, value );
+		}
+
+		void AddArray( double* data, const double* other, size_t count )
+		{
+			size_t i = 0;
+
+			for ( ; i + 2 <= count; i += 2 )
+				_mm_storeu_pd( data + i, _mm_add_pd( _mm_loadu_pd( data + i ), _mm_loadu_pd( other + i ) ) );
+
+			Scalar::AddArray( data + i, other + i, count - i );
+		}
+
+		void Fill( double* data, size_t count, double value )
+		{
+			__m128d values = _mm_set1_pd( value );
+			size_t i = 0;
+
+			for ( ; i + 2 <= count; i += 2 )
+				_mm_storeu_pd( data + i, values );
+
+			Scalar::Fill( data + i, count - i, value );
+		}
+
+		int64_t IndexOf( const double* data, size_t count, double value )
+		{
+			__m128d needle = _mm_set1_pd( value );
+			size_t i = 0;
+
+			for ( ; i + 2 <= count; i += 2 )
+			{
+				int mask = _mm_movemask_pd( _mm_cmpeq_pd( _mm_loadu_pd( data + i ), needle ) );
+
+				if ( mask )
+					return ( int64_t ) i + ( ( mask & 1 ) ? 0 : 1 );
+			}
+
+			auto tail = Scalar::IndexOf( data + i, count - i, value );
+			return tail == -1 ? -1 : ( int64_t ) i + tail;
+		}
+	}
+
+	namespace AVX2
+	{
+		QS_TARGET_AVX2 double Sum( const double* data, size_t count )
+		{
+			__m256d acc0 = _mm256_setzero_pd();
+			__m256d acc1 = _mm256_setzero_pd();
+			size_t i = 0;
+
+			for ( ; i + 8 <= count; i += 8 )
+			{
+				acc0 = _mm256_add_pd( acc0, _mm256_loadu_pd( data + i ) );
+				acc1 = _mm256_add_pd( acc1, _mm256_loadu_pd( data + i + 4 ) );
+			}
+
+			double lanes[ 4 ];
+			_mm256_storeu_pd( lanes, _mm256_add_pd( acc0, acc1 ) );
+
+			return ( lanes[ 0 ] + lanes[ 1 ] ) + ( lanes[ 2 ] + lanes[ 3 ] ) + Scalar::Sum( data + i, count - i );
+		}
+
+		// See SSE2::Min, ordered compares keep NaN out of the lanes
+		QS_TARGET_AVX2 double Min( const double* data, size_t count )
+		{
+			__m256d acc = _mm256_set1_pd( data[ 0 ] );
+			size_t i = 1;
+
+			for ( ; i + 4 <= count; i += 4 )
+			{
+				__m256d value = _mm256_loadu_pd( data + i );
+				acc = _mm256_blendv_pd( acc, value, _mm256_cmp_pd( value, acc, _CMP_LT_OQ ) );
+			}
+
+			double lanes[ 4 ];
+			_mm256_storeu_pd( lanes, acc );
+
+			double min = Scalar::Min( lanes, 4 );
+			for ( ; i < count; ++i )
+				min = data[ i ] < min ? data[ i ] : min;
+
+			return min;
+		}
+
+		QS_TARGET_AVX2 double Max( const double* data, size_t count )
+		{
+			__m256d acc = _mm256_set1_pd( data[ 0 ] );
+			size_t i = 1;
+
+			for ( ; i + 4 <= count; i += 4 )
+			{
+				__m256d value = _mm256_loadu_pd( data + i );
+				acc = _mm256_blendv_pd( acc, value, _mm256_cmp_pd( value, acc, _CMP_GT_OQ ) );
+			}
+
+			double lanes[ 4 ];
+			_mm256_storeu_pd( lanes, acc );
+
+			double max = Scalar::Max( lanes, 4 );
+			for ( ; i < count; ++i )
+				max = data[ i ] > max ? data[ i ] : max;
+
+			return max;
+		}
+
+		QS_TARGET_AVX2 double Dot( const double* a, const double* b, size_t count )
+		{
+			__m256d acc0 = _mm256_setzero_pd();
+			__m256d acc1 = _mm256_setzero_pd();
+			size_t i = 0;
+
+			for ( ; i + 8 <= count; i += 8 )
+			{
+				acc0 = _mm256_add_pd( acc0, _mm256_mul_pd( _mm256_loadu_pd( a + i ), _mm256_loadu_pd( b + i ) ) );
+				acc1 = _mm256_add_pd( acc1, _mm256_mul_pd( _mm256_loadu_pd( a + i + 4 ), _mm256_loadu_pd( b + i + 4 ) ) );
+			}
+
+			double lanes[ 4 ];
+			_mm256_storeu_pd( lanes, _mm256_add_pd( acc0, acc1 ) );
+
+			return ( lanes[ 0 ] + lanes[ 1 ] ) + ( lanes[ 2 ] + lanes[ 3 ] ) + Scalar::Dot( a + i, b + i, count - i );
+		}
+
+		QS_TARGET_AVX2 void Scale( double* data, size_t count, double factor )
+		{
+			__m256d factors = _mm256_set1_pd( factor );
+			size_t i = 0;
+
+			for ( ; i + 4 <= count; i += 4 )
+				_mm256_storeu_pd( data + i, _mm256_mul_pd( _mm256_loadu_pd( data + i ), factors ) );
+
+			Scalar::Scale( data + i, count - i, factor );
+		}
+
+		QS_TARGET_AVX2 void Add( double* data, size_t count, double value )
+		{
+			__m256d values = _mm256_set1_pd( value );
+			size_t i = 0;
+
+			for ( ; i + 4 <= count; i += 4 )
+				_mm256_storeu_pd( data + i, _mm256_add_pd( _mm256_loadu_pd( data + i ), values ) );
+
+			Scalar::Add( data + i, count - i, value );
+		}
+
+		QS_TARGET_AVX2 void AddArray( double* data, const double* other, size_t count )
+		{
+			size_t i = 0;
+
+			for ( ; i + 4 <= count; i += 4 )
+				_mm256_storeu_pd( data + i, _mm256_add_pd( _mm256_loadu_pd( data + i ), _mm256_loadu_pd( other + i ) ) );
+
+			Scalar::AddArray( data + i, other + i, count - i );
+		}
+
+		QS_TARGET_AVX2 void Fill( double* data, size_t count, double value )
+		{
+			__m256d values = _mm256_set1_pd( value );
+			size_t i = 0;
+
+			for ( ; i + 4 <= count; i += 4 )
+				_mm256_storeu_pd( data + i, values );
+
+			Scalar::Fill( data + i, count - i, value );
+		}
+
+		QS_TARGET_AVX2 int64_t IndexOf( const double* data, size_t count, double value )
+		{
+			__m256d needle = _mm256_set1_pd( value );
+			size_t i = 0;
+
+			for ( ; i + 4 <= count; i += 4 )
+			{
+				int mask = _mm256_movemask_pd( _mm256_cmp_pd( _mm256_loadu_pd( data + i ), needle, _CMP_EQ_OQ ) );
+
+				if ( mask )
+				{
+					int lane = 0;
+					while ( !( mask & ( 1 << lane ) ) )
+						++lane;
+
+					return ( int64_t ) ( i + lane );
+				}
+			}
+
+			auto tail = Scalar::IndexOf( data + i, count - i, value );
+			return tail == -1 ? -1 : ( int64_t ) i + tail;
+		}
+	}
+
+	static bool SupportsAVX2()
+	{
+#if defined( _MSC_VER )
+		int info[ 4 ];
+		__cpuid( info, 0 );
+
+		if ( info[ 0 ] < 7 )
+			return false;
+
+		// AVX registers must also be enabled by the OS (OSXSAVE + XCR0)
+		__cpuid( info, 1 );
+		if ( !( info[ 2 ] & ( 1 << 27 ) ) || !( info[ 2 ] & ( 1 << 28 ) ) )
+			return false;
+
+		if ( ( _xgetbv( 0 ) & 6 ) != 6 )
+			return false;
+
+		__cpuidex( info, 7, 0 );
+		return ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports( "avx2" );
+#endif
+	}
+#endif
+
+	#define KERNEL_TABLE( name, set ) KernelTable_t{ name, &set::Sum, &set::Min, &set::Max, &set::Dot, \
+		&set::Scale, &set::Add, &set::AddArray, &set::Fill, &set::IndexOf }
+
+	static KernelTable_t SelectKernels()
+	{
+#ifdef QS_KERNELS_X86
+		if ( SupportsAVX2() )
+			return KERNEL_TABLE( "avx2", AVX2 );
+
+		// SSE2 is part of the x86-64 baseline (and required by the 32-bit builds)
+		return KERNEL_TABLE( "sse2", SSE2 );
+#else
+		return KERNEL_TABLE( "scalar", Scalar );
+#endif
+	}
+
+	#undef KERNEL_TABLE
+
+	static const KernelTable_t& Kernels()
+	{
+		static const KernelTable_t kernels = SelectKernels();
+		return kernels;
+	}
+
+	double Sum( const double* data, size_t count )							{ return Kernels().m_Sum( data, count ); }
+	double Min( const double* data, size_t count )							{ return Kernels().m_Min( data, count ); }
+	double Max( const double* data, size_t count )							{ return Kernels().m_Max( data, count ); }
+	double Dot( const double* a, const double* b, size_t count )			{ return Kernels().m_Dot( a, b, count ); }
+	void Scale( double* data, size_t count, double factor )					{ Kernels().m_Scale( data, count, factor ); }
+	void Add( double* data, size_t count, double value )					{ Kernels().m_Add( data, count, value ); }
+	void AddArray( double* data, const double* other, size_t count )		{ Kernels().m_AddArray( data, other, count ); }
+	void Fill( double* data, size_t count, double value )					{ Kernels().m_Fill( data, count, value ); }
+	int64_t IndexOf( const double* data, size_t count, double value )		{ return Kernels().m_IndexOf( data, count, value ); }
+	const char* KernelName()												{ return Kernels().m_Name; }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace ArrayKernels
+{
+	// Numeric kernels over contiguous doubles. On x86 the widest supported
+	// instruction set (AVX2 or SSE2) is picked at runtime, other targets run scalar code.
+	double Sum( const double* data, size_t count );
+	double Min( const double* data, size_t count );
+	double Max( const double* data, size_t count );
+	double Dot( const double* a, const double* b, size_t count );
+	void Scale( double* data, size_t count, double factor );
+	void Add( double* data, size_t count, double value );
+	void AddArray( double* data, const double* other, size_t count );
+	void Fill( double* data, size_t count, double value );
+	int64_t IndexOf( const double* data, size_t count, double value );
+
+	// Name of the selected kernel set ("avx2", "sse2" or "scalar")
+	const char* KernelName();
+}
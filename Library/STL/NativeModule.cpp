@@ -25,12 +25,19 @@ namespace QScript
 		return NULL;
 	}
 
+	const std::vector< NativeModule* >& GetModules()
+	{
+		return NativeModules;
+	}
+
 	void InitModules()
 	{
-		if ( NativeModules.size() > 0 )
-			return;
+		// VMs and compilers on different threads may get here at the same time
+		static std::once_flag s_ModulesLoaded;
 
-		NATIVE_MODULE( SystemModule );
-		NATIVE_MODULE( TimeModule );
+		std::call_once( s_ModulesLoaded, []() {
+			NATIVE_MODULE( SystemModule );
+			NATIVE_MODULE( TimeModule );
+		} );
 	}
 }
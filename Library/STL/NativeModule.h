@@ -38,5 +38,6 @@ namespace QScript
 	};
 
 	const NativeModule* ResolveModule( const std::string& name );
+	const std::vector< NativeModule* >& GetModules();
 	void InitModules();
 }
@@ -21,6 +21,7 @@ void SystemModule::Import( VM_t* vm ) const
 {
 	vm->CreateNative( "exit", &Native_Exit );
 	vm->CreateNative( "print", &Native_Print );
+	vm->CreateNative( "Float64Array", &ArrayModule::NewFloat64Array );
 
 	ArrayModule::LoadMethods( vm );
 }
@@ -30,12 +31,14 @@ void SystemModule::Import( Compiler::Assembler* assembler, int lineNr, int colNr
 	auto config = assembler->Config();
 	assembler->AddGlobal( "exit", true, -1, -1, Compiler::TYPE_NATIVE, Compiler::TYPE_NONE );
 	assembler->AddGlobal( "print", true, -1, -1, Compiler::TYPE_NATIVE, Compiler::TYPE_NONE );
+	assembler->AddGlobal( "Float64Array", true, -1, -1, Compiler::TYPE_NATIVE, Compiler::TYPE_ARRAY );
 
 	if ( config.m_ImportCb )
 	{
 		std::vector< QScript::NativeFunctionSpec_t > functions = {
 			QScript::NativeFunctionSpec_t{ "exit", { }, Compiler::TYPE_NULL },
 			QScript::NativeFunctionSpec_t{ "print", { QScript::NativeFunctionSpec_t::NativeArg_t{ "", Compiler::TYPE_UNKNOWN, Compiler::TYPE_UNKNOWN, true } }, Compiler::TYPE_NULL },
+			QScript::NativeFunctionSpec_t{ "Float64Array", { QScript::NativeFunctionSpec_t::NativeArg_t{ "source", Compiler::TYPE_NUMBER | Compiler::TYPE_ARRAY, Compiler::TYPE_UNKNOWN, false } }, Compiler::TYPE_ARRAY },
 		};
 
 		config.m_ImportCb( lineNr, colNr, m_Name, functions );
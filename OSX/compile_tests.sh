@@ -1 +1 @@
-g++ -I ../Includes/ ../Tests/Tests.cpp ../Tests/Utils.cpp ../Tests/TestLexer.cpp ../Tests/TestCompiler.cpp ../Tests/TestInterpreter.cpp ./Lib/QScript.a -Wc++11-extensions -std=c++11 -o ./Lib/Tests.o -D _OSX -O3
+g++ -I ../Includes/ ../Tests/Tests.cpp ../Tests/Utils.cpp ../Tests/TestLexer.cpp ../Tests/TestCompiler.cpp ../Tests/TestInterpreter.cpp ../Tests/Benchmarks.cpp ../Tests/BenchInterpreter.cpp ./Lib/QScript.a -Wc++11-extensions -std=c++11 -o ./Lib/Tests.o -D _OSX -O3
@@ -0,0 +1,3 @@
+sh compile_library.sh
+sh compile_tests.sh
+./Lib/Tests.o --bench
\ No newline at end of file
@@ -0,0 +1,725 @@
+#include "QLibPCH.h"
+#include "Benchmarks.h"
+#include "Instructions.h"
+
+#include "../Library/Common/Chunk.h"
+#include "../Library/Runtime/QVM.h"
+#include "../Library/STL/ArrayKernels.h"
+#include "../Library/Runtime/ThreadPool.h"
+#include "../Library/Compiler/Compiler.h"
+
+namespace Benchmarks
+{
+	static void BenchArrayKernels()
+	{
+		// 10^7 elements; plain array is built from the packed one to skip a script push loop
+		auto timings = RunTimedScript( "import Time;					\
+			var n = 10000000;											\
+			var packed = [ Float64Array: n ];							\
+			[ packed.fill: 1.5 ];										\
+			Array empty;												\
+			var plain = [ empty.concat: packed ];						\
+			var t0 = [ clock ];										\
+			num loopSum = 0;											\
+			for ( num i = 0; i < n; ++i ) {								\
+				loopSum += plain( i );									\
+			}															\
+			var t1 = [ clock ];										\
+			var plainSum = [ plain.sum ];								\
+			var t2 = [ clock ];										\
+			var packedSum = [ packed.sum ];							\
+			var t3 = [ clock ];										\
+			for ( num i = 0; i < n; ++i ) {								\
+				plain( i ) = plain( i ) * 2;							\
+			}															\
+			var t4 = [ clock ];										\
+			[ packed.scale: 2 ];										\
+			var t5 = [ clock ];										\
+			Array result;												\
+			[ result.push: t1 - t0, t2 - t1, t3 - t2, t4 - t3, t5 - t4 ];	\
+			return result;" );
+
+		if ( timings.size() != 5 )
+		{
+			std::cout << "[Benchmarks] Array kernels: script failed" << std::endl;
+			return;
+		}
+
+		Report( std::string( "Array kernels, 10^7 elements (" ) + ArrayKernels::KernelName() + ")", {
+			{ "sum: script loop (OP_LOAD_PROP_STACK + OP_ADD)", timings[ 0 ] },
+			{ "sum: [ plain.sum ]", timings[ 1 ] },
+			{ "sum: [ packed.sum ] (Float64Array)", timings[ 2 ] },
+			{ "scale: script loop", timings[ 3 ] },
+			{ "scale: [ packed.scale: 2 ] (Float64Array)", timings[ 4 ] },
+		} );
+	}
+
+	static void BenchHigherOrder()
+	{
+		// 10^6 elements through script callbacks
+		auto timings = RunTimedScript( "import Time;					\
+			var n = 1000000;											\
+			var packed = [ Float64Array: n ];							\
+			for ( num i = 0; i < n; ++i ) {								\
+				packed( i ) = i;										\
+			}															\
+			Array empty;												\
+			var plain = [ empty.concat: packed ];						\
+			const isEven = ( x ) -> { return x % 2 == 0; };				\
+			const twice = ( x ) -> { return x * 2; };					\
+			const add = ( a, b ) -> { return a + b; };					\
+			var t0 = [ clock ];										\
+			[ plain.filter: isEven ];									\
+			var t1 = [ clock ];										\
+			var mapped = [ packed.map: twice ];						\
+			var t2 = [ clock ];										\
+			var total = [ packed.reduce: add, 0 ];						\
+			var t3 = [ clock ];										\
+			Array result;												\
+			[ result.push: t1 - t0, t2 - t1, t3 - t2 ];				\
+			return result;" );
+
+		if ( timings.size() != 3 )
+		{
+			std::cout << "[Benchmarks] Higher-order array methods: script failed" << std::endl;
+			return;
+		}
+
+		Report( "Higher-order array methods, 10^6 elements", {
+			{ "[ plain.filter: isEven ]", timings[ 0 ] },
+			{ "[ packed.map: twice ]", timings[ 1 ] },
+			{ "[ packed.reduce: add, 0 ]", timings[ 2 ] },
+		} );
+	}
+
+	static void BenchParallel()
+	{
+		// Callback heavy enough that chunks dominate the cost of spinning up worker VMs
+		auto timings = RunTimedScript( "import Time;					\
+			var n = 1000000;											\
+			var packed = [ Float64Array: n ];							\
+			for ( num i = 0; i < n; ++i ) {								\
+				packed( i ) = i;										\
+			}															\
+			const heavy = ( x ) -> {									\
+				num s = 0;												\
+				for ( num k = 0; k < 16; ++k ) { s += x * k % 7; }		\
+				return s;												\
+			};															\
+			const add = ( a, b ) -> { return a + b; };					\
+			var t0 = [ clock ];										\
+			[ packed.map: heavy ];										\
+			var t1 = [ clock ];										\
+			[ packed.parallelMap: heavy ];								\
+			var t2 = [ clock ];										\
+			[ packed.reduce: add ];										\
+			var t3 = [ clock ];										\
+			[ packed.parallelReduce: add ];								\
+			var t4 = [ clock ];										\
+			Array result;												\
+			[ result.push: t1 - t0, t2 - t1, t3 - t2, t4 - t3 ];		\
+			return result;" );
+
+		if ( timings.size() != 4 )
+		{
+			std::cout << "[Benchmarks] Parallel array methods: script failed" << std::endl;
+			return;
+		}
+
+		Report( "Parallel array methods, 10^6 elements (" + std::to_string( ThreadPool::Instance().NumThreads() ) + " threads)", {
+			{ "[ packed.map: heavy ]", timings[ 0 ] },
+			{ "[ packed.parallelMap: heavy ]", timings[ 1 ] },
+			{ "[ packed.reduce: add ]", timings[ 2 ] },
+			{ "[ packed.parallelReduce: add ]", timings[ 3 ] },
+		} );
+	}
+
+	static void BenchStartup()
+	{
+		// Typical service script: builds lookup tables once, then answers requests
+		const std::string source = "Table config = {					\
+				const scale = 3;										\
+				const prefix = \"item\";								\
+			};															\
+			Array squares;												\
+			for ( num i = 0; i < 5000; ++i ) {							\
+				[ squares.push: i * i ];								\
+			}															\
+			Array names;												\
+			for ( num i = 0; i < 500; ++i ) {							\
+				[ names.push: config.prefix + i ];						\
+			}															\
+			const lookup = ( x ) -> { return squares( x ) * config.scale; };	\
+			const handle = ( x ) -> { return [ lookup: x ] + 1; };";
+
+		static const int s_Repetitions = 50;
+
+		auto callHandle = []( VM_t& vm ) {
+			QScript::CallFunction( vm, "handle", { MAKE_NUMBER( 42 ) } );
+		};
+
+		auto compileAndRun = Measure( s_Repetitions, [ & ]() {
+			auto fn = QScript::Compile( source );
+			VM_t vm( fn );
+			QScript::Interpret( vm, NULL );
+			callHandle( vm );
+			vm.Release();
+			QScript::FreeFunction( fn );
+		} );
+
+		auto fn = QScript::Compile( source );
+
+		auto initAndRun = Measure( s_Repetitions, [ & ]() {
+			VM_t vm( fn );
+			QScript::Interpret( vm, NULL );
+			callHandle( vm );
+			vm.Release();
+		} );
+
+		auto snapshot = QScript::CreateSnapshot( *fn );
+		QScript::FreeFunction( fn );
+
+		auto loadAndRun = Measure( s_Repetitions, [ & ]() {
+			auto vm = QScript::LoadSnapshot( snapshot );
+			callHandle( *vm );
+			QScript::FreeSnapshot( vm );
+		} );
+
+		Report( "Startup latency, first request (snapshot " + std::to_string( snapshot.size() / 1024 ) + " KiB)", {
+			{ "compile + initialize + call", compileAndRun },
+			{ "initialize + call (precompiled)", initAndRun },
+			{ "load snapshot + call", loadAndRun },
+		} );
+	}
+
+	static void BenchBytecode()
+	{
+		static const char* s_Path = "qs_bench_bytecode.qsc";
+		static const int s_Repetitions = 10;
+
+		// Large generated script: many small functions
+		std::string source;
+		for ( int i = 0; i < 2000; ++i )
+		{
+			auto index = std::to_string( i );
+			source += "const f" + index + " = ( x ) -> { var y = x * " + index + "; if ( y > 10 ) { return y - 1; } return \"v" + index + "\"; };\n";
+		}
+
+		auto compile = Measure( s_Repetitions, [ & ]() {
+			QScript::FreeFunction( QScript::Compile( source ) );
+		} );
+
+		auto fn = QScript::Compile( source );
+		QScript::SaveBytecode( *fn, s_Path );
+		QScript::FreeFunction( fn );
+
+		auto load = Measure( s_Repetitions, [ & ]() {
+			QScript::FreeFunction( QScript::LoadBytecode( s_Path ) );
+		} );
+
+		std::remove( s_Path );
+
+		QScript::ClearCompileCache();
+		QScript::FreeFunction( QScript::CompileCached( source ) );
+
+		auto cached = Measure( s_Repetitions, [ & ]() {
+			QScript::FreeFunction( QScript::CompileCached( source ) );
+		} );
+
+		QScript::ClearCompileCache();
+
+		Report( "Bytecode files, 2000 functions", {
+			{ "QScript::Compile", compile },
+			{ "QScript::LoadBytecode (.qsc)", load },
+			{ "QScript::CompileCached (memory hit)", cached },
+		} );
+	}
+
+	static void BenchLexer()
+	{
+		static const int s_Repetitions = 10;
+
+		// ~8MB of generated source mixing names, keywords, numbers, strings and comments
+		std::string source;
+		for ( int i = 0; source.length() < 8 * 1024 * 1024; ++i )
+		{
+			auto index = std::to_string( i );
+			source += "const func" + index + " = ( num x, string s ) -> auto {\n"
+				"\t// comment " + index + "\n"
+				"\tvar y = x * " + index + ".25 + 3; if ( y >= 10 && s != \"str" + index + "\" ) { return y - 1; }\n"
+				"\twhile ( x <= 100 ) { x += 2; } return [s.length] || null;\n};\n";
+		}
+
+		size_t numTokens = 0;
+		auto lex = Measure( s_Repetitions, [ & ]() {
+			numTokens = Compiler::Lexer( source ).size();
+		} );
+
+		Report( "Lexer, " + std::to_string( source.length() / ( 1024 * 1024 ) ) + "MB source", {
+			{ "Compiler::Lexer", lex },
+		} );
+
+		std::cout << "\t" << std::fixed << std::setprecision( 2 )
+			<< ( ( double ) source.length() / ( 1024.0 * 1024.0 ) ) / lex << " MB/s, "
+			<< ( ( double ) numTokens / 1000000.0 ) / lex << " M tokens/s" << std::endl;
+
+		std::cout.unsetf( std::ios_base::floatfield );
+	}
+
+	static void BenchParser()
+	{
+		static const int s_Repetitions = 3;
+
+		// 100k lines of generated source
+		std::string source;
+		for ( int i = 0; i < 20000; ++i )
+		{
+			auto index = std::to_string( i );
+			source += "const f" + index + " = ( num x ) -> auto {\n"
+				"\tvar y = x * " + index + " + ( x - 1 ) / 2;\n"
+				"\tif ( y >= 10 && y != 20 ) { return [f" + index + ": y - 1]; }\n"
+				"\tfor ( var i = 0; i < 10; i += 1 ) { y = y % 3 ? y : -y; }\n"
+				"\treturn y; };\n";
+		}
+
+		auto lex = Measure( s_Repetitions, [ & ]() {
+			Compiler::Lexer( source );
+		} );
+
+		auto lexParse = Measure( s_Repetitions, [ & ]() {
+			Compiler::NodeArena arena;
+			QScript::GenerateAST( source, &arena );
+		} );
+
+		Report( "Parser, 100k lines", {
+			{ "Compiler::Lexer", lex },
+			{ "QScript::GenerateAST (lexer + parser)", lexParse },
+			{ "Parser only", lexParse - lex },
+		} );
+	}
+
+	static void BenchConstants()
+	{
+		std::vector< BenchResult_t > results;
+
+		// Every statement adds a distinct number and a distinct string constant
+		for ( int numConstants = 1000; numConstants <= 1000000; numConstants *= 10 )
+		{
+			std::string source = "var x = 0; var s = \"\";\n";
+			for ( int i = 0; i < numConstants / 2; ++i )
+			{
+				auto index = std::to_string( i );
+				source += "x = " + index + ".5; s = \"c" + index + "\";\n";
+			}
+
+			auto compile = Measure( numConstants < 1000000 ? 3 : 1, [ & ]() {
+				QScript::FreeFunction( QScript::Compile( source ) );
+			} );
+
+			results.push_back( { "QScript::Compile, " + std::to_string( numConstants ) + " constants", compile } );
+		}
+
+		Report( "Constant pool", results );
+	}
+
+	static void BenchOptimizer()
+	{
+		static const int s_Repetitions = 5;
+
+		// Arithmetic on constants and a disabled branch inside a hot loop
+		const std::string source = "var sum = 0;						\
+			for ( var i = 0; i < 2000000; ++i ) {						\
+				sum = sum + i / 4 + 60 * 60 * 24 - 2 ** 16;				\
+				if ( 1 > 2 ) { sum = 0; }								\
+			}";
+
+		auto run = [ & ]( uint8_t flags ) {
+			QScript::Config_t config( true );
+			config.m_CompilerFlags = flags;
+
+			auto fn = QScript::Compile( source, config );
+			auto time = Measure( s_Repetitions, [ & ]() {
+				VM_t vm( fn );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+			} );
+
+			QScript::FreeFunction( fn );
+			return time;
+		};
+
+		auto unoptimized = run( QScript::Config_t::OF_NONE );
+		auto optimized = run( QScript::Config_t::OF_ALL );
+
+		Report( "AST optimizer, 2 * 10^6 loop iterations", {
+			{ "OF_NONE", unoptimized },
+			{ "OF_ALL", optimized },
+		} );
+	}
+
+	static void BenchPeephole()
+	{
+		static const int s_Repetitions = 5;
+
+		// Assignment statements and nested branches in a hot loop
+		const std::string source = "var sum = 0; var odd = 0;			\
+			for ( var i = 0; i < 2000000; ++i ) {						\
+				var x = i % 3;											\
+				if ( x == 0 ) { sum = sum + i; } else { odd = odd + 1; }	\
+			}";
+
+		auto run = [ & ]( uint8_t flags, const std::string& name ) {
+			QScript::Config_t config( true );
+			config.m_CompilerFlags = flags;
+
+			auto fn = QScript::Compile( source, config );
+			auto size = fn->GetChunk()->m_Code.size();
+			auto time = Measure( s_Repetitions, [ & ]() {
+				VM_t vm( fn );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+			} );
+
+			QScript::FreeFunction( fn );
+			return BenchResult_t{ name + " (" + std::to_string( size ) + " bytes)", time };
+		};
+
+		Report( "Peephole optimizer, 2 * 10^6 loop iterations", {
+			run( QScript::Config_t::OF_NONE, "OF_NONE" ),
+			run( QScript::Config_t::OF_PEEPHOLE, "OF_PEEPHOLE" ),
+		} );
+	}
+
+	static void BenchSuperinstructions()
+	{
+		static const int s_Repetitions = 5;
+
+		// Local loops inside a function, the code superinstructions are generated for
+		const std::string source = "const collatz = ( n ) -> {			\
+				var x = n;												\
+				var steps = 0;											\
+				while ( x != 1 ) {										\
+					if ( x % 2 == 0 ) { x = x / 2; } else { x = x * 3 + 1; }	\
+					steps += 1;											\
+				}														\
+				return steps;											\
+			};															\
+			const sumTo = ( n ) -> {									\
+				var s = 0;												\
+				for ( var i = 0; i < n; i++ ) { s = s + i * 2; }		\
+				return s;												\
+			};															\
+			var total = [ sumTo: 1000000 ];								\
+			for ( var k = 1; k < 10000; k++ ) { total += [ collatz: k ]; }";
+
+		auto run = [ & ]( uint8_t flags ) {
+			QScript::Config_t config( true );
+			config.m_CompilerFlags = flags;
+
+			auto fn = QScript::Compile( source, config );
+			auto time = Measure( s_Repetitions, [ & ]() {
+				VM_t vm( fn );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+			} );
+
+			QScript::FreeFunction( fn );
+			return time;
+		};
+
+		Report( "Superinstructions, " + std::to_string( QScript::OpCode::OP_SUPERINSTRUCTION_COUNT ) + " in the instruction set", {
+			{ "OF_ALL without OF_SUPERINSTRUCTIONS", run( QScript::Config_t::OF_ALL & ~QScript::Config_t::OF_SUPERINSTRUCTIONS ) },
+			{ "OF_ALL", run( QScript::Config_t::OF_ALL ) },
+		} );
+	}
+
+	static void BenchCompareBranch()
+	{
+		static const int s_Repetitions = 5;
+
+		// The same loop with a comparison as its condition and with a negated one, a negation
+		// isn't fused with the branch and tests the truthiness of a pushed value instead
+		auto loop = []( const std::string& condition ) {
+			return "const count = ( n ) -> {						\
+					var c = 0;										\
+					for ( var i = 0; " + condition + "; i++ ) {		\
+						if ( i != c ) { c = -1; }					\
+						c++;										\
+					}												\
+					return c;										\
+				};													\
+				return [ count: 2000000 ];";
+		};
+
+		auto run = [ & ]( const std::string& source, uint8_t flags ) {
+			QScript::Config_t config( true );
+			config.m_CompilerFlags = flags;
+
+			auto fn = QScript::Compile( source, config );
+			auto time = Measure( s_Repetitions, [ & ]() {
+				VM_t vm( fn );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+			} );
+
+			QScript::FreeFunction( fn );
+			return time;
+		};
+
+		Report( "Compare-and-branch, 2 * 10^6 loop iterations", {
+			{ "!( i >= n ), OF_NONE", run( loop( "!( i >= n )" ), QScript::Config_t::OF_NONE ) },
+			{ "i < n, OF_NONE", run( loop( "i < n" ), QScript::Config_t::OF_NONE ) },
+			{ "!( i >= n ), OF_PEEPHOLE", run( loop( "!( i >= n )" ), QScript::Config_t::OF_PEEPHOLE ) },
+			{ "i < n, OF_PEEPHOLE", run( loop( "i < n" ), QScript::Config_t::OF_PEEPHOLE ) },
+		} );
+	}
+
+	static void BenchDirectCall()
+	{
+		static const int s_Repetitions = 5;
+
+		// Recursion and calls to a helper, const functions are called directly while functions in
+		// a var are loaded and go through the generic call path
+		auto program = []( const std::string& declaration ) {
+			return declaration + " half = ( n ) -> { return n / 2; };				\
+				" + declaration + " fib = ( n ) -> {									\
+					if ( n < 2 ) return n;											\
+					return [ fib: n - 1 ] + [ fib: n - 2 ] + [ half: 0 ];			\
+				};																	\
+				return [ fib: 25 ];";
+		};
+
+		auto run = [ & ]( const std::string& source ) {
+			QScript::Config_t config( true );
+			config.m_CompilerFlags = QScript::Config_t::OF_ALL;
+
+			auto fn = QScript::Compile( source, config );
+			auto time = Measure( s_Repetitions, [ & ]() {
+				VM_t vm( fn );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+			} );
+
+			QScript::FreeFunction( fn );
+			return time;
+		};
+
+		Report( "Direct calls, fib( 25 ) with a helper call per frame", {
+			{ "var functions", run( program( "var" ) ) },
+			{ "const functions", run( program( "const" ) ) },
+		} );
+	}
+
+	static void BenchClosures()
+	{
+		static const int s_Repetitions = 5;
+
+		auto run = [ & ]( const std::string& source ) {
+			auto fn = QScript::Compile( source );
+			auto time = Measure( s_Repetitions, [ & ]() {
+				VM_t vm( fn );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+			} );
+
+			QScript::FreeFunction( fn );
+			return time;
+		};
+
+		Report( "Closures", {
+			{ "Create and call 10^5 counters", run( "const makeCounter = ( start ) -> {	\
+					var count = start;												\
+					return () -> { count = count + 1; return count; };				\
+				};																	\
+				var total = 0;														\
+				for ( var i = 0; i < 100000; ++i ) {								\
+					var counter = [ makeCounter: i ];								\
+					total = total + [ counter ] + [ counter ] + [ counter ];			\
+				}																	\
+				return total;" ) },
+			{ "10^6 calls reading and writing 3 upvalues", run( "const run = () -> {	\
+					var a = 1;														\
+					var b = 2;														\
+					var c = 0;														\
+					const step = ( x ) -> { c = c + a * x + b; return c; };			\
+					for ( var i = 0; i < 1000000; ++i ) {							\
+						[ step: i ];												\
+					}																\
+					return c;														\
+				};																	\
+				return [ run ];" ) },
+		} );
+	}
+
+	static void BenchClasses()
+	{
+		static const int s_Repetitions = 3;
+
+		auto run = [ & ]( const std::string& source ) {
+			auto fn = QScript::Compile( source );
+			auto time = Measure( s_Repetitions, [ & ]() {
+				VM_t vm( fn );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+			} );
+
+			QScript::FreeFunction( fn );
+			return time;
+		};
+
+		const std::string methods = "GetX() -> { return this.x; };				\
+			GetY() -> { return this.y; };										\
+			Sum() -> { return this.x + this.y; };								\
+			Scale( k ) -> { this.x = this.x * k; return this.x; };				\
+			Area() -> { return this.x * this.y; };";
+
+		// The same object with 5 methods, built by a factory that binds a copy of every method
+		// into a new table, and declared as a class that shares them between its instances
+		Report( "Objects with 5 methods, construct 10^6 and call a method on each", {
+			{ "Table factory", run( "const make = ( a, b ) -> {					\
+					Table t = { var x = 0; var y = 0; " + methods + " };			\
+					t.x = a;														\
+					t.y = b;														\
+					return t;														\
+				};																	\
+				var total = 0;														\
+				for ( var i = 0; i < 1000000; ++i ) {								\
+					var p = [ make: i, 2 ];											\
+					total = total + [ p.Sum ];										\
+				}																	\
+				return total;" ) },
+			{ "Class", run( "Class Point = { var x = 0; var y = 0; " + methods + " };	\
+				var total = 0;														\
+				for ( var i = 0; i < 1000000; ++i ) {								\
+					var p = [ Point: i, 2 ];										\
+					total = total + [ p.Sum ];										\
+				}																	\
+				return total;" ) },
+		} );
+	}
+
+	static void BenchFieldSlots()
+	{
+		static const int s_Repetitions = 3;
+
+		auto run = [ & ]( const std::string& source ) {
+			auto fn = QScript::Compile( source );
+			auto time = Measure( s_Repetitions, [ & ]() {
+				VM_t vm( fn );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+			} );
+
+			QScript::FreeFunction( fn );
+			return time;
+		};
+
+		const std::string loop = "for ( var i = 0; i < 1000000; ++i ) {	\
+				b.x = b.x + b.v;												\
+				b.v = b.v + 1;													\
+			}																	\
+			return b.x;";
+
+		// Fields looked up by name in a table, by name in an instance held by a variable, and
+		// by slot in an instance held by a constant
+		Report( "Read 3 and write 2 fields, 10^6 iterations", {
+			{ "Table", run( "Table b = { var x = 0; var v = 1; }; " + loop ) },
+			{ "Class (var)", run( "Class Body = { num x = 0; num v = 1; }; var b = [ Body ]; " + loop ) },
+			{ "Class (const)", run( "Class Body = { num x = 0; num v = 1; }; const b = [ Body ]; " + loop ) },
+		} );
+	}
+
+	static void BenchTailCalls()
+	{
+		static const int s_Repetitions = 3;
+
+		// Plain recursion needs a frame per number
+		QScript::Config_t config( true );
+		config.m_MaxCallDepth = 2000000;
+
+		auto run = [ & ]( const std::string& source ) {
+			auto fn = QScript::Compile( source );
+			auto time = Measure( s_Repetitions, [ & ]() {
+				VM_t vm( fn, config );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+			} );
+
+			QScript::FreeFunction( fn );
+			return time;
+		};
+
+		// The same sum, adding up after each call returns and passing the sum along to the call
+		Report( "Sum 1..10^6 recursively", {
+			{ "Recursion", run( "const sum = ( n ) -> {							\
+					if ( n == 0 ) return 0;											\
+					return n + [ sum: n - 1 ];										\
+				};																	\
+				return [ sum: 1000000 ];" ) },
+			{ "Tail recursion", run( "const sum = ( n, acc ) -> {				\
+					if ( n == 0 ) return acc;										\
+					return [ sum: n - 1, acc + n ];									\
+				};																	\
+				return [ sum: 1000000, 0 ];" ) },
+		} );
+	}
+
+	static void BenchLazyCompilation()
+	{
+		static const int s_Repetitions = 3;
+
+		// 100k lines of generated source, of which the program only calls one function
+		std::string source;
+		for ( int i = 0; i < 20000; ++i )
+		{
+			auto index = std::to_string( i );
+			source += "const f" + index + " = ( num x ) -> auto {\n"
+				"\tvar y = x * " + index + " + ( x - 1 ) / 2;\n"
+				"\tif ( y >= 10 && y != 20 ) { return [f" + index + ": y - 1]; }\n"
+				"\tfor ( var i = 0; i < 10; i += 1 ) { y = y % 3 ? y : -y; }\n"
+				"\treturn y; };\n";
+		}
+
+		source += "return [f0: 3];";
+
+		auto run = [ & ]( bool lazy ) {
+			QScript::Config_t config( false );
+			config.m_LazyCompilation = lazy;
+
+			return Measure( s_Repetitions, [ & ]() {
+				auto fn = QScript::Compile( source, config );
+				VM_t vm( fn, config );
+				QScript::Interpret( vm, NULL );
+				vm.Release();
+				QScript::FreeFunction( fn );
+			} );
+		};
+
+		Report( "Lazy compilation, 100k lines calling 1 of 20000 functions", {
+			{ "Eager", run( false ) },
+			{ "Lazy", run( true ) },
+		} );
+	}
+
+	void BenchInterpreter()
+	{
+		BenchArrayKernels();
+		BenchHigherOrder();
+		BenchParallel();
+		BenchStartup();
+		BenchBytecode();
+		BenchLexer();
+		BenchParser();
+		BenchConstants();
+		BenchOptimizer();
+		BenchPeephole();
+		BenchSuperinstructions();
+		BenchCompareBranch();
+		BenchDirectCall();
+		BenchClosures();
+		BenchClasses();
+		BenchFieldSlots();
+		BenchTailCalls();
+		BenchLazyCompilation();
+	}
+}
@@ -0,0 +1,69 @@
+#include "QLibPCH.h"
+#include "Benchmarks.h"
+#include "Utils.h"
+
+#include "../Library/Common/Chunk.h"
+
+#include <chrono>
+
+namespace Benchmarks
+{
+	double Measure( int repetitions, std::function< void() > fn )
+	{
+		double best = std::numeric_limits< double >::max();
+
+		for ( int i = 0; i < repetitions; ++i )
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			fn();
+			auto end = std::chrono::high_resolution_clock::now();
+
+			best = std::min( best, std::chrono::duration< double >( end - start ).count() );
+		}
+
+		return best;
+	}
+
+	std::vector< double > RunTimedScript( const std::string& code )
+	{
+		QScript::Value exitCode;
+		std::vector< double > timings;
+
+		try
+		{
+			TestUtils::RunVM( code, &exitCode );
+		}
+		catch ( const std::vector< CompilerException >& exceptions )
+		{
+			for ( auto exception : exceptions )
+				std::cout << "\t\033[31m[Compiler Exception]" << exception.describe() << "\033[39m" << std::endl;
+		}
+		catch ( const Exception& exception )
+		{
+			std::cout << "\t\033[31m[Exception]" << exception.describe() << "\033[39m" << std::endl;
+		}
+
+		if ( IS_ARRAY( exitCode ) )
+		{
+			for ( auto value : AS_ARRAY( exitCode )->GetArray() )
+				timings.push_back( IS_NUMBER( value ) ? AS_NUMBER( value ) : -1.0 );
+		}
+
+		TestUtils::FreeExitCode( exitCode );
+		return timings;
+	}
+
+	void Report( const std::string& name, const std::vector< BenchResult_t >& results )
+	{
+		std::cout << "[Benchmarks] " << name << std::endl;
+
+		for ( auto& result : results )
+		{
+			std::cout << "\t" << std::left << std::setw( 60 ) << result.m_Description
+				<< std::right << std::fixed << std::setprecision( 2 ) << std::setw( 10 )
+				<< result.m_Seconds * 1000.0 << " ms" << std::endl;
+		}
+
+		std::cout.unsetf( std::ios_base::floatfield );
+	}
+}
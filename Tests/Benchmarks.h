@@ -0,0 +1,20 @@
+#pragma once
+
+namespace Benchmarks
+{
+	void BenchInterpreter();
+
+	struct BenchResult_t
+	{
+		std::string		m_Description;
+		double			m_Seconds;
+	};
+
+	// Run code once, returning the wall time of the best of the given repetitions
+	double Measure( int repetitions, std::function< void() > fn );
+
+	// Run a script that returns an array of timings (in seconds)
+	std::vector< double > RunTimedScript( const std::string& code );
+
+	void Report( const std::string& name, const std::vector< BenchResult_t >& results );
+}
@@ -1,5 +1,7 @@
 #include "QLibPCH.h"
 #include "Tests.h"
+#include <filesystem>
+#include <set>
 #include "Instructions.h"
 
 #include "../Library/Common/Chunk.h"
@@ -19,6 +21,14 @@ UTEST_ASSERT( fn->GetChunk()->m_Code[ address ] == QScript::OpCode::opcode )
 UTEST_ASSERT( fn->GetChunk()->m_Code[ opcodeOffset ] == QScript::OpCode::opcode ) \
 opcodeOffset += Disassembler::InstructionSize( fn->GetChunk()->m_Code[ opcodeOffset ] ); \
 
+// A program, what it returns and how many of the opcodes under test its bytecode holds
+struct OpCodeProgram_t
+{
+	std::string			m_Source;
+	std::string			m_Result;
+	std::vector< int >	m_OpCodeCounts;
+};
+
 bool Tests::TestCompiler()
 {
 #ifdef _DEBUG
@@ -86,6 +96,10 @@ bool Tests::TestCompiler()
 			const std::vector< CompilerException >& e,
 			e.size() == 1 && e[ 0 ].id() == "cp_identifier_already_exists" );
 
+		UTEST_THROW_EXCEPTION( QScript::Compile( "Class P = { num x; M() -> { return 1; }; num M; };" ),
+			const std::vector< CompilerException >& e,
+			e.size() == 1 && e[ 0 ].id() == "cp_identifier_already_exists" );
+
 		UTEST_CASE_CLOSED();
 	}( );
 
@@ -234,5 +248,506 @@ bool Tests::TestCompiler()
 		UTEST_CASE_CLOSED();
 	}( );
 
+	UTEST_CASE( "Compile cache (memory and disk tiers)" )
+	{
+		static const char* s_Directory = "qs_test_cache";
+
+		const std::string source = "const f = ( x ) -> { return x + \"a\"; }; return [ f: 2 ];";
+
+		auto sameCode = []( QScript::FunctionObject* a, QScript::FunctionObject* b ) {
+			auto& codeA = a->GetChunk()->m_Code;
+			auto& codeB = b->GetChunk()->m_Code;
+			return codeA.size() == codeB.size() && std::equal( codeA.begin(), codeA.end(), codeB.begin() );
+		};
+
+		QScript::ClearCompileCache();
+
+		auto reference = QScript::Compile( source );
+		auto first = QScript::CompileCached( source );
+		auto second = QScript::CompileCached( source );
+
+		// Every lookup hands out a separate function
+		UTEST_ASSERT( first != second );
+		UTEST_ASSERT( sameCode( reference, first ) && sameCode( reference, second ) );
+		UTEST_ASSERT( QScript::CompileCacheStats().m_MemoryHits == 1 );
+		UTEST_ASSERT( QScript::CompileCacheStats().m_Misses == 1 );
+
+		QScript::FreeFunction( first );
+		QScript::FreeFunction( second );
+
+		// Config is part of the key
+		QScript::FreeFunction( QScript::CompileCached( source, QScript::Config_t( false ) ) );
+		UTEST_ASSERT( QScript::CompileCacheStats().m_Misses == 2 );
+
+		// Least recently used entries are dropped
+		QScript::SetCompileCacheCapacity( 1 );
+		QScript::FreeFunction( QScript::CompileCached( source ) );
+		UTEST_ASSERT( QScript::CompileCacheStats().m_Misses == 3 );
+		QScript::SetCompileCacheCapacity( 256 );
+
+		// Disk tier survives clearing the memory tier
+		QScript::ClearCompileCache();
+		QScript::SetCompileCacheDirectory( s_Directory );
+
+		QScript::FreeFunction( QScript::CompileCached( source ) );
+		QScript::ClearCompileCache();
+
+		auto fromDisk = QScript::CompileCached( source );
+		UTEST_ASSERT( sameCode( reference, fromDisk ) );
+		UTEST_ASSERT( QScript::CompileCacheStats().m_DiskHits == 1 );
+		UTEST_ASSERT( QScript::CompileCacheStats().m_Misses == 0 );
+
+		QScript::FreeFunction( fromDisk );
+		QScript::FreeFunction( reference );
+
+		// Compile errors are not cached
+		UTEST_THROW_EXCEPTION( QScript::CompileCached( "const x = 1; x = 2;" ),
+			const std::vector< CompilerException >& e,
+			e.size() == 1 && e[ 0 ].id() == "cp_assign_to_const" );
+
+		QScript::SetCompileCacheDirectory( "" );
+		QScript::ClearCompileCache();
+		std::filesystem::remove_all( s_Directory );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Syntax trees in a node arena" )
+	{
+		Compiler::NodeArena arena;
+		auto nodes = QScript::GenerateAST( "const greeting = \"hello\"; [print: greeting + \"!\"];", &arena );
+
+		// Two statements and the terminating return
+		UTEST_ASSERT( nodes.size() == 3 );
+		UTEST_ASSERT( nodes[ 0 ]->Id() == NODE_CONSTVAR );
+		UTEST_ASSERT( nodes[ 0 ]->Token() == "const" );
+		UTEST_ASSERT( nodes[ 1 ]->Id() == NODE_CALL );
+		UTEST_ASSERT( nodes[ 2 ]->Id() == NODE_RETURN );
+
+		auto varNode = static_cast< ListNode* >( nodes[ 0 ] );
+		auto& list = varNode->GetList();
+		UTEST_ASSERT( list.size() == 3 );
+		UTEST_ASSERT( list[ 0 ]->Token() == "greeting" );
+
+		// Values in the tree stay alive with the arena
+		auto value = static_cast< ValueNode* >( list[ 1 ] )->GetValue();
+		UTEST_ASSERT( IS_STRING( value ) && AS_STRING( value )->GetString() == "hello" );
+
+		// Errors free the partially built tree with the arena
+		Compiler::NodeArena errorArena;
+		UTEST_THROW_EXCEPTION( QScript::GenerateAST( "const x = ( 1 + ; const y = 2;", &errorArena ),
+			const std::vector< CompilerException >& e,
+			e.size() > 0 );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Constant folding and dead code elimination" )
+	{
+		QScript::Config_t config( true );
+		config.m_CompilerFlags = QScript::Config_t::OF_ALL;
+
+		auto largeExpression = TestUtils::GenerateSequence( s_LargeConstCount, []( int iter ) {
+			return "0.00" + std::string( iter == ( s_LargeConstCount - 1 ) ? "" : "+" );
+		} );
+
+		// The whole expression is a single constant load
+		auto fn = QScript::Compile( "return " + largeExpression + ";", config );
+
+		ASSERT_OPCODE( 0000, OP_LOAD_0 );
+		ASSERT_OPCODE_NEXT( OP_RETURN );
+
+		QScript::FreeFunction( fn );
+
+		// Branches with constant conditions leave no jumps behind
+		fn = QScript::Compile( "var x = 1; if ( 1 > 2 ) { x = 2; } while ( !true ) { x = 3; } return 1 == 1 ? x : 0;", config );
+
+		auto& code = fn->GetChunk()->m_Code;
+		for ( size_t offset = 0; offset < code.size(); offset += Disassembler::InstructionSize( code[ offset ] ) )
+		{
+			UTEST_ASSERT( code[ offset ] != QScript::OpCode::OP_JUMP_IF_ZERO_SHORT );
+			UTEST_ASSERT( code[ offset ] != QScript::OpCode::OP_JUMP_BACK_SHORT );
+		}
+
+		QScript::FreeFunction( fn );
+
+		// Optimized programs produce the same results as unoptimized ones
+		std::vector< std::string > programs = {
+			"return 2 ** 10 - 24 / 4 % 5;",
+			"return \"a\" + 1 + 2.5 + \"b\";",
+			"return ( 1 < 2 ) == !false;",
+			"return -( 4 - 6 ) * 0.5 >= 1;",
+			"return \"abc\" == \"ab\" + \"c\";",
+			"return true && 5 || 6;",
+			"var x = 3; return x ** 2 + x / 4 + x / 0.5;",
+			"var x = 0; if ( 1 > 2 ) x = 1; else x = 2; return x;",
+			"var x = 0; while ( 1 == 2 ) x = x + 1; return x;",
+			"return 1 == 1 ? \"yes\" : \"no\";",
+			"var f = ( n ) -> { if ( n > 1 ) { return n * 2; } else { return n; } return 0; }; return [f: 4] + [f: 1];",
+		};
+
+		for ( auto& program : programs )
+		{
+			QScript::Value optimized;
+			QScript::Value unoptimized;
+
+			UTEST_ASSERT( TestUtils::RunVM( program, &optimized, config ) );
+			UTEST_ASSERT( TestUtils::RunVM( program, &unoptimized ) );
+
+			UTEST_ASSERT( optimized.ToString() == unoptimized.ToString() );
+
+			TestUtils::FreeExitCode( optimized );
+			TestUtils::FreeExitCode( unoptimized );
+		}
+
+		// Code is checked before it's dropped, optimizing doesn't change which programs compile
+		std::vector< std::string > invalidPrograms = {
+			"num y = true ? 1 : \"s\";",
+			"const f = () -> { return 1; var q = \"a\" - 1; };",
+			"if ( false ) { var q = \"a\" - 1; }",
+			"while ( false ) { num q = \"a\"; }",
+		};
+
+		for ( auto& program : invalidPrograms )
+		{
+			UTEST_THROW_EXCEPTION( QScript::Compile( program ),
+				const std::vector< CompilerException >& e, e.size() == 1 && e[ 0 ].id() == "cp_invalid_expression_type" );
+
+			UTEST_THROW_EXCEPTION( QScript::Compile( program, config ),
+				const std::vector< CompilerException >& e, e.size() == 1 && e[ 0 ].id() == "cp_invalid_expression_type" );
+		}
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Peephole optimization" )
+	{
+		QScript::Config_t config( true );
+		config.m_CompilerFlags = QScript::Config_t::OF_PEEPHOLE;
+
+		auto forEachOpCode = []( QScript::FunctionObject* function, std::function< void( uint32_t offset, uint8_t opCode ) > fn ) {
+			auto& code = function->GetChunk()->m_Code;
+			for ( uint32_t offset = 0; offset < code.size(); offset += Disassembler::InstructionSize( code[ offset ] ) )
+				fn( offset, code[ offset ] );
+		};
+
+		// Assignment statements store without leaving a value behind to pop
+		auto fn = QScript::Compile( "var x = 0; var y = 1; for ( var i = 0; i < 10; i++ ) { x = x + i; y = y * 2; } return x + y;", config );
+
+		int stores = 0;
+		uint8_t previous = QScript::OpCode::OP_NOP;
+
+		forEachOpCode( fn, [ & ]( uint32_t, uint8_t opCode ) {
+			if ( opCode >= QScript::OpCode::OP_STORE_GLOBAL_SHORT && opCode <= QScript::OpCode::OP_STORE_LOCAL_11 )
+				++stores;
+
+			if ( opCode == QScript::OpCode::OP_POP )
+			{
+				UTEST_ASSERT( previous < QScript::OpCode::OP_SET_GLOBAL_LONG || previous > QScript::OpCode::OP_SET_LOCAL_11 );
+			}
+
+			previous = opCode;
+		} );
+
+		UTEST_ASSERT( stores > 0 );
+		QScript::FreeFunction( fn );
+
+		// Code after a return is dropped
+		fn = QScript::Compile( "var f = ( n ) -> { return n + 1; }; return [f: 1];", config );
+
+		for ( auto constant : fn->GetChunk()->m_Constants )
+		{
+			if ( !IS_FUNCTION( constant ) )
+				continue;
+
+			int returns = 0;
+			forEachOpCode( AS_FUNCTION( constant ), [ & ]( uint32_t, uint8_t opCode ) {
+				returns += ( opCode == QScript::OpCode::OP_RETURN ) ? 1 : 0;
+			} );
+
+			UTEST_ASSERT( returns == 1 );
+		}
+
+		QScript::FreeFunction( fn );
+
+		// Jumps over large bodies stay correct and debug symbols still cover the same lines
+		auto largeBody = TestUtils::GenerateSequence( s_LargeConstCount, []( int iter ) {
+			return "x = x + " + std::to_string( iter % 7 ) + ";\n";
+		} );
+
+		std::string largeProgram = "var x = 0;\nfor ( var i = 0; i < 3; i++ ) {\n" + largeBody + "}\nreturn x;";
+
+		auto unoptimizedFn = QScript::Compile( largeProgram );
+		fn = QScript::Compile( largeProgram, config );
+
+		UTEST_ASSERT( fn->GetChunk()->m_Code.size() < unoptimizedFn->GetChunk()->m_Code.size() );
+
+		auto collectLines = [ & ]( QScript::FunctionObject* function ) {
+			std::set< int > lines;
+			forEachOpCode( function, [ & ]( uint32_t offset, uint8_t ) {
+				QScript::Chunk_t::Debug_t symbol;
+				if ( Disassembler::FindDebugSymbol( *function->GetChunk(), offset, &symbol ) )
+					lines.insert( symbol.m_Line );
+			} );
+
+			return lines;
+		};
+
+		UTEST_ASSERT( collectLines( fn ) == collectLines( unoptimizedFn ) );
+
+		QScript::FreeFunction( fn );
+		QScript::FreeFunction( unoptimizedFn );
+
+		// Optimized programs produce the same results as unoptimized ones
+		std::vector< std::string > programs = {
+			largeProgram,
+			"var x = 0; while ( x < 100 ) { x += 3; if ( x % 2 == 0 ) { x++; } else { x += 2; } } return x;",
+			"var s = \"\"; for ( var i = 0; i < 5; i++ ) { s += i; } return s;",
+			"Array a = { 1, 2, 3 }; var sum = 0; for ( var i = 0; i < 3; i++ ) { sum += a( i ); } return sum;",
+			"var f = ( n ) -> { var r = 1; for ( var i = 2; i <= n; i++ ) { r *= i; } return r; }; return [f: 6];",
+			"var x = 1; var g = () -> { return x; }; x = 5; return [g];",
+			"var x = 0; x = x > 1 && x < 3 || x == 0 ? 10 : 20; return x;",
+		};
+
+		for ( auto& program : programs )
+		{
+			QScript::Value optimized;
+			QScript::Value unoptimized;
+
+			UTEST_ASSERT( TestUtils::RunVM( program, &optimized, config ) );
+			UTEST_ASSERT( TestUtils::RunVM( program, &unoptimized ) );
+
+			UTEST_ASSERT( optimized.ToString() == unoptimized.ToString() );
+
+			TestUtils::FreeExitCode( optimized );
+			TestUtils::FreeExitCode( unoptimized );
+		}
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Superinstructions" )
+	{
+		QScript::Config_t config( true );
+		config.m_CompilerFlags = QScript::Config_t::OF_ALL;
+
+		QScript::Config_t unfusedConfig( true );
+		unfusedConfig.m_CompilerFlags = QScript::Config_t::OF_ALL & ~QScript::Config_t::OF_SUPERINSTRUCTIONS;
+
+		// The condition jump of the first loop is too far for a fused short jump
+		auto largeBody = TestUtils::GenerateSequence( s_LargeConstCount, []( int iter ) {
+			return "y = y + " + std::to_string( iter % 5 ) + ";";
+		} );
+
+		std::vector< std::string > programs = {
+			"const f = ( n ) -> { var x = n; var y = 0; while ( x != 1 ) { " + largeBody + " x = x - 1; } return y; }; return [f: 4];",
+			"const f = ( n ) -> { var x = n; var steps = 0; while ( x != 1 ) { if ( x % 2 == 0 ) { x = x / 2; } else { x = x * 3 + 1; } steps += 1; } return steps; }; return [f: 27];",
+			"const f = ( n ) -> { var s = 0; for ( var i = 0; i < n; i++ ) { s = s + i * 2; } return s; }; return [f: 100];",
+			"const f = ( a, b ) -> { if ( a <= 1 ) return b; return [f: a - 1, b * 3 - 2]; }; return [f: 6, 2];",
+			"var s = \"\"; for ( var i = 0; i < 5; i++ ) { s = s + i; } return s;",
+		};
+
+		int fused = 0;
+
+		for ( auto& program : programs )
+		{
+			auto fn = QScript::Compile( program, config );
+
+			// Instruction sizes still walk the code from start to end, none of the closures capture
+			auto complete = TestUtils::ForEachOpCode( fn, [ & ]( uint8_t opCode ) {
+				fused += ( opCode >= QScript::OpCode::OP_SUPERINSTRUCTION_FIRST ) ? 1 : 0;
+			} );
+
+			QScript::FreeFunction( fn );
+			UTEST_ASSERT( complete );
+
+			QScript::Value optimized;
+			QScript::Value unfused;
+
+			UTEST_ASSERT( TestUtils::RunVM( program, &optimized, config ) );
+			UTEST_ASSERT( TestUtils::RunVM( program, &unfused, unfusedConfig ) );
+
+			UTEST_ASSERT( optimized.ToString() == unfused.ToString() );
+
+			TestUtils::FreeExitCode( optimized );
+			TestUtils::FreeExitCode( unfused );
+		}
+
+		// The loops above are the ones the shipped set was generated for
+		UTEST_ASSERT( fused > 0 );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Compare and branch" )
+	{
+		auto isBranch = []( uint8_t opCode ) {
+			return opCode >= QScript::OpCode::OP_JUMP_IF_NOT_LT_SHORT && opCode <= QScript::OpCode::OP_JUMP_IF_NOT_NE_LOCAL_LOCAL;
+		};
+
+		auto isOperandBranch = []( uint8_t opCode ) {
+			return opCode >= QScript::OpCode::OP_JUMP_IF_NOT_LT_LOCAL_CONSTANT && opCode <= QScript::OpCode::OP_JUMP_IF_NOT_NE_LOCAL_LOCAL;
+		};
+
+		// Branches over the large body are long
+		auto largeBody = TestUtils::GenerateSequence( s_LargeConstCount, []( int iter ) {
+			return "y = y + " + std::to_string( iter % 5 ) + ";";
+		} );
+
+		std::vector< std::pair< std::string, std::string > > programs = {
+			{ "const f = ( n ) -> { var s = 0; for ( var i = 0; i < n; i++ ) { if ( i % 3 == 0 ) s += i; else s -= 1; } return s; }; return [f: 100];", "1617.00" },
+			{ "const f = ( n ) -> { var k = n; var c = 0; while ( k > 5 ) { k--; c++; } do { k++; } while ( k != 12 ); return k * 100 + c; }; return [f: 10];", "1205.00" },
+			{ "const f = ( a, b ) -> { if ( a <= 1 ) return b; return [f: a - 1, b * 3 - 2]; }; return [f: 6, 2];", "244.00" },
+			{ "const f = ( n ) -> { var x = 0; var y = 0; while ( x <= n ) { x++; } for ( var i = 10; i >= x; i-- ) { y++; } return y; }; return [f: 7];", "3.00" },
+			{ "const f = ( n ) -> { var x = 0; var y = 0; while ( x < n ) { " + largeBody + " x++; } return x; }; return [f: 3];", "3.00" },
+			{ "var s = \"a\"; var t = \"\"; while ( s != \"aaa\" ) { s = s + \"a\"; t = t + \"b\"; } if ( t == \"bb\" ) return t; return null;", "bb" },
+			{ "var n = null; var b = true; var r = 0; if ( b != false ) r += 1; if ( b == true ) r += 10; if ( n != 0 ) r += 100; return r < 200 ? r : 0;", "111.00" },
+		};
+
+		std::vector< uint32_t > flags = {
+			QScript::Config_t::OF_NONE,
+			QScript::Config_t::OF_PEEPHOLE,
+			QScript::Config_t::OF_ALL,
+		};
+
+		for ( auto flag : flags )
+		{
+			QScript::Config_t config( true );
+			config.m_CompilerFlags = flag;
+
+			int branches = 0;
+			int operandBranches = 0;
+
+			for ( auto& program : programs )
+			{
+				auto fn = QScript::Compile( program.first, config );
+
+				auto complete = TestUtils::ForEachOpCode( fn, [ & ]( uint8_t opCode ) {
+					// Conditions of the branches are all comparisons
+					UTEST_ASSERT( opCode != QScript::OpCode::OP_JUMP_IF_ZERO_SHORT );
+					UTEST_ASSERT( opCode != QScript::OpCode::OP_JUMP_IF_ZERO_LONG );
+
+					branches += isBranch( opCode ) ? 1 : 0;
+					operandBranches += isOperandBranch( opCode ) ? 1 : 0;
+				} );
+
+				QScript::FreeFunction( fn );
+				UTEST_ASSERT( complete );
+
+				QScript::Value exitCode;
+				UTEST_ASSERT( TestUtils::RunVM( program.first, &exitCode, config ) );
+				UTEST_ASSERT( exitCode.ToString() == program.second );
+				TestUtils::FreeExitCode( exitCode );
+			}
+
+			UTEST_ASSERT( branches > 0 );
+
+			// Operands are only folded into the branch by the peephole pass
+			if ( flag & QScript::Config_t::OF_PEEPHOLE )
+			{
+				UTEST_ASSERT( operandBranches > 0 );
+			}
+			else
+			{
+				UTEST_ASSERT( operandBranches == 0 );
+			}
+		}
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Direct calls" )
+	{
+		// Counts are direct calls, then self calls
+		std::vector< OpCodeProgram_t > programs = {
+			{ "const fib = ( n ) -> { if ( n < 2 ) return n; return [fib: n - 1] + [fib: n - 2]; }; return [fib: 15];", "610.00", { 1, 2 } },
+			{ "const sq = ( n ) -> { return n * n; }; const f = ( n ) -> { return [sq: n] + [sq: n + 1]; }; return [f: 3];", "25.00", { 3, 0 } },
+			{ "var sq = ( n ) -> { return n * n; }; var f = ( n ) -> { return [sq: n] + [sq: 2]; }; return [f: 3];", "13.00", { 0, 0 } },
+			{ "const f = () -> { return f; }; const g = f; return [f] == f && g == f;", "True", { 1, 0 } },
+			{ "var x = 2; const f = ( n ) -> { return n * x; }; x = 5; return [f: 3];", "15.00", { 1, 0 } },
+			{ "const f = ( n ) -> { var k = n * 2; const g = () -> { return k; }; return [g]; }; return [f: 4];", "8.00", { 1, 0 } },
+		};
+
+		for ( auto& program : programs )
+		{
+			auto fn = QScript::Compile( program.m_Source );
+
+			int directCalls = 0;
+			int selfCalls = 0;
+
+			auto complete = TestUtils::ForEachOpCode( fn, [ & ]( uint8_t opCode ) {
+				directCalls += ( opCode == QScript::OpCode::OP_CALL_DIRECT_SHORT || opCode == QScript::OpCode::OP_CALL_DIRECT_LONG ) ? 1 : 0;
+				selfCalls += opCode == QScript::OpCode::OP_CALL_SELF ? 1 : 0;
+			} );
+
+			QScript::FreeFunction( fn );
+
+			UTEST_ASSERT( complete );
+
+			UTEST_ASSERT( directCalls == program.m_OpCodeCounts[ 0 ] );
+			UTEST_ASSERT( selfCalls == program.m_OpCodeCounts[ 1 ] );
+
+			QScript::Value exitCode;
+			UTEST_ASSERT( TestUtils::RunVM( program.m_Source, &exitCode ) );
+			UTEST_ASSERT( exitCode.ToString() == program.m_Result );
+			TestUtils::FreeExitCode( exitCode );
+		}
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Class field slots" )
+	{
+		// Counts are slot loads and stores
+		std::vector< OpCodeProgram_t > programs = {
+			{ "Class P = { num x = 1; Get() -> { return this.x; }; }; const p = [P]; return p.x + [p.Get];", "2.00", { 2 } },
+			{ "Class P = { num x = 1; var y; }; const p = [P: 2]; const q = p; q.y = 3; return q.x + p.y;", "5.00", { 3 } },
+			{ "Class P = { num x = 4; F() -> { const g = () -> { return this.x; }; return [g]; }; }; const p = [P]; return [p.F];", "4.00", { 1 } },
+			{ "Class P = { num x = 1; }; var p = [P]; return p.x;", "1.00", { 0 } },
+			{ "Table t = { num v = 3; Get() -> { return this.v; }; }; return [t.Get];", "3.00", { 0 } },
+		};
+
+		for ( auto& program : programs )
+		{
+			auto fn = QScript::Compile( program.m_Source );
+
+			int slotAccesses = 0;
+
+			auto complete = TestUtils::ForEachOpCode( fn, [ & ]( uint8_t opCode ) {
+				switch ( opCode )
+				{
+				case QScript::OpCode::OP_LOAD_SLOT:
+				case QScript::OpCode::OP_SET_SLOT:
+				case QScript::OpCode::OP_SET_SLOT_NUMBER:
+					++slotAccesses;
+					break;
+				default:
+					break;
+				}
+			} );
+
+			QScript::FreeFunction( fn );
+
+			UTEST_ASSERT( complete );
+			UTEST_ASSERT( slotAccesses == program.m_OpCodeCounts[ 0 ] );
+
+			QScript::Value exitCode;
+			UTEST_ASSERT( TestUtils::RunVM( program.m_Source, &exitCode ) );
+			UTEST_ASSERT( exitCode.ToString() == program.m_Result );
+			TestUtils::FreeExitCode( exitCode );
+		}
+
+		UTEST_THROW_EXCEPTION( QScript::Compile( "Class P = { num x = \"a\"; };" ),
+			const std::vector< CompilerException >& e, e.size() == 1 && e[ 0 ].id() == "cp_invalid_expression_type" );
+
+		UTEST_THROW_EXCEPTION( QScript::Compile( "Class P = { num x; }; const p = [P]; p.x = \"a\";" ),
+			const std::vector< CompilerException >& e, e.size() == 1 && e[ 0 ].id() == "cp_invalid_expression_type" );
+
+		UTEST_THROW_EXCEPTION( QScript::Compile( "Class P = { num x; }; const p = [P]; return p.y;" ),
+			const std::vector< CompilerException >& e, e.size() == 1 && e[ 0 ].id() == "cp_unknown_property" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
 	UTEST_END();
 }
@@ -1,8 +1,11 @@
 #include "QLibPCH.h"
 #include "Tests.h"
+#include "Instructions.h"
 
 #include "../Library/Common/Chunk.h"
 #include "../Library/Runtime/QVM.h"
+#include "../Library/STL/Array.h"
+#include "../Library/STL/ArrayKernels.h"
 
 #include "Utils.h"
 
@@ -552,6 +555,237 @@ bool Tests::TestInterpreter()
 		UTEST_CASE_CLOSED();
 	}( );
 
+	UTEST_CASE( "functions 4 (Tail calls)" )
+	{
+#ifdef _DEBUG
+		static const int s_Depth = 100000;
+#else
+		static const int s_Depth = 10000000;
+#endif
+
+		// Self calls and calls through variables in return position run in a single frame
+		auto fn = QScript::Compile( "const count = ( n, acc ) -> {		\
+				if ( n == 0 ) return acc;								\
+				return [count: n - 1, acc + 1];							\
+			};															\
+			var countDown = ( n ) -> {									\
+				if ( n == 0 ) return 0;									\
+				return [countDown: n - 1];								\
+			};															\
+			return [count: " + std::to_string( s_Depth ) + ", 0] + [countDown: " + std::to_string( s_Depth ) + "];" );
+
+		VM_t vm( fn );
+
+		QScript::Value exitCode;
+		QScript::Interpret( vm, &exitCode );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == ( double ) s_Depth );
+		UTEST_ASSERT( vm.m_StackCapacity == VM_t::s_InitStackSize );
+		UTEST_ASSERT( vm.m_FrameTop == vm.m_Frames );
+
+		vm.Release();
+		QScript::FreeFunction( fn );
+
+		// Locals captured by closures are closed before the callee takes over the frame
+		UTEST_ASSERT( TestUtils::RunVM( "var make = ( n, acc ) -> {	\
+				if ( n == 0 ) return acc;								\
+				const k = n;											\
+				return [make: n - 1, () -> { return k + [acc]; }];		\
+			};															\
+			return [[make: 100, () -> { return 0; }]];", &exitCode ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 5050.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		// Classes and natives return to the caller, as do functions called from natives
+		UTEST_ASSERT( TestUtils::RunVM( "Class P = { num x; };			\
+			const make = ( n ) -> { return [P: n]; };					\
+			var sq = ( x ) -> { return x * x; };						\
+			const p = [make: 4];										\
+			Array arr = { 1, 2, 3 };									\
+			const squares = [arr.map: ( x ) -> { return [sq: x]; }];	\
+			return p.x + [squares.sum];", &exitCode ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 18.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "var f = ( a ) -> { return a; }; var g = () -> { return [f]; }; [g];", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_call_arity" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "functions 5 (Call depth)" )
+	{
+		QScript::Value exitCode;
+
+		// Calls that aren't tail calls take a frame each, running out of frames is an error
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "var f = ( n ) -> {	\
+				if ( n == 0 ) return 0;								\
+				return 1 + [f: n - 1];								\
+			};														\
+			return [f: 1000000];", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_stack_overflow" );
+
+		// Main takes the first frame, f( 8 ) to f( 0 ) the rest
+		QScript::Config_t config( true );
+		config.m_MaxCallDepth = 10;
+
+		UTEST_ASSERT( TestUtils::RunVM( "var f = ( n ) -> {		\
+				if ( n == 0 ) return 0;								\
+				return 1 + [f: n - 1];								\
+			};														\
+			return [f: 8];", &exitCode, config ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 8.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "var f = ( n ) -> {	\
+				if ( n == 0 ) return 0;								\
+				return 1 + [f: n - 1];								\
+			};														\
+			return [f: 9];", &exitCode, config ),
+			const RuntimeException& e, e.id() == "rt_stack_overflow" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "functions 6 (Stack growth)" )
+	{
+		// The stack grows in place, upvalues opened before it grew still refer to their local
+		auto fn = QScript::Compile( "var outer = () -> {				\
+				var captured = 1;										\
+				var read = () -> { return captured; };					\
+				var deep = ( n ) -> {									\
+					if ( n == 0 ) return 0;								\
+					return 1 + [deep: n - 1];							\
+				};														\
+				const depth = [deep: 10000];							\
+				captured = 2;											\
+				return depth + [read];									\
+			};															\
+			return [outer];" );
+
+		VM_t vm( fn );
+		auto stack = vm.m_Stack;
+
+		QScript::Value exitCode;
+		QScript::Interpret( vm, &exitCode );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 10002.0 );
+		UTEST_ASSERT( vm.m_Stack == stack );
+		UTEST_ASSERT( vm.m_StackCapacity > VM_t::s_InitStackSize );
+
+		vm.Release();
+		QScript::FreeFunction( fn );
+
+		QScript::Config_t config( true );
+		config.m_MaxStackSize = 1000;
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "var f = ( n ) -> {	\
+				if ( n == 0 ) return 0;								\
+				return 1 + [f: n - 1];								\
+			};														\
+			return [f: 1000];", &exitCode, config ),
+			const RuntimeException& e, e.id() == "rt_stack_overflow" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "functions 7 (Lazy compilation)" )
+	{
+		QScript::Value exitCode;
+		QScript::Config_t config( true );
+		config.m_LazyCompilation = true;
+		config.m_CompilerFlags = QScript::Config_t::OF_PEEPHOLE | QScript::Config_t::OF_SUPERINSTRUCTIONS;
+
+		// Top-level functions are compiled when first called, and run as they would otherwise
+		const std::string program = "const greet = ( name ) -> { return \"hello \" + name; };	\
+			const fib = ( n ) -> {															\
+				if ( n < 2 ) return n;														\
+				return [fib: n - 1] + [fib: n - 2];											\
+			};																				\
+			const count = ( n, acc ) -> {													\
+				if ( n == 0 ) return acc;													\
+				return [count: n - 1, acc + 1];												\
+			};																				\
+			const counter = () -> {															\
+				var c = 0;																	\
+				return () -> { c = c + 1; return c; };										\
+			};																				\
+			const unused = () -> { return \"never\"; };									\
+			const next = [counter];															\
+			[next]; [next];																	\
+			return [greet: \"lazy\"] + \" \" + ( [fib: 15] + [count: 100000, 0] + [next] );";
+
+		UTEST_ASSERT( TestUtils::RunVM( program, &exitCode, config ) );
+		UTEST_ASSERT( IS_STRING( exitCode ) );
+		UTEST_ASSERT( AS_STRING( exitCode )->GetString() == "hello lazy 100613.00" );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		// Uncalled functions stay deferred
+		auto fn = QScript::Compile( program, config );
+		size_t numDeferred = 0;
+
+		for ( auto constant : fn->GetChunk()->m_Constants )
+		{
+			if ( IS_FUNCTION( constant ) && AS_FUNCTION( constant )->IsDeferred() )
+				++numDeferred;
+		}
+
+		UTEST_ASSERT( numDeferred == 5 );
+
+		VM_t vm( fn, config );
+		QScript::Interpret( vm, &exitCode );
+
+		numDeferred = 0;
+		for ( auto constant : fn->GetChunk()->m_Constants )
+		{
+			if ( IS_FUNCTION( constant ) && AS_FUNCTION( constant )->IsDeferred() )
+				++numDeferred;
+		}
+
+		UTEST_ASSERT( numDeferred == 1 );
+
+		vm.Release();
+		QScript::FreeFunction( fn );
+
+		// Callbacks are compiled before array methods look at their code
+		UTEST_ASSERT( TestUtils::RunVM( "const sq = ( x ) -> { return x * x; };	\
+			Array arr = { 1, 2, 3 };												\
+			const squares = [arr.map: sq];										\
+			return [squares.sum];", &exitCode, config ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 14.0 );
+
+		// Errors in functions that are never called go unnoticed, the others fail when called
+		UTEST_ASSERT( TestUtils::RunVM( "const f = () -> { return undefinedName; }; return 1;", &exitCode, config ) );
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 1.0 );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "const f = () -> { return undefinedName; }; return [f];", &exitCode, config ),
+			const RuntimeException& e, e.id() == "cp_unknown_identifier" );
+
+		// Globals declared after a function are still out of its reach
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "const f = () -> { return later; }; var later = 1; return [f];", &exitCode, config ),
+			const RuntimeException& e, e.id() == "cp_unknown_identifier" );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "const f = () -> { return later; }; var later = 1; return [f];", &exitCode ),
+			const std::vector< CompilerException >& e, e[ 0 ].id() == "cp_unknown_identifier" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
 	UTEST_CASE( "Closures 1 (Simple closures)" )
 	{
 		QScript::Value exitCode;
@@ -767,6 +1001,86 @@ bool Tests::TestInterpreter()
 		UTEST_CASE_CLOSED();
 	}( );
 
+	UTEST_CASE( "Closures 4 (Functions capturing nothing share their closure)" )
+	{
+		auto countAllocations = []( const std::string& code, double expected ) {
+			auto fn = QScript::Compile( code );
+			VM_t vm( fn );
+
+			QScript::Value exitCode;
+			QScript::Interpret( vm, &exitCode );
+
+			auto allocations = vm.m_NumAllocations;
+			bool valid = IS_NUMBER( exitCode ) && AS_NUMBER( exitCode ) == expected;
+
+			vm.Release();
+			QScript::FreeFunction( fn );
+			return valid ? allocations : ( uint64_t ) -1;
+		};
+
+		auto program = []( const std::string& setup, const std::string& callback ) {
+			return "Array a = { 1, 2, 3, 4 };							\
+				const f = () -> {										\
+					var k = 3;											\
+					" + setup + "										\
+					var n = 0;											\
+					for ( var i = 0; i < 1000; ++i ) {					\
+						n += [ a.find: " + callback + " ];				\
+					}													\
+					return n;											\
+				};														\
+				return [f];";
+		};
+
+		auto hoisted = countAllocations( program( "const isThree = ( x ) -> { return x == 3; };", "isThree" ), 3000 );
+		auto inlined = countAllocations( program( "", "( x ) -> { return x == 3; }" ), 3000 );
+		auto capturing = countAllocations( program( "", "( x ) -> { return x == k; }" ), 3000 );
+
+		// Evaluating a function expression in the loop allocates nothing unless it captures
+		UTEST_ASSERT( hoisted != ( uint64_t ) -1 );
+		UTEST_ASSERT( inlined == hoisted );
+		UTEST_ASSERT( capturing != ( uint64_t ) -1 && capturing >= hoisted + 1000 );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Closures 5 (Upvalues shared between closures, open upvalues across stack growth)" )
+	{
+		QScript::Value exitCode;
+		UTEST_ASSERT( TestUtils::RunVM( "const f = () -> {				\
+				var a = 1;												\
+				var b = 2;												\
+				const g = () -> { return a; };							\
+				const h = () -> { a = a * 10; return a + b; };			\
+				const k = () -> { return [h] + b; };					\
+				return [g] + [k] + [g];									\
+			};															\
+			return [f];", &exitCode ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 1 + 14 + 10 );
+
+		TestUtils::FreeExitCode( exitCode );
+		UTEST_ASSERT( TestUtils::RunVM( "const deep = ( n ) -> {		\
+				if ( n == 0 ) return 0;									\
+				return [deep: n - 1] + 1;								\
+			};															\
+			const f = () -> {											\
+				var a = 1;												\
+				const get = () -> { return a; };						\
+				var depth = [deep: 1000];								\
+				a = 5;													\
+				return [get] + depth;									\
+			};															\
+			return [f];", &exitCode ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 1005 );
+
+		TestUtils::FreeExitCode( exitCode );
+		UTEST_CASE_CLOSED();
+	}( );
+
 	UTEST_CASE( "Additional operators (%, **, +=, -=, /=, *=, %=, ++, --)" )
 	{
 		QScript::Value exitCode;
@@ -1012,6 +1326,139 @@ bool Tests::TestInterpreter()
 		UTEST_CASE_CLOSED();
 	}( );
 
+	UTEST_CASE( "Classes (Fields, constructors and methods)" )
+	{
+		QScript::Value exitCode;
+		UTEST_ASSERT( TestUtils::RunVM( "Class Vec = {			\
+				num x = 0;											\
+				num y = 0;											\
+				const scale = 2;									\
+				Dot( other ) -> num {								\
+					return this.x * other.x + this.y * other.y;		\
+				};													\
+				Scaled() -> num {									\
+					return [this.Dot: this] * this.scale;			\
+				};													\
+			};														\
+			var a = [Vec: 1, 2];									\
+			var b = [Vec: 3];										\
+			b.y = 4;												\
+			return [a.Dot: b] + [b.Scaled] + [Vec].scale;", &exitCode ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 11.0 + 50.0 + 2.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		// Local classes, methods read out of an instance stay bound to it
+		UTEST_ASSERT( TestUtils::RunVM( "var g0 = 0;				\
+			{														\
+				Class Counter = {									\
+					num n = 10;										\
+					Next() -> num { this.n += 1; return this.n; };	\
+				};													\
+				var c = [Counter];									\
+				const next = c.Next;								\
+				[next];												\
+				[c.Next];											\
+				g0 = [next] + c.n;									\
+			}														\
+			return g0;", &exitCode ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 26.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		// Property calls on tables and arrays still work the same
+		UTEST_ASSERT( TestUtils::RunVM( "Table t = { num v = 3; Get() -> { return this.v; }; };	\
+			var f = () -> { return 4; };										\
+			t.f = f;															\
+			Array arr = { 1, 2 };												\
+			[arr.push: 5];														\
+			return [t.Get] + [t.f] + [arr.sum];", &exitCode ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 15.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "Class P = { num x; }; var p = [P]; p.z = 1;", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_unknown_property" );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "Class P = { num x; }; var p = [P]; return p.z;", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_unknown_property" );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "Class P = { num x; }; var p = [P: 1, 2];", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_call_arity" );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "Class P = { M( a ) -> { return a; }; }; var p = [P]; [p.M];", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_call_arity" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Classes (Field slots and number fields)" )
+	{
+		QScript::Value exitCode;
+		UTEST_ASSERT( TestUtils::RunVM( "Class Body = {			\
+				num x = 1;											\
+				num v = 2;											\
+				var tag = \"body\";									\
+				Step( dt ) -> num {									\
+					this.x += this.v * dt;							\
+					return this.x;									\
+				};													\
+			};														\
+			const b = [Body: 0, 3];									\
+			const c = b;											\
+			[b.Step: 2];											\
+			c.v = 10;												\
+			c.tag = 5;												\
+			[c.Step: 1];											\
+			return b.x + b.v + c.tag;", &exitCode ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 16.0 + 10.0 + 5.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		// Closures inside methods reach fields through the captured "this"
+		UTEST_ASSERT( TestUtils::RunVM( "var g0 = 0;				\
+			{														\
+				Class Acc = {										\
+					num sum;										\
+					AddAll( n ) -> {								\
+						const add = ( k ) -> { this.sum += k; };	\
+						for ( var i = 1; i <= n; ++i ) [add: i];	\
+						return this.sum;							\
+					};												\
+				};													\
+				const a = [Acc];									\
+				g0 = [a.AddAll: 4] + a.sum;							\
+			}														\
+			return g0;", &exitCode ) );
+
+		UTEST_ASSERT( IS_NUMBER( exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 20.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "Class P = { num x; }; var p = [P: \"a\"];", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_field_type" );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "Class P = { num x; }; var p = [P]; p.x = \"a\";", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_field_type" );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "Class P = { num x; S( v ) -> { this.x = v; }; }; const p = [P]; [p.S: \"a\"];", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_field_type" );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "var s = \"a\"; Class P = { num x = s; };", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_field_type" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
 	UTEST_CASE( "Arrays (Simple arrays)" )
 	{
 		QScript::Value exitCode;
@@ -1377,6 +1824,254 @@ bool Tests::TestInterpreter()
 		UTEST_CASE_CLOSED();
 	}( );
 
+	UTEST_CASE( "Arrays (Float64Array)" )
+	{
+		QScript::Value exitCode;
+		UTEST_ASSERT( TestUtils::RunVM( "var g0;			\
+			{												\
+				var a = [ Float64Array: 4 ];				\
+				a( 1 ) = 2.5;								\
+				a( 3 ) = a( 1 ) * 2;						\
+				[ a.push: 7 ];								\
+				Array c = { 1, 2, 3 };						\
+				var b = [ Float64Array: c ];				\
+				g0 = [ [ a.concat: b ].slice: 1, 7 ];		\
+			}												\
+			return g0;", &exitCode ) );
+
+		UTEST_ASSERT( IS_FLOAT64_ARRAY( exitCode ) );
+
+		auto arr = AS_FLOAT64_ARRAY( exitCode )->GetArray();
+		UTEST_ASSERT( arr.size() == 6 );
+		UTEST_ASSERT( arr[ 0 ] == 2.5 );
+		UTEST_ASSERT( arr[ 1 ] == 0.0 );
+		UTEST_ASSERT( arr[ 2 ] == 5.0 );
+		UTEST_ASSERT( arr[ 3 ] == 7.0 );
+		UTEST_ASSERT( arr[ 4 ] == 1.0 );
+		UTEST_ASSERT( arr[ 5 ] == 2.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "var a = [ Float64Array: 2 ]; a( 0 ) = \"x\";", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_array_value" );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "var a = [ Float64Array: 2 ]; return a( 2 );", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_array_index" );
+
+		// Lengths must be whole, non-negative and within bounds
+		const char* invalidLengths[] = { "-1", "2.5", "0 / 0", "1 / 0", "1000000 * 1000000" };
+
+		for ( auto length : invalidLengths )
+		{
+			UTEST_THROW_EXCEPTION( TestUtils::RunVM( std::string( "var a = [ Float64Array: " ) + length + " ];", &exitCode ),
+				const RuntimeException& e, e.id() == "rt_invalid_array_length" );
+		}
+
+		UTEST_ASSERT( TestUtils::RunVM( "var a = [ Float64Array: 0 ]; return [ a.length ];", &exitCode ) );
+		UTEST_ASSERT( AS_NUMBER( exitCode ) == 0.0 );
+
+		// Popping an empty array gives null, packed or not
+		UTEST_ASSERT( TestUtils::RunVM( "Array a = {}; return [ a.pop ];", &exitCode ) );
+		UTEST_ASSERT( IS_NULL( exitCode ) );
+
+		UTEST_ASSERT( TestUtils::RunVM( "var a = [ Float64Array: 0 ]; return [ a.pop ];", &exitCode ) );
+		UTEST_ASSERT( IS_NULL( exitCode ) );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Arrays (STL numeric kernels)" )
+	{
+		QScript::Value exitCode;
+		UTEST_ASSERT( TestUtils::RunVM( "var g0;							\
+			{																\
+				Array a = { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5 };				\
+				var p = [ Float64Array: a ];								\
+				Array r;													\
+				[ r.push: [ a.sum ], [ p.sum ], [ a.min ], [ p.max ] ];		\
+				[ r.push: [ a.indexOf: 9 ], [ p.indexOf: 6 ], [ a.indexOf: 7 ] ];	\
+				[ r.push: [ a.dot: p ] ];									\
+				[ [ p.scale: 2 ].add: 1 ];									\
+				[ a.add: p ];												\
+				[ r.push: [ p.sum ], [ a.sum ], a( 10 ) ];					\
+				[ p.fill: 0.5 ];											\
+				[ r.push: [ p.sum ] ];										\
+				g0 = r;														\
+			}																\
+			return g0;", &exitCode ) );
+
+		UTEST_ASSERT( IS_ARRAY( exitCode ) );
+
+		auto arr = AS_ARRAY( exitCode )->GetArray();
+		UTEST_ASSERT( arr.size() == 12 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 0 ] ) == 44.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 1 ] ) == 44.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 2 ] ) == 1.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 3 ] ) == 9.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 4 ] ) == 5.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 5 ] ) == 7.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 6 ] ) == -1.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 7 ] ) == 232.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 8 ] ) == 99.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 9 ] ) == 143.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 10 ] ) == 16.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 11 ] ) == 5.5 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "Array a = { 1, \"x\" }; return [ a.sum ];", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_native_expected" );
+
+		// Min and max follow the scalar rule whichever kernels run: NaN never replaces the result,
+		// unless it's the first element. Lengths cover a full vector plus a tail.
+		auto sameNumber = []( double a, double b ) { return std::isnan( a ) ? std::isnan( b ) : a == b; };
+
+		for ( size_t count : { 3, 8, 11 } )
+		{
+			for ( size_t nanAt = 0; nanAt < count; ++nanAt )
+			{
+				std::vector< double > values( count, 5.0 );
+				values[ ( nanAt + 1 ) % count ] = 1.0;
+				values[ ( nanAt + 2 ) % count ] = 9.0;
+				values[ nanAt ] = std::nan( "" );
+
+				double min = values[ 0 ], max = values[ 0 ];
+				for ( size_t i = 1; i < count; ++i )
+				{
+					min = values[ i ] < min ? values[ i ] : min;
+					max = values[ i ] > max ? values[ i ] : max;
+				}
+
+				UTEST_ASSERT( sameNumber( ArrayKernels::Min( values.data(), count ), min ) );
+				UTEST_ASSERT( sameNumber( ArrayKernels::Max( values.data(), count ), max ) );
+				UTEST_ASSERT( nanAt == 0 || ( min == 1.0 && max == 9.0 ) );
+			}
+		}
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Arrays (STL map, reduce, forEach, some, every)" )
+	{
+		QScript::Value exitCode;
+		UTEST_ASSERT( TestUtils::RunVM( "var g0;							\
+			{																\
+				Array a = { 1, 2, 3, 4 };									\
+				var p = [ Float64Array: a ];								\
+				Array seen = { 0 };											\
+				Array empty;												\
+				const add = ( s, v ) -> { return s + v; };					\
+				const wrap = ( x ) -> { Array w = { 1 }; [ w.push: x ]; return w; };	\
+				const outer = ( x ) -> {									\
+					return [ [ a.map: ( y ) -> { return x * y; } ].reduce: add ];	\
+				};															\
+				[ a.forEach: seen.push ];									\
+				Array r;													\
+				[ r.push: [ seen.length ], [ [ a.map: outer ].sum ] ];		\
+				[ r.push: [ p.reduce: ( s, v ) -> { return s * v; } ], [ a.reduce: add, 10 ] ];	\
+				[ r.push: [ a.some: ( x ) -> { return x > 3; } ], [ a.every: ( x ) -> { return x > 3; } ] ];	\
+				[ r.push: [ a.find: ( x ) -> { return x > 2; } ] ];			\
+				[ r.push: [ [ p.map: ( x ) -> { return x / 2; } ].sum ] ];	\
+				[ r.push: [ a.map: wrap ], [ empty.reduce: add ] ];			\
+				g0 = r;														\
+			}																\
+			return g0;", &exitCode ) );
+
+		UTEST_ASSERT( IS_ARRAY( exitCode ) );
+
+		auto arr = AS_ARRAY( exitCode )->GetArray();
+		UTEST_ASSERT( arr.size() == 10 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 0 ] ) == 5.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 1 ] ) == 100.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 2 ] ) == 24.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 3 ] ) == 20.0 );
+		UTEST_ASSERT( IS_BOOL( arr[ 4 ] ) && AS_BOOL( arr[ 4 ] ) == true );
+		UTEST_ASSERT( IS_BOOL( arr[ 5 ] ) && AS_BOOL( arr[ 5 ] ) == false );
+		UTEST_ASSERT( AS_NUMBER( arr[ 6 ] ) == 3.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 7 ] ) == 5.0 );
+		UTEST_ASSERT( IS_ARRAY( arr[ 8 ] ) && AS_ARRAY( arr[ 8 ] )->GetArray().size() == 4 );
+
+		auto wrapped = AS_ARRAY( arr[ 8 ] )->GetArray()[ 3 ];
+		UTEST_ASSERT( IS_ARRAY( wrapped ) && AS_ARRAY( wrapped )->GetArray().size() == 2 );
+		UTEST_ASSERT( AS_NUMBER( AS_ARRAY( wrapped )->GetArray()[ 1 ] ) == 4.0 );
+		UTEST_ASSERT( IS_NULL( arr[ 9 ] ) );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "var p = [ Float64Array: 2 ]; return [ p.map: ( x ) -> { return \"x\"; } ];", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_array_value" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Arrays (STL parallelMap, parallelFilter, parallelReduce)" )
+	{
+		QScript::Value exitCode;
+		UTEST_ASSERT( TestUtils::RunVM( "var g0;							\
+			{																\
+				var p = [ Float64Array: 5000 ];								\
+				for ( num i = 0; i < 5000; ++i ) {							\
+					p( i ) = i;												\
+				}															\
+				Array empty;												\
+				var a = [ empty.concat: p ];								\
+				const square = ( x ) -> { return x * x; };					\
+				const add = ( s, v ) -> { return s + v; };					\
+				const label = ( x ) -> { var s = \"l\"; if ( x > 2500 ) s = \"h\"; return s + \"i\"; };	\
+				num offset = 1;												\
+				const impure = ( x ) -> { return x + offset; };				\
+				Array r;													\
+				[ r.push: [ [ p.parallelMap: square ].sum ], [ [ a.map: square ].sum ] ];	\
+				[ r.push: [ a.parallelReduce: add ], [ p.parallelReduce: add, 100 ] ];	\
+				var labels = [ a.parallelMap: label ];						\
+				[ r.push: labels( 0 ), labels( 4999 ) ];					\
+				[ r.push: [ [ a.parallelMap: impure ].sum ] ];				\
+				[ p.parallelFilter: ( x ) -> { return x % 5 == 0; } ];		\
+				[ r.push: [ p.length ], p( 1 ) ];							\
+				g0 = r;														\
+			}																\
+			return g0;", &exitCode ) );
+
+		UTEST_ASSERT( IS_ARRAY( exitCode ) );
+
+		auto arr = AS_ARRAY( exitCode )->GetArray();
+		UTEST_ASSERT( arr.size() == 9 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 0 ] ) == 41654167500.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 1 ] ) == 41654167500.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 2 ] ) == 12497500.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 3 ] ) == 12497600.0 );
+		UTEST_ASSERT( IS_STRING( arr[ 4 ] ) && AS_STRING( arr[ 4 ] )->GetString() == "li" );
+		UTEST_ASSERT( IS_STRING( arr[ 5 ] ) && AS_STRING( arr[ 5 ] )->GetString() == "hi" );
+		UTEST_ASSERT( AS_NUMBER( arr[ 6 ] ) == 12502500.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 7 ] ) == 1000.0 );
+		UTEST_ASSERT( AS_NUMBER( arr[ 8 ] ) == 5.0 );
+
+		TestUtils::FreeExitCode( exitCode );
+
+		UTEST_THROW_EXCEPTION( TestUtils::RunVM( "var p = [ Float64Array: 5000 ];	\
+			return [ p.parallelMap: ( x ) -> { return -\"x\"; } ];", &exitCode ),
+			const RuntimeException& e, e.id() == "rt_invalid_operand_type" );
+
+		// Superinstructions are checked part by part, fused stores outside the callback are impure
+		const uint8_t fusedLocalStore[ 4 ] = { QScript::OpCode::OP_LOAD_LOCAL_1, QScript::OpCode::OP_LOAD_1, QScript::OpCode::OP_ADD, QScript::OpCode::OP_STORE_LOCAL_1 };
+		UTEST_ASSERT( ArrayModule::IsPureSuperinstruction( fusedLocalStore ) );
+
+		const uint8_t impureParts[] = { QScript::OpCode::OP_SET_GLOBAL_SHORT, QScript::OpCode::OP_SET_UPVALUE_SHORT, QScript::OpCode::OP_SET_PROP_SHORT, QScript::OpCode::OP_CALL_1 };
+
+		for ( auto part : impureParts )
+		{
+			const uint8_t fusedStore[ 4 ] = { QScript::OpCode::OP_LOAD_LOCAL_0, QScript::OpCode::OP_LOAD_1, QScript::OpCode::OP_ADD, part };
+			UTEST_ASSERT( !ArrayModule::IsPureOpCode( part ) );
+			UTEST_ASSERT( !ArrayModule::IsPureSuperinstruction( fusedStore ) );
+		}
+
+		// The shipped set only fuses local code, so fused callbacks still run in parallel
+		for ( int opCode = QScript::OpCode::OP_SUPERINSTRUCTION_FIRST; opCode < QScript::OpCode::OP_OPCODE_COUNT; ++opCode )
+			UTEST_ASSERT( ArrayModule::IsPureOpCode( ( uint8_t ) opCode ) );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
 	//UTEST_CASE( "Arrays (STL Find)" )
 	//{
 	//	QScript::Value exitCode;
@@ -1586,5 +2281,199 @@ bool Tests::TestInterpreter()
 		UTEST_CASE_CLOSED();
 	}( );
 
+	UTEST_CASE( "Isolates (32 VMs on 32 threads)" )
+	{
+		static const int s_NumIsolates = 32;
+
+		std::vector< double > results( s_NumIsolates, 0.0 );
+		std::vector< int > succeeded( s_NumIsolates, 0 );
+		std::vector< std::thread > threads;
+
+		// Every thread compiles and runs its own script, with enough allocations to trigger GC
+		for ( int i = 0; i < s_NumIsolates; ++i )
+		{
+			threads.emplace_back( [ i, &results, &succeeded ]() {
+				try
+				{
+					QScript::Value exitCode;
+					bool isValid = TestUtils::RunVM( "Array a;				\
+						for ( num i = 0; i < 2000; ++i ) {					\
+							[ a.push: i + " + std::to_string( i ) + " ];	\
+						}													\
+						const wrap = ( x ) -> { Array w = { 0 }; [ w.push: x ]; return w; };	\
+						var wrapped = [ a.map: wrap ];						\
+						num total = 0;										\
+						for ( num i = 0; i < [ wrapped.length ]; ++i ) {	\
+							var w = wrapped( i );							\
+							total += w( 1 );								\
+						}													\
+						return total;", &exitCode );
+
+					succeeded[ i ] = isValid && IS_NUMBER( exitCode ) ? 1 : 0;
+					results[ i ] = succeeded[ i ] ? AS_NUMBER( exitCode ) : 0.0;
+
+					TestUtils::FreeExitCode( exitCode );
+				}
+				catch ( ... )
+				{
+				}
+			} );
+		}
+
+		for ( auto& thread : threads )
+			thread.join();
+
+		for ( int i = 0; i < s_NumIsolates; ++i )
+		{
+			UTEST_ASSERT( succeeded[ i ] );
+			UTEST_ASSERT( results[ i ] == 1999000.0 + 2000.0 * i );
+		}
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Bytecode files (save, map and run)" )
+	{
+		static const char* s_Path = "qs_test_bytecode.qsc";
+
+		auto fn = QScript::Compile( "const fib = ( n ) -> {			\
+				if ( n < 2 ) { return n; }							\
+				return [ fib: n - 1 ] + [ fib: n - 2 ];				\
+			};														\
+			const greet = ( name ) -> { return \"hello \" + name; };	\
+			return [ greet: \"qsc\" ] + [ fib: 15 ];" );
+
+		QScript::SaveBytecode( *fn, s_Path );
+		QScript::FreeFunction( fn );
+
+		auto loaded = QScript::LoadBytecode( s_Path );
+
+		// Code is used straight from the mapped file
+		UTEST_ASSERT( loaded->GetChunk()->m_Code.IsMapped() );
+		UTEST_ASSERT( loaded->GetChunk()->m_Debug.size() > 0 );
+
+		VM_t vm( loaded );
+
+		QScript::Value exitCode;
+		QScript::Interpret( vm, &exitCode );
+
+		UTEST_ASSERT( IS_STRING( exitCode ) );
+		UTEST_ASSERT( AS_STRING( exitCode )->GetString() == "hello qsc610.00" );
+
+		vm.Release();
+		QScript::FreeFunction( loaded );
+
+		// Files of a different superinstruction set are rejected, the set follows the header
+		{
+			std::fstream file( s_Path, std::ios::binary | std::ios::in | std::ios::out );
+			file.seekg( 32 );
+			char set = ( char ) file.get();
+			file.seekp( 32 );
+			file.put( ( char ) ~set );
+		}
+
+		UTEST_THROW_EXCEPTION( QScript::LoadBytecode( s_Path ),
+			const Exception& e,
+			e.id() == "bytecode_invalid" );
+
+		// Truncated files are rejected
+		{
+			std::ofstream truncated( s_Path, std::ios::binary | std::ios::trunc );
+			truncated << "QSC1";
+		}
+
+		UTEST_THROW_EXCEPTION( QScript::LoadBytecode( s_Path ),
+			const Exception& e,
+			e.id() == "bytecode_invalid" );
+
+		std::remove( s_Path );
+
+		UTEST_THROW_EXCEPTION( QScript::LoadBytecode( s_Path ),
+			const Exception& e,
+			e.id() == "bytecode_no_file" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
+	UTEST_CASE( "Snapshots (create, load and call)" )
+	{
+		auto fn = QScript::Compile( "Table config = {				\
+				const scale = 3;									\
+				const label = \"total\";							\
+			};														\
+			Array squares;											\
+			for ( num i = 0; i < 100; ++i ) {						\
+				[ squares.push: i * i ];							\
+			}														\
+			var packed = [ Float64Array: 4 ];						\
+			[ packed.fill: 2 ];										\
+			const makeCounter = ( start ) -> {						\
+				var n = start;										\
+				return () -> { n = n + 1; return n; };				\
+			};														\
+			var next = [ makeCounter: 10 ];							\
+			const handle = ( x ) -> {								\
+				return [ squares.sum ] * config.scale + [ packed.sum ] + x;	\
+			};														\
+			const describe = ( x ) -> {								\
+				Array garbage;										\
+				for ( num i = 0; i < 200; ++i ) {					\
+					[ garbage.push: config.label + i ];				\
+				}													\
+				return config.label + x;							\
+			};														\
+			Class Point = {											\
+				num x = 0;											\
+				num y = 0;											\
+				LengthSq() -> num { return this.x * this.x + this.y * this.y; };	\
+			};														\
+			var origin = [Point: 3, 4];								\
+			const measure = () -> { return [origin.LengthSq] + [Point: 1].x; };" );
+
+		auto snapshot = QScript::CreateSnapshot( *fn );
+		QScript::FreeFunction( fn );
+
+		UTEST_ASSERT( !snapshot.empty() );
+
+		// Two VMs from the same snapshot share no state
+		auto first = QScript::LoadSnapshot( snapshot );
+		auto second = QScript::LoadSnapshot( snapshot );
+
+		UTEST_ASSERT( AS_NUMBER( QScript::CallFunction( *first, "next", {} ) ) == 11.0 );
+		UTEST_ASSERT( AS_NUMBER( QScript::CallFunction( *first, "next", {} ) ) == 12.0 );
+		UTEST_ASSERT( AS_NUMBER( QScript::CallFunction( *second, "next", {} ) ) == 11.0 );
+
+		UTEST_ASSERT( AS_NUMBER( QScript::CallFunction( *first, "handle", { MAKE_NUMBER( 1 ) } ) ) == 328350.0 * 3 + 8 + 1 );
+
+		auto description = QScript::CallFunction( *second, "describe", { MAKE_NUMBER( 5 ) } );
+		UTEST_ASSERT( IS_STRING( description ) );
+		UTEST_ASSERT( AS_STRING( description )->GetString() == "total5.00" );
+
+		UTEST_ASSERT( AS_NUMBER( QScript::CallFunction( *second, "measure", {} ) ) == 26.0 );
+
+		// Natives are resolved by name against the loading VM's modules
+		UTEST_ASSERT( IS_NATIVE( first->m_Globals[ "Float64Array" ] ) );
+		UTEST_ASSERT( AS_NATIVE( first->m_Globals[ "Float64Array" ] )->GetNative() == first->m_Natives[ "Float64Array" ] );
+		UTEST_ASSERT( first->m_ArrayMethods.find( "fill" ) != first->m_ArrayMethods.end() );
+
+		UTEST_THROW_EXCEPTION( QScript::CallFunction( *first, "missing", {} ),
+			const RuntimeException& e,
+			e.id() == "rt_unknown_global" );
+
+		UTEST_ASSERT( first->m_StackTop - first->m_Stack == 1 );
+		UTEST_ASSERT( second->m_StackTop - second->m_Stack == 1 );
+
+		QScript::FreeSnapshot( first );
+		QScript::FreeSnapshot( second );
+
+		// Corrupted snapshots are rejected
+		auto truncated = std::vector< uint8_t >( snapshot.begin(), snapshot.begin() + snapshot.size() / 2 );
+		UTEST_THROW_EXCEPTION( QScript::LoadSnapshot( truncated ),
+			const Exception& e,
+			e.id() == "snapshot_invalid" );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
 	UTEST_END();
 }
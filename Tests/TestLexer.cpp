@@ -245,5 +245,34 @@ bool Tests::TestLexer()
 		UTEST_CASE_CLOSED();
 	}( );
 
+	UTEST_CASE( "Whitespace and line tracking" )
+	{
+		// Tabs and carriage returns separate words, keywords are recognized before newlines
+		auto tokens = Lexer( "const\tx = 1.5;\r\nreturn\nx; /* multi\nline */ \"a\nb\" 2" );
+
+		UTEST_ASSERT( tokens.size() == 10 );
+		UTEST_ASSERT( tokens[ 0 ].m_Id == TOK_CONST );
+		UTEST_ASSERT( tokens[ 1 ].m_Id == TOK_NAME );
+		UTEST_ASSERT( tokens[ 1 ].m_String == "x" );
+		UTEST_ASSERT( tokens[ 1 ].m_ColNr == 6 );
+		UTEST_ASSERT( tokens[ 3 ].m_Id == TOK_DBL );
+		UTEST_ASSERT( tokens[ 3 ].m_String == "1.5" );
+		UTEST_ASSERT( tokens[ 4 ].m_Id == TOK_SCOLON );
+		UTEST_ASSERT( tokens[ 4 ].m_ColNr == 13 );
+		UTEST_ASSERT( tokens[ 5 ].m_Id == TOK_RETURN );
+		UTEST_ASSERT( tokens[ 5 ].m_LineNr == 2 );
+		UTEST_ASSERT( tokens[ 6 ].m_Id == TOK_NAME );
+		UTEST_ASSERT( tokens[ 6 ].m_LineNr == 3 );
+		UTEST_ASSERT( tokens[ 8 ].m_Id == TOK_STR );
+		UTEST_ASSERT( tokens[ 8 ].m_String == "a\nb" );
+		UTEST_ASSERT( tokens[ 8 ].m_LineNr == 4 );
+		UTEST_ASSERT( tokens[ 8 ].m_ColNr == 8 );
+		UTEST_ASSERT( tokens[ 9 ].m_Id == TOK_INT );
+		UTEST_ASSERT( tokens[ 9 ].m_LineNr == 5 );
+		UTEST_ASSERT( tokens[ 9 ].m_ColNr == 3 );
+
+		UTEST_CASE_CLOSED();
+	}( );
+
 	UTEST_END();
 }
@@ -1,5 +1,6 @@
 #include "QLibPCH.h"
 #include "Tests.h"
+#include "Benchmarks.h"
 
 #if defined(_WIN32) || defined(_WIN64)
 #define WIN32_LEAN_AND_MEAN
@@ -21,6 +22,12 @@ int main( int argc, const char** argv )
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
 #endif
 
+	if ( argc > 1 && std::string( argv[ 1 ] ) == "--bench" )
+	{
+		Benchmarks::BenchInterpreter();
+		return 0;
+	}
+
 	{
 		bool allPassed = true;
 		std::vector< bool > testResults;
@@ -2,6 +2,7 @@
 #include "Utils.h"
 
 #include "../Library/Common/Chunk.h"
+#include "../Library/Common/Disassembler.h"
 #include "../Library/Common/Value.h"
 #include "../Library/Runtime/QVM.h"
 #include "../Library/Compiler/Compiler.h"
@@ -17,12 +18,9 @@ QScript::Object* DeepCopyObject( const QScript::Object* object )
 		auto oldClosure = ( ( QScript::ClosureObject* )( object ) );
 		auto newFunctionObject = ( QScript::FunctionObject* ) DeepCopyObject( oldClosure->GetFunction() );
 
-		std::vector< QScript::UpvalueObject* > upvalueList;
-		for ( auto upvalue : oldClosure->GetUpvalues() )
-			upvalueList.push_back( ( QScript::UpvalueObject* ) DeepCopyObject( upvalue ) );
-
-		auto newClosureObject = QS_NEW QScript::ClosureObject( newFunctionObject );
-		newClosureObject->GetUpvalues() = upvalueList;
+		auto newClosureObject = QScript::ClosureObject::Create( newFunctionObject );
+		for ( int i = 0; i < oldClosure->NumUpvalues(); ++i )
+			newClosureObject->GetUpvalues()[ i ] = ( QScript::UpvalueObject* ) DeepCopyObject( oldClosure->GetUpvalues()[ i ] );
 
 		return newClosureObject;
 	}
@@ -76,6 +74,14 @@ QScript::Object* DeepCopyObject( const QScript::Object* object )
 
 		return newArray;
 	}
+	case QScript::ObjectType::OT_FLOAT64_ARRAY:
+	{
+		auto oldArray = ( ( QScript::Float64ArrayObject* )( object ) );
+		auto newArray = QS_NEW QScript::Float64ArrayObject( oldArray->GetName() );
+
+		newArray->GetArray() = oldArray->GetArray();
+		return newArray;
+	}
 	case QScript::ObjectType::OT_NATIVE:
 		throw Exception( "test_objcpy_invalid_target", "Invalid target object: Native" );
 	default:
@@ -147,14 +153,24 @@ std::string TestUtils::GenerateSequence( int length, std::function< std::string(
 	return output + last;
 }
 
-bool TestUtils::RunVM( const std::string& code, QScript::Value* exitCode )
+bool TestUtils::RunVM( const std::string& code, QScript::Value* exitCode, const QScript::Config_t& config )
 {
-	auto fn = QScript::Compile( code );
+	auto fn = QScript::Compile( code, config );
 
-	VM_t vm( fn );
+	VM_t vm( fn, config );
 
 	QScript::Value vmExitCode;
-	QScript::Interpret( vm, &vmExitCode );
+
+	try
+	{
+		QScript::Interpret( vm, &vmExitCode );
+	}
+	catch ( ... )
+	{
+		vm.Release();
+		QScript::FreeFunction( fn );
+		throw;
+	}
 
 	// Pop (function, <main>)
 	vm.Pop();
@@ -176,3 +192,22 @@ bool TestUtils::CheckVM( VM_t& vm )
 
 	return true;
 }
+
+bool TestUtils::ForEachOpCode( QScript::FunctionObject* function, std::function< void( uint8_t opCode ) > fn )
+{
+	auto& code = function->GetChunk()->m_Code;
+
+	size_t offset = 0;
+	for ( ; offset < code.size(); offset += Disassembler::InstructionSize( code[ offset ] ) )
+		fn( code[ offset ] );
+
+	bool complete = ( offset == code.size() );
+
+	for ( auto constant : function->GetChunk()->m_Constants )
+	{
+		if ( IS_FUNCTION( constant ) )
+			complete = ForEachOpCode( AS_FUNCTION( constant ), fn ) && complete;
+	}
+
+	return complete;
+}
@@ -2,12 +2,21 @@
 
 struct VM_t;
 
+namespace QScript
+{
+	class FunctionObject;
+}
+
 namespace TestUtils
 {
 	std::string GenerateSequence( int length, std::function< std::string( int iteration ) > iterFn,
 		const std::string& first = "", const std::string& last = "" );
 
 	bool CheckVM( VM_t& vm );
-	bool RunVM( const std::string& code, QScript::Value* exitCode );
+	bool RunVM( const std::string& code, QScript::Value* exitCode, const QScript::Config_t& config = QScript::Config_t( true ) );
 	bool FreeExitCode( QScript::Value& value );
+
+	// Visit every opcode of a function and of the functions in its constants. False if the
+	// instructions of a chunk don't end where its code does.
+	bool ForEachOpCode( QScript::FunctionObject* function, std::function< void( uint8_t opCode ) > fn );
 }